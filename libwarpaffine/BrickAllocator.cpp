@@ -8,6 +8,8 @@
 #include <sstream>
 #include <utility>
 #include <limits>
+#include <vector>
+#include <algorithm>
 
 #include "appcontext.h"
 
@@ -71,10 +73,7 @@ std::shared_ptr<void> BrickAllocator::Allocate(MemoryType type, size_t size, boo
                     this->MemoryFreed(size);
                     this->array_allocated_size_[static_cast<size_t>(type)].fetch_sub(size);
                     free(vp);
-                    if (type == MemoryType::DestinationBrick)
-                    {
-                        this->RaiseDestinationBrickMemoryReleased();
-                    }
+                    this->MemoryReleased();
                 }
             });
 
@@ -102,6 +101,194 @@ std::shared_ptr<void> BrickAllocator::Allocate(MemoryType type, size_t size, boo
     return memory;
 }
 
+std::shared_ptr<void> BrickAllocator::RegisterExternalMemory(MemoryType type, size_t size)
+{
+    this->array_allocated_size_[static_cast<size_t>(type)].fetch_add(size);
+    this->MemoryAllocated(size);
+
+    // the object returned is only a token - the pointer is not used for anything, it only has to be non-null
+    return shared_ptr<void>(
+        static_cast<void*>(this),
+        [this, size, type](void*)
+        {
+            this->MemoryFreed(size);
+            this->array_allocated_size_[static_cast<size_t>(type)].fetch_sub(size);
+            this->MemoryReleased();
+        });
+}
+
+std::shared_ptr<void> BrickAllocator::AllocateWaitIfNecessary(MemoryType type, size_t size)
+{
+    for (;;)
+    {
+        auto memory = this->Allocate(type, size, false);
+        if (memory)
+        {
+            return memory;
+        }
+
+        // we are only woken up if enough memory for this request is available (and not whenever some memory is
+        //  released) - the allocation may still fail if another thread was quicker, in which case we wait again
+        this->state_changed_notifier_.Wait(
+            [this, type, size]()->bool
+            {
+                return this->CanAllocate(type, size);
+            });
+    }
+}
+
+void BrickAllocator::WaitUntil(const std::function<bool()>& predicate)
+{
+    this->state_changed_notifier_.Wait(predicate);
+}
+
+void BrickAllocator::NotifyStateChanged()
+{
+    this->state_changed_notifier_.Notify();
+}
+
+std::shared_ptr<void> BrickAllocator::TryAllocateInOrder(MemoryType type, size_t size, const AdmissionFunctor& admission, std::shared_ptr<void>* admission_token)
+{
+    if (this->wait_queue_length_.load() > 0)
+    {
+        // there are requests waiting already, so we do not allow this request to overtake them
+        return nullptr;
+    }
+
+    // we are not holding any lock here, so a token which has to be given back can be released right away
+    return this->TryGrant(type, size, admission, admission_token, nullptr);
+}
+
+void BrickAllocator::EnqueueAllocationRequest(MemoryType type, size_t size, const AdmissionFunctor& admission, const RequestGrantedFunctor& on_granted)
+{
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_wait_queue_);
+        this->wait_queue_.push_back(AllocationRequest{ type, size, admission, on_granted, chrono::steady_clock::now() });
+        ++this->wait_queue_length_;
+    }
+
+    // memory may have been released before the request was enqueued, so we have to check the queue now
+    this->ServiceAllocationWaitQueue();
+}
+
+void BrickAllocator::ServiceAllocationWaitQueue()
+{
+    if (this->wait_queue_length_.load() == 0)
+    {
+        return;
+    }
+
+    struct GrantedRequest
+    {
+        RequestGrantedFunctor on_granted;
+        shared_ptr<void> memory;
+        shared_ptr<void> admission_token;
+    };
+
+    vector<GrantedRequest> granted_requests;
+    shared_ptr<void> token_to_release;
+
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_wait_queue_);
+        while (!this->wait_queue_.empty())
+        {
+            const auto& request = this->wait_queue_.front();
+            shared_ptr<void> admission_token;
+            auto memory = this->TryGrant(request.type, request.size, request.admission, &admission_token, &token_to_release);
+            if (!memory)
+            {
+                // the request at the head of the queue cannot be granted, so we are done here (in FIFO order)
+                break;
+            }
+
+            const auto wait_time = chrono::steady_clock::now() - request.time_enqueued;
+            ++this->requests_granted_after_waiting_;
+            this->total_wait_time_ += wait_time;
+            this->max_wait_time_ = (std::max)(this->max_wait_time_, wait_time);
+
+            granted_requests.push_back(GrantedRequest{ request.on_granted, std::move(memory), std::move(admission_token) });
+            this->wait_queue_.pop_front();
+            --this->wait_queue_length_;
+        }
+    }
+
+    // Releasing a token (or running the 'on_granted'-functor) may lead to this method being called again, so
+    //  this must happen without holding the lock.
+    token_to_release.reset();
+    for (auto& granted_request : granted_requests)
+    {
+        granted_request.on_granted(std::move(granted_request.memory), std::move(granted_request.admission_token));
+    }
+}
+
+BrickAllocator::WaitQueueStatistics BrickAllocator::GetWaitQueueStatistics()
+{
+    WaitQueueStatistics statistics;
+    std::lock_guard<std::mutex> lck(this->mutex_wait_queue_);
+    statistics.queue_length = static_cast<uint32_t>(this->wait_queue_.size());
+    statistics.requests_granted_after_waiting = this->requests_granted_after_waiting_;
+    if (this->requests_granted_after_waiting_ > 0)
+    {
+        statistics.average_wait_time_in_seconds = chrono::duration<double>(this->total_wait_time_).count() / static_cast<double>(this->requests_granted_after_waiting_);
+    }
+
+    statistics.max_wait_time_in_seconds = chrono::duration<double>(this->max_wait_time_).count();
+    return statistics;
+}
+
+std::shared_ptr<void> BrickAllocator::TryGrant(MemoryType type, size_t size, const AdmissionFunctor& admission, std::shared_ptr<void>* admission_token, std::shared_ptr<void>* token_to_release)
+{
+    // We first check (without side-effects) whether the memory is available, then ask for admission (which has no
+    //  side-effects if it fails). Only if the allocation fails nevertheless (because memory was allocated on a different
+    //  thread in the meantime), we have to give back the token - and giving it back must not result in the same
+    //  situation over and over again, which is ensured by checking the memory first.
+    if (!this->CanAllocate(type, size))
+    {
+        return nullptr;
+    }
+
+    shared_ptr<void> token;
+    if (admission)
+    {
+        token = admission();
+        if (!token)
+        {
+            return nullptr;
+        }
+    }
+
+    auto memory = this->Allocate(type, size, false);
+    if (!memory)
+    {
+        if (token_to_release != nullptr)
+        {
+            *token_to_release = std::move(token);
+        }
+
+        return nullptr;
+    }
+
+    if (admission_token != nullptr)
+    {
+        *admission_token = std::move(token);
+    }
+
+    return memory;
+}
+
+void BrickAllocator::MemoryReleased()
+{
+    this->state_changed_notifier_.Notify();
+    this->ServiceAllocationWaitQueue();
+}
+
+bool BrickAllocator::CanAllocate(MemoryType type, size_t size)
+{
+    return
+        CastToIn64ThrowIfTooLarge(this->GetTotalAllocatedMemory() + size) < this->max_memory_ &&
+        this->array_allocated_size_[static_cast<size_t>(type)].load() + size < this->array_max_memory_for_types_[static_cast<size_t>(type)];
+}
+
 bool BrickAllocator::CanAllocateAndIfSuccessfulAddToAllocatedSize(MemoryType type, size_t size)
 {
     if (CastToIn64ThrowIfTooLarge(this->GetTotalAllocatedMemory() + size) < this->max_memory_)
@@ -167,6 +354,12 @@ std::int64_t BrickAllocator::GetTotalAllocatedMemory()
         return "DestinationBrick";
     case MemoryType::CompressedDestinationSlice:
         return "CompressedDestinationSlice";
+    case MemoryType::CompressedSourceSubblock:
+        return "CompressedSourceSubblock";
+    case MemoryType::DecodedSourcePlane:
+        return "DecodedSourcePlane";
+    case MemoryType::CompressionScratchBuffer:
+        return "CompressionScratchBuffer";
     }
 
     return "Invalid";
@@ -12,6 +12,9 @@
 #include <mutex>
 #include <array>
 #include <limits>
+#include <chrono>
+#include <deque>
+#include "utilities.h"
 
 class AppContext;
 
@@ -24,12 +27,39 @@ public:
         DestinationBrick,
         CompressedDestinationSlice,
 
+        /// Compressed subblocks (read from the source document), which are allocated by libCZI and only registered here.
+        CompressedSourceSubblock,
+
+        /// Decoded planes (of the source document), which are allocated by libCZI and only registered here.
+        DecodedSourcePlane,
+
+        /// Temporary buffers used during the compression of a slice (which are released when the compression is done).
+        CompressionScratchBuffer,
+
         Max
     }; 
 
     static constexpr size_t Count_of_MemoryTypes = static_cast<size_t>(MemoryType::Max);
 
     static const char* MemoryTypeToInformalString(MemoryType memory_type);
+
+    /// Statistics about the allocation wait-queue.
+    struct WaitQueueStatistics
+    {
+        std::uint32_t queue_length{ 0 };                    ///< The number of allocation requests currently waiting.
+        std::uint64_t requests_granted_after_waiting{ 0 };  ///< The number of requests which had to wait and have been granted.
+        double average_wait_time_in_seconds{ 0 };           ///< The average time a request was waiting (for the requests granted so far).
+        double max_wait_time_in_seconds{ 0 };               ///< The maximum time a request was waiting.
+    };
+
+    /// A functor which is called before a queued request is granted - it must return a non-null token for the
+    /// request to be granted (e.g. credits acquired from the flow-control), and null if the request cannot be
+    /// admitted at this point. In the latter case it must not have any side-effects.
+    typedef std::function<std::shared_ptr<void>()> AdmissionFunctor;
+
+    /// A functor which is called when a queued request has been granted, passing in the allocated memory and the token
+    /// obtained from the admission-functor.
+    typedef std::function<void(std::shared_ptr<void> memory, std::shared_ptr<void> admission_token)> RequestGrantedFunctor;
 private:
     AppContext& context_;
     std::atomic_int32_t next_functor_handle_;
@@ -45,16 +75,31 @@ private:
     std::array<std::atomic_uint64_t, Count_of_MemoryTypes> array_allocated_size_;
     std::array<std::uint64_t, Count_of_MemoryTypes> array_max_memory_for_types_;
 
-    std::function<void()> func_for_released;
+    /// This notifier is signalled whenever memory is released (or NotifyStateChanged is called).
+    ConditionNotifier state_changed_notifier_;
+
+    struct AllocationRequest
+    {
+        MemoryType type;
+        size_t size;
+        AdmissionFunctor admission;
+        RequestGrantedFunctor on_granted;
+        std::chrono::steady_clock::time_point time_enqueued;
+    };
+
+    /// The mutex protecting the wait-queue and the wait-statistics.
+    std::mutex mutex_wait_queue_;
+    std::deque<AllocationRequest> wait_queue_;
+
+    /// The length of the wait-queue, which allows for a quick check whether there are requests waiting (without taking the lock).
+    std::atomic_uint32_t wait_queue_length_{ 0 };
+    std::uint64_t requests_granted_after_waiting_{ 0 };
+    std::chrono::steady_clock::duration total_wait_time_{ 0 };
+    std::chrono::steady_clock::duration max_wait_time_{ 0 };
 public:
     BrickAllocator() = delete;
     explicit BrickAllocator(AppContext& context);
 
-    void AddDestinationBrickMemoryReleasedCallback(const std::function<void()>& func)
-    {
-        this->func_for_released = func;
-    }
-
     /// Sets the high watermark - if the amount of allocated memory is crossing this number, then
     /// the high-watermark-crossed-callback will be raised.
     /// \param  high_water_mark The high watermark (in bytes).
@@ -86,6 +131,72 @@ public:
     /// \returns    A std::shared_ptr&lt;void&gt; object representing the newly allocated memory.
     std::shared_ptr<void> Allocate(MemoryType type, size_t size, bool must_succeed = true);
 
+    /// Registers memory which has been allocated elsewhere (e.g. by libCZI) with the bookkeeping of this object, so
+    /// that it is accounted for with respect to the high-watermark. The registration is in effect for as long as the
+    /// returned object is alive. Note that the registration always succeeds, i.e. the limits are not enforced here -
+    /// the amount of external memory is to be bounded by the caller (i.e. by the budgets of the flow-control).
+    ///
+    /// \param  type    The type of the memory.
+    /// \param  size    The size in bytes.
+    ///
+    /// \returns    An object representing the registration - when it is destroyed, the memory is unregistered.
+    std::shared_ptr<void> RegisterExternalMemory(MemoryType type, size_t size);
+
+    /// Allocates the specified amount of memory - if this is not possible at this point (because the limits
+    /// would be exceeded), then the call blocks until enough memory has been released, and tries again.
+    ///
+    /// \param  type    The type of the memory requested.
+    /// \param  size    The size in bytes.
+    ///
+    /// \returns    A std::shared_ptr&lt;void&gt; object representing the newly allocated memory.
+    std::shared_ptr<void> AllocateWaitIfNecessary(MemoryType type, size_t size);
+
+    /// Blocks until the specified predicate is true. The predicate is evaluated initially, and then whenever
+    /// memory is released or NotifyStateChanged is called. This is intended for implementing back-pressure, i.e.
+    /// for waiting until a throttling condition is lifted. The predicate must not allocate or release memory.
+    ///
+    /// \param  predicate   The predicate.
+    void WaitUntil(const std::function<bool()>& predicate);
+
+    /// Wakes up the threads blocked in WaitUntil whose predicate is now true. This is to be called when state
+    /// relevant for throttling (other than the memory allocated) has changed.
+    void NotifyStateChanged();
+
+    /// Attempts to allocate the specified amount of memory, where the request is subject to the admission-functor. If
+    /// there are requests waiting in the wait-queue, then this call fails (so that a new request cannot overtake
+    /// the requests which are already waiting). If this call fails, the request is to be queued with
+    /// 'EnqueueAllocationRequest'.
+    ///
+    /// \param          type            The type of the memory requested.
+    /// \param          size            The size in bytes.
+    /// \param          admission       The admission-functor (may be null, in which case no admission is required).
+    /// \param [out]    admission_token If successful, the token obtained from the admission-functor is put here.
+    ///
+    /// \returns    If successful, the newly allocated memory; null otherwise.
+    std::shared_ptr<void> TryAllocateInOrder(MemoryType type, size_t size, const AdmissionFunctor& admission, std::shared_ptr<void>* admission_token);
+
+    /// Adds an allocation request to the wait-queue. The requests in the wait-queue are granted in FIFO order - the
+    /// request at the head of the queue is granted as soon as the memory is available and the admission-functor
+    /// gives its consent, and the requests behind it are only considered after it has been granted (so that large
+    /// requests are not starved by smaller ones). The 'on_granted' functor is called exactly once, either from within
+    /// this call or later from an arbitrary thread (typically the one releasing memory). Only the request which can
+    /// actually be satisfied is signalled, so that there is no "thundering herd" of waiters competing for the memory.
+    ///
+    /// \param  type        The type of the memory requested.
+    /// \param  size        The size in bytes.
+    /// \param  admission   The admission-functor (may be null, in which case no admission is required).
+    /// \param  on_granted  The functor to be called when the request has been granted.
+    void EnqueueAllocationRequest(MemoryType type, size_t size, const AdmissionFunctor& admission, const RequestGrantedFunctor& on_granted);
+
+    /// Tries to grant the requests in the wait-queue. This is done automatically when memory is released, and it
+    /// is to be called when state relevant for the admission-functors has changed.
+    void ServiceAllocationWaitQueue();
+
+    /// Gets statistics about the allocation wait-queue.
+    ///
+    /// \returns    The wait-queue statistics.
+    WaitQueueStatistics GetWaitQueueStatistics();
+
     void GetState(std::array<std::uint64_t, Count_of_MemoryTypes>& allocation_state);
 private:
     void MemoryFreed(size_t size) { this->MemoryChange(-static_cast<std::int64_t>(size)); }
@@ -95,12 +206,7 @@ private:
     std::int64_t GetTotalAllocatedMemory();
     static std::int64_t CastToIn64ThrowIfTooLarge(std::uint64_t value);
     bool CanAllocateAndIfSuccessfulAddToAllocatedSize(MemoryType type, size_t size);
-
-    void RaiseDestinationBrickMemoryReleased()
-    {
-        if (this->func_for_released)
-        {
-            this->func_for_released();
-        }
-    }
+    bool CanAllocate(MemoryType type, size_t size);
+    std::shared_ptr<void> TryGrant(MemoryType type, size_t size, const AdmissionFunctor& admission, std::shared_ptr<void>* admission_token, std::shared_ptr<void>* token_to_release);
+    void MemoryReleased();
 };
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "adaptive_compression_level.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+/*static*/const char* AdaptiveCompressionLevel::kPropertyBagKey_adaptive_level = "adaptive_level";
+/*static*/const char* AdaptiveCompressionLevel::kPropertyBagKey_min_level = "min_level";
+/*static*/const char* AdaptiveCompressionLevel::kPropertyBagKey_max_level = "max_level";
+
+AdaptiveCompressionLevel::AdaptiveCompressionLevel(int min_level, int max_level, int initial_level, std::uint32_t number_of_worker_threads, std::chrono::steady_clock::duration evaluation_interval)
+    : min_level_(min_level),
+    max_level_(max_level),
+    number_of_worker_threads_(max(number_of_worker_threads, 1u)),
+    evaluation_interval_(evaluation_interval),
+    level_(clamp(initial_level, min_level, max(min_level, max_level)))
+{
+    if (max_level < min_level)
+    {
+        throw invalid_argument("The maximal compression level must not be less than the minimal compression level.");
+    }
+
+    this->time_of_last_evaluation_ = chrono::steady_clock::now();
+}
+
+void AdaptiveCompressionLevel::AddCompressionResult(std::uint64_t uncompressed_size, std::uint64_t compressed_size)
+{
+    this->uncompressed_size_at_current_level_ += uncompressed_size;
+    this->compressed_size_at_current_level_ += compressed_size;
+}
+
+bool AdaptiveCompressionLevel::TryUpdate(const PipelineState& state, std::chrono::steady_clock::time_point now, double* compression_ratio)
+{
+    std::unique_lock<std::mutex> lck(this->mutex_update_, std::try_to_lock);
+    if (!lck.owns_lock() || now - this->time_of_last_evaluation_ < this->evaluation_interval_)
+    {
+        return false;
+    }
+
+    this->time_of_last_evaluation_ = now;
+
+    const uint64_t compressed_size = this->compressed_size_at_current_level_.load();
+    const double ratio = compressed_size > 0 ?
+        static_cast<double>(this->uncompressed_size_at_current_level_.load()) / compressed_size :
+        numeric_limits<double>::quiet_NaN();
+
+    const Verdict verdict = AdaptiveCompressionLevel::DetermineVerdict(state, this->previous_write_slices_queue_size_, ratio, this->number_of_worker_threads_);
+    this->previous_write_slices_queue_size_ = state.write_slices_queue_size;
+
+    // we only act if the same verdict was given on the previous evaluation as well (in order to not react on short spikes)
+    const bool act = verdict != Verdict::kBalanced && verdict == this->previous_verdict_;
+    this->previous_verdict_ = verdict;
+    if (!act)
+    {
+        return false;
+    }
+
+    const int level = this->level_.load();
+    const int new_level = clamp(verdict == Verdict::kIoBound ? level + 1 : level - 1, this->min_level_, this->max_level_);
+    if (new_level == level)
+    {
+        return false;
+    }
+
+    this->level_.store(new_level);
+    ++this->number_of_level_changes_;
+    this->uncompressed_size_at_current_level_.store(0);
+    this->compressed_size_at_current_level_.store(0);
+    this->previous_verdict_ = Verdict::kBalanced;
+    if (compression_ratio != nullptr)
+    {
+        *compression_ratio = ratio;
+    }
+
+    return true;
+}
+
+/*static*/AdaptiveCompressionLevel::Verdict AdaptiveCompressionLevel::DetermineVerdict(const PipelineState& state, std::uint64_t previous_write_slices_queue_size, double compression_ratio, std::uint32_t number_of_worker_threads)
+{
+    // The writer's queue is bounded by the budget of the write-stage (in bytes) - it is considered "long" if it fills
+    //  at least half of the budget, and "short" if it fills less than an eighth of it. For the compression tasks,
+    //  "piling up" means more than two tasks per worker thread.
+    const uint64_t long_write_queue = state.write_budget / 2;
+    const uint64_t short_write_queue = state.write_budget / 8;
+    const uint32_t compression_backlog = 2 * number_of_worker_threads;
+
+    if (state.write_slices_queue_size > 0 &&
+        state.write_slices_queue_size >= long_write_queue &&
+        state.write_slices_queue_size >= previous_write_slices_queue_size)
+    {
+        // a higher level only pays off if the data is compressible at all
+        if (!isnan(compression_ratio) && compression_ratio >= kMinimalCompressionRatioForIncreasingLevel)
+        {
+            return Verdict::kIoBound;
+        }
+
+        return Verdict::kBalanced;
+    }
+
+    if (state.compression_tasks_in_flight >= compression_backlog &&
+        state.write_slices_queue_size <= short_write_queue)
+    {
+        return Verdict::kCpuBound;
+    }
+
+    return Verdict::kBalanced;
+}
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/// This class implements the "adaptive compression level" mode - where the zstd-level is adjusted (within given bounds)
+/// during the operation, depending on the state of the pipeline:
+/// - if the writer's queue is filling its budget (i.e. the budget of the write-stage) and is growing, then we are I/O-bound,
+///   and the level is increased (since we can afford to spend more CPU on the compression) - provided that the data is
+///   compressible at all (i.e. the compression ratio observed at the current level is above a threshold)
+/// - if compression tasks are piling up (and the writer's queue is nearly empty), then we are CPU-bound, and the level
+///   is decreased
+/// Note that the level used for a slice depends on the timing of the operation - so the compressed data (and a hash
+/// calculated from it) is not reproducible in this mode.
+/// A change of the level is only made if the same condition has been observed on two consecutive evaluations, and
+/// the evaluations are done at most once per "evaluation interval".
+class AdaptiveCompressionLevel
+{
+public:
+    /// The state of the pipeline which is used to determine the compression level.
+    struct PipelineState
+    {
+        std::uint64_t write_slices_queue_size{ 0 };     ///< The size (in bytes) of the slices in the writer's queue.
+        std::uint64_t write_budget{ 0 };                ///< The budget (in bytes) of the write-stage, which bounds the writer's queue.
+        std::uint32_t compression_tasks_in_flight{ 0 }; ///< The number of compression tasks (queued or executing).
+    };
+
+    /// Values that represent the outcome of an evaluation.
+    enum class Verdict
+    {
+        kBalanced,  ///< Neither I/O-bound nor CPU-bound (or the data is not compressible), the level is not changed.
+        kIoBound,   ///< The writer is the bottleneck, the level should be increased.
+        kCpuBound   ///< The compression is the bottleneck, the level should be decreased.
+    };
+
+    /// This key for the "compression property bag" enables the "adaptive compression level" mode (which is only applicable
+    /// for zstd-compression). The type is "boolean", the default is "false".
+    static const char* kPropertyBagKey_adaptive_level;
+
+    /// This key for the "compression property bag" gives the minimal zstd-level in the "adaptive compression level" mode.
+    /// The type is "int32", the default is "1".
+    static const char* kPropertyBagKey_min_level;
+
+    /// This key for the "compression property bag" gives the maximal zstd-level in the "adaptive compression level" mode.
+    /// The type is "int32", the default is "9".
+    static const char* kPropertyBagKey_max_level;
+
+    /// The minimal compression ratio (uncompressed size / compressed size) at the current level for the level to be increased.
+    static constexpr double kMinimalCompressionRatioForIncreasingLevel = 1.1;
+
+    /// Constructor.
+    ///
+    /// \param  min_level                   The minimal compression level.
+    /// \param  max_level                   The maximal compression level.
+    /// \param  initial_level               The initial compression level (which is clamped to the bounds).
+    /// \param  number_of_worker_threads    The number of worker threads of the task arena (used to scale the threshold for the compression tasks).
+    /// \param  evaluation_interval         The minimal time between two evaluations.
+    AdaptiveCompressionLevel(int min_level, int max_level, int initial_level, std::uint32_t number_of_worker_threads, std::chrono::steady_clock::duration evaluation_interval);
+
+    /// Gets the current compression level.
+    ///
+    /// \returns The current compression level.
+    int GetLevel() const { return this->level_.load(); }
+
+    /// Gets the minimal compression level.
+    ///
+    /// \returns The minimal compression level.
+    int GetMinLevel() const { return this->min_level_; }
+
+    /// Gets the maximal compression level.
+    ///
+    /// \returns The maximal compression level.
+    int GetMaxLevel() const { return this->max_level_; }
+
+    /// Gets the number of times the compression level has been changed.
+    ///
+    /// \returns The number of level changes.
+    std::uint32_t GetNumberOfLevelChanges() const { return this->number_of_level_changes_.load(); }
+
+    /// Reports the result of a compression (done at the current level). This method may be called concurrently.
+    ///
+    /// \param  uncompressed_size   The size of the uncompressed data in bytes.
+    /// \param  compressed_size     The size of the compressed data in bytes.
+    void AddCompressionResult(std::uint64_t uncompressed_size, std::uint64_t compressed_size);
+
+    /// Evaluates the state of the pipeline and adjusts the compression level if appropriate. If the last evaluation
+    /// was less than the evaluation interval ago (or an evaluation is executing concurrently), then nothing is done.
+    /// This method may be called concurrently.
+    ///
+    /// \param          state               The state of the pipeline.
+    /// \param          now                 The current time.
+    /// \param [out]    compression_ratio   If non-null and the level was changed, the compression ratio observed at the previous level is put here.
+    ///
+    /// \returns True if the level was changed; false otherwise.
+    bool TryUpdate(const PipelineState& state, std::chrono::steady_clock::time_point now, double* compression_ratio);
+
+    /// Determines the verdict for the specified state of the pipeline.
+    ///
+    /// \param  state                           The state of the pipeline.
+    /// \param  previous_write_slices_queue_size The size of the writer's queue at the previous evaluation.
+    /// \param  compression_ratio               The compression ratio observed at the current level (or NaN if not known).
+    /// \param  number_of_worker_threads        The number of worker threads.
+    ///
+    /// \returns The verdict.
+    static Verdict DetermineVerdict(const PipelineState& state, std::uint64_t previous_write_slices_queue_size, double compression_ratio, std::uint32_t number_of_worker_threads);
+private:
+    const int min_level_;
+    const int max_level_;
+    const std::uint32_t number_of_worker_threads_;
+    const std::chrono::steady_clock::duration evaluation_interval_;
+
+    std::atomic_int level_;
+    std::atomic_uint32_t number_of_level_changes_{ 0 };
+    std::atomic_uint64_t uncompressed_size_at_current_level_{ 0 };
+    std::atomic_uint64_t compressed_size_at_current_level_{ 0 };
+
+    std::mutex mutex_update_;   ///< Protects the following members (and serializes the evaluations).
+    std::chrono::steady_clock::time_point time_of_last_evaluation_;
+    std::uint64_t previous_write_slices_queue_size_{ 0 };
+    Verdict previous_verdict_{ Verdict::kBalanced };
+};
@@ -40,6 +40,9 @@ bool AppContext::Initialize(int argc, char** argv)
         case TaskArenaImplementation::kTBB:
             this->task_arena_ = CreateTaskArenaTbb(*this);
             break;
+        case TaskArenaImplementation::kStd:
+            this->task_arena_ = CreateTaskArenaStd(*this);
+            break;
         default:
             this->log_->WriteLineStdErr("Unknown task-arena implementation encountered -> exiting");
             throw runtime_error("unknown task-arena implementation");
@@ -77,6 +80,11 @@ BrickAllocator& AppContext::GetAllocator()
     return this->allocator_;
 }
 
+FlowControl& AppContext::GetFlowControl()
+{
+    return this->flow_control_;
+}
+
 void AppContext::FatalError(const std::string& message)
 {
 #if LIBWARPAFFINE_WIN32_ENVIRONMENT
@@ -8,6 +8,7 @@
 #include "consoleio.h"
 #include "taskarena/ITaskArena.h"
 #include "BrickAllocator.h"
+#include "flow_control.h"
 #include <locale>
 #include <memory>
 #include <string>
@@ -21,6 +22,7 @@ private:
     std::shared_ptr<ILog> log_;
     std::shared_ptr<ITaskArena> task_arena_;
     BrickAllocator allocator_;
+    FlowControl flow_control_;
     std::locale formatting_locale_;
 public:
     AppContext();
@@ -41,6 +43,7 @@ public:
     const std::shared_ptr<ITaskArena>& GetTaskArena();
     const CCmdLineOptions& GetCommandLineOptions() const;
     BrickAllocator& GetAllocator();
+    FlowControl& GetFlowControl();
     void FatalError(const std::string& message);
     void WriteDebugString(const char* message);
     const std::locale& GetFormattingLocale() const;
@@ -10,19 +10,26 @@
 using namespace std;
 using namespace libCZI;
 
-std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream)
+std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
 {
-    return make_shared<CziBrickReader>(context, reader, stream);
+    return make_shared<CziBrickReader>(context, reader, stream, document_analysis);
 }
 
-std::shared_ptr<ICziBrickReader> CreateBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream)
+void PrepareDocumentAnalysisForLinearReading(AppContext& context, DocumentAnalysis& document_analysis)
 {
-    return make_shared<CziBrickReaderLinearReading>(context, reader, stream);
+    CziBrickReaderLinearReading::PrepareDocumentAnalysis(context, document_analysis);
 }
 
-std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader2(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream)
+std::shared_ptr<ICziBrickReader> CreateBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
 {
-    return make_shared<CziBrickReader2>(context, reader, stream);
+    return make_shared<CziBrickReaderLinearReading>(context, reader, stream, document_analysis);
+}
+
+std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader2(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
+{
+    return make_shared<CziBrickReader2>(context, reader, stream, document_analysis);
 }
 
 /*static*/const char* ICziBrickReader::kPropertyBagKey_LinearReader_max_number_of_subblocks_to_wait_for = "max_number_of_subblocks_to_wait_for";
+/*static*/const char* ICziBrickReader::kPropertyBagKey_LinearReader_defer_decompression = "defer_decompression";
+/*static*/const char* ICziBrickReader::kPropertyBagKey_PlaneReader2_brick_order = "brick_order";
@@ -5,10 +5,12 @@
 #pragma once
 
 #include <memory>
+#include <chrono>
 #include "../inc_libCZI.h"
 #include "../mmstream/IStreamEx.h"
 #include "../appcontext.h"
 #include "../brick.h"
+#include "../document_analysis.h"
 
 /// This structure gathers the statistics information provided by the brick-reader.
 struct BrickReaderStatistics
@@ -62,6 +64,11 @@ public:
     /// Wait until done - this method will block until the operation is finished.
     virtual void WaitUntilDone() = 0;
 
+    /// Wait until done or until the specified timeout has elapsed - whatever comes first.
+    /// \param timeout The timeout.
+    /// \returns True if operation is finished, false if the timeout elapsed.
+    virtual bool WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout) = 0;
+
     /// Sets the reader object to "paused state". If paused the reader will not acquire additional resources (esp. memory), and
     /// it will not deliver any additional bricks. Note that the 'paused state' will not be entered immediately, so after
     /// return from this call, it is very well possible that the reader will still deliver some additional bricks.
@@ -88,8 +95,22 @@ public:
     /// and gives the suggested limit for "max number of subblocks-in-flight-before-a-brick-is-finished".
     /// The type is "int32".
     static const char* kPropertyBagKey_LinearReader_max_number_of_subblocks_to_wait_for;  
+
+    /// This key for the "brick source property bag" is used by the "linear-reading" implementation,
+    /// and instructs to keep the subblocks compressed until the brick they belong to is complete (instead
+    /// of decoding them immediately after reading). The type is "boolean", the default is "false".
+    static const char* kPropertyBagKey_LinearReader_defer_decompression;
+
+    /// This key for the "brick source property bag" is used by the "planereader2" implementation,
+    /// and selects the order in which the bricks are read. The type is "string", possible values are
+    /// "natural" (first C, then T, then the tile - which is the default) and "file_offset" (in ascending
+    /// order of the file position of the subblocks).
+    static const char* kPropertyBagKey_PlaneReader2_brick_order;
 };
 
-std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream);
-std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader2(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream);
-std::shared_ptr<ICziBrickReader> CreateBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream);
+std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis);
+std::shared_ptr<ICziBrickReader> CreateBrickReaderPlaneReader2(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis);
+/// Prepares the document analysis for use with the "linear reading" brick-reader - this must be called (before the
+/// analysis is shared) for an analysis which is then passed to CreateBrickReaderLinearReading.
+void PrepareDocumentAnalysisForLinearReading(AppContext& context, DocumentAnalysis& document_analysis);
+std::shared_ptr<ICziBrickReader> CreateBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis);
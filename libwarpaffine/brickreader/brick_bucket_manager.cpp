@@ -6,8 +6,11 @@
 #include <utility>
 #include <limits>
 #include <memory>
+#include <cstring>
+#include <vector>
 #include "../BrickAllocator.h"
 #include "../utilities.h"
+#include "../czi_helpers.h"
 
 using namespace std;
 
@@ -18,27 +21,24 @@ BrickBucketManager::BrickBucketManager(std::function<void(const std::shared_ptr<
 {
 }
 
-void BrickBucketManager::Setup(std::uint32_t t_count, std::uint32_t c_count, const std::function<int(int t, int c)>& functor_get_number_of_slices)
+void BrickBucketManager::Setup(const std::map<BrickCoordinate, std::uint32_t>& number_of_slices_per_brick)
 {
-    for (int t = 0; t < t_count; ++t)
+    for (const auto& item : number_of_slices_per_brick)
     {
-        for (int c = 0; c < c_count; ++c)
-        {
-            BucketData* bucket_data = new BucketData(functor_get_number_of_slices(t, c));
-            this->brickcoordinate_buckets_map_.insert({ BrickCoordinate{ t, c }, bucket_data });
-        }
+        BucketData* bucket_data = new BucketData(item.second);
+        this->brickcoordinate_buckets_map_.insert({ item.first, bucket_data });
     }
 }
 
 void BrickBucketManager::AddSlice(const SliceInfo& slice_info)
 {
-    BrickCoordinate brick_coordinate(slice_info.t_coordinate, slice_info.c_coordinate);
+    const BrickCoordinate brick_coordinate(slice_info.t_coordinate, slice_info.c_coordinate, slice_info.s_coordinate, slice_info.m_index);
 
     auto& value = this->brickcoordinate_buckets_map_.at(brick_coordinate);
 
-    if (this->AddToBrick(value, slice_info.x_position, slice_info.y_position, slice_info.z_coordinate, slice_info.bitmap))
+    if (this->AddToBrick(value, slice_info.x_position, slice_info.y_position, slice_info.z_coordinate, slice_info.bitmap, slice_info.subblock, slice_info.memory_registration))
     {
-        const auto brick_result_on_slice_info = make_shared<BrickResultOnSliceInfo>(brick_coordinate.t, brick_coordinate.c, value);
+        const auto brick_result_on_slice_info = make_shared<BrickResultOnSliceInfo>(brick_coordinate, value);
 
         // Now we set the "value" in the map to null - the object is now owned by the "brick_result_on_slice_info"-object.
         // Important is that we do not do any write-access to the map itself, so we leave the key itself in the map (instead
@@ -50,7 +50,7 @@ void BrickBucketManager::AddSlice(const SliceInfo& slice_info)
     }
 }
 
-bool BrickBucketManager::AddToBrick(BucketData* bucket_data, int x, int y, int z_coordinate, std::shared_ptr<libCZI::IBitmapData> bitmap)
+bool BrickBucketManager::AddToBrick(BucketData* bucket_data, int x, int y, int z_coordinate, std::shared_ptr<libCZI::IBitmapData> bitmap, std::shared_ptr<libCZI::ISubBlock> subblock, std::shared_ptr<void> memory_registration)
 {
     // we atomically increment the "next_index"-field - so that (even when executing concurrently)
     //  the plane is inserted into an empty slot
@@ -58,7 +58,7 @@ bool BrickBucketManager::AddToBrick(BucketData* bucket_data, int x, int y, int z
 
     // put the plane into its own slot - note that there is a guarantee of a particular
     //  order (of the planes)
-    bucket_data->items->at(index_to_use) = PlaneAndIndexZ{ std::move(bitmap), x, y, z_coordinate };
+    bucket_data->items->at(index_to_use) = PlaneAndIndexZ{ std::move(bitmap), std::move(subblock), std::move(memory_registration), x, y, z_coordinate };
 
     // This is now important - *after* we placed the data, we increment the "number_of_planes_ready"-counter (atomically),
     //  and only if we did the last increment (i.e. if the number here is the expected number), then we report that we are
@@ -67,10 +67,9 @@ bool BrickBucketManager::AddToBrick(BucketData* bucket_data, int x, int y, int z
 }
 
 // ---------------------------------------------------------------------------------------------
-BrickBucketManager::BrickResultOnSliceInfo::BrickResultOnSliceInfo(int t_coordinate, int c_coordinate, BrickBucketManager::BucketData* bucket_data) :
+BrickBucketManager::BrickResultOnSliceInfo::BrickResultOnSliceInfo(const BrickCoordinate& brick_coordinate, BrickBucketManager::BucketData* bucket_data) :
     bucket_data_(bucket_data),
-    t_coordinate_(t_coordinate),
-    c_coordinate_(c_coordinate)
+    brick_coordinate_(brick_coordinate)
 {
 }
 
@@ -79,9 +78,11 @@ BrickBucketManager::BrickResultOnSliceInfo::BrickResultOnSliceInfo(int t_coordin
     switch (dimension)
     {
     case libCZI::DimensionIndex::T:
-        return this->t_coordinate_;
+        return this->brick_coordinate_.t;
     case libCZI::DimensionIndex::C:
-        return this->c_coordinate_;
+        return this->brick_coordinate_.c;
+    case libCZI::DimensionIndex::S:
+        return this->brick_coordinate_.s;
     }
 
     return (numeric_limits<int>::min)();
@@ -93,6 +94,18 @@ BrickBucketManager::BrickResultOnSliceInfo::BrickResultOnSliceInfo(int t_coordin
 }
 
 /*virtual*/Brick BrickBucketManager::BrickResultOnSliceInfo::ComposeBrick(libCZI::PixelType pixel_type, int x, int y, uint32_t width, uint32_t height, uint32_t depth, BrickAllocator& allocator, bool immediately_release_source_memory)
+{
+    Brick brick = this->AllocateBrick(pixel_type, width, height, depth, allocator);
+
+    for (uint32_t slice_no = 0; slice_no < static_cast<uint32_t>(this->bucket_data_->items->size()); ++slice_no)
+    {
+        this->ComposeSlice(slice_no, x, y, brick, immediately_release_source_memory);
+    }
+
+    return brick;
+}
+
+/*virtual*/Brick BrickBucketManager::BrickResultOnSliceInfo::AllocateBrick(libCZI::PixelType pixel_type, uint32_t width, uint32_t height, uint32_t depth, BrickAllocator& allocator)
 {
     Brick brick;
     brick.info.pixelType = pixel_type;
@@ -103,41 +116,72 @@ BrickBucketManager::BrickResultOnSliceInfo::BrickResultOnSliceInfo(int t_coordin
     brick.info.stride_plane = brick.info.stride_line * brick.info.height;
     brick.data = allocator.Allocate(BrickAllocator::MemoryType::SourceBrick, static_cast<size_t>(brick.info.stride_plane) * brick.info.depth);
 
-    memset(brick.data.get(), 0, static_cast<size_t>(brick.info.stride_plane) * brick.info.depth);
-    // TODO(JBL): maybe only clear slices which are missing
-
-    for (auto iterator = this->bucket_data_->items->begin(); iterator != this->bucket_data_->items->end(); ++iterator)
+    // A plane for which we have a slice is completely written by ComposeSlice (the area not covered by the
+    //  bitmap is cleared there), so we only have to clear the planes for which there is no slice.
+    vector<bool> is_plane_covered(depth, false);
+    for (const auto& item : *this->bucket_data_->items)
     {
-        const int z_coordinate = iterator->z_coordinate;
-        libCZI::IBitmapData* bitmap = iterator->plane.get();
+        if (item.z_coordinate >= 0 && static_cast<uint32_t>(item.z_coordinate) < depth)
+        {
+            is_plane_covered[item.z_coordinate] = true;
+        }
+    }
 
+    for (uint32_t z = 0; z < depth; ++z)
+    {
+        if (!is_plane_covered[z])
         {
-            // note: the locking-object for the bitmap must be destroyed *before* we delete the bitmap itself,
-            //        so this local scope must not be removed
-            const libCZI::ScopedBitmapLocker bitmap_locker(bitmap);
-            Utilities::CopyBitmapAtOffsetAndClearNonCoveredArea(
-            {
-                iterator->x_position - x,
-                iterator->y_position - y,
-                bitmap->GetPixelType(),
-                bitmap_locker.ptrDataRoi,
-                bitmap_locker.stride,
-                static_cast<int>(bitmap->GetWidth()),
-                static_cast<int>(bitmap->GetHeight()),
-                static_cast<uint8_t*>(brick.data.get()) + static_cast<size_t>(z_coordinate) * brick.info.stride_plane,
-                brick.info.stride_line,
-                static_cast<int>(brick.info.width),
-                static_cast<int>(brick.info.height)
-            });
+            memset(static_cast<uint8_t*>(brick.data.get()) + static_cast<size_t>(z) * brick.info.stride_plane, 0, brick.info.stride_plane);
         }
+    }
+
+    return brick;
+}
 
+/*virtual*/void BrickBucketManager::BrickResultOnSliceInfo::ComposeSlice(uint32_t slice_no, int x, int y, const Brick& brick, bool immediately_release_source_memory)
+{
+    auto& item = this->bucket_data_->items->at(slice_no);
+    const int z_coordinate = item.z_coordinate;
+
+    // if the slice was added as a sub-block, then we decode it now
+    shared_ptr<libCZI::IBitmapData> decoded_plane;
+    if (!item.plane)
+    {
+        decoded_plane = CziHelpers::CreateBitmapFromSubblock(item.subblock);
         if (immediately_release_source_memory)
         {
-            iterator->plane.reset();
+            item.subblock.reset();
+            item.memory_registration.reset();
         }
     }
 
-    return brick;
+    libCZI::IBitmapData* bitmap = item.plane ? item.plane.get() : decoded_plane.get();
+
+    {
+        // note: the locking-object for the bitmap must be destroyed *before* we delete the bitmap itself,
+        //        so this local scope must not be removed
+        const libCZI::ScopedBitmapLocker bitmap_locker(bitmap);
+        Utilities::CopyBitmapAtOffsetAndClearNonCoveredArea(
+        {
+            item.x_position - x,
+            item.y_position - y,
+            bitmap->GetPixelType(),
+            bitmap_locker.ptrDataRoi,
+            bitmap_locker.stride,
+            static_cast<int>(bitmap->GetWidth()),
+            static_cast<int>(bitmap->GetHeight()),
+            static_cast<uint8_t*>(brick.data.get()) + static_cast<size_t>(z_coordinate) * brick.info.stride_plane,
+            brick.info.stride_line,
+            static_cast<int>(brick.info.width),
+            static_cast<int>(brick.info.height)
+        });
+    }
+
+    if (immediately_release_source_memory)
+    {
+        item.plane.reset();
+        item.memory_registration.reset();
+    }
 }
 
 /*virtual*/BrickBucketManager::BrickResultOnSliceInfo::~BrickResultOnSliceInfo()
@@ -26,11 +26,15 @@ public:
     IBrickResult(IBrickResult&&) = delete;
     IBrickResult& operator=(IBrickResult&& other) = delete;
 
-    /// Gets the coordinate of the brick: Currently, only T and C are considered valid here.
+    /// Gets the coordinate of the brick: Currently, only T, C and S are considered valid here.
     /// \param  dimension   The dimension.
     /// \returns    The coordinate.
     [[nodiscard]] virtual int GetCoordinate(libCZI::DimensionIndex dimension) const = 0;
 
+    /// Gets the brick-coordinate (i.e. T, C, scene-index and M-index) of the brick.
+    /// \returns    The brick-coordinate.
+    [[nodiscard]] virtual const BrickCoordinate& GetBrickCoordinate() const = 0;
+
     /// Gets number of slices (with actual data) contained in this brick result.
     /// \returns    The number of slices.
     [[nodiscard]] virtual std::uint32_t GetNumberOfSlices() const = 0;
@@ -58,6 +62,29 @@ public:
     /// \returns    The brick.
     [[nodiscard]] virtual Brick ComposeBrick(libCZI::PixelType pixel_type, int x, int y, std::uint32_t width, std::uint32_t height, std::uint32_t depth, BrickAllocator& allocator, bool immediately_release_source_memory) = 0;
 
+    /// Allocates the output brick (and clears it), but does not copy any slice into it. The slices are then to
+    /// be put into the brick with ComposeSlice. This allows to compose the slices of a brick concurrently.
+    ///
+    /// \param      pixel_type  Type of the pixel.
+    /// \param      width       The width of the output brick in pixels.
+    /// \param      height      The height of the output brick in pixels.
+    /// \param      depth       The depth of the output brick in pixels.
+    /// \param [in] allocator   The allocator object to used for allocating the output-brick.
+    ///
+    /// \returns    The (cleared) brick.
+    [[nodiscard]] virtual Brick AllocateBrick(libCZI::PixelType pixel_type, std::uint32_t width, std::uint32_t height, std::uint32_t depth, BrickAllocator& allocator) = 0;
+
+    /// Copies the specified slice into the brick (which must have been allocated with AllocateBrick). If the slice
+    /// was added as a compressed sub-block, then it is decoded here. This method may be called concurrently for
+    /// different slice numbers.
+    ///
+    /// \param          slice_no                            The number of the slice (which must be less than GetNumberOfSlices).
+    /// \param          x                                   The x coordinate (of the brick in the x-y-plane).
+    /// \param          y                                   The y coordinate (of the brick in the x-y-plane).
+    /// \param [in,out] brick                               The brick.
+    /// \param          immediately_release_source_memory   True to immediately release source memory.
+    virtual void ComposeSlice(std::uint32_t slice_no, int x, int y, const Brick& brick, bool immediately_release_source_memory) = 0;
+
     virtual ~IBrickResult() = default;
 };
 
@@ -70,10 +97,12 @@ class BrickBucketManager
 {
 private:
     /// Representation of a bitmap-on-a-plane. The bitmap is located at the specified x and y position,
-    /// and a z-index.
+    /// and a z-index. Either the plane is given as a bitmap, or as a (not yet decoded) sub-block.
     struct PlaneAndIndexZ
     {
         std::shared_ptr<libCZI::IBitmapData> plane;
+        std::shared_ptr<libCZI::ISubBlock> subblock;
+        std::shared_ptr<void> memory_registration;
         int x_position;
         int y_position;
         int z_coordinate;
@@ -111,16 +140,26 @@ public:
     struct SliceInfo
     {
         /// The bitmap containing the plane. Note that we (for the time being) assume that one plane
-        /// is exactly one bitmap and this bitmap is covering the whole area (i.e. no concept of
-        /// a mosaic and this bitmap is positioned at (0,0)).
+        /// of a brick is exactly one bitmap - in case of a mosaic, a brick is a tile (identified by
+        /// scene-index and M-index), and the bitmap is positioned at (x_position, y_position).
         std::shared_ptr<libCZI::IBitmapData> bitmap;
 
+        /// Alternatively to the bitmap, the (not yet decoded) sub-block can be given here - in which case
+        /// the sub-block is decoded only when the brick is composed. Exactly one of "bitmap" and "subblock" must be non-null.
+        std::shared_ptr<libCZI::ISubBlock> subblock;
+
+        /// The registration of the memory used by the bitmap or the sub-block with the BrickAllocator (obtained with
+        /// BrickAllocator::RegisterExternalMemory) - it is released together with the bitmap or the sub-block.
+        std::shared_ptr<void> memory_registration;
+
         int x_position;       ///< The x offset - the x coordinate where to put this bitmap in the brick.
         int y_position;       ///< The y offset - the y coordinate where to put this bitmap in the brick.
 
         int t_coordinate;   ///< The t coordinate.
         int z_coordinate;   ///< The t coordinate.
         int c_coordinate;   ///< the c coordinate.
+        int s_coordinate{ BrickCoordinate::kNotPresent };   ///< The scene-index (of the tile the bitmap belongs to), or BrickCoordinate::kNotPresent.
+        int m_index{ BrickCoordinate::kNotPresent };        ///< The M-index (of the tile the bitmap belongs to), or BrickCoordinate::kNotPresent.
     };
 
     BrickBucketManager() = delete;
@@ -130,16 +169,14 @@ public:
     /// \param  functor_brick_done  A functor which will be called whenever a brick is finished.
     explicit BrickBucketManager(std::function<void(const std::shared_ptr<IBrickResult>&)> functor_brick_done);
 
-    /// Prepare the instance for operation. The caller needs to specify how many t's and c's are
-    /// expected. In addition, a function is to be provided which is called to query for the number
-    /// of z's making up a brick. This allows to give a different depth for each brick, but this not
+    /// Prepare the instance for operation. The caller needs to specify all bricks which are expected (i.e.
+    /// their brick-coordinate - T, C and in case of a mosaic the scene-index and M-index) and the number of
+    /// slices making up the respective brick. This allows to give a different depth for each brick, but this not
     /// intended to be made us at this point. So far, many parts of the application assume that
     /// the depth of all bricks is the same.
     ///
-    /// \param  t_count                         Number of t's.
-    /// \param  c_count                         Number of c's.
-    /// \param  functor_get_number_of_slices    The functor to get the number of slices (where t and c are passed in).
-    void Setup(std::uint32_t t_count, std::uint32_t c_count, const std::function<int(int t, int c)>& functor_get_number_of_slices);
+    /// \param  number_of_slices_per_brick  The bricks to expect and the number of slices for each of them.
+    void Setup(const std::map<BrickCoordinate, std::uint32_t>& number_of_slices_per_brick);
 
     /// Adds a slice. This method may be called from an arbitrary thread-context and concurrently without restrictions.
     /// \param  slice_info  Information describing the slice.
@@ -154,10 +191,12 @@ private:
     /// \param      x               The x coordinate.
     /// \param      y               The y coordinate.
     /// \param      z_coordinate    The z-index of the plane.
-    /// \param      bitmap          The bitmap (containing the plane).
+    /// \param      bitmap          The bitmap (containing the plane), or null if the sub-block is given.
+    /// \param      subblock        The (not yet decoded) sub-block, or null if the bitmap is given.
+    /// \param      memory_registration The registration of the memory used by the bitmap or the sub-block.
     ///
     /// \returns    True if the brick is complete; otherwise false.
-    bool AddToBrick(BucketData* bucket_data, int x, int y, int z_coordinate, std::shared_ptr<libCZI::IBitmapData> bitmap);
+    bool AddToBrick(BucketData* bucket_data, int x, int y, int z_coordinate, std::shared_ptr<libCZI::IBitmapData> bitmap, std::shared_ptr<libCZI::ISubBlock> subblock, std::shared_ptr<void> memory_registration);
 
     /// This class is implementing the "IBrickResult" based on BucketData.
     /// It is non-copyable and non-movable.
@@ -165,8 +204,7 @@ private:
     {
     private:
         BrickBucketManager::BucketData* bucket_data_;
-        int t_coordinate_;
-        int c_coordinate_;
+        BrickCoordinate brick_coordinate_;
     public:
         BrickResultOnSliceInfo() = delete;
         BrickResultOnSliceInfo(const BrickResultOnSliceInfo&) = delete;
@@ -177,20 +215,28 @@ private:
         /// Constructor which takes a pointer to an BucketData-object. This instance is taking ownership of the
         /// BucketData-object.
         ///
-        /// \param          t_coordinate    The T-coordinate.
-        /// \param          c_coordinate    The C-coordinate.
-        /// \param [in,out] bucket_data     The BucketData-object to operate on. This instance is taking ownership of the object passed in here.
-        BrickResultOnSliceInfo(int t_coordinate, int c_coordinate, BrickBucketManager::BucketData* bucket_data);
+        /// \param          brick_coordinate    The brick-coordinate.
+        /// \param [in,out] bucket_data         The BucketData-object to operate on. This instance is taking ownership of the object passed in here.
+        BrickResultOnSliceInfo(const BrickCoordinate& brick_coordinate, BrickBucketManager::BucketData* bucket_data);
 
         /// @copydoc IBrickResult::GetCoordinate
         int GetCoordinate(libCZI::DimensionIndex dimension) const override;
 
+        /// @copydoc IBrickResult::GetBrickCoordinate
+        const BrickCoordinate& GetBrickCoordinate() const override { return this->brick_coordinate_; }
+
         /// @copydoc IBrickResult::GetNumberOfSlices
         std::uint32_t GetNumberOfSlices() const override;
 
         /// @copydoc IBrickResult::ComposeBrick
         Brick ComposeBrick(libCZI::PixelType pixel_type, int x, int y, std::uint32_t width, std::uint32_t height, std::uint32_t depth, BrickAllocator& allocator, bool immediately_release_source_memory) override;
 
+        /// @copydoc IBrickResult::AllocateBrick
+        Brick AllocateBrick(libCZI::PixelType pixel_type, std::uint32_t width, std::uint32_t height, std::uint32_t depth, BrickAllocator& allocator) override;
+
+        /// @copydoc IBrickResult::ComposeSlice
+        void ComposeSlice(std::uint32_t slice_no, int x, int y, const Brick& brick, bool immediately_release_source_memory) override;
+
         ~BrickResultOnSliceInfo() override;
     };
 };
@@ -4,39 +4,72 @@
 
 #pragma once
 
+#include <cstdint>
+#include <initializer_list>
 #include <limits>
 
 /// This is representing a brick-coordinate, i.e. a scheme in order to uniquely identify a brick
-/// within a document.
+/// within a document. A brick is identified by its T- and C-coordinate, and (in case of a mosaic
+/// document) by the scene-index and the M-index of the tile. For a coordinate which is not applicable,
+/// the value BrickCoordinate::kNotPresent is used.
 struct BrickCoordinate
 {
+    /// The value used for a coordinate which is not present/applicable.
+    static constexpr int kNotPresent = (std::numeric_limits<int>::min)();
+
     int t;
     int c;
+    int s;  ///< The scene-index (or kNotPresent).
+    int m;  ///< The M-index (or kNotPresent).
 
-    BrickCoordinate(int t, int c) :t(t), c(c) {}
-    BrickCoordinate() : t(0), c(0) {}
+    BrickCoordinate(int t, int c, int s, int m) :t(t), c(c), s(s), m(m) {}
+    BrickCoordinate(int t, int c) : BrickCoordinate(t, c, kNotPresent, kNotPresent) {}
+    BrickCoordinate() : BrickCoordinate(0, 0) {}
 
     /// Less-than comparison operator - required to use this struct as a key in a map.
     /// \param  other The object to compare with.
     /// \returns {bool} True if the current object should go before the specified object.
     bool operator<(const BrickCoordinate& other) const
     {
-        // t has highest precedence
-        return this->t < other.t || (this->t == other.t && this->c < other.c);
+        // t has highest precedence, then c, s and m
+        if (this->t != other.t)
+        {
+            return this->t < other.t;
+        }
+
+        if (this->c != other.c)
+        {
+            return this->c < other.c;
+        }
+
+        return this->s < other.s || (this->s == other.s && this->m < other.m);
     }
 
     bool operator==(const BrickCoordinate& other) const
     {
-        return this->t == other.t && this->c == other.c;
+        return this->t == other.t && this->c == other.c && this->s == other.s && this->m == other.m;
     }
 
     bool operator!= (const BrickCoordinate& other) const
     {
-        return this->t != other.t || this->c != other.c;
+        return !(*this == other);
+    }
+
+    /// Gets a hash code for the brick-coordinate (which is e.g. used as "locality key" for the tasks operating on the brick).
+    /// \returns The hash code.
+    std::uint64_t GetHashCode() const
+    {
+        std::uint64_t hash = 17;
+        for (const int value : { this->t, this->c, this->s, this->m })
+        {
+            hash = hash * 31 + static_cast<std::uint32_t>(value);
+        }
+
+        return hash;
     }
 
     void MakeInvalid()
     {
-        this->t = this->c = (std::numeric_limits<int>::min)();
+        this->t = this->c = this->s = this->m = kNotPresent;
     }
 };
@@ -33,12 +33,73 @@ void BrickEnumerator::Reset(std::optional<int> max_t, int max_c, const TileIdent
     this->c_ = 0;
 
     this->tile_number_ = 0;
+
+    this->is_ordered_by_file_offset_ = false;
+    this->ordered_bricks_.clear();
+    this->ordered_brick_number_ = 0;
+}
+
+void BrickEnumerator::ResetOrderedByFileOffset(
+    std::optional<int> max_t,
+    int max_c,
+    const TileIdentifierToRectangleMap& regions,
+    const std::function<std::uint64_t(const libCZI::CDimCoordinate&, const TileIdentifier&)>& get_file_offset_of_brick)
+{
+    this->Reset(max_t, max_c, regions);
+
+    // we enumerate all bricks in the "natural order" (first C, then T, then tile) and then (stable) sort them
+    //  by their file offset - so that for bricks with the same file offset the natural order is retained
+    const int t_count = this->is_t_valid_ ? this->max_t_ : 1;
+    for (size_t tile_number = 0; tile_number < this->tile_identifier_and_rects_.size(); ++tile_number)
+    {
+        for (int t = 0; t < t_count; ++t)
+        {
+            for (int c = 0; c < this->max_c_; ++c)
+            {
+                OrderedBrick ordered_brick;
+                ordered_brick.coordinate.Set(DimensionIndex::C, c);
+                if (this->is_t_valid_)
+                {
+                    ordered_brick.coordinate.Set(DimensionIndex::T, t);
+                }
+
+                ordered_brick.tile_number = tile_number;
+                ordered_brick.file_offset = get_file_offset_of_brick(ordered_brick.coordinate, this->tile_identifier_and_rects_[tile_number].tile_identifier);
+                this->ordered_bricks_.emplace_back(ordered_brick);
+            }
+        }
+    }
+
+    stable_sort(
+        this->ordered_bricks_.begin(),
+        this->ordered_bricks_.end(),
+        [](const OrderedBrick& a, const OrderedBrick& b)->bool
+        {
+            return a.file_offset < b.file_offset;
+        });
+
+    this->is_ordered_by_file_offset_ = true;
 }
 
 bool BrickEnumerator::GetNextBrickCoordinate(libCZI::CDimCoordinate& coordinate, TileIdentifier& tile_identifier, libCZI::IntRect& rectangle)
 {
     std::unique_lock<std::mutex> lck(this->mutex_);
 
+    if (this->is_ordered_by_file_offset_)
+    {
+        if (this->ordered_brick_number_ >= this->ordered_bricks_.size())
+        {
+            return false;
+        }
+
+        const OrderedBrick& ordered_brick = this->ordered_bricks_[this->ordered_brick_number_++];
+        coordinate = ordered_brick.coordinate;
+        const TileIdentifierAndRect& tile_identifier_and_rect = this->tile_identifier_and_rects_[ordered_brick.tile_number];
+        rectangle = tile_identifier_and_rect.rectangle;
+        tile_identifier = tile_identifier_and_rect.tile_identifier;
+        return true;
+    }
+
     // we first increment C, then T, then M
     //
     // reminder: we require C to be valid, T is optional, M is required
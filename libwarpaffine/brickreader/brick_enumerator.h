@@ -4,6 +4,10 @@
 
 #pragma once 
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <vector>
 #include <mutex>
 #include <optional>
@@ -11,9 +15,18 @@
 #include "../czi_helpers.h"
 
 /// This class is used to enumerate all "tiles" in a given range. With the Reset-method, the range is set.
+/// By default, the bricks are enumerated by first incrementing C, then T, then the tile. With the
+/// ResetOrderedByFileOffset-method, the bricks are enumerated in ascending order of their file offset instead.
 class BrickEnumerator
 {
 private:
+    struct OrderedBrick
+    {
+        libCZI::CDimCoordinate coordinate;
+        std::size_t tile_number;
+        std::uint64_t file_offset;
+    };
+
     bool is_t_valid_{ false };
     int t_{ 0 };
     int c_{ 0 };
@@ -21,9 +34,33 @@ private:
     int max_t_{ 0 };
     int max_c_{ 0 };
     std::vector<TileIdentifierAndRect> tile_identifier_and_rects_;
+    bool is_ordered_by_file_offset_{ false };
+    std::vector<OrderedBrick> ordered_bricks_;
+    std::size_t ordered_brick_number_{ 0 };
     std::mutex mutex_;
 public:
+    /// The value to be reported as file offset for a brick which does not contain any subblock - those
+    /// bricks are enumerated last.
+    static constexpr std::uint64_t kFileOffsetNotPresent = (std::numeric_limits<std::uint64_t>::max)();
+
     BrickEnumerator() = default;
     void Reset(std::optional<int> max_t, int max_c, const TileIdentifierToRectangleMap& regions);
+
+    /// Sets the range (in the same way as Reset), but the bricks are then enumerated in ascending order of
+    /// their file offset, where the file offset of a brick is given by the specified functor. The intended
+    /// use is to report the minimal file position of the subblocks making up the brick, so that the source
+    /// document is read (as far as possible) sequentially. Bricks with the same file offset are enumerated
+    /// in the same order as with Reset.
+    ///
+    /// \param  max_t                   The number of T-planes (or nullopt if there is no T-dimension).
+    /// \param  max_c                   The number of channels.
+    /// \param  regions                 The tiles.
+    /// \param  get_file_offset_of_brick Functor which gives the file offset for the specified brick.
+    void ResetOrderedByFileOffset(
+        std::optional<int> max_t,
+        int max_c,
+        const TileIdentifierToRectangleMap& regions,
+        const std::function<std::uint64_t(const libCZI::CDimCoordinate&, const TileIdentifier&)>& get_file_offset_of_brick);
+
     bool GetNextBrickCoordinate(libCZI::CDimCoordinate& coordinate, TileIdentifier& tile_identifier, libCZI::IntRect& rectangle);
 };
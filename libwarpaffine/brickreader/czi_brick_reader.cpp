@@ -68,7 +68,7 @@ public:
 
 // --------------------------------------------------------------------------------------
 
-CziBrickReader::CziBrickReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream) : CziBrickReaderBase(context, reader)
+CziBrickReader::CziBrickReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis) : CziBrickReaderBase(context, reader, document_analysis)
 {
     this->accessor_ = reader->CreateSingleChannelTileAccessor();
     this->input_stream_ = std::move(stream);
@@ -109,10 +109,10 @@ void CziBrickReader::StartPumping(
         throw invalid_argument("The document must have a C-dimension.");
     }
 
-    const auto tile_identifier_and_rect = CziHelpers::DetermineTileIdentifierToRectangleMap(this->GetUnderlyingReader().get());
-    this->brick_enumerator_.Reset(t_count_optional, c_count, tile_identifier_and_rect);
+    this->brick_enumerator_.Reset(t_count_optional, c_count, this->GetSubblockIndex()->GetTileIdentifierToRectangleMap());
 
     this->isDone_.store(false);
+    this->active_reader_threads_.store(kNumberOfReadingThreads);
 
     this->deliver_brick_func_ = deliver_brick_func;
 
@@ -137,6 +137,11 @@ void CziBrickReader::WaitUntilDone()
     this->reader_threads_.clear();
 }
 
+bool CziBrickReader::WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout)
+{
+    return this->done_notifier_.WaitFor([this]()->bool { return this->isDone_.load(); }, timeout);
+}
+
 /// This method is running on a worker-thread, and is responsible for reading a source-brick and
 ///  sending it downstream. Note that this method may run concurrently, so it may execute on
 ///  more than one thread.
@@ -180,7 +185,12 @@ void CziBrickReader::ReadBrick()
             this->statistics_brick_data_delivered_.fetch_add(brick.info.GetBrickDataSize());
         }
 
-        this->isDone_.store(true);
+        // the last reader thread to finish sets the "done"-flag
+        if (this->active_reader_threads_.fetch_sub(1) == 1)
+        {
+            this->isDone_.store(true);
+            this->done_notifier_.Notify();
+        }
     }
     catch (exception& exception)
     {
@@ -242,7 +252,11 @@ Brick CziBrickReader::CreateBrick(const libCZI::CDimCoordinate& coordinate, cons
     brick.info.depth = zCount;
     brick.info.stride_line = Utils::GetBytesPerPixel(brick.info.pixelType) * brick.info.width;
     brick.info.stride_plane = brick.info.stride_line * brick.info.height;
-    brick.data = shared_ptr<void>(malloc(static_cast<size_t>(brick.info.stride_plane) * brick.info.depth), free);
+    const size_t size_of_brick = static_cast<size_t>(brick.info.stride_plane) * brick.info.depth;
+
+    // this blocks until the stages downstream have capacity left
+    auto credits = this->GetContextBase().GetFlowControl().Acquire(FlowControl::Stage::Compose, size_of_brick);
+    brick.data = FlowControl::TieCreditsToData(shared_ptr<void>(malloc(size_of_brick), free), std::move(credits));
 
     return brick;
 }
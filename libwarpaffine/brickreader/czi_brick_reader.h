@@ -18,6 +18,7 @@
 #include "../appcontext.h"
 #include "../brick.h"
 #include "../czi_helpers.h"
+#include "../utilities.h"
 
 /// This is the simplest implementation of a CziBrickReader. The features of this reader are:
 /// - bricks are read in a fixed order    
@@ -34,18 +35,21 @@ private:
     std::shared_ptr<libCZI::ISingleChannelTileAccessor> accessor_;
 
     std::atomic_bool isDone_{ false };
+    std::atomic_int active_reader_threads_{ 0 };
+    ConditionNotifier done_notifier_;
     std::function<void(const Brick&, const BrickCoordinateInfo&)> deliver_brick_func_;
 
     std::atomic_uint64_t statistics_brick_data_delivered_{ 0 };
     std::atomic_uint64_t statistics_bricks_delivered_{ 0 };
     std::atomic_uint64_t statistics_slices_read_{ 0 };
 public:
-    CziBrickReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream);
+    CziBrickReader(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis);
 
     void StartPumping(const std::function<void(const Brick&, const BrickCoordinateInfo&)>& deliver_brick_func) override;
     bool IsDone() override;
     BrickReaderStatistics GetStatus() override;
     void WaitUntilDone() override;
+    bool WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout) override;
     std::shared_ptr<libCZI::ICZIReader>& GetUnderlyingReader() override;
     void SetPauseState(bool pause) override {}
     bool GetIsThrottledState() override { return false; }
@@ -4,16 +4,19 @@
 
 #include "czi_brick_reader2.h"
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 #include <memory>
 #include <limits>
+#include <sstream>
 #include <string>
 
 using namespace std;
 using namespace libCZI;
 
-CziBrickReader2::CziBrickReader2(AppContext& context, const std::shared_ptr<libCZI::ICZIReader>& reader, std::shared_ptr<IStreamEx> stream)
-    : CziBrickReaderBase(context, reader)
+CziBrickReader2::CziBrickReader2(AppContext& context, const std::shared_ptr<libCZI::ICZIReader>& reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
+    : CziBrickReaderBase(context, reader, document_analysis)
 {
     this->input_stream_ = std::move(stream);
 
@@ -39,6 +42,9 @@ CziBrickReader2::CziBrickReader2(AppContext& context, const std::shared_ptr<libC
 void CziBrickReader2::SetPauseState(bool pause)
 {
     this->is_paused_externally_.store(pause);
+
+    // wake up the reader threads waiting for the throttling to be lifted
+    this->GetContextBase().GetFlowControl().NotifyStateChanged();
 }
 
 bool CziBrickReader2::GetIsThrottledState()
@@ -69,14 +75,41 @@ void CziBrickReader2::StartPumping(
         throw invalid_argument("The document must have a C-dimension.");
     }
 
-    const auto tile_identifier_and_rect = CziHelpers::DetermineTileIdentifierToRectangleMap(this->GetUnderlyingReader().get());
-    this->brick_enumerator_.Reset(t_count_optional, c_count, tile_identifier_and_rect);
+    const string brick_order = this->GetContextBase().GetCommandLineOptions().GetPropertyBagForBrickSource().GetStringOrDefault(
+        ICziBrickReader::kPropertyBagKey_PlaneReader2_brick_order,
+        "natural");
+    if (brick_order == "file_offset")
+    {
+        // the bricks are handed out to the reader threads in ascending order of their file offset, so that the
+        //  document is read (as far as possible) sequentially - the throttling in ReadBrick is not affected by this
+        this->is_reading_in_file_offset_order_ = true;
+        this->brick_enumerator_.ResetOrderedByFileOffset(
+            t_count_optional,
+            c_count,
+            this->GetSubblockIndex()->GetTileIdentifierToRectangleMap(),
+            [this](const CDimCoordinate& coordinate, const TileIdentifier& tile_identifier)->uint64_t
+            {
+                return this->GetFileOffsetOfBrick(coordinate, tile_identifier);
+            });
+    }
+    else if (brick_order == "natural")
+    {
+        this->is_reading_in_file_offset_order_ = false;
+        this->brick_enumerator_.Reset(t_count_optional, c_count, this->GetSubblockIndex()->GetTileIdentifierToRectangleMap());
+    }
+    else
+    {
+        ostringstream string_stream;
+        string_stream << "Invalid value \"" << brick_order << "\" for the brick-source parameter '" << ICziBrickReader::kPropertyBagKey_PlaneReader2_brick_order << "'.";
+        throw invalid_argument(string_stream.str());
+    }
 
     this->isDone_.store(false);
 
     this->deliver_brick_func_ = deliver_brick_func;
 
     this->pending_tasks_count_.store(0);
+    this->active_reader_threads_.store(kNumberOfReadingThreads);
 
     for (int i = 0; i < kNumberOfReadingThreads; ++i)
     {
@@ -101,13 +134,33 @@ void CziBrickReader2::ReadBrick()
             this->DoBrick(coordinate_of_brick, tile_identifier, rectangle_of_brick, brick);
         }
 
-        while (this->GetIsThrottledState())
-        {
-            this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+        // we also throttle if the compressed subblocks (waiting to be decoded) or the decoded planes exceed their budget,
+        //  the flow-control wakes us up when credits are returned or the pause-state changes (the back-pressure from
+        //  the stages further downstream is applied when acquiring the credits for the next source brick)
+        auto& flow_control = this->GetContextBase().GetFlowControl();
+        flow_control.WaitUntil(
+            [this, &flow_control]()->bool
+            {
+                return !this->GetIsThrottledState() &&
+                    flow_control.HasCapacity(FlowControl::Stage::Read) &&
+                    flow_control.HasCapacity(FlowControl::Stage::Decode);
+            });
     }
 
-    this->isDone_.store(true);
+    // the last reader thread to finish sets the "done"-flag
+    if (this->active_reader_threads_.fetch_sub(1) == 1)
+    {
+        this->isDone_.store(true);
+        this->done_notifier_.Notify();
+    }
+}
+
+void CziBrickReader2::DecrementPendingTasksCount()
+{
+    if (this->pending_tasks_count_.fetch_sub(1) == 1)
+    {
+        this->done_notifier_.Notify();
+    }
 }
 
 Brick CziBrickReader2::CreateBrick(const libCZI::CDimCoordinate& coordinate, const libCZI::IntRect& rectangle)
@@ -125,31 +178,52 @@ Brick CziBrickReader2::CreateBrick(const libCZI::CDimCoordinate& coordinate, con
     brick.info.depth = zCount;
     brick.info.stride_line = Utils::GetBytesPerPixel(brick.info.pixelType) * brick.info.width;
     brick.info.stride_plane = brick.info.stride_line * brick.info.height;
-    for (;;)
-    {
-        brick.data = this->GetContextBase().GetAllocator().Allocate(
-            BrickAllocator::MemoryType::SourceBrick,
-            static_cast<size_t>(brick.info.stride_plane) * brick.info.depth,
-            false);
-        if (!brick.data)
-        {
-            this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-        else
-        {
-            break;
-        }
-    }
+    const size_t size_of_brick = static_cast<size_t>(brick.info.stride_plane) * brick.info.depth;
+
+    // the credits for the source brick are only granted if the stages downstream have capacity left, so this
+    //  is where the reader is throttled by the back-pressure from the warp-, compression- and write-stage
+    auto credits = this->GetContextBase().GetFlowControl().Acquire(FlowControl::Stage::Compose, size_of_brick);
+    brick.data = FlowControl::TieCreditsToData(
+        this->GetContextBase().GetAllocator().AllocateWaitIfNecessary(BrickAllocator::MemoryType::SourceBrick, size_of_brick),
+        std::move(credits));
 
     return brick;
 }
 
 void CziBrickReader2::DoBrick(const libCZI::CDimCoordinate& coordinate, /*int m_index,*/TileIdentifier tile_identifier, const libCZI::IntRect& rectangle, Brick& brick)
 {
-    map<int, int> map_z_subblockindex = CziHelpers::GetSubblocksForBrick(
-        this->GetUnderlyingReaderBase().get(),
-        coordinate,
-        tile_identifier);
+    const map<int, int> map_z_subblockindex = this->GetSubblockIndex()->GetSubblocksForBrick(coordinate, tile_identifier);
+
+    // the subblocks are read in the order of ascending z, or - if reading in file-offset-order - in the order of
+    //  ascending file position
+    // the planes for which there is a subblock are completely written by CopySubblockIntoBrick (the area not
+    //  covered by the subblock is cleared there), so we only have to clear the planes for which there is no subblock
+    for (uint32_t z = 0; z < brick.info.depth; ++z)
+    {
+        if (map_z_subblockindex.find(static_cast<int>(z)) == map_z_subblockindex.cend())
+        {
+            memset(static_cast<uint8_t*>(brick.data.get()) + static_cast<size_t>(z) * brick.info.stride_plane, 0, brick.info.stride_plane);
+        }
+    }
+
+    vector<int> subblock_indices;
+    subblock_indices.reserve(map_z_subblockindex.size());
+    for (const auto& item : map_z_subblockindex)
+    {
+        subblock_indices.push_back(item.second);
+    }
+
+    if (this->is_reading_in_file_offset_order_)
+    {
+        const auto& subblocks = this->GetDocumentAnalysis()->GetSubblocks();
+        sort(
+            subblock_indices.begin(),
+            subblock_indices.end(),
+            [&subblocks](int a, int b)->bool
+            {
+                return subblocks[a].file_position < subblocks[b].file_position;
+            });
+    }
 
     /*
         ostringstream ss;
@@ -164,10 +238,14 @@ void CziBrickReader2::DoBrick(const libCZI::CDimCoordinate& coordinate, /*int m_
 
     // now, read those subblocks
     map<int, std::shared_ptr<ISubBlock>> map_z_subblock;
-    for (const auto& item : map_z_subblockindex)
+    for (const int subblock_index : subblock_indices)
     {
         BrickDecodeInfo* decode_info = new BrickDecodeInfo();
-        decode_info->subBlock = this->GetUnderlyingReaderBase()->ReadSubBlock(item.second);
+        decode_info->subBlock = this->GetUnderlyingReaderBase()->ReadSubBlock(subblock_index);
+        const auto size_of_subblock = CziHelpers::GetMemorySizeOfSubblock(decode_info->subBlock.get());
+        decode_info->memory_registration = FlowControl::TieCreditsToData(
+            this->GetContextBase().GetAllocator().RegisterExternalMemory(BrickAllocator::MemoryType::CompressedSourceSubblock, size_of_subblock),
+            this->GetContextBase().GetFlowControl().Register(FlowControl::Stage::Read, size_of_subblock));
         ++this->statistics_number_of_compressed_subblocks_in_flight_;
 
         decode_info->brick_output_info = brick_output_data;
@@ -177,9 +255,14 @@ void CziBrickReader2::DoBrick(const libCZI::CDimCoordinate& coordinate, /*int m_
         ++this->pending_tasks_count_;
         this->GetContextBase().GetTaskArena()->AddTask(
             TaskType::BrickComposition,
+            reinterpret_cast<uintptr_t>(brick.data.get()),    // all tasks for this brick are run on the same NUMA-node
             [this, decode_info, coordinate, tile_identifier/*m_index*/, rectangle, brick]()->void
             {
-                const auto bitmap = decode_info->subBlock->CreateBitmap();
+                const auto bitmap = CziHelpers::CreateBitmapFromSubblock(decode_info->subBlock);
+                const size_t size_of_bitmap = static_cast<size_t>(bitmap->GetWidth()) * bitmap->GetHeight() * Utils::GetBytesPerPixel(bitmap->GetPixelType());
+                const auto bitmap_memory_registration = FlowControl::TieCreditsToData(
+                    this->GetContextBase().GetAllocator().RegisterExternalMemory(BrickAllocator::MemoryType::DecodedSourcePlane, size_of_bitmap),
+                    this->GetContextBase().GetFlowControl().Register(FlowControl::Stage::Decode, size_of_bitmap));
                 ++this->statistics_number_of_uncompressed_planes_in_flight_;
 
                 int z;
@@ -224,11 +307,23 @@ void CziBrickReader2::DoBrick(const libCZI::CDimCoordinate& coordinate, /*int m_
 
                 --this->statistics_number_of_compressed_subblocks_in_flight_;
                 --this->statistics_number_of_uncompressed_planes_in_flight_;
-                --this->pending_tasks_count_;
+                this->DecrementPendingTasksCount();
             });
     }
 }
 
+std::uint64_t CziBrickReader2::GetFileOffsetOfBrick(const libCZI::CDimCoordinate& coordinate, const TileIdentifier& tile_identifier) const
+{
+    const auto& subblocks = this->GetDocumentAnalysis()->GetSubblocks();
+    uint64_t file_offset = BrickEnumerator::kFileOffsetNotPresent;
+    for (const auto& item : this->GetSubblockIndex()->GetSubblocksForBrick(coordinate, tile_identifier))
+    {
+        file_offset = min(file_offset, subblocks[item.second].file_position);
+    }
+
+    return file_offset;
+}
+
 void CziBrickReader2::CopySubblockIntoBrick(const libCZI::SubBlockInfo& subblock_info, int z, libCZI::IBitmapData* bitmap, const BrickDecodeInfo* decode_info, const libCZI::IntRect& rectangle)
 {
     const libCZI::ScopedBitmapLocker bitmap_locker(bitmap);
@@ -264,15 +359,12 @@ void CziBrickReader2::WaitUntilDone()
         worker_thread.join();
     }
 
-    for (;;)
-    {
-        if (this->pending_tasks_count_.load() == 0)
-        {
-            break;
-        }
+    this->done_notifier_.Wait([this]()->bool { return this->IsDone(); });
+}
 
-        this_thread::sleep_for(std::chrono::milliseconds(5));
-    }
+bool CziBrickReader2::WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout)
+{
+    return this->done_notifier_.WaitFor([this]()->bool { return this->IsDone(); }, timeout);
 }
 
 BrickReaderStatistics CziBrickReader2::GetStatus()
@@ -8,6 +8,7 @@
 #include <thread>
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 #include "brick_enumerator.h"
 #include "IBrickReader.h"
@@ -16,6 +17,7 @@
 #include "../mmstream/IStreamEx.h"
 #include "../appcontext.h"
 #include "../brick.h"
+#include "../utilities.h"
 
 /// This is an implementation of the ICziBrickReader-interface which features asynchronous
 /// decompression.
@@ -27,6 +29,8 @@ private:
     std::vector<std::thread> reader_threads_;
 
     std::atomic_bool isDone_{ false };
+    std::atomic_int active_reader_threads_{ 0 };
+    ConditionNotifier done_notifier_;
     std::function<void(const Brick&, const BrickCoordinateInfo&)> deliver_brick_func_;
 
     std::atomic_uint64_t statistics_number_of_compressed_subblocks_in_flight_{ 0 };
@@ -37,23 +41,37 @@ private:
 
     std::atomic_uint32_t pending_tasks_count_{ 0 };
 
+    /// True if the bricks (and the subblocks within a brick) are read in ascending order of their file offset.
+    bool is_reading_in_file_offset_order_{ false };
+
     int handle_high_watermark_callback_;
 public:
-    CziBrickReader2(AppContext& context, const std::shared_ptr<libCZI::ICZIReader>& reader, std::shared_ptr<IStreamEx> stream);
+    CziBrickReader2(AppContext& context, const std::shared_ptr<libCZI::ICZIReader>& reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis);
 
     void StartPumping(const std::function<void(const Brick&, const BrickCoordinateInfo&)>& deliver_brick_func) override;
     bool IsDone() override;
     BrickReaderStatistics GetStatus() override;
     std::shared_ptr<libCZI::ICZIReader>& GetUnderlyingReader() override;
     void WaitUntilDone() override;
+    bool WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout) override;
     void SetPauseState(bool pause) override;
     bool GetIsThrottledState() override;
 private:
     BrickEnumerator brick_enumerator_;
     void ReadBrick();
+    void DecrementPendingTasksCount();
     Brick CreateBrick(const libCZI::CDimCoordinate& coordinate, const libCZI::IntRect& rectangle);
     void DoBrick(const libCZI::CDimCoordinate& coordinate, TileIdentifier tile_identifier, const libCZI::IntRect& rectangle, Brick& brick);
 
+    /// Gets the file offset of the specified brick, which is the minimal file position of the subblocks
+    /// making up the brick. If the brick does not contain any subblock, then BrickEnumerator::kFileOffsetNotPresent is returned.
+    ///
+    /// \param  coordinate      The coordinate of the brick.
+    /// \param  tile_identifier The tile identifier of the brick.
+    ///
+    /// \returns    The file offset of the brick.
+    std::uint64_t GetFileOffsetOfBrick(const libCZI::CDimCoordinate& coordinate, const TileIdentifier& tile_identifier) const;
+
     struct BrickOutputInfo
     {
         int max_count;
@@ -64,6 +82,7 @@ private:
     struct BrickDecodeInfo
     {
         std::shared_ptr<libCZI::ISubBlock> subBlock;
+        std::shared_ptr<void> memory_registration;  ///< The registration of the sub-block's memory with the BrickAllocator (and the credits held for it).
         BrickOutputInfo* brick_output_info;
     };
 
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../czi_helpers.h"
+#include "../document_analysis.h"
 #include "../inc_libCZI.h"
 #include "IBrickReader.h"
 #include "../appcontext.h"
@@ -19,15 +20,17 @@ private:
     libCZI::SubBlockStatistics statistics_;
     std::map<int, libCZI::PixelType> map_channelno_to_pixeltype_;
     std::shared_ptr<libCZI::ICZIReader> underlying_reader_;
+    std::shared_ptr<const DocumentAnalysis> document_analysis_;
 public:
     CziBrickReaderBase() = delete;
 
-    CziBrickReaderBase(AppContext& context, const std::shared_ptr<libCZI::ICZIReader>& reader)
+    CziBrickReaderBase(AppContext& context, const std::shared_ptr<libCZI::ICZIReader>& reader, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
         : context_(context)
     {
-        this->statistics_ = reader->GetStatistics();
-        this->map_channelno_to_pixeltype_ = CziHelpers::GetMapOfChannelsToPixeltype(reader.get());
+        this->statistics_ = document_analysis->GetStatistics();
+        this->map_channelno_to_pixeltype_ = document_analysis->GetMapOfChannelsToPixeltype();
         this->underlying_reader_ = reader;
+        this->document_analysis_ = document_analysis;
     }
 
     std::shared_ptr<libCZI::ICZIReader>& GetUnderlyingReaderBase()
@@ -50,6 +53,22 @@ public:
         return this->map_channelno_to_pixeltype_[c];
     }
 
+    /// Gets the subblock-index of the underlying document.
+    ///
+    /// \returns   The subblock index.
+    const std::shared_ptr<const SubblockIndex>& GetSubblockIndex() const
+    {
+        return this->document_analysis_->GetSubblockIndex();
+    }
+
+    /// Gets the analysis of the underlying document.
+    ///
+    /// \returns   The document analysis.
+    const std::shared_ptr<const DocumentAnalysis>& GetDocumentAnalysis() const
+    {
+        return this->document_analysis_;
+    }
+
     /// Try to get the stage position from sub block metadata. This method
     /// will return the stage position if it is available in the sub block metadata and
     /// if this option is enabled in the application context. If the stage position is not available
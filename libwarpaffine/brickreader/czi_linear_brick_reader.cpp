@@ -4,47 +4,36 @@
 
 #include "czi_linear_brick_reader.h"
 #include "linearreading_orderhelper.h"
+#include "../czi_helpers.h"
 #include <optional>
 #include <map>
 #include <utility>
 #include <memory>
 #include <limits>
+#include <stdexcept>
 
 using namespace std;
 using namespace libCZI;
 
-CziBrickReaderLinearReading::CziBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream)
+CziBrickReaderLinearReading::CziBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
     :
     context_(context),
     reader_(std::move(reader)),
     input_stream_(std::move(stream)),
+    document_analysis_(document_analysis),
     brick_bucket_manager_([this](auto&& brick_result) { CziBrickReaderLinearReading::BrickCompleted(std::forward<decltype(brick_result)>(brick_result)); })
 {
-    this->statistics_ = this->reader_->GetStatistics();
+    this->statistics_ = document_analysis->GetStatistics();
 
     // create a map "channel-no <-> Pixeltype"
-    int channelCount;
-    if (!this->statistics_.dimBounds.TryGetInterval(DimensionIndex::C, nullptr, &channelCount))
-    {
-        throw invalid_argument("The document must have a C-dimension.");
-    }
+    this->map_channelno_to_pixeltype_ = document_analysis->GetMapOfChannelsToPixeltype();
 
-    for (int c = 0; c < channelCount; ++c)
-    {
-        SubBlockInfo subblock_info_of_channel;
-        if (!this->reader_->TryGetSubBlockInfoOfArbitrarySubBlockInChannel(c, subblock_info_of_channel))
-        {
-            ostringstream string_stream;
-            string_stream << "Unable to determine pixeltype for C=" << c << ".";
-            throw invalid_argument(string_stream.str());
-        }
-
-        this->map_channelno_to_pixeltype_[c] = subblock_info_of_channel.pixelType;
-    }
+    // when testing "stop after decompression", we need to decompress immediately
+    this->defer_decompression_ =
+        this->context_.GetCommandLineOptions().GetPropertyBagForBrickSource().GetBoolOrDefault(ICziBrickReader::kPropertyBagKey_LinearReader_defer_decompression, false) &&
+        this->context_.GetCommandLineOptions().GetTestStopPipelineAfter() != TestStopPipelineAfter::kDecompress;
 
-    this->max_size_of_subblocks_queued_ = 2ULL * 1024 * 1024 * 1024;    // 2GB
-
-    auto map_number_of_slices_per_brick_coordinate = this->GenerateReadInfo();
+    auto map_number_of_slices_per_brick_coordinate = this->GenerateReadInfo(*document_analysis);
 
     this->handle_high_watermark_callback_ = this->context_.GetAllocator().AddHighWatermarkCrossedCallback(
         [this](bool above_high_watermark)->void
@@ -59,46 +48,61 @@ CziBrickReaderLinearReading::CziBrickReaderLinearReading(AppContext& context, st
             }
         });
 
-    int t_count, c_count;
-    this->statistics_.dimBounds.TryGetInterval(DimensionIndex::T, nullptr, &t_count);
-    this->statistics_.dimBounds.TryGetInterval(DimensionIndex::C, nullptr, &c_count);
-    this->brick_bucket_manager_.Setup(
-        t_count,
-        c_count,
-        [&](int t, int c)->int
-        {
-            return map_number_of_slices_per_brick_coordinate[BrickCoordinate(t, c)];
-        });
+    // the bricks are identified by T, C and (in case of a mosaic) by scene-index and M-index, and we
+    //  prepare a bucket for each brick which is present in the document
+    this->brick_bucket_manager_.Setup(map_number_of_slices_per_brick_coordinate);
 }
 
-std::map<BrickCoordinate, std::uint32_t> CziBrickReaderLinearReading::GenerateReadInfo()
+/*static*/std::uint32_t CziBrickReaderLinearReading::GetMaxNumberOfSubblocksInflight(AppContext& context)
 {
-    int z_count, t_count, c_count;
-    this->statistics_.dimBounds.TryGetInterval(DimensionIndex::Z, nullptr, &z_count);
-    this->statistics_.dimBounds.TryGetInterval(DimensionIndex::T, nullptr, &t_count);
-    this->statistics_.dimBounds.TryGetInterval(DimensionIndex::C, nullptr, &c_count);
-
-    LinearReadingOrderHelper::ReadingConstraints reading_constraints;
-    reading_constraints.max_number_of_subblocks_inflight = this->context_.GetCommandLineOptions().GetPropertyBagForBrickSource().GetInt32OrDefault(
+    return context.GetCommandLineOptions().GetPropertyBagForBrickSource().GetInt32OrDefault(
         ICziBrickReader::kPropertyBagKey_LinearReader_max_number_of_subblocks_to_wait_for,
         2000);
+}
 
-    auto subblocks_ordered = LinearReadingOrderHelper::DetermineOrder(this->reader_.get(), reading_constraints);
+/*static*/void CziBrickReaderLinearReading::PrepareDocumentAnalysis(AppContext& context, DocumentAnalysis& document_analysis)
+{
+    LinearReadingOrderHelper::ReadingConstraints reading_constraints;
+    reading_constraints.max_number_of_subblocks_inflight = CziBrickReaderLinearReading::GetMaxNumberOfSubblocksInflight(context);
+
+    // the reading order may be available already (i.e. if it was loaded from the analysis-cache), otherwise
+    //  we determine it now and store it with the document-analysis (so that it can be persisted)
+    auto subblocks_ordered = document_analysis.TryGetLinearReadingOrder(reading_constraints.max_number_of_subblocks_inflight);
+    const bool reading_order_was_cached = subblocks_ordered != nullptr;
+    if (!reading_order_was_cached)
+    {
+        subblocks_ordered = make_shared<const LinearReadingOrderHelper::OrderReadingResult>(LinearReadingOrderHelper::DetermineOrder(document_analysis, reading_constraints));
+        document_analysis.SetLinearReadingOrder(reading_constraints.max_number_of_subblocks_inflight, subblocks_ordered);
+    }
 
     Utilities::ExecuteIfVerbosityAboveOrEqual(
-        this->context_.GetCommandLineOptions().GetPrintOutVerbosity(),
+        context.GetCommandLineOptions().GetPrintOutVerbosity(),
         MessagesPrintVerbosity::kMinimal,
         [&]()->void
         {
             ostringstream stream;
             stream << "linearreading: the suggested limit for the number of subblocks-in-flight was " << reading_constraints.max_number_of_subblocks_inflight << ", " << endl;
-            stream << "               the actual \"max number of subblocks-in-flight\" is " << subblocks_ordered.max_number_of_subblocks_inflight << "." << endl;
-            this->context_.GetLog()->WriteLineStdOut(stream.str());
+            stream << "               the actual \"max number of subblocks-in-flight\" is " << subblocks_ordered->max_number_of_subblocks_inflight << "." << endl;
+            if (reading_order_was_cached)
+            {
+                stream << "               (the reading order was taken from the analysis-cache)" << endl;
+            }
+
+            context.GetLog()->WriteLineStdOut(stream.str());
         });
+}
+
+std::map<BrickCoordinate, std::uint32_t> CziBrickReaderLinearReading::GenerateReadInfo(const DocumentAnalysis& document_analysis)
+{
+    const auto subblocks_ordered = document_analysis.TryGetLinearReadingOrder(CziBrickReaderLinearReading::GetMaxNumberOfSubblocksInflight(this->context_));
+    if (!subblocks_ordered)
+    {
+        throw logic_error("The document-analysis does not contain the linear reading order, 'PrepareDocumentAnalysis' must be called before.");
+    }
 
-    this->subblocks_ordered_ = std::move(subblocks_ordered.reading_order);
+    this->subblocks_ordered_ = subblocks_ordered->reading_order;
 
-    return subblocks_ordered.number_of_slices_per_brick;
+    return subblocks_ordered->number_of_slices_per_brick;
 }
 
 /*virtual*/void CziBrickReaderLinearReading::StartPumping(
@@ -108,6 +112,7 @@ std::map<BrickCoordinate, std::uint32_t> CziBrickReaderLinearReading::GenerateRe
 
     this->deliver_brick_func_ = deliver_brick_func;
     this->isDone_.store(false);
+    this->active_reader_threads_.store(numberOfReadingThreads);
 
     for (int i = 0; i < numberOfReadingThreads; ++i)
     {
@@ -146,15 +151,31 @@ std::map<BrickCoordinate, std::uint32_t> CziBrickReaderLinearReading::GenerateRe
         worker_thread.join();
     }
 
-    for (;;)
-    {
-        if (this->pending_tasks_count_.load() == 0 && this->statistics_number_of_uncompressed_planes_in_flight_.load() == 0 && this->statistics_number_of_compressed_subblocks_in_flight_.load() == 0)
+    // note: the counters for the planes and subblocks in flight are always decremented before the
+    //  pending-tasks-count, so the notification when this count drops to zero is sufficient here
+    this->done_notifier_.Wait(
+        [this]()->bool
         {
-            break;
-        }
+            return this->pending_tasks_count_.load() == 0 && this->statistics_number_of_uncompressed_planes_in_flight_.load() == 0 && this->statistics_number_of_compressed_subblocks_in_flight_.load() == 0;
+        });
+}
 
-        this_thread::sleep_for(std::chrono::milliseconds(5));
-    }
+/*virtual*/bool CziBrickReaderLinearReading::WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout)
+{
+    return this->done_notifier_.WaitFor(
+        [this]()->bool
+        {
+            return this->isDone_.load() && this->pending_tasks_count_.load() == 0 && this->statistics_number_of_uncompressed_planes_in_flight_.load() == 0 && this->statistics_number_of_compressed_subblocks_in_flight_.load() == 0;
+        },
+        timeout);
+}
+
+/*virtual*/void CziBrickReaderLinearReading::SetPauseState(bool pause)
+{
+    this->isPaused_ = pause;
+
+    // wake up the reader threads waiting for the throttling to be lifted
+    this->context_.GetFlowControl().NotifyStateChanged();
 }
 
 /*virtual*/std::shared_ptr<libCZI::ICZIReader>& CziBrickReaderLinearReading::GetUnderlyingReader()
@@ -172,7 +193,7 @@ void CziBrickReaderLinearReading::ReadSubblocksThread()
             break;
         }
 
-        int subblockIndex = this->subblocks_ordered_[index];
+        const int subblockIndex = this->subblocks_ordered_[index];
 
         auto subblock = this->reader_->ReadSubBlock(subblockIndex);
         ++this->statistics_slices_read;
@@ -182,71 +203,113 @@ void CziBrickReaderLinearReading::ReadSubblocksThread()
         this->context_.WriteDebugString(ss.str().c_str());
         //OutputDebugStringA(ss.str().c_str());
 
-        if (this->context_.GetCommandLineOptions().GetTestStopPipelineAfter() != TestStopPipelineAfter::kReadFromSource)
+        if (this->context_.GetCommandLineOptions().GetTestStopPipelineAfter() != TestStopPipelineAfter::kReadFromSource &&
+            this->defer_decompression_)
+        {
+            // the subblock goes into the bucket as it is - it will be decoded when the brick is complete (note that
+            //  we do not throttle on the credits for the read-stage in this case, since they are only returned
+            //  when the brick is complete, which is constrained by the reading order)
+            ++this->statistics_number_of_compressed_subblocks_in_flight_;
+            auto slice_info = this->CreateSliceInfo(subblockIndex);
+            const auto size_of_subblock = CziHelpers::GetMemorySizeOfSubblock(subblock.get());
+            slice_info.memory_registration = FlowControl::TieCreditsToData(
+                this->context_.GetAllocator().RegisterExternalMemory(BrickAllocator::MemoryType::CompressedSourceSubblock, size_of_subblock),
+                this->context_.GetFlowControl().Register(FlowControl::Stage::Read, size_of_subblock));
+            slice_info.subblock = std::move(subblock);
+            this->brick_bucket_manager_.AddSlice(slice_info);
+        }
+        else if (this->context_.GetCommandLineOptions().GetTestStopPipelineAfter() != TestStopPipelineAfter::kReadFromSource)
         {
-            this->memory_used_by_subblocks_in_queue_.fetch_add(DetermineMemorySizeOfSubblock(subblock.get()));
+            const auto size_of_subblock = CziHelpers::GetMemorySizeOfSubblock(subblock.get());
+            auto memory_registration = FlowControl::TieCreditsToData(
+                this->context_.GetAllocator().RegisterExternalMemory(BrickAllocator::MemoryType::CompressedSourceSubblock, size_of_subblock),
+                this->context_.GetFlowControl().Register(FlowControl::Stage::Read, size_of_subblock));
             ++this->pending_tasks_count_;
             ++this->statistics_number_of_compressed_subblocks_in_flight_;
             this->context_.GetTaskArena()->AddTask(
                 TaskType::DecompressSlice,
-                [this, subblock]()->void
+                this->GetLocalityKeyOfSubblock(subblockIndex),
+                [this, subblock, subblockIndex, memory_registration]()->void
                 {
-                    this->DecompressTask(subblock);
-                    --this->pending_tasks_count_;
+                    this->DecompressTask(subblock, subblockIndex);
                     --this->statistics_number_of_compressed_subblocks_in_flight_;
+                    this->DecrementPendingTasksCount();
                 });
         }
 
-        for (;;)
-        {
-            if (this->memory_used_by_subblocks_in_queue_.load() <= this->max_size_of_subblocks_queued_)
-            {
-                this->isThrottledInternally_.store(false);
-            }
-            else
-            {
-                this->isThrottledInternally_.store(true);
-            }
-
-            if (!this->isPaused_.load() && !this->isThrottledInternally_.load())
+        // wait until neither paused nor throttled - we are throttled if the compressed subblocks (waiting to be decoded)
+        //  exceed the budget of the read-stage, or if the stages downstream of the decode-stage have no capacity left
+        //  (we are woken up by the flow-control whenever credits are returned or the pause-state changes)
+        auto& flow_control = this->context_.GetFlowControl();
+        flow_control.WaitUntil(
+            [this, &flow_control]()->bool
             {
-                break;
-            }
+                this->isThrottledInternally_.store(
+                    (!this->defer_decompression_ && !flow_control.HasCapacity(FlowControl::Stage::Read)) ||
+                    !flow_control.HasDownstreamCapacity(FlowControl::Stage::Decode));
+                return !this->isPaused_.load() && !this->isThrottledInternally_.load();
+            });
+    }
 
-            this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+    // the last reader thread to finish sets the "done"-flag
+    if (this->active_reader_threads_.fetch_sub(1) == 1)
+    {
+        this->isDone_.store(true);
+        this->done_notifier_.Notify();
     }
+}
 
-    this->isDone_.store(true);
+void CziBrickReaderLinearReading::DecrementPendingTasksCount()
+{
+    if (this->pending_tasks_count_.fetch_sub(1) == 1)
+    {
+        this->done_notifier_.Notify();
+    }
 }
 
-void CziBrickReaderLinearReading::DecompressTask(const std::shared_ptr<libCZI::ISubBlock>& subblock)
+void CziBrickReaderLinearReading::DecompressTask(const std::shared_ptr<libCZI::ISubBlock>& subblock, int subblock_index)
 {
     // ok, so now... decompress the subblock and forward it
-    auto bitmap = subblock->CreateBitmap();
-
-    int z_coordinate, t_coordinate, c_coordinate;
-    subblock->GetSubBlockInfo().coordinate.TryGetPosition(DimensionIndex::T, &t_coordinate);
-    subblock->GetSubBlockInfo().coordinate.TryGetPosition(DimensionIndex::C, &c_coordinate);
-    subblock->GetSubBlockInfo().coordinate.TryGetPosition(DimensionIndex::Z, &z_coordinate);
+    auto bitmap = CziHelpers::CreateBitmapFromSubblock(subblock);
 
     if (this->context_.GetCommandLineOptions().GetTestStopPipelineAfter() != TestStopPipelineAfter::kDecompress)
     {
         // ...and one uncompressed subblock more around (and we only increment our counter
         //    if we actually "keep" this subblock)
         ++this->statistics_number_of_uncompressed_planes_in_flight_;     
-        BrickBucketManager::SliceInfo slice_info;
+        auto slice_info = this->CreateSliceInfo(subblock_index);
+        const auto size_of_bitmap = DetermineMemorySizeOfBitmap(bitmap.get());
+        slice_info.memory_registration = FlowControl::TieCreditsToData(
+            this->context_.GetAllocator().RegisterExternalMemory(BrickAllocator::MemoryType::DecodedSourcePlane, size_of_bitmap),
+            this->context_.GetFlowControl().Register(FlowControl::Stage::Decode, size_of_bitmap));
         slice_info.bitmap = std::move(bitmap);
-        slice_info.x_position = subblock->GetSubBlockInfo().logicalRect.x;
-        slice_info.y_position = subblock->GetSubBlockInfo().logicalRect.y;
-        slice_info.t_coordinate = t_coordinate;
-        slice_info.z_coordinate = z_coordinate;
-        slice_info.c_coordinate = c_coordinate;
         this->brick_bucket_manager_.AddSlice(slice_info);
     }
+}
+
+BrickBucketManager::SliceInfo CziBrickReaderLinearReading::CreateSliceInfo(int subblock_index) const
+{
+    // the brick this subblock belongs to is determined with the same rules as used when determining the reading order
+    const auto& subblock_info = this->document_analysis_->GetSubblocks()[subblock_index];
+    const auto brick_coordinate = LinearReadingOrderHelper::GetBrickCoordinateOfSubblock(this->statistics_, subblock_info);
+
+    BrickBucketManager::SliceInfo slice_info;
+    slice_info.x_position = subblock_info.logical_rect.x;
+    slice_info.y_position = subblock_info.logical_rect.y;
+    slice_info.t_coordinate = brick_coordinate.t;
+    slice_info.z_coordinate = subblock_info.z;
+    slice_info.c_coordinate = brick_coordinate.c;
+    slice_info.s_coordinate = brick_coordinate.s;
+    slice_info.m_index = brick_coordinate.m;
+    return slice_info;
+}
 
-    auto size_of_subblock = DetermineMemorySizeOfSubblock(subblock.get());
-    this->memory_used_by_subblocks_in_queue_.fetch_sub(size_of_subblock);
+std::uint64_t CziBrickReaderLinearReading::GetLocalityKeyOfSubblock(int subblock_index) const
+{
+    // the tasks for the subblocks of a brick (and for the brick itself) are to be run on the same NUMA-node, so the
+    //  locality key is derived from the brick-coordinate
+    const auto& subblock_info = this->document_analysis_->GetSubblocks()[subblock_index];
+    return LinearReadingOrderHelper::GetBrickCoordinateOfSubblock(this->statistics_, subblock_info).GetHashCode();
 }
 
 void CziBrickReaderLinearReading::BrickCompleted(const std::shared_ptr<IBrickResult>& brick_result)
@@ -254,62 +317,138 @@ void CziBrickReaderLinearReading::BrickCompleted(const std::shared_ptr<IBrickRes
     // now, start a task which will copy all planes into a brick
     ++this->pending_tasks_count_;
 
+    if (this->defer_decompression_)
+    {
+        this->context_.GetTaskArena()->AddTask(
+            TaskType::BrickComposition,
+            brick_result->GetBrickCoordinate().GetHashCode(),
+            [this, brick_result]()->void
+            {
+                this->ComposeBrickFromSubblocksTask(brick_result);
+                this->DecrementPendingTasksCount();
+            });
+        return;
+    }
+
     //ostringstream ss;
     //ss << "BrickCompleted: T=" << brick_result->GetCoordinate(DimensionIndex::T) << " C=" << brick_result->GetCoordinate(DimensionIndex::C);
     //OutputDebugStringA(ss.str().c_str());
 
     this->context_.GetTaskArena()->AddTask(
         TaskType::BrickComposition,
+        brick_result->GetBrickCoordinate().GetHashCode(),
         [this, brick_result]()->void
         {
             this->ComposeBrickTask(brick_result);
-            --this->pending_tasks_count_;
+            this->DecrementPendingTasksCount();
         });
 }
 
 void CziBrickReaderLinearReading::ComposeBrickTask(const std::shared_ptr<IBrickResult>& brick_result)
 {
-    const int c_coordinate = brick_result->GetCoordinate(DimensionIndex::C);
-    const CDimCoordinate dim_coordinate
-    {
-        { DimensionIndex::C, c_coordinate },
-        { DimensionIndex::T, brick_result->GetCoordinate(DimensionIndex::T) },
-    };
+    const auto& brick_coordinate = brick_result->GetBrickCoordinate();
+    const auto& rectangle_of_brick = this->GetRectangleOfBrick(brick_coordinate);
 
     int number_of_slices;
     this->statistics_.dimBounds.TryGetInterval(DimensionIndex::Z, nullptr, &number_of_slices);
 
-    const auto brick = brick_result->ComposeBrick(
-        this->map_channelno_to_pixeltype_[c_coordinate],
-        this->statistics_.boundingBoxLayer0Only.x,
-        this->statistics_.boundingBoxLayer0Only.y,
-        this->statistics_.boundingBoxLayer0Only.w,
-        this->statistics_.boundingBoxLayer0Only.h,
+    auto brick = brick_result->ComposeBrick(
+        this->map_channelno_to_pixeltype_[brick_coordinate.c],
+        rectangle_of_brick.x,
+        rectangle_of_brick.y,
+        rectangle_of_brick.w,
+        rectangle_of_brick.h,
         number_of_slices,
         this->context_.GetAllocator(),
         true);
 
+    // the source brick is admitted already (by the reader), so the credits are taken unconditionally here
+    brick.data = FlowControl::TieCreditsToData(
+        std::move(brick.data),
+        this->context_.GetFlowControl().Register(FlowControl::Stage::Compose, brick.info.GetBrickDataSize()));
+
     // and, finally, deliver the brick
+    this->DeliverBrick(brick_coordinate, rectangle_of_brick, brick);
+
+    // the uncompressed planes (which are held inside the brick_result object) are not needed any more,
+    //  and will be released when this method returns
+    this->statistics_number_of_uncompressed_planes_in_flight_.fetch_sub(brick_result->GetNumberOfSlices());
+}
+
+void CziBrickReaderLinearReading::ComposeBrickFromSubblocksTask(const std::shared_ptr<IBrickResult>& brick_result)
+{
+    const auto& brick_coordinate = brick_result->GetBrickCoordinate();
+    const auto& rectangle_of_brick = this->GetRectangleOfBrick(brick_coordinate);
+
+    int number_of_slices;
+    this->statistics_.dimBounds.TryGetInterval(DimensionIndex::Z, nullptr, &number_of_slices);
+
+    const auto brick = make_shared<Brick>(brick_result->AllocateBrick(
+        this->map_channelno_to_pixeltype_[brick_coordinate.c],
+        rectangle_of_brick.w,
+        rectangle_of_brick.h,
+        number_of_slices,
+        this->context_.GetAllocator()));
+    brick->data = FlowControl::TieCreditsToData(
+        std::move(brick->data),
+        this->context_.GetFlowControl().Register(FlowControl::Stage::Compose, brick->info.GetBrickDataSize()));
+
+    // we now start a task for each slice, which decodes the subblock directly into the brick - and the task
+    //  which finishes last delivers the brick
+    const uint32_t number_of_slices_in_brick = brick_result->GetNumberOfSlices();
+    const auto number_of_slices_pending = make_shared<atomic_uint32_t>(number_of_slices_in_brick);
+    for (uint32_t slice_no = 0; slice_no < number_of_slices_in_brick; ++slice_no)
+    {
+        ++this->pending_tasks_count_;
+        this->context_.GetTaskArena()->AddTask(
+            TaskType::DecompressSlice,
+            brick_result->GetBrickCoordinate().GetHashCode(),
+            [this, brick_result, brick, number_of_slices_pending, slice_no, rectangle_of_brick]()->void
+            {
+                brick_result->ComposeSlice(slice_no, rectangle_of_brick.x, rectangle_of_brick.y, *brick, true);
+                --this->statistics_number_of_compressed_subblocks_in_flight_;
+
+                if (--*number_of_slices_pending == 0)
+                {
+                    this->DeliverBrick(brick_result->GetBrickCoordinate(), rectangle_of_brick, *brick);
+                }
+
+                this->DecrementPendingTasksCount();
+            });
+    }
+}
+
+const libCZI::IntRect& CziBrickReaderLinearReading::GetRectangleOfBrick(const BrickCoordinate& brick_coordinate) const
+{
+    // the tile-identifier is constructed so that it matches the keys of the "tile-identifier to rectangle"-map, i.e. for
+    //  a non-mosaic document, this gives the bounding-box of all layer-0 subblocks
+    const TileIdentifier tile_identifier(
+        brick_coordinate.s != BrickCoordinate::kNotPresent ? optional<int>(brick_coordinate.s) : nullopt,
+        brick_coordinate.m != BrickCoordinate::kNotPresent ? optional<int>(brick_coordinate.m) : nullopt);
+    return this->document_analysis_->GetSubblockIndex()->GetTileIdentifierToRectangleMap().at(tile_identifier);
+}
+
+void CziBrickReaderLinearReading::DeliverBrick(const BrickCoordinate& brick_coordinate, const libCZI::IntRect& rectangle_of_brick, const Brick& brick)
+{
+    CDimCoordinate dim_coordinate{ { DimensionIndex::C, brick_coordinate.c } };
+    if (brick_coordinate.t != BrickCoordinate::kNotPresent)
+    {
+        dim_coordinate.Set(DimensionIndex::T, brick_coordinate.t);
+    }
+
     BrickCoordinateInfo brick_coordinate_info;
     brick_coordinate_info.coordinate = dim_coordinate;
-    brick_coordinate_info.mIndex = numeric_limits<int>::max();      
-    brick_coordinate_info.x_position = 0;
-    brick_coordinate_info.y_position = 0;
+    brick_coordinate_info.mIndex = brick_coordinate.m != BrickCoordinate::kNotPresent ? brick_coordinate.m : std::numeric_limits<int>::min();
+    brick_coordinate_info.scene_index = brick_coordinate.s != BrickCoordinate::kNotPresent ? brick_coordinate.s : std::numeric_limits<int>::min();
+    brick_coordinate_info.x_position = rectangle_of_brick.x;
+    brick_coordinate_info.y_position = rectangle_of_brick.y;
     brick_coordinate_info.stage_x_position = brick_coordinate_info.stage_y_position = numeric_limits<double>::quiet_NaN();  // TODO(JBL): retrieve subblock-metadata
     this->deliver_brick_func_(brick, brick_coordinate_info);
     ++this->statistics_bricks_delivered;
     this->statistics_brick_data_delivered.fetch_add(brick.info.GetBrickDataSize());
-
-    // the uncompressed planes (which are held inside the brick_result object) are not needed any more,
-    //  and will be released when this method returns
-    this->statistics_number_of_uncompressed_planes_in_flight_.fetch_sub(brick_result->GetNumberOfSlices());
 }
 
-/*static*/std::uint64_t CziBrickReaderLinearReading::DetermineMemorySizeOfSubblock(libCZI::ISubBlock* subblock)
+/*static*/std::uint64_t CziBrickReaderLinearReading::DetermineMemorySizeOfBitmap(libCZI::IBitmapData* bitmap)
 {
-    size_t sizeData, sizeAttachment;
-    const void* dummy;
-    subblock->DangerousGetRawData(ISubBlock::Data, dummy, sizeData);
-    subblock->DangerousGetRawData(ISubBlock::Attachment, dummy, sizeAttachment);
-    return sizeData + sizeAttachment;
+    return static_cast<uint64_t>(bitmap->GetWidth()) * bitmap->GetHeight() * Utils::GetBytesPerPixel(bitmap->GetPixelType());
 }
@@ -14,6 +14,8 @@
 #include "../mmstream/IStreamEx.h"
 #include "../appcontext.h"
 #include "../brick.h"
+#include "../document_analysis.h"
+#include "../utilities.h"
 #include "IBrickReader.h"
 #include "brick_bucket_manager.h"
 #include "brick_coordinate.h"
@@ -28,6 +30,7 @@ private:
     AppContext& context_;
     std::shared_ptr<libCZI::ICZIReader> reader_;
     std::shared_ptr<IStreamEx> input_stream_;
+    std::shared_ptr<const DocumentAnalysis> document_analysis_;
     libCZI::SubBlockStatistics statistics_;
     std::map<int, libCZI::PixelType> map_channelno_to_pixeltype_;
     std::vector<std::thread> reader_threads_;
@@ -48,39 +51,56 @@ private:
 
     std::atomic_uint32_t pending_tasks_count_{ 0 };
     std::atomic_bool isDone_{ false };
+    std::atomic_int active_reader_threads_{ 0 };
+    ConditionNotifier done_notifier_;
 
     std::atomic_bool isPaused_{ false };
     std::atomic_bool isThrottledInternally_{ false };
 
     std::atomic_uint32_t active_bricks_count_{ 0 };
 
-    std::atomic_uint64_t memory_used_by_subblocks_in_queue_{ 0 };
-
-    std::uint64_t max_size_of_subblocks_queued_{ (std::numeric_limits<std::uint64_t>::max)() };
+    /// If true, then the subblocks are kept compressed (in the brick_bucket_manager) until the brick they belong to
+    /// is complete, and they are decoded (concurrently) directly into the composed brick.
+    bool defer_decompression_{ false };
 
     BrickBucketManager brick_bucket_manager_;
 
     int handle_high_watermark_callback_;
 public:
-    CziBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream);
+    CziBrickReaderLinearReading(AppContext& context, std::shared_ptr<libCZI::ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis);
+
+    /// Adds the information required by this brick-reader to the document-analysis (i.e. the linear reading order, which
+    /// is determined here unless it is already present). This must be called before the analysis is passed to the constructor.
+    ///
+    /// \param [in]     context             The application context.
+    /// \param [in,out] document_analysis   The document analysis.
+    static void PrepareDocumentAnalysis(AppContext& context, DocumentAnalysis& document_analysis);
 
 public:
     void StartPumping(const std::function<void(const Brick&, const BrickCoordinateInfo&)>& deliver_brick_func) override;
     bool IsDone() override;
     BrickReaderStatistics GetStatus() override;
     void WaitUntilDone() override;
+    bool WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout) override;
     std::shared_ptr<libCZI::ICZIReader>& GetUnderlyingReader() override;
-    void SetPauseState(bool pause) override { this->isPaused_ = pause; }
+    void SetPauseState(bool pause) override;
     bool GetIsThrottledState() override { return this->isThrottledInternally_.load() || this->isPaused_.load(); }
 private:
     std::atomic_int32_t next_subblock_index_to_read_{0};  ///< The next subblock index to be read (i.e. an index into the subblocks_ordered_-vector).
     std::vector<int> subblocks_ordered_;                  ///< This array contains the order in which the subblocks are to be read from the file.
 
-    std::map<BrickCoordinate, std::uint32_t> GenerateReadInfo();
+    static std::uint32_t GetMaxNumberOfSubblocksInflight(AppContext& context);
+    std::map<BrickCoordinate, std::uint32_t> GenerateReadInfo(const DocumentAnalysis& document_analysis);
     void ReadSubblocksThread();
+    void DecrementPendingTasksCount();
 
-    void DecompressTask(const std::shared_ptr<libCZI::ISubBlock>& subblock);
+    void DecompressTask(const std::shared_ptr<libCZI::ISubBlock>& subblock, int subblock_index);
+    BrickBucketManager::SliceInfo CreateSliceInfo(int subblock_index) const;
+    std::uint64_t GetLocalityKeyOfSubblock(int subblock_index) const;
     void BrickCompleted(const std::shared_ptr<IBrickResult>& brick_result);
     void ComposeBrickTask(const std::shared_ptr<IBrickResult>& brick_result);
-    static std::uint64_t DetermineMemorySizeOfSubblock(libCZI::ISubBlock* subblock);
+    void ComposeBrickFromSubblocksTask(const std::shared_ptr<IBrickResult>& brick_result);
+    const libCZI::IntRect& GetRectangleOfBrick(const BrickCoordinate& brick_coordinate) const;
+    void DeliverBrick(const BrickCoordinate& brick_coordinate, const libCZI::IntRect& rectangle_of_brick, const Brick& brick);
+    static std::uint64_t DetermineMemorySizeOfBitmap(libCZI::IBitmapData* bitmap);
 };
@@ -4,105 +4,134 @@
 
 #include "linearreading_orderhelper.h"
 #include <algorithm>
+#include <stdexcept>
 #include <vector>
 #include <utility>
 
 using namespace std;
 using namespace libCZI;
 
-/*static*/LinearReadingOrderHelper::CziDocumentInfo LinearReadingOrderHelper::GetCziDocumentInfo(libCZI::ICZIReader* subblock_repository)
+/*static*/LinearReadingOrderHelper::CziDocumentInfo LinearReadingOrderHelper::GetCziDocumentInfo(const DocumentAnalysis& document_analysis)
 {
     CziDocumentInfo document_info;
-    document_info.statistics = subblock_repository->GetStatistics();
+    document_info.statistics = document_analysis.GetStatistics();
     int z_count;
     document_info.statistics.dimBounds.TryGetInterval(DimensionIndex::Z, nullptr, &z_count);
     document_info.no_of_z = static_cast<uint32_t>(z_count);
     return document_info;
 }
 
-/*static*/LinearReadingOrderHelper::InitialInspectionResult LinearReadingOrderHelper::CreateInitialInspectionResult(libCZI::ICZIReader* subblock_repository, const CziDocumentInfo& info)
+/*static*/LinearReadingOrderHelper::InitialInspectionResult LinearReadingOrderHelper::CreateInitialInspectionResult(const DocumentAnalysis& document_analysis, const CziDocumentInfo& info)
 {
     InitialInspectionResult result;
-    int t_count, c_count;
-    info.statistics.dimBounds.TryGetInterval(DimensionIndex::T, nullptr, &t_count);
-    info.statistics.dimBounds.TryGetInterval(DimensionIndex::C, nullptr, &c_count);
-    for (int t = 0; t < t_count; ++t)
+    const auto& subblocks = document_analysis.GetSubblocks();
+    result.subblocks_ordered_by_fileposition.reserve(subblocks.size());
+
+    // TODO(JBL): we could check here whether they are already in correct order, and then skip the sort altogether
+    for (size_t index = 0; index < subblocks.size(); ++index)
     {
-        for (int c = 0; c < c_count; ++c)
+        // only layer-0 subblocks which are part of a brick are to be read (pyramid-subblocks are not used, and
+        //  subblocks which are not part of a tile cannot be assigned to a brick)
+        if (IsSubblockPartOfBrick(info.statistics, subblocks[index]))
         {
-            result.number_of_slices_per_brick[BrickCoordinate{ t, c }] = 0;
+            result.subblocks_ordered_by_fileposition.emplace_back(static_cast<int>(index));
+            ++result.number_of_slices_per_brick[GetBrickCoordinateOfSubblock(info.statistics, subblocks[index])];
         }
     }
 
-    result.subblocks_ordered_by_fileposition.reserve(info.statistics.subBlockCount);
-    std::vector<std::uint64_t> filepositions;
-    filepositions.reserve(info.statistics.subBlockCount);
-
-    // TODO(JBL): we could check here whether they are already in correct order, and then skip the sort altogether
-    subblock_repository->EnumerateSubBlocksEx(
-        [&](int index, const DirectorySubBlockInfo& info)->bool
-        {
-            result.subblocks_ordered_by_fileposition.emplace_back(index);
-            filepositions.emplace_back(info.filePosition);
-
-            int t_coordinate, c_coordinate;
-            info.coordinate.TryGetPosition(DimensionIndex::T, &t_coordinate);
-            info.coordinate.TryGetPosition(DimensionIndex::C, &c_coordinate);
-            ++result.number_of_slices_per_brick[BrickCoordinate{ t_coordinate, c_coordinate }];
-
-            return true;
-        });
-
     sort(
         result.subblocks_ordered_by_fileposition.begin(),
         result.subblocks_ordered_by_fileposition.end(),
         [&](int a, int b)
         {
-            return filepositions[a] < filepositions[b];
+            return subblocks[a].file_position < subblocks[b].file_position;
         });
 
     return result;
 }
 
-/*static*/std::vector<int> LinearReadingOrderHelper::CreateOrder_OrderedByFilePosition(libCZI::ICZIReader* subblock_repository, const CziDocumentInfo& info)
+/*static*/std::vector<int> LinearReadingOrderHelper::CreateOrder_OrderedByFilePosition(const DocumentAnalysis& document_analysis, const CziDocumentInfo& info)
 {
+    const auto& subblocks = document_analysis.GetSubblocks();
     std::vector<int> subblocks_order_by_fileposition;
-    subblocks_order_by_fileposition.reserve(info.statistics.subBlockCount);
-    std::vector<std::uint64_t> filepositions;
-    filepositions.reserve(info.statistics.subBlockCount);
+    subblocks_order_by_fileposition.reserve(subblocks.size());
 
     // TODO(JBL): we could check here whether they are already in correct order, and then skip the sort altogether
-    subblock_repository->EnumerateSubBlocksEx(
-        [&](int index, const DirectorySubBlockInfo& info)->bool
+    for (size_t index = 0; index < subblocks.size(); ++index)
+    {
+        if (IsSubblockPartOfBrick(info.statistics, subblocks[index]))
         {
-            subblocks_order_by_fileposition.emplace_back(index);
-            filepositions.emplace_back(info.filePosition);
-            return true;
-        });
+            subblocks_order_by_fileposition.emplace_back(static_cast<int>(index));
+        }
+    }
 
     sort(
         subblocks_order_by_fileposition.begin(),
         subblocks_order_by_fileposition.end(),
         [&](int a, int b)
         {
-            return filepositions[a] < filepositions[b];
+            return subblocks[a].file_position < subblocks[b].file_position;
         });
 
     return subblocks_order_by_fileposition;
 }
 
-/*static*/BrickCoordinate LinearReadingOrderHelper::BrickCoordinateFromSubBlockInfo(const libCZI::SubBlockInfo& subblock_info)
+/*static*/bool LinearReadingOrderHelper::IsSubblockPartOfBrick(const libCZI::SubBlockStatistics& statistics, const SubblockDirectoryInfo& subblock_info)
+{
+    if (!subblock_info.is_layer0)
+    {
+        return false;
+    }
+
+    // this must be in sync with the logic in SubblockIndex (which determines the tile-rectangles)
+    const bool document_has_scenes = !statistics.sceneBoundingBoxes.empty();
+    if (!statistics.IsMIndexValid() && !document_has_scenes)
+    {
+        return true;
+    }
+
+    if (subblock_info.m == SubblockDirectoryInfo::kNotPresent ||
+        subblock_info.m < statistics.minMindex ||
+        subblock_info.m > statistics.maxMindex)
+    {
+        return false;
+    }
+
+    return !document_has_scenes ||
+        (subblock_info.s != SubblockDirectoryInfo::kNotPresent && statistics.sceneBoundingBoxes.find(subblock_info.s) != statistics.sceneBoundingBoxes.cend());
+}
+
+/*static*/BrickCoordinate LinearReadingOrderHelper::GetBrickCoordinateOfSubblock(const libCZI::SubBlockStatistics& statistics, const SubblockDirectoryInfo& subblock_info)
 {
     BrickCoordinate brick_coordinate;
-    bool b = subblock_info.coordinate.TryGetPosition(DimensionIndex::T, &brick_coordinate.t);
-    b = subblock_info.coordinate.TryGetPosition(DimensionIndex::C, &brick_coordinate.c);
+    brick_coordinate.t = subblock_info.t;
+    brick_coordinate.c = subblock_info.c;
+
+    // this must be in sync with the logic in SubblockIndex (which determines the tile-rectangles) - if the document has
+    //  scenes, then a tile is identified by scene-index and M-index, otherwise (if the M-index is valid) by the M-index only
+    const bool document_has_scenes = !statistics.sceneBoundingBoxes.empty();
+    if (statistics.IsMIndexValid() || document_has_scenes)
+    {
+        if (subblock_info.m == SubblockDirectoryInfo::kNotPresent)
+        {
+            throw invalid_argument("In a mosaic document, all subblocks are required to have an M-index.");
+        }
+
+        brick_coordinate.m = subblock_info.m;
+        if (document_has_scenes)
+        {
+            brick_coordinate.s = subblock_info.s;
+        }
+    }
+
     return brick_coordinate;
 }
 
-/*static*/LinearReadingOrderHelper::OrderReadingResult LinearReadingOrderHelper::DetermineOrder(libCZI::ICZIReader* subblock_repository, const ReadingConstraints& options)
+/*static*/LinearReadingOrderHelper::OrderReadingResult LinearReadingOrderHelper::DetermineOrder(const DocumentAnalysis& document_analysis, const ReadingConstraints& options)
 {
-    const auto document_info = GetCziDocumentInfo(subblock_repository);
-    auto initial_inspection_result = CreateInitialInspectionResult(subblock_repository, document_info);
+    const auto document_info = GetCziDocumentInfo(document_analysis);
+    auto initial_inspection_result = CreateInitialInspectionResult(document_analysis, document_info);
+    const auto& subblocks = document_analysis.GetSubblocks();
 
     OrderReadingResult result;
 
@@ -114,31 +143,27 @@ using namespace libCZI;
     for (size_t i = 0; i < initial_inspection_result.subblocks_ordered_by_fileposition.size(); ++i)
     {
         int subblock_index = initial_inspection_result.subblocks_ordered_by_fileposition[i];
-
-        SubBlockInfo subblock_info;
-        bool b = subblock_repository->TryGetSubBlockInfo(subblock_index, &subblock_info);
-        BrickCoordinate brick_coordinate = BrickCoordinateFromSubBlockInfo(subblock_info);
+        BrickCoordinate brick_coordinate = GetBrickCoordinateOfSubblock(document_info.statistics, subblocks[subblock_index]);
 
         // so, ok, is this a new brick or have we seen this before?
         auto unfinished_brick_info_iterator = unfinished_bricks.find(brick_coordinate);
         if (unfinished_brick_info_iterator == unfinished_bricks.end())
         {
             unfinished_brick_info_iterator = get<0>(unfinished_bricks.emplace(
-                brick_coordinate, UnfinishedBrickInfo{ /*document_info.no_of_z*/initial_inspection_result.number_of_slices_per_brick[brick_coordinate], 1 }));
-            ++subblocks_currently_inflight;
+                brick_coordinate, UnfinishedBrickInfo{ /*document_info.no_of_z*/initial_inspection_result.number_of_slices_per_brick[brick_coordinate], 0 }));
         }
-        else
+
+        ++(unfinished_brick_info_iterator->second.number_of_subblocks_present_for_brick);
+        ++subblocks_currently_inflight;
+
+        // note that a brick may be complete with its first subblock (i.e. if the brick consists of only one slice)
+        if (unfinished_brick_info_iterator->second.number_of_subblocks_present_for_brick == unfinished_brick_info_iterator->second.number_of_subblocks_required_for_brick)
         {
-            ++(unfinished_brick_info_iterator->second.number_of_subblocks_present_for_brick);
-            ++subblocks_currently_inflight;
-            if (unfinished_brick_info_iterator->second.number_of_subblocks_present_for_brick == unfinished_brick_info_iterator->second.number_of_subblocks_required_for_brick)
-            {
-                // subtract this from the number of currently allocated subblocks
-                subblocks_currently_inflight -= unfinished_brick_info_iterator->second.number_of_subblocks_present_for_brick;
+            // subtract this from the number of currently allocated subblocks
+            subblocks_currently_inflight -= unfinished_brick_info_iterator->second.number_of_subblocks_present_for_brick;
 
-                // ok, then this brick is done and fine, let's remove it from the map
-                unfinished_bricks.erase(unfinished_brick_info_iterator);
-            }
+            // ok, then this brick is done and fine, let's remove it from the map
+            unfinished_bricks.erase(unfinished_brick_info_iterator);
         }
 
         // If we have too many items in flight, we re-order the remaining items so that a brick is completed next.
@@ -147,6 +172,7 @@ using namespace libCZI;
         {
             brick_coordinate_of_brick_it_was_reordered_for.MakeInvalid();
             if (subblocks_currently_inflight >= options.max_number_of_subblocks_inflight &&
+                !unfinished_bricks.empty() &&
                 i + 2 < initial_inspection_result.subblocks_ordered_by_fileposition.size())
             {
                 // ok, so now we change the order so that all remaining subblocks for the brick which has
@@ -158,7 +184,7 @@ using namespace libCZI;
                     });
 
                 LinearReadingOrderHelper::Reorder(
-                    subblock_repository,
+                    document_analysis,
                     initial_inspection_result.subblocks_ordered_by_fileposition,
                     i + 1,
                     *brick_with_lowest_number_of_subblocks_missing);
@@ -181,19 +207,18 @@ using namespace libCZI;
     return result;
 }
 
-/*static*/void LinearReadingOrderHelper::Reorder(libCZI::ICZIReader* subblock_repository, std::vector<int>& subblocks_list, size_t index_where_to_insert, const std::pair<BrickCoordinate, UnfinishedBrickInfo>& brick)
+/*static*/void LinearReadingOrderHelper::Reorder(const DocumentAnalysis& document_analysis, std::vector<int>& subblocks_list, size_t index_where_to_insert, const std::pair<BrickCoordinate, UnfinishedBrickInfo>& brick)
 {
     // what we do here is:
     // * starting at the specified index, we scan the remainder for subblocks belonging to the specified brick
     // * if we find one, we move (or: swap) it with the position behind the index
 
+    const auto& subblocks = document_analysis.GetSubblocks();
     uint32_t no_of_subblocks_missing_for_brick = brick.second.CalcNumberOfSubblocksMissing();
     for (size_t index = index_where_to_insert; index < subblocks_list.size(); ++index)
     {
         int subblock_index = subblocks_list[index];
-        SubBlockInfo subblock_info;
-        bool b = subblock_repository->TryGetSubBlockInfo(subblock_index, &subblock_info);
-        BrickCoordinate brick_coordinate = BrickCoordinateFromSubBlockInfo(subblock_info);
+        BrickCoordinate brick_coordinate = GetBrickCoordinateOfSubblock(document_analysis.GetStatistics(), subblocks[subblock_index]);
         if (brick_coordinate == brick.first)
         {
             swap(subblocks_list[index_where_to_insert], subblocks_list[index]);
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "../inc_libCZI.h"
+#include "../document_analysis.h"
 #include "brick_coordinate.h"
 
 class LinearReadingOrderHelper
@@ -44,12 +45,9 @@ public:
         std::uint32_t max_number_of_subblocks_inflight{ 0 };
     };
 
-    struct OrderReadingResult
-    {
-        std::vector<int> reading_order;
-        std::uint32_t max_number_of_subblocks_inflight{ 0 };
-        std::map<BrickCoordinate, std::uint32_t> number_of_slices_per_brick;
-    };
+    /// The result of determining the reading order - this type is defined alongside DocumentAnalysis so
+    /// that it can be stored (and persisted) together with the analysis.
+    typedef LinearReadingOrder OrderReadingResult;
 
     /// The purpose of this function is to determine an order (in which to read the subblocks) which
     /// ensures that the number of "subblocks-in-flight" has a certain limit. With "subblocks-in-flight"
@@ -67,16 +65,38 @@ public:
     /// counter-measures (i.e. change the order). However, note that the max amount of subblocks-in-flight is
     /// reported (and, as said, it may be larger than the max_number specified on input).
     ///
-    /// \param [in,out] subblock_repository The subblock repository.
+    /// \param          document_analysis   The document analysis (giving the file-positions and coordinates of the subblocks).
     /// \param          options             Options for controlling the operation.
     ///
     /// \returns    The result of determining the read order (including the max number of "subblocks-in-flight" when processing subblocks in this order).
-    static OrderReadingResult DetermineOrder(libCZI::ICZIReader* subblock_repository, const ReadingConstraints& options);
+    static OrderReadingResult DetermineOrder(const DocumentAnalysis& document_analysis, const ReadingConstraints& options);
+
+    /// Determines whether the specified subblock is to be read, i.e. whether it is part of a brick. This is the case for
+    /// layer-0 subblocks which are part of a tile - the rules are the same as the ones used for determining the tile-rectangles
+    /// (c.f. SubblockIndex::GetTileIdentifierToRectangleMap). So, in a mosaic document, subblocks without a valid M-index (or
+    /// with an M-index outside of the range given by the statistics) and, in a document with scenes, subblocks without an
+    /// S-index (or with an S-index for which there is no scene-bounding-box) are not part of a brick.
+    ///
+    /// \param  statistics      The subblock-statistics of the document.
+    /// \param  subblock_info   Information describing the subblock.
+    ///
+    /// \returns    True if the subblock is part of a brick (and is to be read); false otherwise.
+    static bool IsSubblockPartOfBrick(const libCZI::SubBlockStatistics& statistics, const SubblockDirectoryInfo& subblock_info);
+
+    /// Gets the brick-coordinate of the brick the specified subblock belongs to. The brick is identified by T and C, and in case
+    /// of a mosaic document, by the scene-index and the M-index (the rules for which are the same as the ones used for determining
+    /// the tile-rectangles, c.f. SubblockIndex::GetTileIdentifierToRectangleMap). Only subblocks for which IsSubblockPartOfBrick
+    /// gives true are to be passed in here - for a mosaic-subblock without a valid M-index an exception is thrown.
+    ///
+    /// \param  statistics      The subblock-statistics of the document.
+    /// \param  subblock_info   Information describing the subblock.
+    ///
+    /// \returns    The brick-coordinate.
+    static BrickCoordinate GetBrickCoordinateOfSubblock(const libCZI::SubBlockStatistics& statistics, const SubblockDirectoryInfo& subblock_info);
 
 private:
-    static InitialInspectionResult CreateInitialInspectionResult(libCZI::ICZIReader* subblock_repository, const CziDocumentInfo& info);
-    static std::vector<int> CreateOrder_OrderedByFilePosition(libCZI::ICZIReader* subblock_repository, const CziDocumentInfo& info);
-    static CziDocumentInfo GetCziDocumentInfo(libCZI::ICZIReader* subblock_repository);
-    static BrickCoordinate BrickCoordinateFromSubBlockInfo(const libCZI::SubBlockInfo& subblock_info);
-    static void Reorder(libCZI::ICZIReader* subblock_repository, std::vector<int>& subblocks_list, size_t index, const std::pair<BrickCoordinate, UnfinishedBrickInfo>& brick);
+    static InitialInspectionResult CreateInitialInspectionResult(const DocumentAnalysis& document_analysis, const CziDocumentInfo& info);
+    static std::vector<int> CreateOrder_OrderedByFilePosition(const DocumentAnalysis& document_analysis, const CziDocumentInfo& info);
+    static CziDocumentInfo GetCziDocumentInfo(const DocumentAnalysis& document_analysis);
+    static void Reorder(const DocumentAnalysis& document_analysis, std::vector<int>& subblocks_list, size_t index, const std::pair<BrickCoordinate, UnfinishedBrickInfo>& brick);
 };
@@ -15,10 +15,11 @@ CalcResultHash::CalcResultHash()
 
 void CalcResultHash::AddSlice(const std::shared_ptr<libCZI::IMemoryBlock>& memory_block, const libCZI::CDimCoordinate& coordinate)
 {
-    std::array<std::uint8_t, 16> hash_of_data;
-    size_t size_of_data = memory_block->GetSizeOfData();
-    Utils::CalcMd5SumHash(memory_block->GetPtr(), size_of_data, hash_of_data.data(), sizeof(hash_of_data));
+    this->AddSlice(CalcResultHash::CalculateHashOfData(memory_block), coordinate);
+}
 
+void CalcResultHash::AddSlice(const std::array<std::uint8_t, 16>& hash_of_data, const libCZI::CDimCoordinate& coordinate)
+{
     std::array<std::uint8_t, 16> hash_of_coordinate;
     string coordinate_string_representation = Utils::DimCoordinateToString(&coordinate);
     Utils::CalcMd5SumHash(coordinate_string_representation.c_str(), coordinate_string_representation.size(), hash_of_coordinate.data(), sizeof(hash_of_coordinate));
@@ -34,6 +35,14 @@ void CalcResultHash::AddSlice(const std::shared_ptr<libCZI::IMemoryBlock>& memor
     this->AddHash(hash_of_coordinate);
 }
 
+/*static*/std::array<std::uint8_t, 16> CalcResultHash::CalculateHashOfData(const std::shared_ptr<libCZI::IMemoryBlock>& memory_block)
+{
+    std::array<std::uint8_t, 16> hash_of_data;
+    const size_t size_of_data = memory_block->GetSizeOfData();
+    Utils::CalcMd5SumHash(memory_block->GetPtr(), size_of_data, hash_of_data.data(), sizeof(hash_of_data));
+    return hash_of_data;
+}
+
 std::array<std::uint8_t, 16> CalcResultHash::GetHash()
 {
     std::lock_guard<std::mutex> guard(this->mutex_);
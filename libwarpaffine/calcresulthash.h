@@ -29,6 +29,17 @@ public:
     /// \param  coordinate       The coordinate.
     void AddSlice(const std::shared_ptr<libCZI::IMemoryBlock>& memory_block, const libCZI::CDimCoordinate& coordinate);
 
+    /// Adds a slice to the hash calculation, where the hash of the data has already been calculated (with
+    /// "CalculateHashOfData"). This allows to hash data which is added multiple times only once.
+    /// \param  hash_of_data     The hash of the data (as returned by "CalculateHashOfData").
+    /// \param  coordinate       The coordinate.
+    void AddSlice(const std::array<std::uint8_t, 16>& hash_of_data, const libCZI::CDimCoordinate& coordinate);
+
+    /// Calculates the hash of the data of the specified memory-block (as it is used by "AddSlice").
+    /// \param  memory_block     Memory block to be hashed.
+    /// \returns The hash of the data.
+    static std::array<std::uint8_t, 16> CalculateHashOfData(const std::shared_ptr<libCZI::IMemoryBlock>& memory_block);
+
     /// Gets the cumulative hash.
     /// \returns    The hash.
     std::array<std::uint8_t, 16> GetHash();
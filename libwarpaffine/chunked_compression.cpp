@@ -0,0 +1,174 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "chunked_compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace libCZI;
+
+/*static*/const char* ChunkedZstdCompression::kPropertyBagKey_chunk_size_mb = "chunk_size_mb";
+
+ChunkedZstdCompression::ChunkedZstdCompression(
+    BrickAllocator& allocator,
+    libCZI::CompressionMode compression_mode,
+    libCZI::PixelType pixel_type,
+    std::uint32_t width,
+    std::uint32_t height,
+    std::uint32_t stride,
+    const void* source,
+    const libCZI::ICompressParameters* parameters,
+    size_t chunk_size)
+    : allocator_(allocator), parameters_(parameters), chunk_size_(chunk_size)
+{
+    // the chunks are compressed as "zstd0"-bitmaps of type Gray8 with a height of one, so the size of a chunk
+    //  must be representable as the width of a bitmap
+    if (chunk_size == 0 || chunk_size > numeric_limits<uint32_t>::max())
+    {
+        ostringstream string_stream;
+        string_stream << "Invalid chunk size " << chunk_size << ".";
+        throw invalid_argument(string_stream.str());
+    }
+
+    bool do_lo_hi_byte_packing = false;
+    switch (compression_mode)
+    {
+    case CompressionMode::Zstd0:
+        break;
+    case CompressionMode::Zstd1:
+    {
+        // the "lo-hi-byte packing" is only applicable for pixel types with 16 bits per channel (the same logic is
+        //  found in libCZI's zstd1-compression)
+        CompressParameter parameter;
+        if ((pixel_type == PixelType::Gray16 || pixel_type == PixelType::Bgr48) &&
+            parameters != nullptr &&
+            parameters->TryGetProperty(static_cast<int>(CompressionParameterKey::ZSTD_PREPROCESS_DOLOHIBYTEPACKING), &parameter))
+        {
+            do_lo_hi_byte_packing = parameter.GetBoolean();
+        }
+
+        // The zstd1-header gives the size of the header in the first byte, followed by "chunks" - the only chunk
+        //  defined is "lo-hi-byte packing" (type 1) with a one-byte payload.
+        if (do_lo_hi_byte_packing)
+        {
+            this->header_ = { 3, 1, 1 };
+        }
+        else
+        {
+            this->header_ = { 1 };
+        }
+
+        break;
+    }
+    default:
+        throw invalid_argument("Chunked compression is only supported for zstd0 and zstd1.");
+    }
+
+    this->PreparePayload(pixel_type, width, height, stride, source, do_lo_hi_byte_packing);
+    this->compressed_chunks_.resize(ChunkedZstdCompression::CalculateNumberOfChunks(this->size_of_payload_, chunk_size));
+}
+
+void ChunkedZstdCompression::PreparePayload(libCZI::PixelType pixel_type, std::uint32_t width, std::uint32_t height, std::uint32_t stride, const void* source, bool do_lo_hi_byte_packing)
+{
+    const size_t bytes_per_line = static_cast<size_t>(width) * Utils::GetBytesPerPixel(pixel_type);
+    this->size_of_payload_ = static_cast<uint64_t>(bytes_per_line) * height;
+    const auto* source_bytes = static_cast<const uint8_t*>(source);
+
+    if (do_lo_hi_byte_packing)
+    {
+        // all the low-bytes (of the 16-bit words) are put first, followed by all the high-bytes
+        this->prepared_payload_ = this->allocator_.Allocate(BrickAllocator::MemoryType::CompressionScratchBuffer, this->size_of_payload_);
+        const size_t words_per_line = bytes_per_line / 2;
+        uint8_t* low_bytes = static_cast<uint8_t*>(this->prepared_payload_.get());
+        uint8_t* high_bytes = static_cast<uint8_t*>(this->prepared_payload_.get()) + this->size_of_payload_ / 2;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* line = source_bytes + static_cast<size_t>(y) * stride;
+            for (size_t x = 0; x < words_per_line; ++x)
+            {
+                *low_bytes++ = line[2 * x];
+                *high_bytes++ = line[2 * x + 1];
+            }
+        }
+
+        this->payload_ = static_cast<const uint8_t*>(this->prepared_payload_.get());
+    }
+    else if (stride == bytes_per_line)
+    {
+        this->payload_ = source_bytes;
+    }
+    else
+    {
+        this->prepared_payload_ = this->allocator_.Allocate(BrickAllocator::MemoryType::CompressionScratchBuffer, this->size_of_payload_);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            memcpy(static_cast<uint8_t*>(this->prepared_payload_.get()) + static_cast<size_t>(y) * bytes_per_line, source_bytes + static_cast<size_t>(y) * stride, bytes_per_line);
+        }
+
+        this->payload_ = static_cast<const uint8_t*>(this->prepared_payload_.get());
+    }
+}
+
+void ChunkedZstdCompression::CompressChunk(size_t chunk_index)
+{
+    const uint64_t offset = static_cast<uint64_t>(chunk_index) * this->chunk_size_;
+    const auto size_of_chunk = static_cast<uint32_t>(min(static_cast<uint64_t>(this->chunk_size_), this->size_of_payload_ - offset));
+    const size_t max_size_necessary = ZstdCompress::CalculateMaxCompressedSizeZStd0(size_of_chunk, 1, PixelType::Gray8);
+
+    auto& compressed_chunk = this->compressed_chunks_.at(chunk_index);
+    compressed_chunk.data = this->allocator_.Allocate(BrickAllocator::MemoryType::CompressionScratchBuffer, max_size_necessary);
+    compressed_chunk.size = max_size_necessary;
+    const bool b = ZstdCompress::CompressZStd0(
+        size_of_chunk,
+        1,
+        size_of_chunk,
+        PixelType::Gray8,
+        this->payload_ + offset,
+        compressed_chunk.data.get(),
+        compressed_chunk.size,
+        this->parameters_);
+    if (!b)
+    {
+        ostringstream error_text;
+        error_text << "Compression of chunk #" << chunk_index << " failed with the max possible size (size=" << max_size_necessary << ").";
+        throw logic_error(error_text.str());
+    }
+}
+
+size_t ChunkedZstdCompression::GetSizeOfResult() const
+{
+    size_t size = this->header_.size();
+    for (const auto& compressed_chunk : this->compressed_chunks_)
+    {
+        size += compressed_chunk.size;
+    }
+
+    return size;
+}
+
+void ChunkedZstdCompression::CopyResult(void* destination) const
+{
+    auto* destination_bytes = static_cast<uint8_t*>(destination);
+    if (!this->header_.empty())
+    {
+        memcpy(destination_bytes, this->header_.data(), this->header_.size());
+        destination_bytes += this->header_.size();
+    }
+
+    for (const auto& compressed_chunk : this->compressed_chunks_)
+    {
+        memcpy(destination_bytes, compressed_chunk.data.get(), compressed_chunk.size);
+        destination_bytes += compressed_chunk.size;
+    }
+}
+
+/*static*/size_t ChunkedZstdCompression::CalculateNumberOfChunks(std::uint64_t size_of_payload, size_t chunk_size)
+{
+    return static_cast<size_t>((size_of_payload + chunk_size - 1) / chunk_size);
+}
@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "inc_libCZI.h"
+#include "BrickAllocator.h"
+
+/// This class implements the "chunked compression" of a slice with zstd - which allows to compress a large slice concurrently.
+/// The payload of the slice (i.e. the data which is fed into the zstd-compressor, for "zstd1" with "HiLoByteUnpack" this is
+/// the data after the preprocessing) is split into chunks, and each chunk is compressed into an independent zstd-frame.
+/// The chunks can be compressed concurrently, and the frames are then concatenated (preceded by the "zstd1"-header if applicable).
+/// A sequence of zstd-frames is a valid zstd-stream (which decodes to the concatenation of the content of the frames), so the
+/// result is a valid "zstd0"- or "zstd1"-subblock. The operation is:
+/// - construct the object (which prepares the payload)
+/// - call 'CompressChunk' for all chunks (0 ... GetNumberOfChunks()-1), which may be done concurrently
+/// - get the size of the result with 'GetSizeOfResult' and retrieve it with 'CopyResult'.
+/// The memory for the prepared payload and for the compressed chunks is taken from the allocator (as "compression scratch
+/// buffer"), and it is released when the object is destroyed.
+class ChunkedZstdCompression
+{
+public:
+    /// This key for the "compression property bag" gives the size of a chunk (in units of megabytes) - slices whose payload is
+    /// larger than this are compressed in chunks (concurrently). The type is "int32", the default is "0" (meaning that slices
+    /// are not split into chunks).
+    static const char* kPropertyBagKey_chunk_size_mb;
+
+    /// Constructor. The source data must remain valid until all chunks have been compressed.
+    ///
+    /// \param [in] allocator       The allocator (which must remain valid for the lifetime of this object).
+    /// \param  compression_mode    The compression mode, which must be "zstd0" or "zstd1".
+    /// \param  pixel_type          The pixel type of the source bitmap.
+    /// \param  width               The width of the source bitmap in pixels.
+    /// \param  height              The height of the source bitmap in pixels.
+    /// \param  stride              The stride of the source bitmap in bytes.
+    /// \param  source              Pointer to the source bitmap.
+    /// \param  parameters          The compression parameters (may be null).
+    /// \param  chunk_size          The size of a chunk in bytes (which must be greater than zero).
+    ChunkedZstdCompression(
+        BrickAllocator& allocator,
+        libCZI::CompressionMode compression_mode,
+        libCZI::PixelType pixel_type,
+        std::uint32_t width,
+        std::uint32_t height,
+        std::uint32_t stride,
+        const void* source,
+        const libCZI::ICompressParameters* parameters,
+        size_t chunk_size);
+
+    /// Gets the number of chunks the payload is split into.
+    ///
+    /// \returns The number of chunks.
+    size_t GetNumberOfChunks() const { return this->compressed_chunks_.size(); }
+
+    /// Compresses the specified chunk. This method may be called concurrently for different chunks.
+    ///
+    /// \param  chunk_index Zero-based index of the chunk.
+    void CompressChunk(size_t chunk_index);
+
+    /// Gets the size of the result in bytes - this is only valid after all chunks have been compressed.
+    ///
+    /// \returns The size of the result in bytes.
+    size_t GetSizeOfResult() const;
+
+    /// Copies the result (i.e. the header followed by the compressed chunks) to the specified destination, which must
+    /// be (at least) of the size reported by 'GetSizeOfResult'.
+    ///
+    /// \param [out] destination    The destination.
+    void CopyResult(void* destination) const;
+
+    /// Gets the number of chunks a payload of the specified size is split into.
+    ///
+    /// \param  size_of_payload The size of the payload in bytes.
+    /// \param  chunk_size      The size of a chunk in bytes.
+    ///
+    /// \returns The number of chunks.
+    static size_t CalculateNumberOfChunks(std::uint64_t size_of_payload, size_t chunk_size);
+private:
+    struct CompressedChunk
+    {
+        std::shared_ptr<void> data;
+        size_t size{ 0 };
+    };
+
+    BrickAllocator& allocator_;
+    const libCZI::ICompressParameters* parameters_;
+    size_t chunk_size_;
+    std::vector<std::uint8_t> header_;                  ///< The header which precedes the zstd-frames (for "zstd1"), empty for "zstd0".
+    std::shared_ptr<void> prepared_payload_;            ///< If the payload needs to be prepared (i.e. preprocessed or made contiguous), this is where it is stored.
+    const std::uint8_t* payload_;
+    std::uint64_t size_of_payload_;
+    std::vector<CompressedChunk> compressed_chunks_;
+
+    void PreparePayload(libCZI::PixelType pixel_type, std::uint32_t width, std::uint32_t height, std::uint32_t stride, const void* source, bool do_lo_hi_byte_packing);
+};
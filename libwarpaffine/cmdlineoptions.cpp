@@ -5,6 +5,9 @@
 #include "cmdlineoptions.h"
 #include "utilities.h"
 #include "brickreader/IBrickReader.h"
+#include "taskarena/ITaskArena.h"
+#include "sliceswriter/ISlicesWriter.h"
+#include "adaptive_compression_level.h"
 #include "CLI/App.hpp"
 #include "CLI/Formatter.hpp"
 #include "CLI/Config.hpp"
@@ -20,6 +23,8 @@
 #include <memory>
 #include <limits>
 #include <utility>
+#include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -240,6 +245,7 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
     std::map<std::string, TaskArenaImplementation> map_string_to_task_arena_implementation
     {
         { "tbb", TaskArenaImplementation::kTBB},
+        { "std", TaskArenaImplementation::kStd},
     };
 
     // specify the string-to-enum-mapping for "verbosity"
@@ -265,10 +271,14 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
     int number_of_reader_threads = 1;
     string compression_options_text;
     string brickreader_parameters;
+    string taskarena_parameters;
+    string writer_parameters;
+    string compression_parameters;
     string argument_source_stream_class;
     string argument_source_stream_creation_propbag;
     MessagesPrintVerbosity print_out_verbosity;
     bool hash_result = false;
+    bool omit_empty_subblocks = false;
     int max_tile_extent;
     string override_ram_size_parameter;
     bool override_check_for_skewed_source = false;
@@ -277,6 +287,7 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
     bool do_not_copy_attachments_from_source_to_destination = false;
     double illumination_angle_degrees = std::numeric_limits<double>::quiet_NaN();
     bool allow_memory_oversubscription = false;
+    string analysis_cache_filename;
     app.add_option("-s,--source", source_filename, "The source CZI-file to be processed.")
         ->option_text("SOURCE_FILE")
         ->required();
@@ -322,7 +333,7 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
         ->option_text("STOP_AFTER_OPERATION")
         ->default_val(TestStopPipelineAfter::kNone)
         ->transform(CLI::CheckedTransformer(map_string_to_stop_pipeline_after_operation, CLI::ignore_case));
-    app.add_option("--task_arena_implementation", task_arena_implementation, "For testing: choose the task-arena implementation. Currently, there is only one available: 'tbb'.")
+    app.add_option("--task_arena_implementation", task_arena_implementation, "For testing: choose the task-arena implementation. Possible values are 'tbb' (the default) and 'std' (a work-stealing pool of std::threads).")
         ->option_text("TASK_ARENA_IMPLEMENTATION")
         ->default_val(TaskArenaImplementation::kTBB)
         ->transform(CLI::CheckedTransformer(map_string_to_task_arena_implementation, CLI::ignore_case));
@@ -330,6 +341,19 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
         ->option_text("COMPRESSION_OPTIONS")
         ->default_val(CCmdLineOptions::kDefaultCompressionOptions);
     app.add_option("--parameters_bricksource", brickreader_parameters, "Specify parameters for the brick-reader");
+    app.add_option("--parameters_taskarena", taskarena_parameters,
+        "Specify parameters for the task-arena, e.g. the max number of concurrently executing tasks per task-type "
+        "('max_concurrent_decompress_tasks', 'max_concurrent_composition_tasks', 'max_concurrent_warp_tasks' and "
+        "'max_concurrent_compress_tasks'), whether downstream tasks are given priority ('prioritize_downstream_tasks') "
+        "or whether the NUMA-nodes are modeled ('numa_aware').")
+        ->option_text("TASK_ARENA_PARAMETERS");
+    app.add_option("--parameters_writer", writer_parameters,
+        "Specify parameters for the writer of the output file, e.g. whether the subblocks are written concurrently ('parallel_write') or with direct I/O ('direct_io'), or whether the output is distributed to several files ('fan_out').")
+        ->option_text("WRITER_PARAMETERS");
+    app.add_option("--parameters_compression", compression_parameters,
+        "Specify parameters for the compression, e.g. whether the zstd-level is adjusted to the state of the pipeline ('adaptive_level') "
+        "within given bounds ('min_level' and 'max_level'), or whether large slices are compressed concurrently in chunks ('chunk_size_mb').")
+        ->option_text("COMPRESSION_PARAMETERS");
     app.add_option("--verbosity", print_out_verbosity,
         "Specify the verbosity for messages from the application. Possible values are "
         "'maximal' (3), 'chatty' (2), 'normal' (1) or 'minimal' (0).")
@@ -337,6 +361,7 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
         ->default_val(MessagesPrintVerbosity::kNormal)
         ->transform(CLI::CheckedTransformer(map_string_to_print_out_verbosity, CLI::ignore_case));
     app.add_flag("--hash-result", hash_result, "Calculate a hash for the result data.");
+    app.add_flag("--omit-empty-subblocks", omit_empty_subblocks, "Do not write subblocks which are known to be all zero (i.e. outside of the source volume).");
     app.add_option("-m,--max-tile-extent", max_tile_extent,
         "Specify the max width/height of a tile. If larger, the tile is split into smaller tiles. Default is 2048.")
         ->option_text("MAX_TILE_EXTENT")
@@ -366,6 +391,11 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
         "insufficient. With this flag, processing continues using the minimum "
         "required memory. \\nWarning: May cause significant performance "
         "degradation or system instability.");
+    app.add_option("--analysis-cache", analysis_cache_filename,
+        "Specifies a file where the result of analyzing the source document (subblock-directory and reading order) is cached. "
+        "If the file exists and was created for the same source file (same size, last-write-time and file-header), "
+        "the analysis is loaded from it; otherwise the file is (re-)written.")
+        ->option_text("CACHE_FILE");
 
     auto formatter = make_shared<CustomFormatter>();
     app.formatter(formatter);
@@ -398,6 +428,7 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
     this->compression_option_ = libCZI::Utils::ParseCompressionOptions(compression_options_text);
     this->verbosity_ = print_out_verbosity;
     this->hash_result_ = hash_result;
+    this->omit_empty_subblocks_ = omit_empty_subblocks;
     this->max_tile_extent_ = max_tile_extent;
     this->override_check_for_skewed_source_ = override_check_for_skewed_source;
     this->use_acquisition_tiles_ = use_acquisition_tiles;
@@ -405,6 +436,7 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
     this->copy_attachments_from_source_to_destination_ = !do_not_copy_attachments_from_source_to_destination;
     this->source_stream_class_ = argument_source_stream_class;
     this->allow_memory_oversubscription_ = allow_memory_oversubscription;
+    this->analysis_cache_filename_ = analysis_cache_filename;
     if (!std::isnan(illumination_angle_degrees))
     {
         this->illumination_angle_degrees_ = illumination_angle_degrees;
@@ -431,10 +463,79 @@ CCmdLineOptions::ParseResult CCmdLineOptions::Parse(int argc, char** argv)
                     return PropertyBagTools::ValueType::kInt32;
                 }
 
+                if (key == ICziBrickReader::kPropertyBagKey_LinearReader_defer_decompression)
+                {
+                    return PropertyBagTools::ValueType::kBoolean;
+                }
+
                 return PropertyBagTools::ValueType::kString;
             });
     }
 
+    if (!taskarena_parameters.empty())
+    {
+        PropertyBagTools::ParseFromString(
+            this->property_bag_task_arena_,
+            taskarena_parameters,
+            [](const string& key)->PropertyBagTools::ValueType
+            {
+                if (key == ITaskArena::kPropertyBagKey_prioritize_downstream_tasks ||
+                    key == ITaskArena::kPropertyBagKey_numa_aware)
+                {
+                    return PropertyBagTools::ValueType::kBoolean;
+                }
+
+                return PropertyBagTools::ValueType::kInt32;
+            });
+    }
+
+    if (!writer_parameters.empty())
+    {
+        PropertyBagTools::ParseFromString(
+            this->property_bag_writer_,
+            writer_parameters,
+            [](const string& key)->PropertyBagTools::ValueType
+            {
+                if (key == ICziSlicesWriter::kPropertyBagKey_parallel_write ||
+                    key == ICziSlicesWriter::kPropertyBagKey_direct_io)
+                {
+                    return PropertyBagTools::ValueType::kBoolean;
+                }
+
+                if (key == ICziSlicesWriter::kPropertyBagKey_fan_out)
+                {
+                    return PropertyBagTools::ValueType::kString;
+                }
+
+                return PropertyBagTools::ValueType::kInt32;
+            });
+    }
+
+    if (!compression_parameters.empty())
+    {
+        PropertyBagTools::ParseFromString(
+            this->property_bag_compression_,
+            compression_parameters,
+            [](const string& key)->PropertyBagTools::ValueType
+            {
+                if (key == AdaptiveCompressionLevel::kPropertyBagKey_adaptive_level)
+                {
+                    return PropertyBagTools::ValueType::kBoolean;
+                }
+
+                return PropertyBagTools::ValueType::kInt32;
+            });
+    }
+
+    // with the "adaptive compression level" mode, the compressed data depends on the timing of the operation - so
+    //  a hash of it would not be reproducible
+    if (this->hash_result_ && this->property_bag_compression_.GetBoolOrDefault(AdaptiveCompressionLevel::kPropertyBagKey_adaptive_level, false))
+    {
+        ostringstream string_stream;
+        string_stream << "The option '--hash-result' cannot be combined with the compression-parameter '" << AdaptiveCompressionLevel::kPropertyBagKey_adaptive_level << "'.";
+        throw invalid_argument(string_stream.str());
+    }
+
     if (!argument_source_stream_creation_propbag.empty())
     {
         const bool b = TryParseInputStreamCreationPropertyBag(argument_source_stream_creation_propbag, &this->property_bag_for_stream_class);
@@ -35,8 +35,12 @@ private:
     TaskArenaImplementation task_arena_implementation_{ TaskArenaImplementation::kTBB };
     libCZI::Utils::CompressionOption compression_option_;
     PropertyBag property_bag_brick_source_;
+    PropertyBag property_bag_task_arena_;
+    PropertyBag property_bag_writer_;
+    PropertyBag property_bag_compression_;
     MessagesPrintVerbosity verbosity_{ MessagesPrintVerbosity::kNormal };
     bool hash_result_{ false };
+    bool omit_empty_subblocks_{ false };
     std::uint32_t max_tile_extent_{ 2048 };
     std::uint64_t override_main_memory_size_{ 0 };
     bool override_check_for_skewed_source_{ false };
@@ -47,6 +51,7 @@ private:
     std::string source_stream_class_;
     std::map<int, libCZI::StreamsFactory::Property> property_bag_for_stream_class;
     std::optional<double> illumination_angle_degrees_;
+    std::string analysis_cache_filename_;
 public:
     /// Values that represent the result of the "Parse"-operation.
     enum class ParseResult
@@ -86,8 +91,12 @@ public:
     [[nodiscard]] TaskArenaImplementation GetTaskArenaImplementation() const { return this->task_arena_implementation_; }
     [[nodiscard]] const libCZI::Utils::CompressionOption& GetCompressionOptions() const { return this->compression_option_; }
     [[nodiscard]] const IPropBag& GetPropertyBagForBrickSource() const { return this->property_bag_brick_source_; }
+    [[nodiscard]] const IPropBag& GetPropertyBagForTaskArena() const { return this->property_bag_task_arena_; }
+    [[nodiscard]] const IPropBag& GetPropertyBagForWriter() const { return this->property_bag_writer_; }
+    [[nodiscard]] const IPropBag& GetPropertyBagForCompression() const { return this->property_bag_compression_; }
     [[nodiscard]] MessagesPrintVerbosity GetPrintOutVerbosity() const { return this->verbosity_; }
     [[nodiscard]] bool GetDoCalculateHashOfOutputData() const { return this->hash_result_; }
+    [[nodiscard]] bool GetDoOmitEmptySubblocks() const { return this->omit_empty_subblocks_; }
     [[nodiscard]] std::uint32_t GetMaxOutputTileExtent() const { return this->max_tile_extent_; }
     [[nodiscard]] bool GetIsMainMemorySizeOverrideValid() const { return this->override_main_memory_size_ != 0; }
     [[nodiscard]] std::uint64_t GetMainMemorySizeOverride() const { return this->override_main_memory_size_; }
@@ -100,6 +109,10 @@ public:
     /// Gets the illumination angle override from command line, if specified.
     /// \returns The illumination angle in degrees if specified, nullopt otherwise.
     [[nodiscard]] std::optional<double> GetIlluminationAngleOverride() const { return this->illumination_angle_degrees_; }
+
+    /// Gets the filename of the analysis-cache file (where the result of analyzing the source document is persisted).
+    /// \returns The filename of the analysis-cache file, or an empty string if no analysis-cache is to be used.
+    [[nodiscard]] const std::string& GetAnalysisCacheFilename() const { return this->analysis_cache_filename_; }
 private:
     bool TryParseInputStreamCreationPropertyBag(const std::string& s, std::map<int, libCZI::StreamsFactory::Property>* property_bag);
 };
@@ -52,7 +52,7 @@ enum class Interpolation
 enum class TaskArenaImplementation
 {
     kTBB,       ///< An enum constant representing the "task arena implementation" based on Intel TBB.
-    /*IFB*/
+    kStd,       ///< An enum constant representing the "task arena implementation" based on a work-stealing pool of std::threads.
 };
 
 /// Values that represent different levels of "print-out verbosity", i.e. how much
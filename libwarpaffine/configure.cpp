@@ -144,9 +144,38 @@ bool Configure::DoConfiguration(const DeskewDocumentInfo& deskew_document_info,
     this->app_context_.GetAllocator().SetMaximumMemoryLimitForMemoryType(BrickAllocator::MemoryType::DestinationBrick, limit_for_memory_type_destination_brick);
     this->app_context_.GetAllocator().SetHighWatermark(high_water_mark_limit);
 
+    this->ConfigureFlowControl(memory_characteristics, high_water_mark_limit, limit_for_memory_type_destination_brick);
+
     return true;
 }
 
+void Configure::ConfigureFlowControl(const MemoryCharacteristicsOfOperation& memory_characteristics, std::uint64_t high_water_mark_limit, std::uint64_t limit_for_memory_type_destination_brick)
+{
+    // The budgets for the stages of the pipeline are chosen so that (in steady state) the high-water mark is not
+    //  reached, i.e. the reader is throttled by the credits (and not paused by the high-water mark):
+    // * for compressed subblocks (waiting to be decoded) we allow for about 1/32 of the main-memory, and 1/8 for decoded planes
+    // * the budget for destination bricks is the limit for the memory-type "destination brick"
+    // * slices queued for compression are part of the destination bricks, we allow for at least one (tiled) output brick
+    // * for compressed slices queued in the writer we allow for 1/32 of the main-memory
+    // * the source bricks get half of what remains below the high-water mark, but at least one input brick
+    const uint64_t budget_read = this->physical_memory_size_ / 32;
+    const uint64_t budget_decode = this->physical_memory_size_ / 8;
+    const uint64_t budget_write = this->physical_memory_size_ / 32;
+    const uint64_t budget_compress = max(memory_characteristics.max_size_of_output_brick_including_tiling, this->physical_memory_size_ / 16);
+    const uint64_t sum_of_budgets_reader_and_writer = budget_read + budget_decode + budget_write;
+    const uint64_t budget_compose = max(
+        memory_characteristics.max_size_of_input_brick,
+        high_water_mark_limit > sum_of_budgets_reader_and_writer ? (high_water_mark_limit - sum_of_budgets_reader_and_writer) / 2 : 0);
+
+    auto& flow_control = this->app_context_.GetFlowControl();
+    flow_control.SetBudget(FlowControl::Stage::Read, budget_read);
+    flow_control.SetBudget(FlowControl::Stage::Decode, budget_decode);
+    flow_control.SetBudget(FlowControl::Stage::Compose, budget_compose);
+    flow_control.SetBudget(FlowControl::Stage::Warp, limit_for_memory_type_destination_brick);
+    flow_control.SetBudget(FlowControl::Stage::Compress, budget_compress);
+    flow_control.SetBudget(FlowControl::Stage::Write, budget_write);
+}
+
 /*static*/std::uint64_t Configure::DetermineMainMemorySize()
 {
 #if LIBWARPAFFINE_WIN32_ENVIRONMENT
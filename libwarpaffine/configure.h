@@ -37,4 +37,11 @@ private:
     };
 
     static MemoryCharacteristicsOfOperation CalculateMemoryCharacteristics(const DeskewDocumentInfo& deskew_document_info, const DoWarp& do_warp);
+
+    /// Sets up the budgets of the pipeline stages for the flow control.
+    ///
+    /// \param  memory_characteristics                      The memory characteristics of the operation.
+    /// \param  high_water_mark_limit                       The high-water mark which has been determined.
+    /// \param  limit_for_memory_type_destination_brick     The limit for the memory-type "destination brick" which has been determined.
+    void ConfigureFlowControl(const MemoryCharacteristicsOfOperation& memory_characteristics, std::uint64_t high_water_mark_limit, std::uint64_t limit_for_memory_type_destination_brick);
 };
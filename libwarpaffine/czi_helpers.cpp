@@ -3,6 +3,8 @@
 // SPDX-License-Identifier: MIT
 
 #include "czi_helpers.h"
+#include "document_analysis.h"
+#include <atomic>
 #include <vector>
 #include <algorithm>
 #include <limits>
@@ -40,12 +42,69 @@ namespace
 
         return value;
     }
+
+    /// This is an implementation of the libCZI::IBitmapData-interface which references the data of an
+    /// uncompressed sub-block. The sub-block is kept alive by this object.
+    class SubblockDataBitmapFacade : public libCZI::IBitmapData
+    {
+    private:
+        std::shared_ptr<libCZI::ISubBlock> sub_block_;
+        const void* ptr_data_;
+        libCZI::PixelType pixeltype_;
+        std::uint32_t width_;
+        std::uint32_t height_;
+        std::uint32_t stride_;
+        std::atomic<int> lock_count_{ 0 };
+    public:
+        SubblockDataBitmapFacade(std::shared_ptr<libCZI::ISubBlock> sub_block, const void* ptr_data, libCZI::PixelType pixeltype, std::uint32_t width, std::uint32_t height, std::uint32_t stride)
+            : sub_block_(std::move(sub_block)), ptr_data_(ptr_data), pixeltype_(pixeltype), width_(width), height_(height), stride_(stride)
+        {
+        }
+
+        libCZI::PixelType GetPixelType() const override
+        {
+            return this->pixeltype_;
+        }
+
+        libCZI::IntSize GetSize() const override
+        {
+            return libCZI::IntSize{ this->width_, this->height_ };
+        }
+
+        libCZI::BitmapLockInfo Lock() override
+        {
+            ++this->lock_count_;
+            libCZI::BitmapLockInfo bitmap_lock_info;
+
+            // the data is only to be read from, the interface just does not allow to express this
+            bitmap_lock_info.ptrData = const_cast<void*>(this->ptr_data_);
+            bitmap_lock_info.ptrDataRoi = bitmap_lock_info.ptrData;
+            bitmap_lock_info.stride = this->stride_;
+            bitmap_lock_info.size = static_cast<uint64_t>(this->stride_) * this->height_;
+            return bitmap_lock_info;
+        }
+
+        void Unlock() override
+        {
+            --this->lock_count_;
+        }
+
+        int GetLockCount() const override
+        {
+            return this->lock_count_.load();
+        }
+    };
 }
 
 /*static*/DeskewDocumentInfo CziHelpers::GetDocumentInfo(libCZI::ICZIReader* czi_reader)
+{
+    return CziHelpers::GetDocumentInfo(czi_reader, DocumentAnalysis(czi_reader));
+}
+
+/*static*/DeskewDocumentInfo CziHelpers::GetDocumentInfo(libCZI::ICZIReader* czi_reader, const DocumentAnalysis& document_analysis)
 {
     DeskewDocumentInfo document_info;
-    const auto statistics = czi_reader->GetStatistics();
+    const auto& statistics = document_analysis.GetStatistics();
     document_info.width = statistics.boundingBox.w;
     document_info.height = statistics.boundingBox.h;
 
@@ -72,21 +131,19 @@ namespace
     document_info.document_origin_x = statistics.boundingBoxLayer0Only.x;
     document_info.document_origin_y = statistics.boundingBoxLayer0Only.y;
 
-    auto vector_mindex_and_rect = CziHelpers::GetTileIdentifierRectangles(czi_reader);
-
     // TODO(JBL): 
     // If we have more than one element, then the tile-identifiers must be unique (and there must not be an invalid m-index). We should
     // check for this here.
-    for (const auto& item : vector_mindex_and_rect)
+    for (const auto& item : document_analysis.GetSubblockIndex()->GetTileIdentifierToRectangleMap())
     {
         BrickInPlaneIdentifier brick_identifier;
-        brick_identifier.m_index = item.tile_identifier.m_index.value_or(std::numeric_limits<int>::min());
-        brick_identifier.s_index = item.tile_identifier.scene_index.value_or(std::numeric_limits<int>::min());
-        BrickRectPositionInfo position_info{ item.rectangle.x, item.rectangle.y, static_cast<uint32_t>(item.rectangle.w), static_cast<uint32_t>(item.rectangle.h) };
+        brick_identifier.m_index = item.first.m_index.value_or(std::numeric_limits<int>::min());
+        brick_identifier.s_index = item.first.scene_index.value_or(std::numeric_limits<int>::min());
+        BrickRectPositionInfo position_info{ item.second.x, item.second.y, static_cast<uint32_t>(item.second.w), static_cast<uint32_t>(item.second.h) };
         document_info.map_brickid_position.insert(pair<BrickInPlaneIdentifier, BrickRectPositionInfo>(brick_identifier, position_info));
     }
 
-    document_info.map_channelindex_pixeltype = CziHelpers::GetMapOfChannelsToPixeltype(czi_reader);
+    document_info.map_channelindex_pixeltype = document_analysis.GetMapOfChannelsToPixeltype();
 
     return document_info;
 }
@@ -484,3 +541,39 @@ static bool IsCoordinateInBrick(const libCZI::CDimCoordinate& brick_coordinate,
 
     return std::make_tuple(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
 }
+
+/*static*/std::shared_ptr<libCZI::IBitmapData> CziHelpers::CreateBitmapFromSubblock(const std::shared_ptr<libCZI::ISubBlock>& sub_block)
+{
+    const auto& sub_block_info = sub_block->GetSubBlockInfo();
+    if (sub_block_info.GetCompressionMode() == CompressionMode::UnCompressed)
+    {
+        // the data of an uncompressed sub-block is the bitmap with its physical size and a "packed" stride - if
+        //  the data is not as expected, we leave it to libCZI to deal with it
+        const void* ptr_data;
+        size_t size_of_data;
+        sub_block->DangerousGetRawData(ISubBlock::MemBlkType::Data, ptr_data, size_of_data);
+        const uint8_t bytes_per_pixel = Utils::GetBytesPerPixel(sub_block_info.pixelType);
+        const uint32_t stride = sub_block_info.physicalSize.w * bytes_per_pixel;
+        if (ptr_data != nullptr && bytes_per_pixel != 0 && static_cast<uint64_t>(stride) * sub_block_info.physicalSize.h <= size_of_data)
+        {
+            return make_shared<SubblockDataBitmapFacade>(
+                sub_block,
+                ptr_data,
+                sub_block_info.pixelType,
+                sub_block_info.physicalSize.w,
+                sub_block_info.physicalSize.h,
+                stride);
+        }
+    }
+
+    return sub_block->CreateBitmap();
+}
+
+/*static*/std::uint64_t CziHelpers::GetMemorySizeOfSubblock(libCZI::ISubBlock* sub_block)
+{
+    size_t size_data, size_attachment;
+    const void* dummy;
+    sub_block->DangerousGetRawData(ISubBlock::Data, dummy, size_data);
+    sub_block->DangerousGetRawData(ISubBlock::Attachment, dummy, size_attachment);
+    return size_data + size_attachment;
+}
@@ -139,6 +139,8 @@ struct TileIdentifierAndRect
 
 typedef std::map<TileIdentifier, libCZI::IntRect> TileIdentifierToRectangleMap;
 
+class DocumentAnalysis;
+
 /// A bunch of helper functions related to "CZI-documents" are gathered here.
 class CziHelpers
 {
@@ -149,6 +151,14 @@ public:
     /// \returns  The document information.
     static DeskewDocumentInfo GetDocumentInfo(libCZI::ICZIReader* czi_reader);
 
+    /// Extract the "DeskewDocumentInfo" from the CZI, and throw an exception if the document is not
+    /// found "suitable" for our purposes. All information derived from the subblock-directory is taken
+    /// from the specified document-analysis (so that the subblock-directory is not enumerated again).
+    /// \param [in] czi_reader       The czi reader.
+    /// \param      document_analysis The document analysis.
+    /// \returns  The document information.
+    static DeskewDocumentInfo GetDocumentInfo(libCZI::ICZIReader* czi_reader, const DocumentAnalysis& document_analysis);
+
     /// If the specified document has M-index, then we gather an array with "m-index" and "region for this
     /// m-index". If the specified document does not have an m-index, we use a value of numeric_limits<int>::min()
     /// for the single item in the returned vector.
@@ -213,4 +223,21 @@ public:
     /// \returns    If successful, a tuple with the x- and y-coordinates of the stage position; otherwise, a 
     ///             tuple with both coordinates set to NaN.
     static std::tuple<double, double> GetStagePositionFromXmlMetadata(const libCZI::ISubBlock* sub_block);
+
+    /// Gets a bitmap with the content of the specified sub-block. For an uncompressed sub-block, the bitmap
+    /// directly references the data of the sub-block (so, no memory is allocated and no data is copied), and the
+    /// sub-block is kept alive for as long as the bitmap exists. For all other compression modes, the sub-block
+    /// is decoded as usual (i.e. with libCZI::ISubBlock::CreateBitmap).
+    ///
+    /// \param  sub_block   The sub block.
+    ///
+    /// \returns    The bitmap.
+    static std::shared_ptr<libCZI::IBitmapData> CreateBitmapFromSubblock(const std::shared_ptr<libCZI::ISubBlock>& sub_block);
+
+    /// Gets the amount of memory occupied by the specified subblock (i.e. the size of its data and attachment).
+    ///
+    /// \param [in] sub_block   The sub block.
+    ///
+    /// \returns    The size in bytes of the subblock's data and attachment.
+    static std::uint64_t GetMemorySizeOfSubblock(libCZI::ISubBlock* sub_block);
 };
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "document_analysis.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+using namespace libCZI;
+
+DocumentAnalysis::DocumentAnalysis(libCZI::ICZIReader* czi_reader)
+{
+    const auto time_point_analysis_started = std::chrono::high_resolution_clock::now();
+
+    this->statistics_ = czi_reader->GetStatistics();
+    this->subblocks_.reserve(static_cast<size_t>(max(this->statistics_.subBlockCount, 0)));
+
+    // this is the one and only pass over the subblock-directory
+    czi_reader->EnumerateSubBlocksEx(
+        [this](int index, const DirectorySubBlockInfo& info)->bool
+        {
+            if (this->subblocks_.size() <= static_cast<size_t>(index))
+            {
+                this->subblocks_.resize(static_cast<size_t>(index) + 1);
+            }
+
+            const auto subblock_directory_info = SubblockIndex::GetSubblockDirectoryInfo(info);
+            this->subblocks_[index] = subblock_directory_info;
+
+            // we take note of the pixeltype of the first subblock we find for a channel
+            if (subblock_directory_info.c != SubblockDirectoryInfo::kNotPresent)
+            {
+                this->map_channelindex_pixeltype_.insert(make_pair(subblock_directory_info.c, info.pixelType));
+            }
+
+            if (!this->is_layer0_tile_size_valid_ && subblock_directory_info.is_layer0)
+            {
+                this->layer0_tile_size_ = info.physicalSize;
+                this->is_layer0_tile_size_valid_ = true;
+            }
+
+            return true;
+        });
+
+    this->subblock_index_ = make_shared<SubblockIndex>(this->statistics_, this->subblocks_);
+
+    this->duration_of_analysis_ = std::chrono::high_resolution_clock::now() - time_point_analysis_started;
+}
+
+DocumentAnalysis::DocumentAnalysis(const libCZI::SubBlockStatistics& statistics, std::vector<SubblockDirectoryInfo> subblocks, std::map<int, libCZI::PixelType> map_channelindex_pixeltype)
+    : statistics_(statistics), subblocks_(std::move(subblocks)), map_channelindex_pixeltype_(std::move(map_channelindex_pixeltype))
+{
+    const auto time_point_analysis_started = std::chrono::high_resolution_clock::now();
+
+    // for a layer-0 subblock, the logical size is equal to the physical size, so the tile-size can be
+    //  determined from the logical rectangle here
+    const auto first_layer0_subblock = find_if(
+        this->subblocks_.cbegin(),
+        this->subblocks_.cend(),
+        [](const SubblockDirectoryInfo& info)->bool { return info.is_layer0; });
+    if (first_layer0_subblock != this->subblocks_.cend())
+    {
+        this->layer0_tile_size_ = IntSize{ static_cast<uint32_t>(first_layer0_subblock->logical_rect.w), static_cast<uint32_t>(first_layer0_subblock->logical_rect.h) };
+        this->is_layer0_tile_size_valid_ = true;
+    }
+
+    this->subblock_index_ = make_shared<SubblockIndex>(this->statistics_, this->subblocks_);
+
+    this->duration_of_analysis_ = std::chrono::high_resolution_clock::now() - time_point_analysis_started;
+}
+
+std::map<int, libCZI::PixelType> DocumentAnalysis::GetMapOfChannelsToPixeltype() const
+{
+    int channel_count;
+    if (!this->statistics_.dimBounds.TryGetInterval(DimensionIndex::C, nullptr, &channel_count))
+    {
+        throw invalid_argument("The document must have a C-dimension.");
+    }
+
+    map<int, libCZI::PixelType> map_channelno_to_pixeltype;
+    for (int c = 0; c < channel_count; ++c)
+    {
+        const auto iterator = this->map_channelindex_pixeltype_.find(c);
+        if (iterator == this->map_channelindex_pixeltype_.cend())
+        {
+            ostringstream string_stream;
+            string_stream << "Unable to determine pixeltype for C=" << c << ".";
+            throw invalid_argument(string_stream.str());
+        }
+
+        map_channelno_to_pixeltype[c] = iterator->second;
+    }
+
+    return map_channelno_to_pixeltype;
+}
+
+bool DocumentAnalysis::TryGetLayer0TileSize(libCZI::IntSize* tile_size) const
+{
+    if (!this->is_layer0_tile_size_valid_)
+    {
+        return false;
+    }
+
+    if (tile_size != nullptr)
+    {
+        *tile_size = this->layer0_tile_size_;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const LinearReadingOrder> DocumentAnalysis::TryGetLinearReadingOrder(std::uint32_t max_number_of_subblocks_inflight) const
+{
+    const auto iterator = this->linear_reading_orders_.find(max_number_of_subblocks_inflight);
+    if (iterator == this->linear_reading_orders_.cend())
+    {
+        return nullptr;
+    }
+
+    return iterator->second;
+}
+
+void DocumentAnalysis::SetLinearReadingOrder(std::uint32_t max_number_of_subblocks_inflight, std::shared_ptr<const LinearReadingOrder> linear_reading_order)
+{
+    this->linear_reading_orders_[max_number_of_subblocks_inflight] = std::move(linear_reading_order);
+}
+
+std::map<std::uint32_t, std::shared_ptr<const LinearReadingOrder>> DocumentAnalysis::GetLinearReadingOrders() const
+{
+    return this->linear_reading_orders_;
+}
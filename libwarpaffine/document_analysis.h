@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "inc_libCZI.h"
+#include "subblock_index.h"
+#include "brickreader/brick_coordinate.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+/// The order in which the subblocks are to be read by the "linear-reading" brick-reader (as determined
+/// by LinearReadingOrderHelper::DetermineOrder).
+struct LinearReadingOrder
+{
+    std::vector<int> reading_order;                     ///< The subblock-indices in the order in which they are to be read.
+    std::uint32_t max_number_of_subblocks_inflight{ 0 };///< The max number of "subblocks-in-flight" when reading in this order.
+    std::map<BrickCoordinate, std::uint32_t> number_of_slices_per_brick; ///< The number of slices for each brick.
+};
+
+/// This class gathers all information about the source document which is derived from the subblock-directory.
+/// The analysis is done in a single pass over the subblock-directory (at startup), and the result is then shared
+/// by all consumers (i.e. the document-info construction, the brick-readers and the reading-order-helper), so that
+/// no consumer needs to enumerate the subblock-directory itself.
+class DocumentAnalysis
+{
+private:
+    libCZI::SubBlockStatistics statistics_;
+    std::vector<SubblockDirectoryInfo> subblocks_;
+    std::shared_ptr<const SubblockIndex> subblock_index_;
+    std::map<int, libCZI::PixelType> map_channelindex_pixeltype_;
+    bool is_layer0_tile_size_valid_{ false };
+    libCZI::IntSize layer0_tile_size_{ 0, 0 };
+    std::chrono::duration<double> duration_of_analysis_{ 0 };
+
+    std::map<std::uint32_t, std::shared_ptr<const LinearReadingOrder>> linear_reading_orders_;
+public:
+    DocumentAnalysis() = delete;
+
+    /// Analyze the specified document. Note that this operation does not throw an exception if the document is
+    /// found to be unsuitable, the checks are done by the consumers of the information.
+    ///
+    /// \param [in] czi_reader  The CZI-reader object.
+    explicit DocumentAnalysis(libCZI::ICZIReader* czi_reader);
+
+    /// Constructs the analysis from information which was gathered before (i.e. which was persisted
+    /// by DocumentAnalysisCache). No access to the document is necessary here.
+    ///
+    /// \param  statistics                  The subblock-statistics of the document.
+    /// \param  subblocks                   Information about all subblocks of the document (indexed by the subblock-index).
+    /// \param  map_channelindex_pixeltype  The map "channel index - pixel type" (as found in the document).
+    DocumentAnalysis(const libCZI::SubBlockStatistics& statistics, std::vector<SubblockDirectoryInfo> subblocks, std::map<int, libCZI::PixelType> map_channelindex_pixeltype);
+
+    /// Gets the subblock-statistics of the document.
+    ///
+    /// \returns    The statistics.
+    const libCZI::SubBlockStatistics& GetStatistics() const { return this->statistics_; }
+
+    /// Gets information about all subblocks in the document (including pyramid-subblocks). The vector is
+    /// indexed by the subblock-index.
+    ///
+    /// \returns    The subblock information.
+    const std::vector<SubblockDirectoryInfo>& GetSubblocks() const { return this->subblocks_; }
+
+    /// Gets the index of the layer-0 subblocks.
+    ///
+    /// \returns    The subblock index.
+    const std::shared_ptr<const SubblockIndex>& GetSubblockIndex() const { return this->subblock_index_; }
+
+    /// Gets a map "channel index - pixel type". If this information cannot be determined for every channel
+    /// of the document, an exception is thrown (this is the equivalent of CziHelpers::GetMapOfChannelsToPixeltype).
+    ///
+    /// \returns    The map of channels index to pixeltype.
+    std::map<int, libCZI::PixelType> GetMapOfChannelsToPixeltype() const;
+
+    /// Attempts to get the size of a layer-0 subblock (i.e. the tile-size). The size of the first layer-0 subblock
+    /// found in the directory is reported.
+    ///
+    /// \param [out] tile_size  If successful, the size of a tile is put here.
+    ///
+    /// \returns    True if it succeeds (i.e. a layer-0 subblock was found); false otherwise.
+    bool TryGetLayer0TileSize(libCZI::IntSize* tile_size) const;
+
+    /// Gets the time it took to do the analysis.
+    ///
+    /// \returns    The duration of the analysis.
+    std::chrono::duration<double> GetDurationOfAnalysis() const { return this->duration_of_analysis_; }
+
+    /// Gets the map "channel index - pixel type" as found in the document, without checking for completeness.
+    ///
+    /// \returns    The map of channels index to pixeltype.
+    const std::map<int, libCZI::PixelType>& GetChannelPixeltypes() const { return this->map_channelindex_pixeltype_; }
+
+    /// Attempts to get a linear reading order which was determined before (and stored with this object) for the
+    /// specified constraint. This is a cache for the (rather expensive) operation LinearReadingOrderHelper::DetermineOrder,
+    /// and the information is persisted by DocumentAnalysisCache.
+    ///
+    /// \param  max_number_of_subblocks_inflight The constraint "max number of subblocks in flight" the reading order was determined for.
+    ///
+    /// \returns    If available, the reading order; null otherwise.
+    std::shared_ptr<const LinearReadingOrder> TryGetLinearReadingOrder(std::uint32_t max_number_of_subblocks_inflight) const;
+
+    /// Stores a linear reading order (determined for the specified constraint) with this object. This method
+    /// is not thread-safe - the analysis is to be completed (i.e. all reading orders are to be added) before it
+    /// is handed out to consumers.
+    ///
+    /// \param  max_number_of_subblocks_inflight The constraint "max number of subblocks in flight" the reading order was determined for.
+    /// \param  linear_reading_order             The reading order.
+    void SetLinearReadingOrder(std::uint32_t max_number_of_subblocks_inflight, std::shared_ptr<const LinearReadingOrder> linear_reading_order);
+
+    /// Gets all linear reading orders which are stored with this object.
+    ///
+    /// \returns    A map "constraint - reading order".
+    std::map<std::uint32_t, std::shared_ptr<const LinearReadingOrder>> GetLinearReadingOrders() const;
+};
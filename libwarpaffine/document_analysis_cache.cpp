@@ -0,0 +1,459 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "document_analysis_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace libCZI;
+
+namespace
+{
+    /// Helper for writing PODs to a binary stream.
+    class BinaryWriter
+    {
+    private:
+        ostream& stream_;
+    public:
+        explicit BinaryWriter(ostream& stream) : stream_(stream) {}
+
+        template <typename t>
+        void Write(const t& value)
+        {
+            static_assert(is_trivially_copyable<t>::value, "only trivially copyable types can be written");
+            this->stream_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void Write(const IntRect& rectangle)
+        {
+            this->Write(rectangle.x);
+            this->Write(rectangle.y);
+            this->Write(rectangle.w);
+            this->Write(rectangle.h);
+        }
+    };
+
+    /// Helper for reading PODs from a binary stream. If reading fails, the stream's fail-bit is set and
+    /// all subsequent reads will fail as well, so it is sufficient to check the state at the end.
+    class BinaryReader
+    {
+    private:
+        istream& stream_;
+    public:
+        explicit BinaryReader(istream& stream) : stream_(stream) {}
+
+        template <typename t>
+        t Read()
+        {
+            static_assert(is_trivially_copyable<t>::value, "only trivially copyable types can be read");
+            t value{};
+            this->stream_.read(reinterpret_cast<char*>(&value), sizeof(value));
+            return value;
+        }
+
+        IntRect ReadIntRect()
+        {
+            IntRect rectangle;
+            rectangle.x = this->Read<int32_t>();
+            rectangle.y = this->Read<int32_t>();
+            rectangle.w = this->Read<int32_t>();
+            rectangle.h = this->Read<int32_t>();
+            return rectangle;
+        }
+
+        /// Reads an element count and checks it for plausibility (i.e. we do not want to allocate
+        /// huge amounts of memory if the file is corrupted).
+        bool TryReadCount(uint64_t max_count, uint64_t* count)
+        {
+            *count = this->Read<uint64_t>();
+            return this->IsGood() && *count <= max_count;
+        }
+
+        bool IsGood() const { return this->stream_.good(); }
+    };
+
+    // an (arbitrary) upper limit for the number of elements in a container, used for checking the plausibility of the data
+    constexpr uint64_t kMaxElementCount = 0x10000000ULL;
+
+    void WriteFingerprint(BinaryWriter& writer, const DocumentAnalysisCache::SourceFingerprint& fingerprint)
+    {
+        writer.Write(fingerprint.file_size);
+        writer.Write(fingerprint.last_write_time);
+        writer.Write(fingerprint.header_hash);
+    }
+
+    DocumentAnalysisCache::SourceFingerprint ReadFingerprint(BinaryReader& reader)
+    {
+        DocumentAnalysisCache::SourceFingerprint fingerprint;
+        fingerprint.file_size = reader.Read<uint64_t>();
+        fingerprint.last_write_time = reader.Read<int64_t>();
+        fingerprint.header_hash = reader.Read<array<uint8_t, 16>>();
+        return fingerprint;
+    }
+
+    void WriteStatistics(BinaryWriter& writer, const SubBlockStatistics& statistics)
+    {
+        writer.Write(static_cast<int32_t>(statistics.subBlockCount));
+        writer.Write(static_cast<int32_t>(statistics.minMindex));
+        writer.Write(static_cast<int32_t>(statistics.maxMindex));
+        writer.Write(statistics.boundingBox);
+        writer.Write(statistics.boundingBoxLayer0Only);
+
+        vector<tuple<DimensionIndex, int, int>> dimension_bounds;
+        statistics.dimBounds.EnumValidDimensions(
+            [&](DimensionIndex dimension_index, int start, int size)->bool
+            {
+                dimension_bounds.emplace_back(dimension_index, start, size);
+                return true;
+            });
+
+        writer.Write(static_cast<uint64_t>(dimension_bounds.size()));
+        for (const auto& item : dimension_bounds)
+        {
+            writer.Write(static_cast<int32_t>(get<0>(item)));
+            writer.Write(static_cast<int32_t>(get<1>(item)));
+            writer.Write(static_cast<int32_t>(get<2>(item)));
+        }
+
+        writer.Write(static_cast<uint64_t>(statistics.sceneBoundingBoxes.size()));
+        for (const auto& item : statistics.sceneBoundingBoxes)
+        {
+            writer.Write(static_cast<int32_t>(item.first));
+            writer.Write(item.second.boundingBox);
+            writer.Write(item.second.boundingBoxLayer0);
+        }
+    }
+
+    bool TryReadStatistics(BinaryReader& reader, SubBlockStatistics& statistics)
+    {
+        statistics.Invalidate();
+        statistics.subBlockCount = reader.Read<int32_t>();
+        statistics.minMindex = reader.Read<int32_t>();
+        statistics.maxMindex = reader.Read<int32_t>();
+        statistics.boundingBox = reader.ReadIntRect();
+        statistics.boundingBoxLayer0Only = reader.ReadIntRect();
+
+        uint64_t count;
+        if (!reader.TryReadCount(static_cast<uint64_t>(DimensionIndex::MaxDim), &count))
+        {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            const auto dimension_index = reader.Read<int32_t>();
+            const auto start = reader.Read<int32_t>();
+            const auto size = reader.Read<int32_t>();
+            if (!reader.IsGood() ||
+                dimension_index < static_cast<int32_t>(DimensionIndex::MinDim) ||
+                dimension_index > static_cast<int32_t>(DimensionIndex::MaxDim))
+            {
+                return false;
+            }
+
+            statistics.dimBounds.Set(static_cast<DimensionIndex>(dimension_index), start, size);
+        }
+
+        if (!reader.TryReadCount(kMaxElementCount, &count))
+        {
+            return false;
+        }
+
+        statistics.sceneBoundingBoxes.clear();
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            const auto scene_index = reader.Read<int32_t>();
+            BoundingBoxes bounding_boxes;
+            bounding_boxes.boundingBox = reader.ReadIntRect();
+            bounding_boxes.boundingBoxLayer0 = reader.ReadIntRect();
+            statistics.sceneBoundingBoxes[scene_index] = bounding_boxes;
+        }
+
+        return reader.IsGood();
+    }
+
+    void WriteSubblocks(BinaryWriter& writer, const vector<SubblockDirectoryInfo>& subblocks)
+    {
+        writer.Write(static_cast<uint64_t>(subblocks.size()));
+        for (const auto& info : subblocks)
+        {
+            writer.Write(info.file_position);
+            writer.Write(info.logical_rect);
+            writer.Write(static_cast<int32_t>(info.t));
+            writer.Write(static_cast<int32_t>(info.c));
+            writer.Write(static_cast<int32_t>(info.s));
+            writer.Write(static_cast<int32_t>(info.m));
+            writer.Write(static_cast<int32_t>(info.z));
+            writer.Write(static_cast<uint8_t>(info.is_layer0 ? 1 : 0));
+        }
+    }
+
+    bool TryReadSubblocks(BinaryReader& reader, vector<SubblockDirectoryInfo>& subblocks)
+    {
+        uint64_t count;
+        if (!reader.TryReadCount(kMaxElementCount, &count))
+        {
+            return false;
+        }
+
+        subblocks.resize(static_cast<size_t>(count));
+        for (auto& info : subblocks)
+        {
+            info.file_position = reader.Read<uint64_t>();
+            info.logical_rect = reader.ReadIntRect();
+            info.t = reader.Read<int32_t>();
+            info.c = reader.Read<int32_t>();
+            info.s = reader.Read<int32_t>();
+            info.m = reader.Read<int32_t>();
+            info.z = reader.Read<int32_t>();
+            info.is_layer0 = reader.Read<uint8_t>() != 0;
+        }
+
+        return reader.IsGood();
+    }
+
+    void WriteLinearReadingOrder(BinaryWriter& writer, const LinearReadingOrder& linear_reading_order)
+    {
+        writer.Write(linear_reading_order.max_number_of_subblocks_inflight);
+        writer.Write(static_cast<uint64_t>(linear_reading_order.reading_order.size()));
+        for (const int subblock_index : linear_reading_order.reading_order)
+        {
+            writer.Write(static_cast<int32_t>(subblock_index));
+        }
+
+        writer.Write(static_cast<uint64_t>(linear_reading_order.number_of_slices_per_brick.size()));
+        for (const auto& item : linear_reading_order.number_of_slices_per_brick)
+        {
+            writer.Write(static_cast<int32_t>(item.first.t));
+            writer.Write(static_cast<int32_t>(item.first.c));
+            writer.Write(static_cast<int32_t>(item.first.s));
+            writer.Write(static_cast<int32_t>(item.first.m));
+            writer.Write(item.second);
+        }
+    }
+
+    /// Reads a linear reading order - the subblock-indices are checked to be valid for the specified number of subblocks.
+    bool TryReadLinearReadingOrder(BinaryReader& reader, size_t number_of_subblocks, LinearReadingOrder& linear_reading_order)
+    {
+        linear_reading_order.max_number_of_subblocks_inflight = reader.Read<uint32_t>();
+        uint64_t count;
+        if (!reader.TryReadCount(kMaxElementCount, &count))
+        {
+            return false;
+        }
+
+        linear_reading_order.reading_order.resize(static_cast<size_t>(count));
+        for (auto& subblock_index : linear_reading_order.reading_order)
+        {
+            subblock_index = reader.Read<int32_t>();
+            if (subblock_index < 0 || static_cast<size_t>(subblock_index) >= number_of_subblocks)
+            {
+                return false;
+            }
+        }
+
+        if (!reader.TryReadCount(kMaxElementCount, &count))
+        {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            BrickCoordinate brick_coordinate;
+            brick_coordinate.t = reader.Read<int32_t>();
+            brick_coordinate.c = reader.Read<int32_t>();
+            brick_coordinate.s = reader.Read<int32_t>();
+            brick_coordinate.m = reader.Read<int32_t>();
+            linear_reading_order.number_of_slices_per_brick[brick_coordinate] = reader.Read<uint32_t>();
+        }
+
+        return reader.IsGood();
+    }
+}
+
+/*static*/bool DocumentAnalysisCache::TryGetSourceFingerprint(const std::string& source_filename, libCZI::IStream* stream, SourceFingerprint* fingerprint)
+{
+    error_code error_code;
+    const auto path = filesystem::u8path(source_filename);
+    const auto file_size = filesystem::file_size(path, error_code);
+    if (error_code)
+    {
+        return false;
+    }
+
+    const auto last_write_time = filesystem::last_write_time(path, error_code);
+    if (error_code)
+    {
+        return false;
+    }
+
+    // we hash the file-header-segment, which contains e.g. the file-GUID and the positions of the
+    //  subblock-directory and the metadata (so, it is modified whenever the document is re-written)
+    vector<uint8_t> file_header_segment(kSizeOfFileHeaderSegment);
+    uint64_t bytes_read = 0;
+    try
+    {
+        stream->Read(0, file_header_segment.data(), file_header_segment.size(), &bytes_read);
+    }
+    catch (exception&)
+    {
+        return false;
+    }
+
+    if (bytes_read != file_header_segment.size())
+    {
+        return false;
+    }
+
+    if (fingerprint != nullptr)
+    {
+        fingerprint->file_size = file_size;
+        fingerprint->last_write_time = static_cast<int64_t>(last_write_time.time_since_epoch().count());
+        Utils::CalcMd5SumHash(file_header_segment.data(), file_header_segment.size(), fingerprint->header_hash.data(), static_cast<int>(fingerprint->header_hash.size()));
+    }
+
+    return true;
+}
+
+/*static*/std::shared_ptr<DocumentAnalysis> DocumentAnalysisCache::TryLoad(const std::string& cache_filename, const SourceFingerprint& fingerprint)
+{
+    ifstream stream(filesystem::u8path(cache_filename), ios::binary);
+    if (!stream.is_open())
+    {
+        return nullptr;
+    }
+
+    BinaryReader reader(stream);
+    if (reader.Read<uint64_t>() != kMagic || reader.Read<uint32_t>() != kVersion || !reader.IsGood())
+    {
+        return nullptr;
+    }
+
+    if (ReadFingerprint(reader) != fingerprint || !reader.IsGood())
+    {
+        return nullptr;
+    }
+
+    SubBlockStatistics statistics;
+    if (!TryReadStatistics(reader, statistics))
+    {
+        return nullptr;
+    }
+
+    uint64_t count;
+    if (!reader.TryReadCount(kMaxElementCount, &count))
+    {
+        return nullptr;
+    }
+
+    map<int, PixelType> map_channelindex_pixeltype;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const auto channel_index = reader.Read<int32_t>();
+        map_channelindex_pixeltype[channel_index] = static_cast<PixelType>(reader.Read<int32_t>());
+    }
+
+    vector<SubblockDirectoryInfo> subblocks;
+    if (!TryReadSubblocks(reader, subblocks))
+    {
+        return nullptr;
+    }
+
+    if (!reader.TryReadCount(kMaxElementCount, &count))
+    {
+        return nullptr;
+    }
+
+    map<uint32_t, shared_ptr<const LinearReadingOrder>> linear_reading_orders;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const auto max_number_of_subblocks_inflight = reader.Read<uint32_t>();
+        auto linear_reading_order = make_shared<LinearReadingOrder>();
+        if (!TryReadLinearReadingOrder(reader, subblocks.size(), *linear_reading_order))
+        {
+            return nullptr;
+        }
+
+        linear_reading_orders[max_number_of_subblocks_inflight] = linear_reading_order;
+    }
+
+    auto document_analysis = make_shared<DocumentAnalysis>(statistics, std::move(subblocks), std::move(map_channelindex_pixeltype));
+    for (auto& item : linear_reading_orders)
+    {
+        document_analysis->SetLinearReadingOrder(item.first, std::move(item.second));
+    }
+
+    return document_analysis;
+}
+
+/*static*/bool DocumentAnalysisCache::TrySave(const std::string& cache_filename, const SourceFingerprint& fingerprint, const DocumentAnalysis& document_analysis)
+{
+    // the data is written to a temporary file (with a unique name) first, which is then renamed to the
+    //  cache file - so, a crash or a concurrent run cannot leave a partially written cache file behind
+    const auto cache_path = filesystem::u8path(cache_filename);
+    ostringstream temporary_filename_suffix;
+    temporary_filename_suffix << ".tmp" << hex << random_device{}();
+    auto temporary_path = cache_path;
+    temporary_path += temporary_filename_suffix.str();
+
+    bool success = DocumentAnalysisCache::TryWrite(temporary_path, fingerprint, document_analysis);
+    error_code error_code;
+    if (success)
+    {
+        filesystem::rename(temporary_path, cache_path, error_code);
+        success = !error_code;
+    }
+
+    if (!success)
+    {
+        filesystem::remove(temporary_path, error_code);
+    }
+
+    return success;
+}
+
+/*static*/bool DocumentAnalysisCache::TryWrite(const std::filesystem::path& path, const SourceFingerprint& fingerprint, const DocumentAnalysis& document_analysis)
+{
+    ofstream stream(path, ios::binary | ios::trunc);
+    if (!stream.is_open())
+    {
+        return false;
+    }
+
+    BinaryWriter writer(stream);
+    writer.Write(kMagic);
+    writer.Write(kVersion);
+    WriteFingerprint(writer, fingerprint);
+    WriteStatistics(writer, document_analysis.GetStatistics());
+
+    const auto& map_channelindex_pixeltype = document_analysis.GetChannelPixeltypes();
+    writer.Write(static_cast<uint64_t>(map_channelindex_pixeltype.size()));
+    for (const auto& item : map_channelindex_pixeltype)
+    {
+        writer.Write(static_cast<int32_t>(item.first));
+        writer.Write(static_cast<int32_t>(item.second));
+    }
+
+    WriteSubblocks(writer, document_analysis.GetSubblocks());
+
+    const auto linear_reading_orders = document_analysis.GetLinearReadingOrders();
+    writer.Write(static_cast<uint64_t>(linear_reading_orders.size()));
+    for (const auto& item : linear_reading_orders)
+    {
+        writer.Write(item.first);
+        WriteLinearReadingOrder(writer, *item.second);
+    }
+
+    stream.flush();
+    return stream.good();
+}
@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "inc_libCZI.h"
+#include "document_analysis.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+/// This class is used to persist a DocumentAnalysis (including the linear reading orders stored with it) in a
+/// "sidecar file", so that it can be re-used when processing the same source document again. The cache file
+/// is tied to the source document by a "fingerprint" consisting of the file size, the last-write-time and a hash
+/// of the file-header-segment - if the fingerprint does not match, the cache is considered stale and is not used.
+/// The per-brick subblock lists are not persisted - they are given by the SubblockIndex, which is re-constructed
+/// from the persisted subblock-information without any access to the document.
+/// Note that the cache file is a binary file in native byte-order, it is not intended to be exchanged between machines.
+class DocumentAnalysisCache
+{
+public:
+    /// Information identifying a specific version of the source document.
+    struct SourceFingerprint
+    {
+        std::uint64_t file_size{ 0 };                   ///< The size of the file in bytes.
+        std::int64_t last_write_time{ 0 };              ///< The last-write-time of the file (in file-system specific units).
+        std::array<std::uint8_t, 16> header_hash{};     ///< MD5-hash of the file-header-segment.
+
+        bool operator==(const SourceFingerprint& other) const
+        {
+            return this->file_size == other.file_size && this->last_write_time == other.last_write_time && this->header_hash == other.header_hash;
+        }
+
+        bool operator!=(const SourceFingerprint& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /// Attempts to determine the fingerprint of the source document. This requires that the source document
+    /// is a file in the file-system.
+    ///
+    /// \param          source_filename The filename of the source document (UTF8-encoded).
+    /// \param [in]     stream          The stream the source document is read from (used to read the file-header-segment).
+    /// \param [out]    fingerprint     If successful, the fingerprint is put here.
+    ///
+    /// \returns    True if it succeeds; false otherwise.
+    static bool TryGetSourceFingerprint(const std::string& source_filename, libCZI::IStream* stream, SourceFingerprint* fingerprint);
+
+    /// Attempts to load a document-analysis from the specified cache file. If the cache file does not exist, is
+    /// not valid (including the case that it contains out-of-range values) or was written for a different fingerprint,
+    /// then null is returned.
+    ///
+    /// \param  cache_filename  The filename of the cache file (UTF8-encoded).
+    /// \param  fingerprint     The fingerprint of the source document.
+    ///
+    /// \returns    If successful, the document-analysis; null otherwise.
+    static std::shared_ptr<DocumentAnalysis> TryLoad(const std::string& cache_filename, const SourceFingerprint& fingerprint);
+
+    /// Writes the specified document-analysis (together with the linear reading orders stored with it) into the
+    /// specified cache file. An existing file is replaced - the data is written to a temporary file which is then
+    /// renamed, so that the cache file is never left partially written.
+    ///
+    /// \param  cache_filename      The filename of the cache file (UTF8-encoded).
+    /// \param  fingerprint         The fingerprint of the source document.
+    /// \param  document_analysis   The document-analysis.
+    ///
+    /// \returns    True if it succeeds; false otherwise.
+    static bool TrySave(const std::string& cache_filename, const SourceFingerprint& fingerprint, const DocumentAnalysis& document_analysis);
+
+private:
+    static constexpr std::uint64_t kMagic = 0x3145484341434157ULL;   // "WACACHE1" in little-endian
+    static constexpr std::uint32_t kVersion = 3;                     // version 3: reading orders only contain subblocks which are part of a brick
+    static constexpr std::uint64_t kSizeOfFileHeaderSegment = 32 + 512;
+
+    static bool TryWrite(const std::filesystem::path& path, const SourceFingerprint& fingerprint, const DocumentAnalysis& document_analysis);
+};
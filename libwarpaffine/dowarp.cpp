@@ -11,9 +11,13 @@
 #include <limits>
 #include <memory>
 #include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
 
 #include "inc_libCZI.h"
 #include "deskew_helpers.h"
+#include "chunked_compression.h"
 
 using namespace std;
 using namespace libCZI;
@@ -162,12 +166,11 @@ DoWarp::DoWarp(
     const DeskewDocumentInfo& document_info,
     const Eigen::Matrix4d& transformation_matrix,
     std::shared_ptr<ICziBrickReader> brick_reader,
-    std::shared_ptr<ICziSlicesWriter> writer,
+    const std::function<std::shared_ptr<ICziSlicesWriter>(std::uint32_t)>& create_writer,
     std::shared_ptr<IWarpAffine> warp_affine_engine) :
     context_(context),
     transformation_matrix_(transformation_matrix),
     document_info_(document_info),
-    writer_(std::move(writer)),
     brick_reader_(std::move(brick_reader)),
     warp_affine_engine_(std::move(warp_affine_engine)),
     output_brick_info_repository_(context, document_info, transformation_matrix)
@@ -188,18 +191,35 @@ DoWarp::DoWarp(
 
     this->total_number_of_subblocks_to_output = this->output_brick_info_repository_.GetTotalNumberOfSubblocksToOutput() * number_of_3dplanes_to_process;
 
+    // the writer may need to know the number of subblocks up-front (e.g. in order to reserve space for the subblock-directory)
+    this->writer_ = create_writer(this->total_number_of_subblocks_to_output);
+
     if (context.GetCommandLineOptions().GetDoCalculateHashOfOutputData())
     {
         this->calculate_result_hash_ = std::make_unique<CalcResultHash>();
     }
 
-    this->context_.GetAllocator().AddDestinationBrickMemoryReleasedCallback(
-        [this]()->void
+    this->InitializeChunkedCompression();
+    this->InitializeAdaptiveCompressionLevel();
+
+    // the tasks waiting for a destination brick are queued with the allocator, and they are also waiting for credits
+    //  of the warp-stage (which are only granted if the compress- and the write-stage have capacity left) - so we
+    //  have the allocator check its wait-queue when those credits are returned
+    this->handle_credits_released_callback_ = this->context_.GetFlowControl().AddCreditsReleasedCallback(
+        [this](FlowControl::Stage stage)->void
         {
-            this->DestinationMemoryReleased();
+            if (stage >= FlowControl::Stage::Warp)
+            {
+                this->context_.GetAllocator().ServiceAllocationWaitQueue();
+            }
         });
 }
 
+DoWarp::~DoWarp()
+{
+    this->context_.GetFlowControl().RemoveCreditsReleasedCallback(this->handle_credits_released_callback_);
+}
+
 std::tuple<std::uint32_t, std::uint32_t, std::uint32_t> DoWarp::GetOutputExtent() const
 {
     return make_tuple(this->output_width_, this->output_height_, this->output_depth_);
@@ -224,6 +244,11 @@ const Eigen::Matrix4d& DoWarp::GetTransformationMatrix() const
     return this->transformation_matrix_;
 }
 
+const std::shared_ptr<ICziSlicesWriter>& DoWarp::GetWriter() const
+{
+    return this->writer_;
+}
+
 WarpStatistics DoWarp::GetStatistics()
 {
     WarpStatistics statistics;
@@ -248,15 +273,26 @@ WarpStatistics DoWarp::GetStatistics()
 
     statistics.warp_tasks_in_flight = this->warp_tasks_in_flight_.load();
     statistics.compression_tasks_in_flight = this->compression_tasks_in_flight_.load();
+    statistics.compression_level = this->adaptive_compression_level_ ? this->adaptive_compression_level_->GetLevel() : -1;
+    statistics.compression_level_changes = this->adaptive_compression_level_ ? this->adaptive_compression_level_->GetNumberOfLevelChanges() : 0;
     statistics.write_slices_queue_length = this->writer_->GetNumberOfPendingSliceWriteOperations();
+    statistics.write_slices_queue_size = this->writer_->GetSizeOfPendingSliceWriteOperations();
+    statistics.bytes_written_to_destination_file = this->writer_->GetNumberOfBytesWritten();
+    statistics.average_datarate_to_destination_file = statistics.bytes_written_to_destination_file / elapsed_seconds.count();
     statistics.reader_throttled = this->brick_reader_->GetIsThrottledState();
 
     const auto task_arena_statistics_ = this->context_.GetTaskArena()->GetStatistics();
     statistics.task_arena_queue_length = task_arena_statistics_.queue_length;
+    statistics.task_arena_queue_length_per_task_type = task_arena_statistics_.queue_length_per_task_type;
     statistics.currently_active_tasks = task_arena_statistics_.active_tasks;
     statistics.currently_suspended_tasks = task_arena_statistics_.suspended_tasks;
+    statistics.numa_node_utilization = task_arena_statistics_.numa_node_utilization;
     this->context_.GetAllocator().GetState(statistics.memory_status);
+    statistics.allocation_wait_queue = this->context_.GetAllocator().GetWaitQueueStatistics();
+    this->context_.GetFlowControl().GetState(statistics.credits_occupancy, statistics.credits_budget);
     statistics.subblocks_added_to_writer = this->number_of_subblocks_added_to_writer_.load();
+    statistics.all_zero_slices = this->number_of_all_zero_slices_.load();
+    statistics.subblocks_omitted = this->number_of_subblocks_omitted_.load();
     statistics.total_progress_percent = this->CalculateTotalProgress();
 
     return statistics;
@@ -284,15 +320,22 @@ void DoWarp::WaitUntilDone()
 {
     this->brick_reader_->WaitUntilDone();
 
-    for (;;)
-    {
-        if (this->GetTotalNumberOfTasksInFlight() == 0)
-        {
-            break;
-        }
+    this->tasks_done_notifier_.Wait([this]()->bool { return this->GetTotalNumberOfTasksInFlight() == 0; });
+}
 
-        this_thread::sleep_for(std::chrono::milliseconds(10));
+bool DoWarp::WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout)
+{
+    const auto time_point_timeout = std::chrono::steady_clock::now() + timeout;
+    if (!this->brick_reader_->WaitUntilDoneOrTimeout(timeout))
+    {
+        return false;
     }
+
+    // the brick-reader is done, now wait for the tasks in flight (with the remaining time)
+    const auto remaining_time = std::chrono::duration_cast<std::chrono::milliseconds>(time_point_timeout - std::chrono::steady_clock::now());
+    return this->tasks_done_notifier_.WaitFor(
+        [this]()->bool { return this->GetTotalNumberOfTasksInFlight() == 0; },
+        (std::max)(remaining_time, std::chrono::milliseconds(0)));
 }
 
 bool DoWarp::TryGetHash(std::array<uint8_t, 16>* hash_code) const
@@ -349,18 +392,26 @@ void DoWarp::InputBrick(const Brick& brick, const BrickCoordinateInfo& coordinat
 
 void DoWarp::ProcessBrickCommon2(const Brick& brick, uint32_t brick_id, const Brick& destination_brick, const BrickCoordinateInfo& coordinate_info, uint32_t source_depth, const OutputBrickInfoRepository::TilingRectAndMandSceneIndex& rect_and_tile_identifier)
 {
-    this->warp_affine_engine_->Execute(
+    vector<bool> is_slice_all_zero;
+    this->warp_affine_engine_->ExecuteAndReportAllZeroSlices(
         this->transformation_matrix_,
         IntPos3{rect_and_tile_identifier.rectangle.x, rect_and_tile_identifier.rectangle.y, 0},
         this->context_.GetCommandLineOptions().GetInterpolationMode(),
         brick,
-        destination_brick);
+        destination_brick,
+        is_slice_all_zero);
 
     // ok, what we now do is - add a task for every slice, in order to 
     //  parallelize the compression
     for (uint32_t z = 0; z < destination_brick.info.depth; ++z)
     {
-        auto slice_to_compress_task_info = new OutputSliceToCompressTaskInfo{ destination_brick, static_cast<int>(z) };
+        auto slice_to_compress_task_info = new OutputSliceToCompressTaskInfo
+        {
+            destination_brick,
+            static_cast<int>(z),
+            this->context_.GetFlowControl().Register(FlowControl::Stage::Compress, destination_brick.info.stride_plane),
+            is_slice_all_zero[z]
+        };
         this->IncCompressionTasksInFlight();
         this->context_.GetTaskArena()->AddTask(
             TaskType::CompressSlice,
@@ -408,15 +459,49 @@ void DoWarp::ProcessBrickCommon2(const Brick& brick, uint32_t brick_id, const Br
 
 void DoWarp::ProcessOutputSlice(OutputSliceToCompressTaskInfo* output_slice_task_info, const libCZI::CDimCoordinate& coordinate, const SubblockXYM& xym, uint32_t source_brick_id)
 {
-    auto compression_mode_and_memblk = this->Compress(*output_slice_task_info);
+    if (output_slice_task_info->is_all_zero)
+    {
+        ++this->number_of_all_zero_slices_;
+        if (this->context_.GetCommandLineOptions().GetDoOmitEmptySubblocks())
+        {
+            // the subblock is not written at all - a reader will then show the background (which is zero) for this area
+            ++this->number_of_subblocks_omitted_;
+            delete output_slice_task_info;
+            return;
+        }
+    }
 
-    if (this->calculate_result_hash_)
+    tuple<CompressionMode, shared_ptr<IMemoryBlock>> compression_mode_and_memblk;
+    if (output_slice_task_info->is_all_zero)
     {
-        this->calculate_result_hash_->AddSlice(get<1>(compression_mode_and_memblk), coordinate);
+        // the all-zero slice is shared, and so is its hash (which is calculated only once)
+        const auto all_zero_slice = this->GetAllZeroSlice(*output_slice_task_info);
+        compression_mode_and_memblk = make_tuple(this->context_.GetCommandLineOptions().GetCompressionOptions().first, all_zero_slice.data);
+        if (this->calculate_result_hash_)
+        {
+            this->calculate_result_hash_->AddSlice(all_zero_slice.hash_of_data, coordinate);
+        }
     }
+    else
+    {
+        compression_mode_and_memblk = this->Compress(*output_slice_task_info);
+        if (this->calculate_result_hash_)
+        {
+            this->calculate_result_hash_->AddSlice(get<1>(compression_mode_and_memblk), coordinate);
+        }
+    }
+
+    // the compressed slice is held by the writer until it is written out, and the credits of the write-stage
+    //  are tied to its lifetime
+    const auto& memory_block = get<1>(compression_mode_and_memblk);
+    const size_t size_of_compressed_slice = memory_block->GetSizeOfData();
 
     ICziSlicesWriter::AddSliceInfo add_slice_info;
-    add_slice_info.subblock_raw_data = get<1>(compression_mode_and_memblk);
+    add_slice_info.subblock_raw_data = make_shared<MemoryBlockWrapper>(
+        FlowControl::TieCreditsToData(
+            shared_ptr<void>(memory_block, memory_block->GetPtr()),
+            this->context_.GetFlowControl().Register(FlowControl::Stage::Write, size_of_compressed_slice)),
+        size_of_compressed_slice);
     add_slice_info.compression_mode = get<0>(compression_mode_and_memblk);
     add_slice_info.pixeltype = output_slice_task_info->brick.info.pixelType;
     add_slice_info.width = output_slice_task_info->brick.info.width;
@@ -437,7 +522,7 @@ void DoWarp::ProcessOutputSlice(OutputSliceToCompressTaskInfo* output_slice_task
         add_slice_info.brick_id = source_brick_id;
     }
 
-    this->writer_->AddSlice(add_slice_info);
+    this->AddSliceToWriter(add_slice_info);
     ++this->number_of_subblocks_added_to_writer_;
 
     delete output_slice_task_info;
@@ -452,7 +537,7 @@ void DoWarp::IncWarpTasksInFlight()
 void DoWarp::DecWarpTasksInFlight()
 {
     --this->warp_tasks_in_flight_;
-    --this->total_tasks_in_flight_;
+    this->DecTotalTasksInFlight();
 }
 
 void DoWarp::IncCompressionTasksInFlight()
@@ -464,7 +549,15 @@ void DoWarp::IncCompressionTasksInFlight()
 void DoWarp::DecCompressionTasksInFlight()
 {
     --this->compression_tasks_in_flight_;
-    --this->total_tasks_in_flight_;
+    this->DecTotalTasksInFlight();
+}
+
+void DoWarp::DecTotalTasksInFlight()
+{
+    if (this->total_tasks_in_flight_.fetch_sub(1) == 1)
+    {
+        this->tasks_done_notifier_.Notify();
+    }
 }
 
 std::uint32_t DoWarp::GetTotalNumberOfTasksInFlight()
@@ -533,31 +626,87 @@ Brick DoWarp::CreateBrickAndWaitUntilAvailable(libCZI::PixelType pixel_type, std
     brick.info.stride_plane = brick.info.stride_line * brick.info.height;
 
     const uint64_t size_of_brick = brick.info.stride_plane * static_cast<uint64_t>(brick.info.depth);
-    for (;;)
-    {
-        if (this->above_high_water_mask2_.load() == false)
+
+    // the credits for the warp-stage are only granted if the compress- and the write-stage have capacity left
+    const BrickAllocator::AdmissionFunctor admission =
+        [this, size_of_brick]()->shared_ptr<void>
         {
-            brick.data = this->context_.GetAllocator().Allocate(BrickAllocator::MemoryType::DestinationBrick, size_of_brick, false);
-            if (brick.data)
-            {
-                break;
-            }
-        }
+            return this->context_.GetFlowControl().TryAcquire(FlowControl::Stage::Warp, size_of_brick);
+        };
 
-        this->context_.WriteDebugString("Waiting for Destination-brick allocation\n");
-        this->context_.GetTaskArena()->SuspendCurrentTask([this](void* handle)->void {this->AddResumeHandle(handle); });
-        this->context_.WriteDebugString("*** Was resumed ***\n");
+    auto& allocator = this->context_.GetAllocator();
+    shared_ptr<void> credits;
+    auto memory = allocator.TryAllocateInOrder(BrickAllocator::MemoryType::DestinationBrick, size_of_brick, admission, &credits);
+    if (memory)
+    {
+        brick.data = FlowControl::TieCreditsToData(std::move(memory), std::move(credits));
+        return brick;
     }
 
+    // Otherwise, we queue the request with the allocator and suspend the task. The allocator grants the requests in
+    //  FIFO order, and it resumes this task only after the memory (and the credits) have been granted to it - so
+    //  there is no need to retry the allocation here.
+    this->context_.WriteDebugString("Waiting for Destination-brick allocation\n");
+    const auto& task_arena = this->context_.GetTaskArena();
+    task_arena->SuspendCurrentTask(
+        [&](ITaskArena::SuspendHandle handle)->void
+        {
+            allocator.EnqueueAllocationRequest(
+                BrickAllocator::MemoryType::DestinationBrick,
+                size_of_brick,
+                admission,
+                [&brick, task_arena, handle](shared_ptr<void> memory, shared_ptr<void> credits)->void
+                {
+                    brick.data = FlowControl::TieCreditsToData(std::move(memory), std::move(credits));
+                    task_arena->ResumeTask(handle);
+                });
+        });
+    this->context_.WriteDebugString("*** Was resumed ***\n");
+
     return brick;
 }
 
+void DoWarp::AddSliceToWriter(const ICziSlicesWriter::AddSliceInfo& add_slice_info)
+{
+    if (this->writer_->TryAddSlice(add_slice_info, nullptr))
+    {
+        return;
+    }
+
+    // The writer's queue is full, so we suspend the compression task (instead of blocking a thread of the
+    //  task-arena). The writer resumes the task when there is space in the queue again, and then we retry. Note
+    //  that the resume-functor may be called before 'TryAddSlice' returns, which is fine for 'ResumeTask'.
+    const auto& task_arena = this->context_.GetTaskArena();
+    for (bool slice_added = false; !slice_added;)
+    {
+        task_arena->SuspendCurrentTask(
+            [&](ITaskArena::SuspendHandle handle)->void
+            {
+                slice_added = this->writer_->TryAddSlice(
+                    add_slice_info,
+                    [task_arena, handle]()->void
+                    {
+                        task_arena->ResumeTask(handle);
+                    });
+                if (slice_added)
+                {
+                    task_arena->ResumeTask(handle);
+                }
+            });
+    }
+}
+
 std::tuple<libCZI::CompressionMode, std::shared_ptr<libCZI::IMemoryBlock>> DoWarp::Compress(const OutputSliceToCompressTaskInfo& output_slice_task_info)
 {
     size_t(*pfn_calc_compression_size)(uint32_t, uint32_t, PixelType);
     bool (*pfn_compress)(uint32_t, uint32_t, uint32_t, PixelType, const void*, void*, size_t&, const ICompressParameters*);
 
     const auto& compression_options = this->context_.GetCommandLineOptions().GetCompressionOptions();
+    if (compression_options.first == CompressionMode::UnCompressed)
+    {
+        return make_tuple(CompressionMode::UnCompressed, DoWarp::GetUncompressedSlice(this->context_.GetAllocator(), output_slice_task_info.brick, output_slice_task_info.z_slice));
+    }
+
     switch (compression_options.first)
     {
     case CompressionMode::Zstd0:
@@ -572,63 +721,341 @@ std::tuple<libCZI::CompressionMode, std::shared_ptr<libCZI::IMemoryBlock>> DoWar
         throw logic_error("An unsupported compression-mode was specified.");
     }
 
+    const ICompressParameters* compression_parameters = compression_options.second.get();
+    if (this->adaptive_compression_level_)
+    {
+        compression_parameters = this->compression_parameters_per_level_[this->adaptive_compression_level_->GetLevel() - this->adaptive_compression_level_->GetMinLevel()].get();
+    }
+
+    const uint64_t size_of_slice = static_cast<uint64_t>(output_slice_task_info.brick.info.width) * output_slice_task_info.brick.info.height * Utils::GetBytesPerPixel(output_slice_task_info.brick.info.pixelType);
+    if (this->compression_chunk_size_ > 0 && size_of_slice > this->compression_chunk_size_)
+    {
+        auto compressed_slice = this->CompressChunked(output_slice_task_info, compression_options.first, compression_parameters);
+        if (this->adaptive_compression_level_)
+        {
+            this->UpdateAdaptiveCompressionLevel(size_of_slice, compressed_slice->GetSizeOfData());
+        }
+
+        return make_tuple(compression_options.first, compressed_slice);
+    }
+
     const size_t max_size_necessary = pfn_calc_compression_size(
         output_slice_task_info.brick.info.width,
         output_slice_task_info.brick.info.height,
         output_slice_task_info.brick.info.pixelType);
 
-    // As an effort to save some memory, we try the compression with a destination buffer size of half the max possible size, assuming
-    //  that in "almost all cases" this is sufficiently large (or, we assume a compression rate of ~50%). If this turns out to be not 
-    //  sufficient, we do one more compression where we allocate the "max possible amount of memory". So, the second attempt should in
-    //  all cases succeed. Of course, we could think of a more elaborate scheme here, e.g. keeping track of the compression ratio and
-    //  start with a buffer size determined by the compression ratio so far.
-    for (int attempt = 0; attempt < 2; ++attempt)
-    {
-        size_t size = (attempt == 0) ? (max_size_necessary / 2) : max_size_necessary;
-        auto allocated_memory = this->context_.GetAllocator().Allocate(BrickAllocator::MemoryType::CompressedDestinationSlice, size);
-
-        size_t actual_size = size;
-        bool b = pfn_compress(
-            output_slice_task_info.brick.info.width,
-            output_slice_task_info.brick.info.height,
-            output_slice_task_info.brick.info.stride_line,
-            output_slice_task_info.brick.info.pixelType,
-            static_cast<uint8_t*>(output_slice_task_info.brick.data.get()) + static_cast<size_t>(output_slice_task_info.z_slice) * output_slice_task_info.brick.info.stride_plane,
-            allocated_memory.get(),
-            actual_size,
-            compression_options.second.get());
-
-        if (b == true)
+    // We compress into a scratch buffer of the max possible size, so the compression cannot fail for lack of space. Only then,
+    //  when the actual size is known, we allocate a block of exactly this size and copy the compressed data into it - so that the
+    //  memory accounted for as "compressed destination slice" is exactly the size of the compressed data. The scratch buffer is
+    //  taken from a pool (and returned afterwards), so its memory is allocated and accounted for only once per worker.
+    auto scratch_buffer = this->GetCompressionScratchBuffer(max_size_necessary);
+    size_t actual_size = max_size_necessary;
+    const bool b = pfn_compress(
+        output_slice_task_info.brick.info.width,
+        output_slice_task_info.brick.info.height,
+        output_slice_task_info.brick.info.stride_line,
+        output_slice_task_info.brick.info.pixelType,
+        static_cast<uint8_t*>(output_slice_task_info.brick.data.get()) + static_cast<size_t>(output_slice_task_info.z_slice) * output_slice_task_info.brick.info.stride_plane,
+        scratch_buffer->data.get(),
+        actual_size,
+        compression_parameters);
+
+    if (!b)
+    {
+        ostringstream error_text;
+        error_text << "We should not be able to get here, compression failed with the max possible size (size=" << max_size_necessary << ").";
+        throw logic_error(error_text.str());
+    }
+
+    if (this->adaptive_compression_level_)
+    {
+        this->UpdateAdaptiveCompressionLevel(size_of_slice, actual_size);
+    }
+
+    auto allocated_memory = this->context_.GetAllocator().Allocate(BrickAllocator::MemoryType::CompressedDestinationSlice, actual_size);
+    memcpy(allocated_memory.get(), scratch_buffer->data.get(), actual_size);
+    this->ReturnCompressionScratchBuffer(std::move(scratch_buffer));
+    return make_tuple(compression_options.first, make_shared<MemoryBlockWrapper>(allocated_memory, actual_size));
+}
+
+std::unique_ptr<DoWarp::CompressionScratchBuffer> DoWarp::GetCompressionScratchBuffer(size_t size)
+{
+    unique_ptr<CompressionScratchBuffer> scratch_buffer;
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_compression_scratch_buffers_);
+        if (!this->compression_scratch_buffers_.empty())
         {
-            return make_tuple(compression_options.first, make_shared<MemoryBlockWrapper>(allocated_memory, actual_size));
+            scratch_buffer = std::move(this->compression_scratch_buffers_.back());
+            this->compression_scratch_buffers_.pop_back();
         }
     }
 
-    ostringstream error_text;
-    error_text << "We should not be able to get here, compression failed on second attempt (size=" << max_size_necessary << ").";
-    throw logic_error(error_text.str());
+    if (!scratch_buffer)
+    {
+        scratch_buffer = make_unique<CompressionScratchBuffer>();
+    }
+
+    if (scratch_buffer->size < size)
+    {
+        // release the memory (and its registration) first, so that we do not hold both buffers at the same time
+        scratch_buffer->registration.reset();
+        scratch_buffer->data.reset();
+        scratch_buffer->size = 0;
+        scratch_buffer->data.reset(new uint8_t[size]);
+        scratch_buffer->size = size;
+        scratch_buffer->registration = this->context_.GetAllocator().RegisterExternalMemory(BrickAllocator::MemoryType::CompressionScratchBuffer, size);
+    }
+
+    return scratch_buffer;
+}
+
+void DoWarp::ReturnCompressionScratchBuffer(std::unique_ptr<CompressionScratchBuffer> scratch_buffer)
+{
+    if (scratch_buffer->size > DoWarp::kMaxSizeOfPooledCompressionScratchBuffer)
+    {
+        // an exceptionally large buffer is not kept around - it is released (and unregistered) here
+        return;
+    }
+
+    std::lock_guard<std::mutex> lck(this->mutex_compression_scratch_buffers_);
+    this->compression_scratch_buffers_.push_back(std::move(scratch_buffer));
+}
+
+/*static*/std::shared_ptr<libCZI::IMemoryBlock> DoWarp::GetUncompressedSlice(BrickAllocator& allocator, const Brick& brick, int z_slice)
+{
+    const auto& brick_info = brick.info;
+    const size_t bytes_per_line = static_cast<size_t>(brick_info.width) * Utils::GetBytesPerPixel(brick_info.pixelType);
+    const size_t size_of_slice = bytes_per_line * brick_info.height;
+    const auto* slice_data = static_cast<const uint8_t*>(brick.data.get()) + static_cast<size_t>(z_slice) * brick_info.stride_plane;
+
+    if (brick_info.stride_line == bytes_per_line)
+    {
+        // The z-plane of the destination brick is passed to the writer as it is (without a copy) - the aliasing shared_ptr
+        //  keeps the destination brick alive until the writer has written out the slice.
+        return make_shared<MemoryBlockWrapper>(
+            shared_ptr<void>(brick.data, const_cast<uint8_t*>(slice_data)),
+            size_of_slice);
+    }
+
+    // if the lines are not contiguous (which is not the case with the bricks we create), we have to copy them
+    auto allocated_memory = allocator.Allocate(BrickAllocator::MemoryType::CompressedDestinationSlice, size_of_slice);
+    for (uint32_t y = 0; y < brick_info.height; ++y)
+    {
+        memcpy(static_cast<uint8_t*>(allocated_memory.get()) + y * bytes_per_line, slice_data + y * static_cast<size_t>(brick_info.stride_line), bytes_per_line);
+    }
+
+    return make_shared<MemoryBlockWrapper>(allocated_memory, size_of_slice);
 }
 
-void DoWarp::DestinationMemoryReleased()
+std::shared_ptr<libCZI::IMemoryBlock> DoWarp::CompressChunked(const OutputSliceToCompressTaskInfo& output_slice_task_info, libCZI::CompressionMode compression_mode, const libCZI::ICompressParameters* compression_parameters)
 {
-    this->DoResume();
+    const auto& brick_info = output_slice_task_info.brick.info;
+    ChunkedZstdCompression chunked_compression(
+        this->context_.GetAllocator(),
+        compression_mode,
+        brick_info.pixelType,
+        brick_info.width,
+        brick_info.height,
+        brick_info.stride_line,
+        static_cast<const uint8_t*>(output_slice_task_info.brick.data.get()) + static_cast<size_t>(output_slice_task_info.z_slice) * brick_info.stride_plane,
+        compression_parameters,
+        this->compression_chunk_size_);
+
+    // The chunks are compressed by tasks of type "Compression" - which are not subject to the limit for "CompressSlice"-tasks
+    //  (which the suspended task here counts against). The counter includes the suspending task itself, so whoever decrements
+    //  it to zero (the last chunk-task or the suspending task) resumes the task.
+    const size_t number_of_chunks = chunked_compression.GetNumberOfChunks();
+    ITaskArena* task_arena = this->context_.GetTaskArena().get();
+    atomic<size_t> outstanding{ number_of_chunks + 1 };
+    atomic<bool> chunk_failed{ false };
+    ITaskArena::SuspendHandle suspend_handle = nullptr;
+    for (size_t i = 0; i < number_of_chunks; ++i)
+    {
+        task_arena->AddTask(
+            TaskType::Compression,
+            [task_arena, i, &chunked_compression, &outstanding, &chunk_failed, &suspend_handle]()->void
+            {
+                try
+                {
+                    chunked_compression.CompressChunk(i);
+                }
+                catch (exception&)
+                {
+                    chunk_failed = true;
+                }
+
+                if (--outstanding == 0)
+                {
+                    task_arena->ResumeTask(suspend_handle);
+                }
+            });
+    }
+
+    task_arena->SuspendCurrentTask(
+        [task_arena, &outstanding, &suspend_handle](ITaskArena::SuspendHandle handle)->void
+        {
+            suspend_handle = handle;
+            if (--outstanding == 0)
+            {
+                task_arena->ResumeTask(handle);
+            }
+        });
+
+    if (chunk_failed)
+    {
+        throw runtime_error("The chunked compression of a slice failed.");
+    }
+
+    const size_t size_of_compressed_slice = chunked_compression.GetSizeOfResult();
+    auto allocated_memory = this->context_.GetAllocator().Allocate(BrickAllocator::MemoryType::CompressedDestinationSlice, size_of_compressed_slice);
+    chunked_compression.CopyResult(allocated_memory.get());
+    return make_shared<MemoryBlockWrapper>(allocated_memory, size_of_compressed_slice);
+}
+
+DoWarp::AllZeroSlice DoWarp::GetAllZeroSlice(const OutputSliceToCompressTaskInfo& output_slice_task_info)
+{
+    const auto& brick_info = output_slice_task_info.brick.info;
+    const auto key = make_tuple(brick_info.width, brick_info.height, brick_info.pixelType);
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_all_zero_slices_);
+        const auto iterator = this->all_zero_slices_.find(key);
+        if (iterator != this->all_zero_slices_.cend())
+        {
+            return iterator->second;
+        }
+    }
+
+    // The slice at hand is all zero, so compressing it gives the data we are after. In the "uncompressed" mode, we must not
+    //  use the view onto the destination brick (which would keep it alive), so we create a zero-filled block instead.
+    // Note that two tasks may get here concurrently for the same key, in which case the first one to insert wins.
+    AllZeroSlice all_zero_slice;
+    if (this->context_.GetCommandLineOptions().GetCompressionOptions().first == CompressionMode::UnCompressed)
+    {
+        const size_t size_of_slice = static_cast<size_t>(brick_info.width) * brick_info.height * Utils::GetBytesPerPixel(brick_info.pixelType);
+        auto allocated_memory = this->context_.GetAllocator().Allocate(BrickAllocator::MemoryType::CompressedDestinationSlice, size_of_slice);
+        memset(allocated_memory.get(), 0, size_of_slice);
+        all_zero_slice.data = make_shared<MemoryBlockWrapper>(allocated_memory, size_of_slice);
+    }
+    else
+    {
+        all_zero_slice.data = get<1>(this->Compress(output_slice_task_info));
+    }
+
+    if (this->calculate_result_hash_)
+    {
+        all_zero_slice.hash_of_data = CalcResultHash::CalculateHashOfData(all_zero_slice.data);
+    }
+    else
+    {
+        all_zero_slice.hash_of_data.fill(0);
+    }
+
+    std::lock_guard<std::mutex> lck(this->mutex_all_zero_slices_);
+    return this->all_zero_slices_.emplace(key, all_zero_slice).first->second;
 }
 
-void DoWarp::AddResumeHandle(ITaskArena::SuspendHandle handle)
+void DoWarp::InitializeChunkedCompression()
 {
-    std::lock_guard<std::mutex> lck(this->mutex_resume_handles_);
-    this->resume_handles_.push_back(handle);
+    const int chunk_size_mb = this->context_.GetCommandLineOptions().GetPropertyBagForCompression().GetInt32OrDefault(ChunkedZstdCompression::kPropertyBagKey_chunk_size_mb, 0);
+    if (chunk_size_mb < 0)
+    {
+        ostringstream string_stream;
+        string_stream << "Invalid value " << chunk_size_mb << " for the compression parameter '" << ChunkedZstdCompression::kPropertyBagKey_chunk_size_mb << "'.";
+        throw invalid_argument(string_stream.str());
+    }
+
+    // the chunked compression is only applicable for zstd-compression (for "uncompressed" it is simply not used)
+    const auto compression_mode = this->context_.GetCommandLineOptions().GetCompressionOptions().first;
+    if (compression_mode == CompressionMode::Zstd0 || compression_mode == CompressionMode::Zstd1)
+    {
+        this->compression_chunk_size_ = static_cast<size_t>(chunk_size_mb) * 1024 * 1024;
+    }
 }
 
-void DoWarp::DoResume()
+void DoWarp::InitializeAdaptiveCompressionLevel()
 {
-    std::lock_guard<std::mutex> lck(this->mutex_resume_handles_);
-    for (const auto handle : this->resume_handles_)
+    const auto& property_bag = this->context_.GetCommandLineOptions().GetPropertyBagForCompression();
+    if (!property_bag.GetBoolOrDefault(AdaptiveCompressionLevel::kPropertyBagKey_adaptive_level, false))
     {
-        this->context_.GetTaskArena()->ResumeTask(handle);
+        return;
     }
 
-    this->resume_handles_.clear();
+    const auto& compression_options = this->context_.GetCommandLineOptions().GetCompressionOptions();
+    if (compression_options.first != CompressionMode::Zstd0 && compression_options.first != CompressionMode::Zstd1)
+    {
+        this->context_.DoIfVerbosityGreaterOrEqual(
+            MessagesPrintVerbosity::kNormal,
+            [](ILog* log)->void
+            {
+                log->WriteLineStdOut("The 'adaptive compression level' mode is only applicable for zstd-compression, it is ignored.");
+            });
+        return;
+    }
+
+    // the initial level is the one given with the compression-options (and the minimal level if none is given there)
+    const int min_level = property_bag.GetInt32OrDefault(AdaptiveCompressionLevel::kPropertyBagKey_min_level, 1);
+    const int max_level = property_bag.GetInt32OrDefault(AdaptiveCompressionLevel::kPropertyBagKey_max_level, 9);
+    CompressParameter parameter;
+    int initial_level = min_level;
+    if (compression_options.second &&
+        compression_options.second->TryGetProperty(static_cast<int>(CompressionParameterKey::ZSTD_RAWCOMPRESSION_LEVEL), &parameter))
+    {
+        initial_level = parameter.GetInt32();
+    }
+
+    this->adaptive_compression_level_ = make_unique<AdaptiveCompressionLevel>(
+        min_level,
+        max_level,
+        initial_level,
+        this->context_.GetTaskArena()->GetConcurrency(),
+        chrono::seconds(1));
+
+    // we prepare the compression parameters for all levels - they only differ in the level, the other parameters
+    //  are taken from the compression-options
+    for (int level = min_level; level <= max_level; ++level)
+    {
+        auto compression_parameters = make_shared<CompressParametersOnMap>();
+        if (compression_options.second &&
+            compression_options.second->TryGetProperty(static_cast<int>(CompressionParameterKey::ZSTD_PREPROCESS_DOLOHIBYTEPACKING), &parameter))
+        {
+            compression_parameters->map[static_cast<int>(CompressionParameterKey::ZSTD_PREPROCESS_DOLOHIBYTEPACKING)] = parameter;
+        }
+
+        compression_parameters->map[static_cast<int>(CompressionParameterKey::ZSTD_RAWCOMPRESSION_LEVEL)] = CompressParameter(static_cast<int32_t>(level));
+        this->compression_parameters_per_level_.push_back(compression_parameters);
+    }
+}
+
+void DoWarp::UpdateAdaptiveCompressionLevel(std::uint64_t uncompressed_size, std::uint64_t compressed_size)
+{
+    this->adaptive_compression_level_->AddCompressionResult(uncompressed_size, compressed_size);
+
+    AdaptiveCompressionLevel::PipelineState state;
+    state.write_slices_queue_size = this->writer_->GetSizeOfPendingSliceWriteOperations();
+    state.write_budget = this->context_.GetFlowControl().GetBudget(FlowControl::Stage::Write);
+    state.compression_tasks_in_flight = this->compression_tasks_in_flight_.load();
+    const int previous_level = this->adaptive_compression_level_->GetLevel();
+    double compression_ratio;
+    if (this->adaptive_compression_level_->TryUpdate(state, chrono::steady_clock::now(), &compression_ratio))
+    {
+        ostringstream string_stream;
+        string_stream << "Compression level changed from " << previous_level << " to " << this->adaptive_compression_level_->GetLevel() <<
+            " (write-slices queue-size: " << state.write_slices_queue_size << " of " << state.write_budget << " bytes" <<
+            ", compression tasks in flight: " << state.compression_tasks_in_flight <<
+            ", compression ratio: " << fixed << setprecision(2) << compression_ratio << ")";
+        this->context_.WriteDebugString((string_stream.str() + "\n").c_str());
+
+        // when the statistics are printed to the terminal, we do not interfere with this
+        this->context_.DoIfVerbosityGreaterOrEqual(
+            MessagesPrintVerbosity::kChatty,
+            [&](ILog* log)->void
+            {
+                if (!log->IsStdOutATerminal())
+                {
+                    log->WriteLineStdOut(string_stream.str());
+                }
+            });
+    }
 }
 
 float DoWarp::CalculateTotalProgress()
@@ -636,7 +1063,8 @@ float DoWarp::CalculateTotalProgress()
     auto expected_total_number = this->total_number_of_subblocks_to_output;
     if (expected_total_number > 0)
     {
-        float progress = 100.f * static_cast<float>(this->number_of_subblocks_added_to_writer_.load()) / this->total_number_of_subblocks_to_output;
+        // the omitted subblocks are accounted for as if they had been added to the writer
+        float progress = 100.f * static_cast<float>(this->number_of_subblocks_added_to_writer_.load() + this->number_of_subblocks_omitted_.load()) / this->total_number_of_subblocks_to_output;
         return progress;
     }
 
@@ -4,11 +4,14 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <functional>
 #include <tuple>
 #include <map>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <Eigen/Eigen>
 #include "inc_libCZI.h"
@@ -21,12 +24,16 @@
 #include "brickreader/IBrickReader.h"
 #include "BrickAllocator.h"
 #include "deskew_helpers.h"
+#include "utilities.h"
+#include "adaptive_compression_level.h"
 
 struct WarpStatistics
 {
     double elapsed_time_since_start_in_seconds;
     std::uint64_t bytes_read_from_source_file;
     double datarate_read_from_source_file;
+    std::uint64_t bytes_written_to_destination_file;    ///< The number of bytes (of subblocks) written to the destination file.
+    double average_datarate_to_destination_file;       ///< The number of bytes handed to the writer divided by the elapsed time (in bytes per second) - this is not the bandwidth achieved by the storage, since data may still be buffered.
     std::uint64_t source_brick_data_delivered;
     std::uint64_t source_bricks_delivered;
     std::uint64_t source_slices_read;
@@ -35,17 +42,28 @@ struct WarpStatistics
     double source_slices_read_per_second;
     std::uint32_t warp_tasks_in_flight;
     std::uint32_t compression_tasks_in_flight;
+    int compression_level;                      ///< The current zstd-level in the "adaptive compression level" mode (or -1 if this mode is not active).
+    std::uint32_t compression_level_changes;    ///< The number of changes of the zstd-level in the "adaptive compression level" mode.
     std::uint32_t write_slices_queue_length;
+    std::uint64_t write_slices_queue_size;     ///< The size (in bytes) of the slices in the writer's queue.
     bool reader_throttled;
     std::uint32_t task_arena_queue_length;      ///< The number of tasks in task-arena's queue.
+    std::array<std::uint32_t, Count_of_TaskTypes> task_arena_queue_length_per_task_type;  ///< The number of tasks in task-arena's queue for each task-type.
     std::uint32_t currently_active_tasks;       ///< The number of currently active tasks in task-arena's thread-pool.
     std::uint32_t currently_suspended_tasks;    ///< The number of currently suspended tasks in task-arena's thread-pool.
+    std::vector<float> numa_node_utilization;   ///< The utilization (in percent) of each NUMA-node of the task-arena (empty if not available).
     std::uint64_t brickreader_compressed_subblocks_in_flight;
     std::uint64_t brickreader_uncompressed_planes_in_flight;
     std::uint32_t subblocks_added_to_writer;    ///< The number of slices added to the writer.
+    std::uint32_t all_zero_slices;              ///< The number of slices which were known to be all zero (and for which the compression was skipped).
+    std::uint32_t subblocks_omitted;            ///< The number of (all zero) slices which were not written at all.
     float         total_progress_percent;       ///< An estimation of the overall progress, in percent (between 0 and 100). It is NaN in case no progress information is available.
 
     std::array<std::uint64_t, BrickAllocator::Count_of_MemoryTypes> memory_status;
+    BrickAllocator::WaitQueueStatistics allocation_wait_queue;  ///< Statistics about the allocator's wait-queue (i.e. the tasks waiting for a destination brick).
+
+    std::array<std::uint64_t, FlowControl::Count_of_Stages> credits_occupancy;  ///< The credits (in bytes) currently held by the stages of the pipeline.
+    std::array<std::uint64_t, FlowControl::Count_of_Stages> credits_budget;     ///< The budget (in bytes) of the stages of the pipeline.
 };
 
 /// This class is orchestrating the warp-operation.
@@ -113,6 +131,36 @@ class DoWarp
 
     std::unique_ptr<CalcResultHash> calculate_result_hash_; ///< This object is used to calculate a hash of the output; may be null in case this is not wanted.
 
+    std::unique_ptr<AdaptiveCompressionLevel> adaptive_compression_level_;  ///< In the "adaptive compression level" mode, this object determines the zstd-level; null otherwise.
+    std::vector<std::shared_ptr<libCZI::ICompressParameters>> compression_parameters_per_level_;   ///< In the "adaptive compression level" mode, the compression parameters for each level (starting with the minimal level).
+    /// The data of an all-zero slice (as passed to the writer), together with the hash of this data (which is only valid
+    /// if the result hash is calculated).
+    struct AllZeroSlice
+    {
+        std::shared_ptr<libCZI::IMemoryBlock> data;
+        std::array<std::uint8_t, 16> hash_of_data;
+    };
+
+    std::mutex mutex_all_zero_slices_;
+    std::map<std::tuple<std::uint32_t, std::uint32_t, libCZI::PixelType>, AllZeroSlice> all_zero_slices_;   ///< The (compressed) all-zero slices, for each combination of width, height and pixel type.
+    size_t compression_chunk_size_{ 0 };    ///< Slices larger than this (in bytes) are compressed in chunks (concurrently); zero means "no chunked compression".
+
+    /// A scratch buffer a slice is compressed into. Those buffers are kept in a pool and reused, so that the memory is
+    /// allocated (and accounted for as "compression scratch buffer") once per worker compressing slices - and not for
+    /// each slice.
+    struct CompressionScratchBuffer
+    {
+        std::unique_ptr<std::uint8_t[]> data;
+        size_t size{ 0 };
+        std::shared_ptr<void> registration;     ///< The registration of the memory with the allocator.
+    };
+
+    /// Scratch buffers larger than this (in bytes) are not put back into the pool, but released after use.
+    static constexpr size_t kMaxSizeOfPooledCompressionScratchBuffer = 64 * 1024 * 1024;
+
+    std::mutex mutex_compression_scratch_buffers_;
+    std::vector<std::unique_ptr<CompressionScratchBuffer>> compression_scratch_buffers_;    ///< The scratch buffers not in use at this time.
+
     std::chrono::time_point<std::chrono::high_resolution_clock> time_point_operation_started_;
 
     DeskewHelpers::ProjectionPlaneInfo projection_plane_info_; ///< This contains the information about the projection plane
@@ -125,9 +173,11 @@ class DoWarp
     std::atomic_uint32_t compression_tasks_in_flight_{ 0 };
     std::atomic_uint32_t warp_tasks_in_flight_{ 0 };
     std::atomic_uint32_t total_tasks_in_flight_{ 0 };
+    ConditionNotifier tasks_done_notifier_;  ///< Signalled when the number of tasks in flight drops to zero.
     std::atomic_uint32_t number_of_subblocks_added_to_writer_{ 0 };
-
-    std::atomic_bool above_high_water_mask2_{ false };
+    std::atomic_uint32_t number_of_all_zero_slices_{ 0 };
+    std::atomic_uint32_t number_of_subblocks_omitted_{ 0 };
+    int handle_credits_released_callback_{ 0 };
 public:
     /// Gets extent of the output brick for the specified input-brick. Note that
     /// this result does **not** including a tiling of the output-brick. If the specified brick_identifier is
@@ -144,6 +194,21 @@ public:
 
     const Eigen::Matrix4d& GetTransformationMatrix() const;
 
+    /// Gets the writer (as created in the constructor).
+    /// \returns The writer.
+    const std::shared_ptr<ICziSlicesWriter>& GetWriter() const;
+
+    /// Gets the data of the slice for the "uncompressed" mode - which usually is a view onto the z-plane of the brick (which
+    /// then keeps the brick alive). Only if the lines of the brick are not contiguous, the data is copied into memory taken
+    /// from the allocator.
+    ///
+    /// \param [in] allocator   The allocator.
+    /// \param      brick       The brick.
+    /// \param      z_slice     The z-plane of the brick.
+    ///
+    /// \returns The data of the slice.
+    static std::shared_ptr<libCZI::IMemoryBlock> GetUncompressedSlice(BrickAllocator& allocator, const Brick& brick, int z_slice);
+
     /// Constructor - where all relevant objects are passed in.
     ///
     /// \param [in,out] context                       The app-context.
@@ -151,7 +216,9 @@ public:
     /// \param          document_info                 Information describing the document.
     /// \param          transformation_matrix         The transformation matrix.
     /// \param          brick_reader                  The brick reader.
-    /// \param          writer                        The writer.
+    /// \param          create_writer                 Functor which creates the writer. It is called (from within the constructor) with
+    ///                                               the total number of subblocks to be written (not taking into account
+    ///                                               subblocks which may be omitted).
     /// \param          warp_affine_engine            The warp affine engine.
     DoWarp(
         AppContext& context,
@@ -159,9 +226,11 @@ public:
         const DeskewDocumentInfo& document_info,
         const Eigen::Matrix4d& transformation_matrix,
         std::shared_ptr< ICziBrickReader> brick_reader,
-        std::shared_ptr<ICziSlicesWriter> writer,
+        const std::function<std::shared_ptr<ICziSlicesWriter>(std::uint32_t)>& create_writer,
         std::shared_ptr<IWarpAffine> warp_affine_engine);
 
+    ~DoWarp();
+
     void DoOperation();
 
     bool IsDone();
@@ -169,16 +238,23 @@ public:
 
     void WaitUntilDone();
 
+    /// Wait until the operation is done or until the specified timeout has elapsed - whatever comes first.
+    ///
+    /// \param  timeout The timeout.
+    ///
+    /// \returns    True if the operation is done; false if the timeout elapsed.
+    bool WaitUntilDoneOrTimeout(std::chrono::milliseconds timeout);
+
     bool TryGetHash(std::array<uint8_t, 16>* hash_code) const;
 private:
     void InputBrick(const Brick& brick, const BrickCoordinateInfo& coordinate_info);
-    std::vector<ITaskArena::SuspendHandle> resume_handles_;
-    std::mutex mutex_resume_handles_;
 
     struct OutputSliceToCompressTaskInfo
     {
         Brick brick;
         int z_slice;
+        std::shared_ptr<void> credits;  ///< The credits (of the compress-stage) held for this slice.
+        bool is_all_zero;               ///< Whether the slice is known to be all zero (as reported by the warp-engine).
     };
 
     void ProcessOutputSlice(OutputSliceToCompressTaskInfo* output_slice_task_info, const libCZI::CDimCoordinate& coordinate, const SubblockXYM& xym, std::uint32_t source_brick_id);
@@ -187,6 +263,7 @@ private:
     void DecWarpTasksInFlight();
     void IncCompressionTasksInFlight();
     void DecCompressionTasksInFlight();
+    void DecTotalTasksInFlight();
 
     std::uint32_t GetTotalNumberOfTasksInFlight();
 
@@ -194,13 +271,47 @@ private:
     std::vector<libCZI::IntRect> Create2dTiling(const libCZI::IntRect& rectangle);
     Brick CreateBrick(libCZI::PixelType pixel_type, std::uint32_t width, std::uint32_t height, std::uint32_t depth);
     Brick CreateBrickAndWaitUntilAvailable(libCZI::PixelType pixel_type, std::uint32_t width, std::uint32_t height, std::uint32_t depth);
+    void AddSliceToWriter(const ICziSlicesWriter::AddSliceInfo& add_slice_info);
 
     void ProcessBrickCommon2(const Brick& brick, std::uint32_t brick_id, const Brick& destination_brick, const BrickCoordinateInfo& coordinate_info, std::uint32_t source_depth, const OutputBrickInfoRepository::TilingRectAndMandSceneIndex& rect_and_tile_identifier);
 
     std::tuple<libCZI::CompressionMode, std::shared_ptr<libCZI::IMemoryBlock>> Compress(const OutputSliceToCompressTaskInfo& output_slice_task_info);
 
-    void DestinationMemoryReleased();
-    void AddResumeHandle(ITaskArena::SuspendHandle handle);
-    void DoResume();
+    /// Gets a scratch buffer of (at least) the specified size from the pool - if the pool is empty, a new one is created,
+    /// and if the buffer is too small, it is enlarged. The buffer is to be returned with "ReturnCompressionScratchBuffer".
+    ///
+    /// \param  size    The size of the buffer in bytes.
+    ///
+    /// \returns The scratch buffer.
+    std::unique_ptr<CompressionScratchBuffer> GetCompressionScratchBuffer(size_t size);
+
+    /// Returns a scratch buffer to the pool - or releases it if it is larger than "kMaxSizeOfPooledCompressionScratchBuffer".
+    ///
+    /// \param  scratch_buffer  The scratch buffer.
+    void ReturnCompressionScratchBuffer(std::unique_ptr<CompressionScratchBuffer> scratch_buffer);
+
+    /// Gets the data of the slice (as it is passed to the writer) for a slice which is all zero. This data is the same for all
+    /// slices with the same width, height and pixel type - so it is only created once (from the first such slice) and then
+    /// shared.
+    ///
+    /// \param  output_slice_task_info  Information describing the slice (which must be all zero).
+    ///
+    /// \returns The data of the slice (and its hash).
+    AllZeroSlice GetAllZeroSlice(const OutputSliceToCompressTaskInfo& output_slice_task_info);
+
+    /// Compresses the slice in chunks, which are compressed concurrently by tasks of their own - the calling task is
+    /// suspended until all chunks are done. This method must be called from within a task.
+    ///
+    /// \param  output_slice_task_info  Information describing the slice.
+    /// \param  compression_mode        The compression mode (which must be "zstd0" or "zstd1").
+    /// \param  compression_parameters  The compression parameters (may be null).
+    ///
+    /// \returns The compressed data of the slice.
+    std::shared_ptr<libCZI::IMemoryBlock> CompressChunked(const OutputSliceToCompressTaskInfo& output_slice_task_info, libCZI::CompressionMode compression_mode, const libCZI::ICompressParameters* compression_parameters);
+
+    void InitializeChunkedCompression();
+    void InitializeAdaptiveCompressionLevel();
+    void UpdateAdaptiveCompressionLevel(std::uint64_t uncompressed_size, std::uint64_t compressed_size);
+
     float CalculateTotalProgress();
 };
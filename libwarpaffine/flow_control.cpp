@@ -0,0 +1,213 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "flow_control.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+FlowControl::FlowControl()
+{
+    for (size_t i = 0; i < Count_of_Stages; ++i)
+    {
+        this->array_occupancy_[i].store(0);
+        this->array_budget_[i].store(kUnlimitedBudget);
+    }
+}
+
+void FlowControl::SetBudget(Stage stage, std::uint64_t budget)
+{
+    this->array_budget_[static_cast<size_t>(stage)].store(budget);
+    this->NotifyStateChanged();
+}
+
+std::uint64_t FlowControl::GetBudget(Stage stage) const
+{
+    return this->array_budget_[static_cast<size_t>(stage)].load();
+}
+
+std::uint64_t FlowControl::GetOccupancy(Stage stage) const
+{
+    return this->array_occupancy_[static_cast<size_t>(stage)].load();
+}
+
+void FlowControl::GetState(std::array<std::uint64_t, Count_of_Stages>& occupancy, std::array<std::uint64_t, Count_of_Stages>& budget) const
+{
+    for (size_t i = 0; i < Count_of_Stages; ++i)
+    {
+        occupancy[i] = this->array_occupancy_[i].load();
+        budget[i] = this->array_budget_[i].load();
+    }
+}
+
+bool FlowControl::HasCapacity(Stage stage) const
+{
+    return this->GetOccupancy(stage) < this->GetBudget(stage);
+}
+
+bool FlowControl::HasDownstreamCapacity(Stage stage) const
+{
+    for (size_t i = static_cast<size_t>(stage) + 1; i < Count_of_Stages; ++i)
+    {
+        if (static_cast<Stage>(i) != Stage::Decode && !this->HasCapacity(static_cast<Stage>(i)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<void> FlowControl::TryAcquire(Stage stage, std::uint64_t size)
+{
+    if (!this->HasDownstreamCapacity(stage) || !this->TryAddToOccupancy(stage, size))
+    {
+        return nullptr;
+    }
+
+    return this->CreateToken(stage, size);
+}
+
+std::shared_ptr<void> FlowControl::Acquire(Stage stage, std::uint64_t size)
+{
+    for (;;)
+    {
+        auto credits = this->TryAcquire(stage, size);
+        if (credits)
+        {
+            return credits;
+        }
+
+        this->state_changed_notifier_.Wait(
+            [this, stage, size]()->bool
+            {
+                return this->CanAcquire(stage, size);
+            });
+    }
+}
+
+std::shared_ptr<void> FlowControl::Register(Stage stage, std::uint64_t size)
+{
+    this->array_occupancy_[static_cast<size_t>(stage)].fetch_add(size);
+    return this->CreateToken(stage, size);
+}
+
+void FlowControl::WaitUntil(const std::function<bool()>& predicate)
+{
+    this->state_changed_notifier_.Wait(predicate);
+}
+
+void FlowControl::NotifyStateChanged()
+{
+    this->state_changed_notifier_.Notify();
+}
+
+int FlowControl::AddCreditsReleasedCallback(const std::function<void(Stage)>& func)
+{
+    const int handle = this->next_functor_handle_++;
+    std::lock_guard<std::recursive_mutex> lck(this->mutex_callbacks_);
+    if (this->credits_released_functors_.insert(pair(handle, func)).second != true)
+    {
+        ostringstream error_text;
+        error_text << "handle " << handle << " was already existing, which is unexpected.";
+        throw logic_error(error_text.str());
+    }
+
+    return handle;
+}
+
+bool FlowControl::RemoveCreditsReleasedCallback(int handle)
+{
+    std::lock_guard<std::recursive_mutex> lck(this->mutex_callbacks_);
+    return this->credits_released_functors_.erase(handle) == 1;
+}
+
+/*static*/std::shared_ptr<void> FlowControl::TieCreditsToData(std::shared_ptr<void> data, std::shared_ptr<void> credits)
+{
+    void* pointer = data.get();
+    return shared_ptr<void>(
+        pointer,
+        [data = std::move(data), credits = std::move(credits)](void*) mutable
+        {
+            // release the data first, then return the credits (so that the memory is available again when the credits are)
+            data.reset();
+            credits.reset();
+        });
+}
+
+bool FlowControl::CanAcquire(Stage stage, std::uint64_t size) const
+{
+    if (!this->HasDownstreamCapacity(stage))
+    {
+        return false;
+    }
+
+    const uint64_t occupancy = this->GetOccupancy(stage);
+    return occupancy == 0 || occupancy + size <= this->GetBudget(stage);
+}
+
+bool FlowControl::TryAddToOccupancy(Stage stage, std::uint64_t size)
+{
+    const uint64_t budget = this->GetBudget(stage);
+    auto& occupancy = this->array_occupancy_[static_cast<size_t>(stage)];
+    for (;;)
+    {
+        uint64_t current_occupancy = occupancy.load();
+
+        // if no credits are held for the stage, we grant the request regardless of its size - otherwise a request
+        //  larger than the budget could never be granted
+        if (current_occupancy != 0 && current_occupancy + size > budget)
+        {
+            return false;
+        }
+
+        // Try to (atomically) make the adjustment - if this fails, then credits have been acquired or returned
+        //  on a different thread in the meantime, and we simply repeat the operation.
+        if (occupancy.compare_exchange_strong(current_occupancy, current_occupancy + size))
+        {
+            return true;
+        }
+    }
+}
+
+std::shared_ptr<void> FlowControl::CreateToken(Stage stage, std::uint64_t size)
+{
+    // the object returned is only a token - the pointer is not used for anything, it only has to be non-null
+    return shared_ptr<void>(
+        static_cast<void*>(this),
+        [this, stage, size](void*)
+        {
+            this->array_occupancy_[static_cast<size_t>(stage)].fetch_sub(size);
+            this->state_changed_notifier_.Notify();
+            std::lock_guard<std::recursive_mutex> lck(this->mutex_callbacks_);
+            for (const auto& item : this->credits_released_functors_)
+            {
+                item.second(stage);
+            }
+        });
+}
+
+/*static*/const char* FlowControl::StageToInformalString(Stage stage)
+{
+    switch (stage)
+    {
+    case Stage::Read:
+        return "Read";
+    case Stage::Decode:
+        return "Decode";
+    case Stage::Compose:
+        return "Compose";
+    case Stage::Warp:
+        return "Warp";
+    case Stage::Compress:
+        return "Compress";
+    case Stage::Write:
+        return "Write";
+    }
+
+    return "Invalid";
+}
@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "utilities.h"
+
+/// This class implements a credit-based flow control between the stages of the processing pipeline. Each stage
+/// has a budget (in bytes), and the data held by a stage is accounted for by acquiring credits from this budget.
+/// The credits are represented by a token object, and they are returned to the budget when this token is
+/// destroyed. An upstream stage may only acquire credits if the stages downstream of it have capacity left, so
+/// that back-pressure propagates smoothly from the writer back to the reader (instead of pausing the reader
+/// altogether when a global high-watermark is crossed).
+class FlowControl
+{
+public:
+    /// The stages of the pipeline, in the order in which the data is flowing through them.
+    enum class Stage
+    {
+        Read = 0,   ///< Compressed subblocks read from the source document (and not yet decoded).
+        Decode,     ///< Decoded planes of the source document (not yet composed into a brick).
+        Compose,    ///< Source bricks (not yet processed by the warp-affine operation).
+        Warp,       ///< Destination bricks.
+        Compress,   ///< Slices of destination bricks queued for (or undergoing) compression.
+        Write,      ///< Compressed slices queued in the writer.
+
+        Max
+    };
+
+    static constexpr size_t Count_of_Stages = static_cast<size_t>(Stage::Max);
+
+    /// The value used for "no budget", i.e. credits are granted without limit.
+    static constexpr std::uint64_t kUnlimitedBudget = (std::numeric_limits<std::uint64_t>::max)();
+
+    static const char* StageToInformalString(Stage stage);
+private:
+    std::array<std::atomic_uint64_t, Count_of_Stages> array_occupancy_;
+    std::array<std::atomic_uint64_t, Count_of_Stages> array_budget_;
+
+    std::atomic_int32_t next_functor_handle_{ 1 };
+
+    /// The mutex protecting the map of released-callbacks - it is held while the callbacks are running (so that a callback is
+    /// not running anymore once it has been removed). It is recursive because a callback may (indirectly) return credits.
+    std::recursive_mutex mutex_callbacks_;
+    std::map<int, std::function<void(Stage)>> credits_released_functors_;
+
+    /// This notifier is signalled whenever credits are returned (or NotifyStateChanged is called).
+    ConditionNotifier state_changed_notifier_;
+public:
+    FlowControl();
+
+    /// Sets the budget (in bytes) for the specified stage.
+    ///
+    /// \param  stage   The stage.
+    /// \param  budget  The budget in bytes (or kUnlimitedBudget).
+    void SetBudget(Stage stage, std::uint64_t budget);
+
+    /// Gets the budget (in bytes) of the specified stage.
+    ///
+    /// \param  stage   The stage.
+    ///
+    /// \returns    The budget (which is kUnlimitedBudget if no budget has been set).
+    std::uint64_t GetBudget(Stage stage) const;
+
+    /// Gets the amount of credits currently held for the specified stage.
+    ///
+    /// \param  stage   The stage.
+    ///
+    /// \returns    The occupancy of the stage in bytes.
+    std::uint64_t GetOccupancy(Stage stage) const;
+
+    /// Gets the occupancy and the budget of all stages.
+    ///
+    /// \param [out] occupancy  The occupancy (in bytes) of all stages.
+    /// \param [out] budget     The budget (in bytes) of all stages.
+    void GetState(std::array<std::uint64_t, Count_of_Stages>& occupancy, std::array<std::uint64_t, Count_of_Stages>& budget) const;
+
+    /// Query if the occupancy of the specified stage is below its budget.
+    ///
+    /// \param  stage   The stage.
+    ///
+    /// \returns    True if the stage has capacity left; false otherwise.
+    bool HasCapacity(Stage stage) const;
+
+    /// Query if all stages downstream of the specified stage have capacity left. The Decode-stage is exempt from
+    /// this check - decoded planes may have to wait for the remaining planes of their brick to be read (which is
+    /// the case with the linear-reading brick-reader), so back-pressure from this stage onto the reader could stall
+    /// the pipeline. The brick-readers for which this is safe check the Decode-stage themselves.
+    ///
+    /// \param  stage   The stage.
+    ///
+    /// \returns    True if all stages downstream have capacity left; false otherwise.
+    bool HasDownstreamCapacity(Stage stage) const;
+
+    /// Attempts to acquire the specified amount of credits for a stage. The credits are granted if they fit into
+    /// the budget of the stage (or if no credits are held for the stage at all, so that a request larger than the
+    /// budget is still granted, one at a time), and if the stages downstream have capacity left.
+    ///
+    /// \param  stage   The stage.
+    /// \param  size    The amount of credits (in bytes).
+    ///
+    /// \returns    If successful, a token representing the credits (which are returned when it is destroyed); null otherwise.
+    std::shared_ptr<void> TryAcquire(Stage stage, std::uint64_t size);
+
+    /// Acquires the specified amount of credits for a stage - blocking until they can be granted (with the same
+    /// rules as for TryAcquire). This method must only be called on threads which can be blocked without
+    /// preventing the pipeline to progress (i.e. not from within a task of the task-arena).
+    ///
+    /// \param  stage   The stage.
+    /// \param  size    The amount of credits (in bytes).
+    ///
+    /// \returns    A token representing the credits (which are returned when it is destroyed).
+    std::shared_ptr<void> Acquire(Stage stage, std::uint64_t size);
+
+    /// Takes the specified amount of credits for a stage unconditionally, i.e. the budget may be exceeded. This is
+    /// used for data which has been admitted upstream already and which has to be accounted for.
+    ///
+    /// \param  stage   The stage.
+    /// \param  size    The amount of credits (in bytes).
+    ///
+    /// \returns    A token representing the credits (which are returned when it is destroyed).
+    std::shared_ptr<void> Register(Stage stage, std::uint64_t size);
+
+    /// Blocks until the specified predicate is true. The predicate is evaluated initially, and then whenever
+    /// credits are returned or NotifyStateChanged is called. The predicate must not acquire or return credits.
+    ///
+    /// \param  predicate   The predicate.
+    void WaitUntil(const std::function<bool()>& predicate);
+
+    /// Wakes up the threads blocked in Acquire or WaitUntil whose condition is now satisfied.
+    void NotifyStateChanged();
+
+    /// Adds a functor which is called whenever credits are returned (passing in the stage the credits were held for).
+    ///
+    /// \param  func    The functor.
+    ///
+    /// \returns    A handle identifying the callback (to be used with RemoveCreditsReleasedCallback).
+    int AddCreditsReleasedCallback(const std::function<void(Stage)>& func);
+
+    /// Removes the callback identified by the specified handle. When this method returns, the callback is guaranteed
+    /// not to be running anymore (unless this method is called from within the callback itself).
+    ///
+    /// \param  handle  The handle (as returned by AddCreditsReleasedCallback).
+    ///
+    /// \returns    True if the callback was found and removed; false otherwise.
+    bool RemoveCreditsReleasedCallback(int handle);
+
+    /// Creates an object which keeps the specified data and the specified credits alive, and which points to the
+    /// data. This is used to tie the credits to the lifetime of e.g. a brick's data.
+    ///
+    /// \param  data    The data.
+    /// \param  credits The credits.
+    ///
+    /// \returns    An object pointing to the data and owning both the data and the credits.
+    static std::shared_ptr<void> TieCreditsToData(std::shared_ptr<void> data, std::shared_ptr<void> credits);
+private:
+    bool CanAcquire(Stage stage, std::uint64_t size) const;
+    bool TryAddToOccupancy(Stage stage, std::uint64_t size);
+    std::shared_ptr<void> CreateToken(Stage stage, std::uint64_t size);
+};
@@ -15,6 +15,7 @@
 #endif
 
 #include <chrono>  
+#include <optional>
 #include <thread>
 #include <tuple>
 #include <memory>
@@ -26,6 +27,8 @@
 #include "configure.h"
 #include "inc_libCZI.h"
 #include "czi_helpers.h"
+#include "document_analysis.h"
+#include "document_analysis_cache.h"
 #include "deskew_helpers.h"
 #include "dowarp.h"
 #include "sliceswriter/ISlicesWriter.h"
@@ -63,14 +66,14 @@ static std::uint32_t GetNumberOf3dplanesToProcess(const shared_ptr<ICZIReader>&
     return t_count * c_count;
 }
 
-static bool ReportSourceInfoAndCheckWhetherItCanBeProcessed(AppContext& app_context, const shared_ptr<ICZIReader>& reader)
+static bool ReportSourceInfoAndCheckWhetherItCanBeProcessed(AppContext& app_context, const shared_ptr<ICZIReader>& reader, const DocumentAnalysis& document_analysis)
 {
     try
     {
         bool can_be_processed = true;
 
         ostringstream ss;
-        auto statistics = reader->GetStatistics();
+        const auto& statistics = document_analysis.GetStatistics();
         bool t_valid, z_valid, c_valid;
         int t_count, z_count, c_count;
         t_valid = statistics.dimBounds.TryGetInterval(DimensionIndex::T, nullptr, &t_count);
@@ -105,19 +108,12 @@ static bool ReportSourceInfoAndCheckWhetherItCanBeProcessed(AppContext& app_cont
             }
         }
 
-        bool tile_found = false;
         libCZI::IntSize size_of_tile;
         // now, let's determine the size of a tile 
         // ...how do we go about it - the simplest approach is:
         // - look for the first tile which is pyramid-layer 0
         // - then... report it's size
-        reader->EnumSubset(nullptr, nullptr, true,
-            [&](int index, const SubBlockInfo& info)->bool
-            {
-                size_of_tile = info.physicalSize;
-                tile_found = true;
-                return false;
-            });
+        const bool tile_found = document_analysis.TryGetLayer0TileSize(&size_of_tile);
 
         if (tile_found)
         {
@@ -292,17 +288,88 @@ static tuple<shared_ptr<ICZIReader>, shared_ptr<IStreamEx>> CreateCziReader(AppC
     return make_tuple(spReader, stream);
 }
 
-static std::shared_ptr<ICziSlicesWriter> CreateCziWriter(AppContext& context)
+static std::shared_ptr<ICziSlicesWriter> CreateCziWriter(AppContext& context, std::uint32_t expected_number_of_subblocks)
 {
     if (!context.GetCommandLineOptions().GetUseNullWriter())
     {
-        return CreateSlicesWriterTbb(context, context.GetCommandLineOptions().GetDestinationCZIFilenameW());
+        if (!context.GetCommandLineOptions().GetPropertyBagForWriter().GetStringOrDefault(ICziSlicesWriter::kPropertyBagKey_fan_out, "").empty())
+        {
+            return CreateFanOutSlicesWriter(context, context.GetCommandLineOptions().GetDestinationCZIFilenameW());
+        }
+
+        return CreateSlicesWriterTbb(context, context.GetCommandLineOptions().GetDestinationCZIFilenameW(), expected_number_of_subblocks);
     }
 
     return CreateNullSlicesWriter();
 }
 
-static shared_ptr<ICziBrickReader> CreateCziBrickSource(AppContext& context, std::shared_ptr<ICZIReader> reader, std::shared_ptr<IStreamEx> stream)
+/// Gets the analysis of the source document. If an analysis-cache file is configured, we try to load the analysis
+/// from there (which is only successful if the cache file was created for the very same source file). Otherwise, the
+/// subblock-directory of the source document is analyzed.
+///
+/// \param [in]     app_context         The application context.
+/// \param          reader              The reader object for the source document.
+/// \param          stream              The stream object for the source document.
+/// \param [out]    source_fingerprint  If an analysis-cache is to be used, the fingerprint of the source document is put here.
+/// \param [out]    is_from_cache       True is put here if the analysis was loaded from the cache, false otherwise.
+///
+/// \returns    The document analysis.
+static shared_ptr<DocumentAnalysis> GetDocumentAnalysis(AppContext& app_context, const shared_ptr<ICZIReader>& reader, const shared_ptr<IStreamEx>& stream, std::optional<DocumentAnalysisCache::SourceFingerprint>& source_fingerprint, bool* is_from_cache)
+{
+    *is_from_cache = false;
+    const auto& cache_filename = app_context.GetCommandLineOptions().GetAnalysisCacheFilename();
+    if (!cache_filename.empty())
+    {
+        DocumentAnalysisCache::SourceFingerprint fingerprint;
+        if (DocumentAnalysisCache::TryGetSourceFingerprint(app_context.GetCommandLineOptions().GetSourceCZIFilename(), stream.get(), &fingerprint))
+        {
+            source_fingerprint = fingerprint;
+            auto document_analysis = DocumentAnalysisCache::TryLoad(cache_filename, fingerprint);
+            if (document_analysis)
+            {
+                *is_from_cache = true;
+                return document_analysis;
+            }
+
+            app_context.DoIfVerbosityGreaterOrEqual(MessagesPrintVerbosity::kNormal, [](auto log) {log->WriteLineStdOut("analysis-cache: not present or stale, the source document is analyzed"); });
+        }
+        else
+        {
+            app_context.DoIfVerbosityGreaterOrEqual(MessagesPrintVerbosity::kNormal, [](auto log) {log->WriteLineStdOut("analysis-cache: unable to identify the source file, the cache is not used"); });
+        }
+    }
+
+    return make_shared<DocumentAnalysis>(reader.get());
+}
+
+/// Write the document analysis to the analysis-cache file, if this is configured and if the cache file is
+/// not up-to-date (i.e. it was not loaded from the cache file, or more information was added to it).
+///
+/// \param [in]     app_context                                 The application context.
+/// \param          source_fingerprint                          The fingerprint of the source document (if not valid, nothing is done).
+/// \param          document_analysis                           The document analysis.
+/// \param          is_from_cache                               True if the document analysis was loaded from the cache file.
+/// \param          number_of_linear_reading_orders_from_cache  The number of linear-reading-orders contained in the analysis when it was loaded.
+static void UpdateDocumentAnalysisCache(AppContext& app_context, const std::optional<DocumentAnalysisCache::SourceFingerprint>& source_fingerprint, const DocumentAnalysis& document_analysis, bool is_from_cache, size_t number_of_linear_reading_orders_from_cache)
+{
+    if (!source_fingerprint.has_value())
+    {
+        return;
+    }
+
+    if (is_from_cache && document_analysis.GetLinearReadingOrders().size() == number_of_linear_reading_orders_from_cache)
+    {
+        return;
+    }
+
+    const auto& cache_filename = app_context.GetCommandLineOptions().GetAnalysisCacheFilename();
+    const bool success = DocumentAnalysisCache::TrySave(cache_filename, source_fingerprint.value(), document_analysis);
+    ostringstream ss;
+    ss << "analysis-cache: " << (success ? "written to" : "could not write to") << " \"" << cache_filename << "\"";
+    app_context.DoIfVerbosityGreaterOrEqual(MessagesPrintVerbosity::kNormal, [&ss](auto log) {log->WriteLineStdOut(ss.str()); });
+}
+
+static shared_ptr<ICziBrickReader> CreateCziBrickSource(AppContext& context, std::shared_ptr<ICZIReader> reader, std::shared_ptr<IStreamEx> stream, const std::shared_ptr<const DocumentAnalysis>& document_analysis)
 {
     shared_ptr<ICziBrickReader> brick_reader;
     try
@@ -310,13 +377,13 @@ static shared_ptr<ICziBrickReader> CreateCziBrickSource(AppContext& context, std
         switch (context.GetCommandLineOptions().GetBrickReaderImplementation())
         {
         case BrickReaderImplementation::kPlaneReader:
-            brick_reader = CreateBrickReaderPlaneReader(context, reader, stream);
+            brick_reader = CreateBrickReaderPlaneReader(context, reader, stream, document_analysis);
             break;
         case BrickReaderImplementation::kLinearReading:
-            brick_reader = CreateBrickReaderLinearReading(context, reader, stream);
+            brick_reader = CreateBrickReaderLinearReading(context, reader, stream, document_analysis);
             break;
         case BrickReaderImplementation::kPlaneReader2:
-            brick_reader = CreateBrickReaderPlaneReader2(context, reader, stream);
+            brick_reader = CreateBrickReaderPlaneReader2(context, reader, stream, document_analysis);
             break;
         }
     }
@@ -351,9 +418,8 @@ static void WaitUntilDoneWithStatisticsReporting(AppContext& app_context, DoWarp
             }
         }
 
-        this_thread::sleep_for(chrono::milliseconds(500));
-
-        if (do_warp.IsDone())
+        // wait for the operation to finish - the timeout determines how often the progress-report is updated
+        if (do_warp.WaitUntilDoneOrTimeout(chrono::milliseconds(500)))
         {
             break;
         }
@@ -380,7 +446,7 @@ static void WriteOutTotalProgress(AppContext& app_context, float total_progress)
 static void WaitUntilDoneMinimalVerbosity(AppContext& app_context, DoWarp& do_warp)
 {
     // what we do here is:
-    // - we loop-with-a-sleep until the DoWarp-object is reporting that it's operation is done
+    // - we loop-with-a-timed-wait until the DoWarp-object is reporting that it's operation is done
     // - we check the progress state at each iteration, and print a line like this "34.4%" every time the progress has 
     //    increased by at least 1% compared to the last report we printed
 
@@ -408,9 +474,8 @@ static void WaitUntilDoneMinimalVerbosity(AppContext& app_context, DoWarp& do_wa
             }
         }
 
-        this_thread::sleep_for(chrono::milliseconds(500));
-
-        if (do_warp.IsDone())
+        // wait for the operation to finish - the timeout determines how often the progress-report is updated
+        if (do_warp.WaitUntilDoneOrTimeout(chrono::milliseconds(500)))
         {
             break;
         }
@@ -432,12 +497,23 @@ static void WaitUntilDone(AppContext& app_context, DoWarp& do_warp)
     }
 }
 
-/// This function is used to modify the metadata of the output-document, depending on the operation-type.
+/// This function is used to modify the metadata of the output-document, depending on the operation-type. It is called
+/// after the metadata from the source document has been merged with the automatically generated metadata.
 ///
 /// \param [in,out] root_node      The root node of the CZI-document's XML-metadata.
 /// \param          operation_type Type of the operation.
-static void TweakMetadata(libCZI::IXmlNodeRw* root_node, OperationType operation_type)
+/// \param          output_extent  If non-null, the sizes SizeX, SizeY and SizeZ are set to this extent (of the output
+///                                document). This is used when subblocks are omitted, where the sizes determined from the
+///                                subblocks actually written may be smaller than the output document.
+static void TweakMetadata(libCZI::IXmlNodeRw* root_node, OperationType operation_type, const tuple<uint32_t, uint32_t, uint32_t>* output_extent)
 {
+    if (output_extent != nullptr)
+    {
+        root_node->GetOrCreateChildNode("Metadata/Information/Image/SizeX")->SetValueUI32(get<0>(*output_extent));
+        root_node->GetOrCreateChildNode("Metadata/Information/Image/SizeY")->SetValueUI32(get<1>(*output_extent));
+        root_node->GetOrCreateChildNode("Metadata/Information/Image/SizeZ")->SetValueUI32(get<2>(*output_extent));
+    }
+
     // here we tweak the metadata (specific to LLS-documents), depending on the operation-type
     auto zaxis_shear_node = root_node->GetChildNode("Metadata/Information/Image/Dimensions/Z/ZAxisShear");
     if (zaxis_shear_node)
@@ -508,19 +584,44 @@ int libmain(int argc, char** _argv)
             return EXIT_FAILURE;
         }
 
-        const bool can_process_document = ReportSourceInfoAndCheckWhetherItCanBeProcessed(app_context, get<0>(reader_and_stream));
+        // this is the one place where the subblock-directory of the source document is analyzed (or the analysis is
+        //  loaded from the analysis-cache) - all subsequent consumers are using the result of this analysis
+        std::optional<DocumentAnalysisCache::SourceFingerprint> source_fingerprint;
+        bool document_analysis_is_from_cache;
+        const auto document_analysis = GetDocumentAnalysis(app_context, get<0>(reader_and_stream), get<1>(reader_and_stream), source_fingerprint, &document_analysis_is_from_cache);
+        const size_t number_of_linear_reading_orders_from_cache = document_analysis->GetLinearReadingOrders().size();
+        app_context.DoIfVerbosityGreaterOrEqual(
+            MessagesPrintVerbosity::kNormal,
+            [&](auto log)
+            {
+                ostringstream ss;
+                ss.imbue(app_context.GetFormattingLocale());
+                ss << (document_analysis_is_from_cache ? "analysis of subblock-directory (from analysis-cache): " : "analysis of subblock-directory: ")
+                    << document_analysis->GetSubblocks().size() << " subblocks in "
+                    << fixed << setprecision(2) << document_analysis->GetDurationOfAnalysis().count() << "s";
+                log->WriteLineStdOut(ss.str());
+            });
+
+        const bool can_process_document = ReportSourceInfoAndCheckWhetherItCanBeProcessed(app_context, get<0>(reader_and_stream), *document_analysis);
         if (!can_process_document)
         {
             app_context.DoIfVerbosityGreaterOrEqual(MessagesPrintVerbosity::kNormal, [](auto log) {log->WriteLineStdOut("-> Document was determined to be unsuitable and cannot be processed with this tool."); });
             return EXIT_FAILURE;
         }
 
-        auto writer = CreateCziWriter(app_context);
+        // the brick-reader may need to add information to the analysis (i.e. the linear reading order) - this is done
+        //  here, before the analysis is shared with the brick-reader (and the cache is updated only afterwards)
+        if (app_context.GetCommandLineOptions().GetBrickReaderImplementation() == BrickReaderImplementation::kLinearReading)
+        {
+            PrepareDocumentAnalysisForLinearReading(app_context, *document_analysis);
+        }
+
+        auto brick_source = CreateCziBrickSource(app_context, get<0>(reader_and_stream), get<1>(reader_and_stream), document_analysis);
 
-        auto brick_source = CreateCziBrickSource(app_context, get<0>(reader_and_stream), get<1>(reader_and_stream));
+        UpdateDocumentAnalysisCache(app_context, source_fingerprint, *document_analysis, document_analysis_is_from_cache, number_of_linear_reading_orders_from_cache);
         auto warp_affine_engine = CreateWarpAffineEngine(app_context);
 
-        DeskewDocumentInfo document_info = CziHelpers::GetDocumentInfo(get<0>(reader_and_stream).get());
+        DeskewDocumentInfo document_info = CziHelpers::GetDocumentInfo(get<0>(reader_and_stream).get(), *document_analysis);
 
         // Apply illumination angle override from command line if specified
         const auto illumination_angle_override = app_context.GetCommandLineOptions().GetIlluminationAngleOverride();
@@ -533,14 +634,16 @@ int libmain(int argc, char** _argv)
             app_context.GetCommandLineOptions().GetTypeOfOperation(),
             document_info);
 
+        const uint32_t number_of_3dplanes_to_process = GetNumberOf3dplanesToProcess(get<0>(reader_and_stream));
         DoWarp doWarp(
             app_context,
-            GetNumberOf3dplanesToProcess(get<0>(reader_and_stream)),
+            number_of_3dplanes_to_process,
             document_info,
             transformation_matrix,
             brick_source,
-            writer,
+            [&app_context](uint32_t expected_number_of_subblocks)->shared_ptr<ICziSlicesWriter> {return CreateCziWriter(app_context, expected_number_of_subblocks); },
             warp_affine_engine);
+        const auto writer = doWarp.GetWriter();
 
         Configure configurator(app_context);
         const bool configuration_successful = configurator.DoConfiguration(document_info, doWarp);
@@ -564,7 +667,15 @@ int libmain(int argc, char** _argv)
         WaitUntilDone(app_context, doWarp);
 
         const auto type_of_operation = app_context.GetCommandLineOptions().GetTypeOfOperation();
-        const auto functor_tweak_metadata = [type_of_operation](libCZI::IXmlNodeRw* root_node)->void {TweakMetadata(root_node, type_of_operation); };
+        // with "omit empty subblocks", the sizes derived from the subblocks written may not cover the whole output volume, so
+        //  we state the full extent explicitly
+        const bool set_output_extent = app_context.GetCommandLineOptions().GetDoOmitEmptySubblocks();
+        const auto output_extent = doWarp.GetOutputExtent();
+        const auto functor_tweak_metadata =
+            [type_of_operation, set_output_extent, output_extent](libCZI::IXmlNodeRw* root_node)->void
+            {
+                TweakMetadata(root_node, type_of_operation, set_output_extent ? &output_extent : nullptr);
+            };
         const auto functor_copy_attachments = app_context.GetCommandLineOptions().GetCopyAttachmentsFromSourceToDestination() ?
                                                 [&reader_and_stream](libCZI::ICziWriter* czi_writer)->void {CopyAttachmentsFromSourceToDestination(get<0>(reader_and_stream).get(), czi_writer); } :
                                                 std::function<void(libCZI::ICziWriter*)>{};
@@ -607,6 +718,19 @@ int libmain(int argc, char** _argv)
             break;
         }
 
+        app_context.DoIfVerbosityGreaterOrEqual(
+            MessagesPrintVerbosity::kNormal,
+            [&](auto log)
+            {
+                const auto close_timings = writer->GetCloseTimings();
+                ostringstream ss;
+                ss.imbue(app_context.GetFormattingLocale());
+                ss << fixed << setprecision(2)
+                    << "closing the output: drain " << close_timings.drain.count() << "s, metadata " << close_timings.metadata.count()
+                    << "s, attachments " << close_timings.attachments.count() << "s, subblock-directory " << close_timings.directory.count() << "s";
+                log->WriteLineStdOut(ss.str());
+            });
+
         array<uint8_t, 16> hash_code;
         if (doWarp.TryGetHash(&hash_code))
         {
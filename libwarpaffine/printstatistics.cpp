@@ -22,7 +22,10 @@ PrintStatistics::PrintStatistics(AppContext& context)
     this->info_items_.push_back({ "task-arena queue length", bind(&PrintStatistics::FormatTaskArenaQueueLength, this, placeholders::_1) });
     this->info_items_.push_back({ "read from source file", bind(&PrintStatistics::FormatBytesReadFromSourceFile, this, placeholders::_1) });
     this->info_items_.push_back({ "# of subblocks added to writer", bind(&PrintStatistics::FormatNumberOfSlicesAddedToWriter, this, placeholders::_1) });
+    this->info_items_.push_back({ "# of all-zero slices", bind(&PrintStatistics::FormatNumberOfAllZeroSlices, this, placeholders::_1) });
     this->info_items_.push_back({ "datarate reading from source file", bind(&PrintStatistics::FormatDataRateReadingFromSourceFile, this, placeholders::_1) });
+    this->info_items_.push_back({ "written to destination file", bind(&PrintStatistics::FormatBytesWrittenToDestinationFile, this, placeholders::_1) });
+    this->info_items_.push_back({ "avg. datarate to dest. file", bind(&PrintStatistics::FormatAverageDataRateToDestinationFile, this, placeholders::_1) });
     this->info_items_.push_back({ "input total brick-data size", bind(&PrintStatistics::FormatTotalInputBrickDataSize, this, placeholders::_1) });
     this->info_items_.push_back({ "input brick count", bind(&PrintStatistics::FormatInputBrickCount, this, placeholders::_1) });
     this->info_items_.push_back({ "input brick datarate", bind(&PrintStatistics::FormatInputBrickDataRate, this, placeholders::_1) });
@@ -30,15 +33,29 @@ PrintStatistics::PrintStatistics(AppContext& context)
     this->info_items_.push_back({ "input slices rate", bind(&PrintStatistics::FormatInputSlicesRate, this, placeholders::_1) });
     this->info_items_.push_back({ "warp-affine tasks in flight", bind(&PrintStatistics::FormatWarpAffineTasksInFlight, this, placeholders::_1) });
     this->info_items_.push_back({ "compression tasks in flight", bind(&PrintStatistics::FormatCompressionTasksInFlight, this, placeholders::_1) });
+    this->info_items_.push_back({ "adaptive compression level", bind(&PrintStatistics::FormatAdaptiveCompressionLevel, this, placeholders::_1) });
     this->info_items_.push_back({ "write-slices queue-length", bind(&PrintStatistics::FormatWriteSlicesQueueLength, this, placeholders::_1) });
+    this->info_items_.push_back({ "write-slices queue-size", bind(&PrintStatistics::FormatWriteSlicesQueueSize, this, placeholders::_1) });
     this->info_items_.push_back({ "brickreader throttled", bind(&PrintStatistics::FormatBrickReaderThrottled, this, placeholders::_1) });
     this->info_items_.push_back({ "# of active tasks", bind(&PrintStatistics::FormatCurrentlyActiveTasks, this, placeholders::_1) });
     this->info_items_.push_back({ "# of suspended tasks", bind(&PrintStatistics::FormatCurrentlySuspendedTasks, this, placeholders::_1) });
+    this->info_items_.push_back({ "NUMA-node utilization", bind(&PrintStatistics::FormatNumaNodeUtilization, this, placeholders::_1) });
+    this->info_items_.push_back({ "allocation wait-queue length", bind(&PrintStatistics::FormatAllocationWaitQueueLength, this, placeholders::_1) });
+    this->info_items_.push_back({ "allocation wait-time (avg/max)", bind(&PrintStatistics::FormatAllocationWaitTime, this, placeholders::_1) });
     this->info_items_.push_back({ "(compressed) subblocks in flight", bind(&PrintStatistics::FormatNumberOfCompressedSubblocksInFlight, this, placeholders::_1) });
     this->info_items_.push_back({ "(uncompressed) planes in flight", bind(&PrintStatistics::FormatNumberOfUncompressedPlanesInFlight, this, placeholders::_1) });
     this->info_items_.push_back({ "Memory: source bricks", bind(&PrintStatistics::FormatAllocatedMemorySourceBricks, this, placeholders::_1) });
     this->info_items_.push_back({ "Memory: destination bricks", bind(&PrintStatistics::FormatAllocatedMemoryDestinationBricks, this, placeholders::_1) });
     this->info_items_.push_back({ "Memory: compressed dest. slices", bind(&PrintStatistics::FormatAllocatedMemoryCompressedDestinationSlice, this, placeholders::_1) });
+    this->info_items_.push_back({ "Memory: compressed src. subblocks", bind(&PrintStatistics::FormatAllocatedMemoryCompressedSourceSubblock, this, placeholders::_1) });
+    this->info_items_.push_back({ "Memory: decoded source planes", bind(&PrintStatistics::FormatAllocatedMemoryDecodedSourcePlane, this, placeholders::_1) });
+    this->info_items_.push_back({ "Memory: compression scratch", bind(&PrintStatistics::FormatAllocatedMemoryCompressionScratchBuffer, this, placeholders::_1) });
+    this->info_items_.push_back({ "Credits: read", bind(&PrintStatistics::FormatCreditsOfStage, this, placeholders::_1, FlowControl::Stage::Read) });
+    this->info_items_.push_back({ "Credits: decode", bind(&PrintStatistics::FormatCreditsOfStage, this, placeholders::_1, FlowControl::Stage::Decode) });
+    this->info_items_.push_back({ "Credits: compose", bind(&PrintStatistics::FormatCreditsOfStage, this, placeholders::_1, FlowControl::Stage::Compose) });
+    this->info_items_.push_back({ "Credits: warp", bind(&PrintStatistics::FormatCreditsOfStage, this, placeholders::_1, FlowControl::Stage::Warp) });
+    this->info_items_.push_back({ "Credits: compress", bind(&PrintStatistics::FormatCreditsOfStage, this, placeholders::_1, FlowControl::Stage::Compress) });
+    this->info_items_.push_back({ "Credits: write", bind(&PrintStatistics::FormatCreditsOfStage, this, placeholders::_1, FlowControl::Stage::Write) });
 
     this->max_length_of_name = (numeric_limits<int>::min)();
     for (const auto& item : this->info_items_)
@@ -63,6 +80,23 @@ std::string PrintStatistics::FormatTaskArenaQueueLength(const WarpStatistics& wa
     std::ostringstream ss;
     ss.imbue(this->GetFormattingLocale());
     ss << warp_statistics.task_arena_queue_length;
+
+    // and then the breakdown by task-type, for the task-types which are currently queued
+    const char* separator = " (";
+    for (size_t i = 0; i < Count_of_TaskTypes; ++i)
+    {
+        if (warp_statistics.task_arena_queue_length_per_task_type[i] > 0)
+        {
+            ss << separator << ITaskArena::TaskTypeToInformalString(static_cast<TaskType>(i)) << ": " << warp_statistics.task_arena_queue_length_per_task_type[i];
+            separator = ", ";
+        }
+    }
+
+    if (*separator == ',')
+    {
+        ss << ")";
+    }
+
     return ss.str();
 }
 
@@ -82,6 +116,22 @@ std::string PrintStatistics::FormatDataRateReadingFromSourceFile(const WarpStati
     return ss.str();
 }
 
+std::string PrintStatistics::FormatBytesWrittenToDestinationFile(const WarpStatistics& warp_statistics)
+{
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << fixed << setprecision(1) << warp_statistics.bytes_written_to_destination_file / 1e6 << " MB";
+    return ss.str();
+}
+
+std::string PrintStatistics::FormatAverageDataRateToDestinationFile(const WarpStatistics& warp_statistics)
+{
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << fixed << setprecision(1) << warp_statistics.average_datarate_to_destination_file / 1e6 << " MB/s";
+    return ss.str();
+}
+
 std::string PrintStatistics::FormatTotalInputBrickDataSize(const WarpStatistics& warp_statistics)
 {
     std::ostringstream ss;
@@ -138,6 +188,19 @@ std::string PrintStatistics::FormatCompressionTasksInFlight(const WarpStatistics
     return ss.str();
 }
 
+std::string PrintStatistics::FormatAdaptiveCompressionLevel(const WarpStatistics& warp_statistics)
+{
+    if (warp_statistics.compression_level < 0)
+    {
+        return "N/A";
+    }
+
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << warp_statistics.compression_level << " (" << warp_statistics.compression_level_changes << " changes)";
+    return ss.str();
+}
+
 std::string PrintStatistics::FormatWriteSlicesQueueLength(const WarpStatistics& warp_statistics)
 {
     std::ostringstream ss;
@@ -146,6 +209,14 @@ std::string PrintStatistics::FormatWriteSlicesQueueLength(const WarpStatistics&
     return ss.str();
 }
 
+std::string PrintStatistics::FormatWriteSlicesQueueSize(const WarpStatistics& warp_statistics)
+{
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << fixed << setprecision(1) << warp_statistics.write_slices_queue_size / 1e6 << " MB";
+    return ss.str();
+}
+
 std::string PrintStatistics::FormatBrickReaderThrottled(const WarpStatistics& warp_statistics)
 {
     return warp_statistics.reader_throttled ? "yes" : "no";
@@ -167,6 +238,40 @@ std::string PrintStatistics::FormatCurrentlySuspendedTasks(const WarpStatistics&
     return ss.str();
 }
 
+std::string PrintStatistics::FormatNumaNodeUtilization(const WarpStatistics& warp_statistics)
+{
+    if (warp_statistics.numa_node_utilization.empty())
+    {
+        return "N/A";
+    }
+
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    for (size_t i = 0; i < warp_statistics.numa_node_utilization.size(); ++i)
+    {
+        ss << (i > 0 ? ", " : "") << "node" << i << ": " << fixed << setprecision(0) << warp_statistics.numa_node_utilization[i] << " %";
+    }
+
+    return ss.str();
+}
+
+std::string PrintStatistics::FormatAllocationWaitQueueLength(const WarpStatistics& warp_statistics)
+{
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << warp_statistics.allocation_wait_queue.queue_length;
+    return ss.str();
+}
+
+std::string PrintStatistics::FormatAllocationWaitTime(const WarpStatistics& warp_statistics)
+{
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << fixed << setprecision(1) << warp_statistics.allocation_wait_queue.average_wait_time_in_seconds * 1000 << " ms / "
+        << warp_statistics.allocation_wait_queue.max_wait_time_in_seconds * 1000 << " ms";
+    return ss.str();
+}
+
 std::string PrintStatistics::FormatNumberOfCompressedSubblocksInFlight(const WarpStatistics& warp_statistics)
 {
     if (warp_statistics.brickreader_compressed_subblocks_in_flight != numeric_limits<uint64_t>::max())
@@ -208,6 +313,37 @@ std::string PrintStatistics::FormatAllocatedMemoryCompressedDestinationSlice(con
     return Utilities::FormatMemorySize(warp_statistics.memory_status[static_cast<size_t>(BrickAllocator::MemoryType::CompressedDestinationSlice)], " ");
 }
 
+std::string PrintStatistics::FormatAllocatedMemoryCompressedSourceSubblock(const WarpStatistics& warp_statistics)
+{
+    return Utilities::FormatMemorySize(warp_statistics.memory_status[static_cast<size_t>(BrickAllocator::MemoryType::CompressedSourceSubblock)], " ");
+}
+
+std::string PrintStatistics::FormatAllocatedMemoryDecodedSourcePlane(const WarpStatistics& warp_statistics)
+{
+    return Utilities::FormatMemorySize(warp_statistics.memory_status[static_cast<size_t>(BrickAllocator::MemoryType::DecodedSourcePlane)], " ");
+}
+
+std::string PrintStatistics::FormatAllocatedMemoryCompressionScratchBuffer(const WarpStatistics& warp_statistics)
+{
+    return Utilities::FormatMemorySize(warp_statistics.memory_status[static_cast<size_t>(BrickAllocator::MemoryType::CompressionScratchBuffer)], " ");
+}
+
+std::string PrintStatistics::FormatCreditsOfStage(const WarpStatistics& warp_statistics, FlowControl::Stage stage)
+{
+    // we give the occupancy of the stage as percentage of its budget
+    const uint64_t occupancy = warp_statistics.credits_occupancy[static_cast<size_t>(stage)];
+    const uint64_t budget = warp_statistics.credits_budget[static_cast<size_t>(stage)];
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << Utilities::FormatMemorySize(occupancy, " ");
+    if (budget != FlowControl::kUnlimitedBudget && budget > 0)
+    {
+        ss << " (" << fixed << setprecision(0) << 100.0 * static_cast<double>(occupancy) / static_cast<double>(budget) << " %)";
+    }
+
+    return ss.str();
+}
+
 std::string PrintStatistics::FormatNumberOfSlicesAddedToWriter(const WarpStatistics& warp_statistics)
 {
     std::ostringstream ss;
@@ -216,6 +352,19 @@ std::string PrintStatistics::FormatNumberOfSlicesAddedToWriter(const WarpStatist
     return ss.str();
 }
 
+std::string PrintStatistics::FormatNumberOfAllZeroSlices(const WarpStatistics& warp_statistics)
+{
+    std::ostringstream ss;
+    ss.imbue(this->GetFormattingLocale());
+    ss << warp_statistics.all_zero_slices;
+    if (warp_statistics.subblocks_omitted > 0)
+    {
+        ss << " (" << warp_statistics.subblocks_omitted << " omitted)";
+    }
+
+    return ss.str();
+}
+
 std::string PrintStatistics::FormatOverallProgress(const WarpStatistics& warp_statistics)
 {
     std::ostringstream ss;
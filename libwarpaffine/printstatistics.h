@@ -56,6 +56,8 @@ private:
     std::string FormatTaskArenaQueueLength(const WarpStatistics& warp_statistics);
     std::string FormatBytesReadFromSourceFile(const WarpStatistics& warp_statistics);
     std::string FormatDataRateReadingFromSourceFile(const WarpStatistics& warp_statistics);
+    std::string FormatBytesWrittenToDestinationFile(const WarpStatistics& warp_statistics);
+    std::string FormatAverageDataRateToDestinationFile(const WarpStatistics& warp_statistics);
     std::string FormatTotalInputBrickDataSize(const WarpStatistics& warp_statistics);
     std::string FormatInputBrickCount(const WarpStatistics& warp_statistics);
     std::string FormatInputBrickDataRate(const WarpStatistics& warp_statistics);
@@ -63,16 +65,26 @@ private:
     std::string FormatInputSlicesRate(const WarpStatistics& warp_statistics);
     std::string FormatWarpAffineTasksInFlight(const WarpStatistics& warp_statistics);
     std::string FormatCompressionTasksInFlight(const WarpStatistics& warp_statistics);
+    std::string FormatAdaptiveCompressionLevel(const WarpStatistics& warp_statistics);
     std::string FormatWriteSlicesQueueLength(const WarpStatistics& warp_statistics);
+    std::string FormatWriteSlicesQueueSize(const WarpStatistics& warp_statistics);
     std::string FormatBrickReaderThrottled(const WarpStatistics& warp_statistics);
     std::string FormatCurrentlyActiveTasks(const WarpStatistics& warp_statistics);
     std::string FormatCurrentlySuspendedTasks(const WarpStatistics& warp_statistics);
+    std::string FormatNumaNodeUtilization(const WarpStatistics& warp_statistics);
+    std::string FormatAllocationWaitQueueLength(const WarpStatistics& warp_statistics);
+    std::string FormatAllocationWaitTime(const WarpStatistics& warp_statistics);
     std::string FormatNumberOfCompressedSubblocksInFlight(const WarpStatistics& warp_statistics);
     std::string FormatNumberOfUncompressedPlanesInFlight(const WarpStatistics& warp_statistics);
     std::string FormatAllocatedMemorySourceBricks(const WarpStatistics& warp_statistics);
     std::string FormatAllocatedMemoryDestinationBricks(const WarpStatistics& warp_statistics);
     std::string FormatAllocatedMemoryCompressedDestinationSlice(const WarpStatistics& warp_statistics);
+    std::string FormatAllocatedMemoryCompressedSourceSubblock(const WarpStatistics& warp_statistics);
+    std::string FormatAllocatedMemoryDecodedSourcePlane(const WarpStatistics& warp_statistics);
+    std::string FormatAllocatedMemoryCompressionScratchBuffer(const WarpStatistics& warp_statistics);
+    std::string FormatCreditsOfStage(const WarpStatistics& warp_statistics, FlowControl::Stage stage);
     std::string FormatNumberOfSlicesAddedToWriter(const WarpStatistics& warp_statistics);
+    std::string FormatNumberOfAllZeroSlices(const WarpStatistics& warp_statistics);
     std::string FormatOverallProgress(const WarpStatistics& warp_statistics);
 
     const std::locale& GetFormattingLocale() const { return this->context_.GetFormattingLocale(); }
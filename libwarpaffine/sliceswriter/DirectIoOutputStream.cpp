@@ -0,0 +1,298 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "DirectIoOutputStream.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+using namespace std;
+
+void DirectIoOutputStream::AlignedMemoryDeleter::operator()(std::uint8_t* p) const
+{
+    ::operator delete(p, std::align_val_t{ kAlignment });
+}
+
+DirectIoOutputStream::DirectIoOutputStream(const std::wstring& filename, std::uint64_t staging_buffer_size, bool use_direct_io)
+    : filename_(filename)
+{
+    if (staging_buffer_size == 0)
+    {
+        throw invalid_argument("The size of the staging buffer must be greater than zero.");
+    }
+
+    this->staging_buffer_size_ = (staging_buffer_size + kAlignment - 1) / kAlignment * kAlignment;
+    for (auto& staging_buffer : this->staging_buffers_)
+    {
+        staging_buffer.data.reset(static_cast<uint8_t*>(::operator new(static_cast<size_t>(this->staging_buffer_size_), std::align_val_t{ kAlignment })));
+    }
+
+    if (use_direct_io)
+    {
+        try
+        {
+            this->file_ = make_unique<OutputFile>(filename, OutputFile::OpenMode::kCreate, true);
+            this->is_direct_io_ = true;
+        }
+        catch (runtime_error&)
+        {
+            // the file system (or the operating system) may not support direct I/O, so we fall back to regular I/O
+        }
+    }
+
+    if (!this->file_)
+    {
+        this->file_ = make_unique<OutputFile>(filename, OutputFile::OpenMode::kCreate, false);
+        this->is_direct_io_ = false;
+    }
+
+    this->flush_thread_ = std::thread([this] {this->FlushWorker(); });
+}
+
+DirectIoOutputStream::~DirectIoOutputStream()
+{
+    if (!this->closed_)
+    {
+        try
+        {
+            this->Close();
+        }
+        catch (...)
+        {
+            // there is no way to report an error from the destructor
+        }
+    }
+
+    this->ShutdownFlushThread();
+}
+
+void DirectIoOutputStream::Write(std::uint64_t offset, const void* pv, std::uint64_t size, std::uint64_t* ptrBytesWritten)
+{
+    if (this->closed_)
+    {
+        throw logic_error("The stream has already been closed.");
+    }
+
+    const auto* data = static_cast<const uint8_t*>(pv);
+    uint64_t position = offset;
+    uint64_t remaining = size;
+    while (remaining > 0)
+    {
+        StagingBuffer& staging_buffer = this->staging_buffers_[this->filling_buffer_index_];
+        if (position < staging_buffer.file_offset)
+        {
+            // this part of the file has already been handed over for writing, so we have to defer this write operation
+            const uint64_t bytes_to_copy = min(remaining, staging_buffer.file_offset - position);
+            this->deferred_writes_.push_back(DeferredWrite{ position, vector<uint8_t>(data, data + bytes_to_copy) });
+            position += bytes_to_copy;
+            data += bytes_to_copy;
+            remaining -= bytes_to_copy;
+        }
+        else if (position < staging_buffer.file_offset + this->staging_buffer_size_)
+        {
+            const uint64_t offset_in_buffer = position - staging_buffer.file_offset;
+            if (offset_in_buffer > staging_buffer.size)
+            {
+                // a part of the file which has been skipped is filled with zeroes
+                memset(staging_buffer.data.get() + staging_buffer.size, 0, static_cast<size_t>(offset_in_buffer - staging_buffer.size));
+            }
+
+            const uint64_t bytes_to_copy = min(remaining, this->staging_buffer_size_ - offset_in_buffer);
+            memcpy(staging_buffer.data.get() + offset_in_buffer, data, static_cast<size_t>(bytes_to_copy));
+            staging_buffer.size = max(staging_buffer.size, offset_in_buffer + bytes_to_copy);
+            position += bytes_to_copy;
+            data += bytes_to_copy;
+            remaining -= bytes_to_copy;
+            if (staging_buffer.size == this->staging_buffer_size_)
+            {
+                this->HandOverFillingBufferForFlush();
+            }
+        }
+        else
+        {
+            // the write operation is beyond the staging buffer, so we fill the rest of it with zeroes and hand it over
+            memset(staging_buffer.data.get() + staging_buffer.size, 0, static_cast<size_t>(this->staging_buffer_size_ - staging_buffer.size));
+            staging_buffer.size = this->staging_buffer_size_;
+            this->HandOverFillingBufferForFlush();
+        }
+    }
+
+    if (ptrBytesWritten != nullptr)
+    {
+        *ptrBytesWritten = size;
+    }
+}
+
+void DirectIoOutputStream::Close()
+{
+    if (this->closed_)
+    {
+        return;
+    }
+
+    this->closed_ = true;
+    try
+    {
+        this->WaitForPendingFlush();
+    }
+    catch (...)
+    {
+        this->ShutdownFlushThread();
+        this->file_.reset();
+        throw;
+    }
+
+    this->ShutdownFlushThread();
+
+    // the aligned part of the staging buffer which is currently being filled is still written with direct I/O...
+    const StagingBuffer& staging_buffer = this->staging_buffers_[this->filling_buffer_index_];
+    const uint64_t aligned_size = staging_buffer.size / kAlignment * kAlignment;
+    if (aligned_size > 0)
+    {
+        this->WriteAligned(staging_buffer.file_offset, staging_buffer.data.get(), aligned_size);
+    }
+
+    // ...whereas the unaligned tail and the deferred write operations are written with regular I/O
+    if (aligned_size < staging_buffer.size || !this->deferred_writes_.empty())
+    {
+        if (this->is_direct_io_)
+        {
+            this->ReopenForRegularIo();
+        }
+
+        if (aligned_size < staging_buffer.size)
+        {
+            this->file_->WriteAt(staging_buffer.file_offset + aligned_size, staging_buffer.data.get() + aligned_size, staging_buffer.size - aligned_size);
+        }
+
+        for (const auto& deferred_write : this->deferred_writes_)
+        {
+            this->file_->WriteAt(deferred_write.file_offset, deferred_write.data.data(), deferred_write.data.size());
+        }
+
+        this->deferred_writes_.clear();
+    }
+
+    this->file_.reset();
+}
+
+void DirectIoOutputStream::HandOverFillingBufferForFlush()
+{
+    // wait until the other staging buffer has been written out, so that it can be filled next
+    this->WaitForPendingFlush();
+
+    StagingBuffer& full_buffer = this->staging_buffers_[this->filling_buffer_index_];
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_flush_);
+        this->buffer_to_flush_ = &full_buffer;
+    }
+
+    this->condition_variable_flush_.notify_all();
+
+    this->filling_buffer_index_ = 1 - this->filling_buffer_index_;
+    StagingBuffer& next_buffer = this->staging_buffers_[this->filling_buffer_index_];
+    next_buffer.file_offset = full_buffer.file_offset + this->staging_buffer_size_;
+    next_buffer.size = 0;
+}
+
+void DirectIoOutputStream::WaitForPendingFlush()
+{
+    std::unique_lock<std::mutex> lck(this->mutex_flush_);
+    this->condition_variable_flush_.wait(lck, [this] {return this->buffer_to_flush_ == nullptr; });
+    if (this->flush_error_)
+    {
+        rethrow_exception(this->flush_error_);
+    }
+}
+
+void DirectIoOutputStream::ShutdownFlushThread()
+{
+    if (this->flush_thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lck(this->mutex_flush_);
+            this->shutdown_flush_thread_ = true;
+        }
+
+        this->condition_variable_flush_.notify_all();
+        this->flush_thread_.join();
+    }
+}
+
+void DirectIoOutputStream::FlushWorker()
+{
+    for (;;)
+    {
+        StagingBuffer* staging_buffer;
+        {
+            std::unique_lock<std::mutex> lck(this->mutex_flush_);
+            this->condition_variable_flush_.wait(lck, [this] {return this->buffer_to_flush_ != nullptr || this->shutdown_flush_thread_; });
+            if (this->buffer_to_flush_ == nullptr)
+            {
+                break;
+            }
+
+            staging_buffer = this->buffer_to_flush_;
+        }
+
+        exception_ptr error;
+        try
+        {
+            this->WriteAligned(staging_buffer->file_offset, staging_buffer->data.get(), staging_buffer->size);
+        }
+        catch (...)
+        {
+            error = current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lck(this->mutex_flush_);
+            if (error && !this->flush_error_)
+            {
+                this->flush_error_ = error;
+            }
+
+            this->buffer_to_flush_ = nullptr;
+        }
+
+        this->condition_variable_flush_.notify_all();
+    }
+}
+
+void DirectIoOutputStream::WriteAligned(std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    // Note that this method is called either on the flush-thread or (after the flush-thread has ended) in Close, so
+    //  there is no concurrent access to the file-object here.
+    try
+    {
+        this->file_->WriteAt(offset, data, size);
+    }
+    catch (runtime_error&)
+    {
+        // Opening the file for direct I/O may succeed even if the file system does not support it (e.g. on Windows,
+        //  FILE_FLAG_NO_BUFFERING then fails with the first write operation) - so, if the first direct write operation
+        //  fails, we switch to regular I/O and try again. An error after this point is reported as such.
+        if (!this->is_direct_io_ || this->direct_write_succeeded_)
+        {
+            throw;
+        }
+
+        this->ReopenForRegularIo();
+        this->is_direct_io_ = false;
+        this->file_->WriteAt(offset, data, size);
+        return;
+    }
+
+    if (this->is_direct_io_)
+    {
+        this->direct_write_succeeded_ = true;
+    }
+}
+
+void DirectIoOutputStream::ReopenForRegularIo()
+{
+    this->file_.reset();
+    this->file_ = make_unique<OutputFile>(this->filename_, OutputFile::OpenMode::kOpenExisting, false);
+}
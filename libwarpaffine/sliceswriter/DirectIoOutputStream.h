@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <LibWarpAffine_Config.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../inc_libCZI.h"
+#include "OutputFile.h"
+
+/// An output-stream (writing to a file) which bypasses the page cache ("direct I/O"). The data is aggregated into
+/// large (and suitably aligned) staging buffers, and a full staging buffer is written out by a dedicated thread while
+/// the next one is being filled ("double buffering"). Since the libCZI-writer is writing the file (mostly) sequentially,
+/// this results in large aligned write operations.
+/// Write operations which target a part of the file which has already been handed over for writing (e.g. the update
+/// of the file-header when the file is finalized) are recorded, and they are executed (together with the last,
+/// unaligned part of the file) when the stream is closed - with regular (buffered) I/O.
+/// If the file cannot be opened for direct I/O (e.g. because the file system does not support it), or if the first direct
+/// write operation fails (which is how e.g. FILE_FLAG_NO_BUFFERING fails on some file systems on Windows), then regular
+/// I/O is used instead (with the same aggregation into large write operations).
+class DirectIoOutputStream : public libCZI::IOutputStream
+{
+private:
+    /// The alignment of the staging buffers, and of the file offset and the size of the direct write operations.
+    static constexpr std::uint64_t kAlignment = OutputFile::kUnbufferedAlignment;
+
+    struct AlignedMemoryDeleter
+    {
+        void operator()(std::uint8_t* p) const;
+    };
+
+    struct StagingBuffer
+    {
+        std::unique_ptr<std::uint8_t, AlignedMemoryDeleter> data;
+        std::uint64_t file_offset{ 0 };     ///< The file offset where the staging buffer is to be written to.
+        std::uint64_t size{ 0 };            ///< The number of bytes (starting at the beginning) which are valid.
+    };
+
+    /// A write operation targeting a part of the file which has already been handed over for writing.
+    struct DeferredWrite
+    {
+        std::uint64_t file_offset;
+        std::vector<std::uint8_t> data;
+    };
+
+    std::wstring filename_;
+    std::unique_ptr<OutputFile> file_;
+    std::atomic_bool is_direct_io_{ false };
+    bool direct_write_succeeded_{ false };
+    bool closed_{ false };
+
+    std::uint64_t staging_buffer_size_;
+    StagingBuffer staging_buffers_[2];
+    int filling_buffer_index_{ 0 };
+    std::vector<DeferredWrite> deferred_writes_;
+
+    std::thread flush_thread_;
+    std::mutex mutex_flush_;
+    std::condition_variable condition_variable_flush_;
+    StagingBuffer* buffer_to_flush_{ nullptr };
+    bool shutdown_flush_thread_{ false };
+    std::exception_ptr flush_error_;
+public:
+    /// Constructor - the file is created (and an existing file is overwritten).
+    ///
+    /// \param  filename            The filename.
+    /// \param  staging_buffer_size The size of a staging buffer in bytes (which is rounded up to the required alignment).
+    /// \param  use_direct_io       If false, regular I/O is used from the start (with the same aggregation into large write operations).
+    DirectIoOutputStream(const std::wstring& filename, std::uint64_t staging_buffer_size, bool use_direct_io = true);
+    ~DirectIoOutputStream() override;
+
+    void Write(std::uint64_t offset, const void* pv, std::uint64_t size, std::uint64_t* ptrBytesWritten) override;
+
+    /// Writes out all pending data and closes the file. In case of an error, an exception is thrown. After this
+    /// method has been called, no further write operations are allowed.
+    void Close();
+
+    /// Gets a boolean indicating whether the file is written with direct I/O (or whether it was necessary to
+    /// fall back to regular I/O).
+    ///
+    /// \returns True if direct I/O is used; false otherwise.
+    bool GetIsDirectIo() const { return this->is_direct_io_.load(); }
+
+    // non-copyable and non-moveable
+    DirectIoOutputStream(const DirectIoOutputStream&) = delete;
+    DirectIoOutputStream& operator=(const DirectIoOutputStream&) = delete;
+    DirectIoOutputStream(DirectIoOutputStream&&) = delete;
+    DirectIoOutputStream& operator=(DirectIoOutputStream&&) = delete;
+private:
+    void FlushWorker();
+    void WriteAligned(std::uint64_t offset, const void* data, std::uint64_t size);
+    void ReopenForRegularIo();
+    void HandOverFillingBufferForFlush();
+    void WaitForPendingFlush();
+    void ShutdownFlushThread();
+};
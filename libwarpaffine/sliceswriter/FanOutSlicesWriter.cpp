@@ -0,0 +1,382 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "FanOutSlicesWriter.h"
+#include "../utilities.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace libCZI;
+
+FanOutSlicesWriter::FanOutSlicesWriter(AppContext& context, const std::wstring& filename)
+    : context_(context), filename_(filename)
+{
+    const auto& property_bag_writer = context.GetCommandLineOptions().GetPropertyBagForWriter();
+    const string key_text = property_bag_writer.GetStringOrDefault(ICziSlicesWriter::kPropertyBagKey_fan_out, "");
+    if (!FanOutSlicesWriter::TryParseKey(key_text, &this->key_))
+    {
+        ostringstream string_stream;
+        string_stream << "The writer-parameter '" << ICziSlicesWriter::kPropertyBagKey_fan_out << "' must be 'C', 'T' or 'S' (value=\"" << key_text << "\").";
+        throw invalid_argument(string_stream.str());
+    }
+
+    this->t_range_ = property_bag_writer.GetInt32OrDefault(ICziSlicesWriter::kPropertyBagKey_fan_out_t_range, 1);
+    if (this->t_range_ <= 0)
+    {
+        ostringstream string_stream;
+        string_stream << "The writer-parameter '" << ICziSlicesWriter::kPropertyBagKey_fan_out_t_range << "' must be greater than zero (value=" << this->t_range_ << ").";
+        throw invalid_argument(string_stream.str());
+    }
+}
+
+bool FanOutSlicesWriter::TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available)
+{
+    const int part_index = FanOutSlicesWriter::GetPartIndex(this->key_, this->t_range_, add_slice_info);
+    const auto part = this->GetOrCreatePart(part_index);
+
+    // the budget of the write-stage is shared by all parts, so the admission is done here - the total size of the
+    //  slices admitted here is an upper bound for the size of a part's queue, so the part will not reject the slice
+    const uint64_t size_of_slice = add_slice_info.subblock_raw_data->GetSizeOfData();
+    if (!this->queue_admission_.TryAdmit(
+        size_of_slice,
+        this->context_.GetFlowControl().GetBudget(FlowControl::Stage::Write),
+        on_space_available))
+    {
+        return false;
+    }
+
+    // the slice is accounted for until the part has written it out and released its data
+    AddSliceInfo add_slice_info_for_part = add_slice_info;
+    add_slice_info_for_part.subblock_raw_data = shared_ptr<IMemoryBlock>(
+        shared_ptr<void>(
+            add_slice_info.subblock_raw_data.get(),
+            [this, data = add_slice_info.subblock_raw_data, size_of_slice](void*) mutable
+            {
+                data.reset();
+                this->queue_admission_.Release(size_of_slice);
+            }),
+        add_slice_info.subblock_raw_data.get());
+    FanOutSlicesWriter::AdjustCoordinateForPart(this->key_, this->t_range_, part_index, add_slice_info_for_part);
+
+    return part->TryAddSlice(add_slice_info_for_part, on_space_available);
+}
+
+std::shared_ptr<CziSlicesWriterTbb> FanOutSlicesWriter::GetOrCreatePart(int part_index)
+{
+    std::lock_guard<std::mutex> lck(this->mutex_parts_);
+    auto& part = this->parts_[part_index];
+    if (!part)
+    {
+        // the number of subblocks which will end up in a part is not known, so no space for the subblock-directory is reserved
+        part = make_shared<CziSlicesWriterTbb>(
+            this->context_,
+            FanOutSlicesWriter::CreateFilenameOfPart(this->filename_, this->key_, this->t_range_, part_index),
+            0);
+    }
+
+    return part;
+}
+
+void FanOutSlicesWriter::Close(const std::shared_ptr<libCZI::ICziMetadata>& source_metadata,
+                                const libCZI::ScalingInfo* new_scaling_info,
+                                const std::function<void(libCZI::IXmlNodeRw*)>& tweak_metadata_hook,
+                                const std::function<void(libCZI::ICziWriter*)>& finalize_hook)
+{
+    // the parts are closed one after the other (the hooks are not required to be thread-safe), the timings reported
+    //  are the sum over all parts
+    std::lock_guard<std::mutex> lck(this->mutex_parts_);
+    this->close_timings_ = CloseTimings();
+    for (const auto& part : this->parts_)
+    {
+        const Key key = this->key_;
+        const int part_index = part.first;
+        part.second->Close(
+            source_metadata,
+            new_scaling_info,
+            [&tweak_metadata_hook, key, part_index](libCZI::IXmlNodeRw* root_node)->void
+            {
+                if (tweak_metadata_hook)
+                {
+                    tweak_metadata_hook(root_node);
+                }
+
+                FanOutSlicesWriter::PruneMetadataForPart(root_node, key, part_index);
+            },
+            finalize_hook);
+        const auto close_timings_of_part = part.second->GetCloseTimings();
+        this->close_timings_.drain += close_timings_of_part.drain;
+        this->close_timings_.metadata += close_timings_of_part.metadata;
+        this->close_timings_.attachments += close_timings_of_part.attachments;
+        this->close_timings_.directory += close_timings_of_part.directory;
+    }
+}
+
+std::uint32_t FanOutSlicesWriter::GetNumberOfPendingSliceWriteOperations()
+{
+    return this->queue_admission_.GetNumberOfSlicesAdmitted();
+}
+
+std::uint64_t FanOutSlicesWriter::GetSizeOfPendingSliceWriteOperations()
+{
+    return this->queue_admission_.GetSizeOfSlicesAdmitted();
+}
+
+std::uint64_t FanOutSlicesWriter::GetNumberOfBytesWritten()
+{
+    std::lock_guard<std::mutex> lck(this->mutex_parts_);
+    uint64_t number_of_bytes_written = 0;
+    for (const auto& part : this->parts_)
+    {
+        number_of_bytes_written += part.second->GetNumberOfBytesWritten();
+    }
+
+    return number_of_bytes_written;
+}
+
+ICziSlicesWriter::CloseTimings FanOutSlicesWriter::GetCloseTimings()
+{
+    return this->close_timings_;
+}
+
+/*static*/bool FanOutSlicesWriter::TryParseKey(const std::string& text, Key* key)
+{
+    Key key_parsed;
+    if (Utilities::StrcmpCaseInsensitive(text.c_str(), "C") == 0)
+    {
+        key_parsed = Key::Channel;
+    }
+    else if (Utilities::StrcmpCaseInsensitive(text.c_str(), "T") == 0)
+    {
+        key_parsed = Key::TRange;
+    }
+    else if (Utilities::StrcmpCaseInsensitive(text.c_str(), "S") == 0)
+    {
+        key_parsed = Key::Scene;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (key != nullptr)
+    {
+        *key = key_parsed;
+    }
+
+    return true;
+}
+
+/*static*/int FanOutSlicesWriter::GetPartIndex(Key key, int t_range, const AddSliceInfo& add_slice_info)
+{
+    int index = 0;
+    switch (key)
+    {
+    case Key::Channel:
+        add_slice_info.coordinate.TryGetPosition(DimensionIndex::C, &index);
+        return index;
+    case Key::TRange:
+        add_slice_info.coordinate.TryGetPosition(DimensionIndex::T, &index);
+        // round towards negative infinity, so that the ranges are aligned to multiples of the range size
+        return index >= 0 ? index / t_range : -((-index + t_range - 1) / t_range);
+    case Key::Scene:
+        if (add_slice_info.scene_index.has_value())
+        {
+            return add_slice_info.scene_index.value();
+        }
+
+        add_slice_info.coordinate.TryGetPosition(DimensionIndex::S, &index);
+        return index;
+    }
+
+    throw logic_error("Unknown key.");
+}
+
+/*static*/std::wstring FanOutSlicesWriter::CreateFilenameOfPart(const std::wstring& filename, Key key, int t_range, int part_index)
+{
+    wostringstream suffix;
+    switch (key)
+    {
+    case Key::Channel:
+        suffix << L"_C" << part_index;
+        break;
+    case Key::TRange:
+        suffix << L"_T" << part_index * t_range;
+        if (t_range > 1)
+        {
+            suffix << L"-" << part_index * t_range + t_range - 1;
+        }
+
+        break;
+    case Key::Scene:
+        suffix << L"_S" << part_index;
+        break;
+    }
+
+    // the suffix goes in front of the extension (if there is one in the last component of the path)
+    const size_t position_of_last_separator = filename.find_last_of(L"/\\");
+    const size_t position_of_dot = filename.find_last_of(L'.');
+    if (position_of_dot != wstring::npos &&
+        (position_of_last_separator == wstring::npos || position_of_dot > position_of_last_separator))
+    {
+        return filename.substr(0, position_of_dot) + suffix.str() + filename.substr(position_of_dot);
+    }
+
+    return filename + suffix.str();
+}
+
+/*static*/void FanOutSlicesWriter::AdjustCoordinateForPart(Key key, int t_range, int part_index, AddSliceInfo& add_slice_info)
+{
+    int index;
+    switch (key)
+    {
+    case Key::Channel:
+        if (add_slice_info.coordinate.TryGetPosition(DimensionIndex::C, &index))
+        {
+            add_slice_info.coordinate.Set(DimensionIndex::C, 0);
+        }
+
+        break;
+    case Key::TRange:
+        if (add_slice_info.coordinate.TryGetPosition(DimensionIndex::T, &index))
+        {
+            add_slice_info.coordinate.Set(DimensionIndex::T, index - part_index * t_range);
+        }
+
+        break;
+    case Key::Scene:
+        if (add_slice_info.scene_index.has_value())
+        {
+            add_slice_info.scene_index = 0;
+        }
+
+        if (add_slice_info.coordinate.TryGetPosition(DimensionIndex::S, &index))
+        {
+            add_slice_info.coordinate.Set(DimensionIndex::S, 0);
+        }
+
+        break;
+    }
+}
+
+namespace
+{
+    /// A copy of an XML-node (with its attributes, its value and its children).
+    struct XmlNodeCopy
+    {
+        wstring name;
+        vector<tuple<wstring, wstring>> attributes;
+        wstring value;
+        vector<XmlNodeCopy> children;
+    };
+
+    XmlNodeCopy CopyXmlNode(IXmlNodeRead* node)
+    {
+        XmlNodeCopy copy;
+        copy.name = node->Name();
+        node->EnumAttributes(
+            [&copy](const std::wstring& attribute_name, const std::wstring& attribute_value)->bool
+            {
+                copy.attributes.emplace_back(attribute_name, attribute_value);
+                return true;
+            });
+        node->TryGetValue(&copy.value);
+        node->EnumChildren(
+            [&copy](std::shared_ptr<IXmlNodeRead> child)->bool
+            {
+                copy.children.push_back(CopyXmlNode(child.get()));
+                return true;
+            });
+        return copy;
+    }
+
+    void AppendXmlNode(IXmlNodeRw* parent_node, const XmlNodeCopy& copy)
+    {
+        const auto node = parent_node->AppendChildNode(Utilities::convertToUtf8(copy.name).c_str());
+        for (const auto& attribute : copy.attributes)
+        {
+            node->SetAttribute(get<0>(attribute).c_str(), get<1>(attribute).c_str());
+        }
+
+        if (!copy.value.empty())
+        {
+            node->SetValue(copy.value.c_str());
+        }
+
+        for (const auto& child : copy.children)
+        {
+            AppendXmlNode(node.get(), child);
+        }
+    }
+
+    /// Removes all children with the specified name from the node at the specified path, except the one at position
+    /// 'index_to_keep' (counting only the children with this name). If there is no such child, nothing is changed.
+    void KeepOnlyChildAt(IXmlNodeRw* root_node, const char* path, const wchar_t* name, int index_to_keep)
+    {
+        const auto node = root_node->GetChildNode(path);
+        if (!node)
+        {
+            return;
+        }
+
+        // the libCZI-API only allows to remove all children, so we copy the children (to be kept) and then re-create them
+        vector<XmlNodeCopy> children;
+        static_cast<IXmlNodeRead*>(node.get())->EnumChildren(
+            [&children](std::shared_ptr<IXmlNodeRead> child)->bool
+            {
+                children.push_back(CopyXmlNode(child.get()));
+                return true;
+            });
+
+        const auto number_of_children_with_name = count_if(
+            children.cbegin(),
+            children.cend(),
+            [name](const XmlNodeCopy& child)->bool {return child.name == name; });
+        if (index_to_keep < 0 || index_to_keep >= number_of_children_with_name)
+        {
+            return;
+        }
+
+        node->RemoveChildren();
+        int index = 0;
+        for (const auto& child : children)
+        {
+            if (child.name == name)
+            {
+                if (index++ != index_to_keep)
+                {
+                    continue;
+                }
+            }
+
+            AppendXmlNode(node.get(), child);
+        }
+    }
+}
+
+/*static*/void FanOutSlicesWriter::PruneMetadataForPart(libCZI::IXmlNodeRw* root_node, Key key, int part_index)
+{
+    switch (key)
+    {
+    case Key::Channel:
+        KeepOnlyChildAt(root_node, "Metadata/Information/Image/Dimensions/Channels", L"Channel", part_index);
+        KeepOnlyChildAt(root_node, "Metadata/DisplaySetting/Channels", L"Channel", part_index);
+        break;
+    case Key::Scene:
+        KeepOnlyChildAt(root_node, "Metadata/Information/Image/Dimensions/S/Scenes", L"Scene", part_index);
+        if (const auto size_s_node = root_node->GetChildNode("Metadata/Information/Image/SizeS"))
+        {
+            size_s_node->SetValueI32(1);
+        }
+
+        break;
+    case Key::TRange:
+        // the size of the T-dimension is taken from the subblocks written (and the T-index is relative to the range)
+        break;
+    }
+}
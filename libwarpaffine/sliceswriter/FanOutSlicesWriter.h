@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ISlicesWriter.h"
+#include "SlicesWriterTbb.h"
+#include "SliceQueueAdmission.h"
+
+#include <memory>
+#include <mutex>
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+
+/// Implementation of a ICziSlicesWriter which distributes the slices to several CZI-files. The slices are routed by a key
+/// (the channel, a range of T-indices or the scene), and for each value of the key there is an independent CziSlicesWriterTbb
+/// (with its own writer thread and output stream) - so the files are written in parallel. A writer (and its file) is created
+/// when the first slice for it arrives. The filename of a part is the output filename with a suffix identifying the part
+/// (e.g. "output_C1.czi", "output_T10-19.czi" or "output_S2.czi").
+/// Each part is a document of its own - the coordinate of the key is renumbered so that it starts at zero in each part (i.e.
+/// the channel-index or the scene-index is zero, and the T-index is relative to the start of the range). The document-metadata
+/// (copied from the source document) is pruned accordingly, so that the information about the channels or the scenes only
+/// describes the channel or the scene in the part.
+/// The budget of the write-stage is shared by all parts - a slice is only admitted if the total size of the slices queued
+/// in all writers stays within the budget.
+class FanOutSlicesWriter : public ICziSlicesWriter
+{
+public:
+    /// The key by which the slices are routed to the parts.
+    enum class Key
+    {
+        Channel,    ///< There is a part for each channel.
+        TRange,     ///< There is a part for each range of T-indices (where the size of the range is configurable).
+        Scene       ///< There is a part for each scene.
+    };
+private:
+    AppContext& context_;
+    std::wstring filename_;
+    Key key_;
+    int t_range_;
+
+    /// This mutex protects the map of parts.
+    std::mutex mutex_parts_;
+    std::map<int, std::shared_ptr<CziSlicesWriterTbb>> parts_;
+
+    /// The admission of slices (for all parts), the size of the slices admitted is bounded by the budget of the write-stage.
+    SliceQueueAdmission queue_admission_;
+
+    CloseTimings close_timings_;
+public:
+    /// Constructor. The key (and the size of a T-range) is taken from the writer property bag (see ICziSlicesWriter::kPropertyBagKey_fan_out
+    /// and ICziSlicesWriter::kPropertyBagKey_fan_out_t_range).
+    ///
+    /// \param [in] context     The application context.
+    /// \param      filename    The filename of the output file (from which the filenames of the parts are derived).
+    FanOutSlicesWriter(AppContext& context, const std::wstring& filename);
+
+    std::uint32_t GetNumberOfPendingSliceWriteOperations() override;
+    std::uint64_t GetSizeOfPendingSliceWriteOperations() override;
+    bool TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available) override;
+    void Close(const std::shared_ptr<libCZI::ICziMetadata>& source_metadata,
+        const libCZI::ScalingInfo* new_scaling_info,
+        const std::function<void(libCZI::IXmlNodeRw*)>& tweak_metadata_hook,
+        const std::function<void(libCZI::ICziWriter*)>& finalize_hook) override;
+    std::uint64_t GetNumberOfBytesWritten() override;
+    CloseTimings GetCloseTimings() override;
+
+    /// Attempts to parse the specified text (as given with the writer property bag) into a key. Valid values are "C" (channel),
+    /// "T" (range of T-indices) and "S" (scene), case-insensitive.
+    ///
+    /// \param          text    The text.
+    /// \param [out]    key     If non-null and successful, the key is put here.
+    ///
+    /// \returns True if it succeeds; false otherwise.
+    static bool TryParseKey(const std::string& text, Key* key);
+
+    /// Gets the index of the part the specified slice is routed to. If the dimension the key refers to is not
+    /// present with the slice, the index is zero.
+    ///
+    /// \param  key             The key.
+    /// \param  t_range         The size of a T-range (only used for Key::TRange).
+    /// \param  add_slice_info  Information describing the slice.
+    ///
+    /// \returns The index of the part.
+    static int GetPartIndex(Key key, int t_range, const AddSliceInfo& add_slice_info);
+
+    /// Creates the filename for the specified part - the suffix identifying the part is inserted in front of the extension.
+    ///
+    /// \param  filename    The filename of the output file.
+    /// \param  key         The key.
+    /// \param  t_range     The size of a T-range (only used for Key::TRange).
+    /// \param  part_index  The index of the part.
+    ///
+    /// \returns The filename of the part.
+    static std::wstring CreateFilenameOfPart(const std::wstring& filename, Key key, int t_range, int part_index);
+
+    /// Renumbers the coordinate of the key of the specified slice, so that it is relative to the part - i.e. the channel-index
+    /// or the scene-index is set to zero, and the T-index is made relative to the start of the T-range.
+    ///
+    /// \param          key             The key.
+    /// \param          t_range         The size of a T-range (only used for Key::TRange).
+    /// \param          part_index      The index of the part (which the slice is routed to).
+    /// \param [in,out] add_slice_info  Information describing the slice.
+    static void AdjustCoordinateForPart(Key key, int t_range, int part_index, AddSliceInfo& add_slice_info);
+
+    /// Prunes the document-metadata for the specified part - for Key::Channel only the channel with the index of the part is kept
+    /// in the channel-information and the display-settings, and for Key::Scene only the scene with the index of the part is kept
+    /// (where the channels/scenes are identified by their position). For Key::TRange, the metadata is not changed.
+    ///
+    /// \param [in] root_node   The root node of the metadata.
+    /// \param      key         The key.
+    /// \param      part_index  The index of the part.
+    static void PruneMetadataForPart(libCZI::IXmlNodeRw* root_node, Key key, int part_index);
+
+private:
+    std::shared_ptr<CziSlicesWriterTbb> GetOrCreatePart(int part_index);
+};
@@ -6,9 +6,11 @@
 
 #include <LibWarpAffine_Config.h>
 #include <string>
+#include <chrono>
 #include <cstdint>
 #include <optional>
 #include <memory>
+#include <functional>
 #include "../inc_libCZI.h"
 #include "../appcontext.h"
 
@@ -63,14 +65,35 @@ public:
         double stage_y_position;
     };
 
+    /// The durations of the phases of the 'Close'-operation.
+    struct CloseTimings
+    {
+        std::chrono::duration<double> drain{};          ///< Waiting for the pending slice-write operations to complete.
+        std::chrono::duration<double> metadata{};       ///< Preparing and writing the metadata.
+        std::chrono::duration<double> attachments{};    ///< Executing the finalize-hook (which is where the attachments are written).
+        std::chrono::duration<double> directory{};      ///< Writing the subblock- and attachment-directory and the file-header (and flushing the output).
+    };
+
     /// Gets number of currently pending slice write operations.
     ///
     /// \returns The number of currently pending slice write operations.
     virtual std::uint32_t GetNumberOfPendingSliceWriteOperations() = 0;
 
-    /// Adds a slice (or subblock).
-    /// \param  add_slice_info Information describing the add slice.
-    virtual void AddSlice(const AddSliceInfo& add_slice_info) = 0;
+    /// Gets the total size (in bytes) of the slices which are currently pending to be written.
+    ///
+    /// \returns The size of the currently pending slice write operations in bytes.
+    virtual std::uint64_t GetSizeOfPendingSliceWriteOperations() = 0;
+
+    /// Attempts to add a slice (or subblock) - this method does not block. The size of the slices queued in the writer
+    /// is limited, and if the slice does not fit into the queue, it is not added and false is returned. In this case,
+    /// the specified functor (if non-null) is called (exactly once, and possibly on a different thread, or even before
+    /// this method returns) when space has become available in the queue - and the caller is expected to retry then.
+    ///
+    /// \param  add_slice_info      Information describing the add slice.
+    /// \param  on_space_available  Functor which is called when space has become available (in case the slice was not added).
+    ///
+    /// \returns True if the slice was added; false otherwise.
+    virtual bool TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available) = 0;
     
     /// Wait until the write-queue is empty and then closes the output CZI-file. The specified metadata 
     /// object (of the source document) is used to update the metadata of the output CZI-file. In addition,
@@ -91,8 +114,40 @@ public:
                         const std::function<void(libCZI::IXmlNodeRw*)>& tweak_metadata_hook,
                         const std::function<void(libCZI::ICziWriter*)>& finalize_hook) = 0;
 
+    /// Gets the number of bytes (of subblock-data and subblock-metadata) which have been written to the output file so far.
+    ///
+    /// \returns The number of bytes written.
+    virtual std::uint64_t GetNumberOfBytesWritten() = 0;
+
+    /// Gets the durations of the phases of the 'Close'-operation. This is only valid after 'Close' has been called.
+    ///
+    /// \returns The durations of the phases of the 'Close'-operation.
+    virtual CloseTimings GetCloseTimings() = 0;
+
     virtual ~ICziSlicesWriter() = default;
 
+    /// This key for the "writer property bag" controls whether the subblocks are written concurrently (by the tasks adding
+    /// them) instead of being serialized through a single writer thread. The type is "boolean", the default is "false".
+    static const char* kPropertyBagKey_parallel_write;
+
+    /// This key for the "writer property bag" controls whether the output file is written with direct I/O (bypassing the
+    /// page cache), with the data being aggregated into large aligned staging buffers. The type is "boolean", the default is "false".
+    /// This mode cannot be combined with the "parallel write" mode.
+    static const char* kPropertyBagKey_direct_io;
+
+    /// This key for the "writer property bag" gives the size (in megabytes) of a staging buffer used in the "direct I/O" mode.
+    /// The type is "int32", the default is 16.
+    static const char* kPropertyBagKey_direct_io_buffer_size_mb;
+
+    /// This key for the "writer property bag" instructs to distribute the output to several CZI-files, where the slices are
+    /// routed by the channel ("C"), by a range of T-indices ("T") or by the scene ("S"). The type is "string", the default is
+    /// empty (meaning that a single file is written).
+    static const char* kPropertyBagKey_fan_out;
+
+    /// This key for the "writer property bag" gives the number of T-indices which go into one file if the output is distributed
+    /// by T-ranges (see kPropertyBagKey_fan_out). The type is "int32", the default is 1.
+    static const char* kPropertyBagKey_fan_out_t_range;
+
     // non-copyable and non-moveable
     ICziSlicesWriter() = default;
     ICziSlicesWriter(const ICziSlicesWriter&) = default;             // copy constructor
@@ -102,4 +157,22 @@ public:
 };
 
 std::shared_ptr<ICziSlicesWriter> CreateNullSlicesWriter();
-std::shared_ptr<ICziSlicesWriter> CreateSlicesWriterTbb(AppContext& context, const std::wstring& filename);
+
+/// Creates the slices-writer (writing a CZI-file).
+///
+/// \param [in] context                         The application context.
+/// \param      filename                        The filename of the output file.
+/// \param      expected_number_of_subblocks    The number of subblocks which is expected to be written (or zero if not known). This
+///                                             is used to reserve space for the subblock-directory at the start of the file.
+///
+/// \returns The newly created slices-writer.
+std::shared_ptr<ICziSlicesWriter> CreateSlicesWriterTbb(AppContext& context, const std::wstring& filename, std::uint32_t expected_number_of_subblocks);
+
+/// Creates a slices-writer which distributes the slices to several CZI-files (as configured with the writer property bag,
+/// see ICziSlicesWriter::kPropertyBagKey_fan_out).
+///
+/// \param [in] context     The application context.
+/// \param      filename    The filename of the output file (from which the filenames of the parts are derived).
+///
+/// \returns The newly created slices-writer.
+std::shared_ptr<ICziSlicesWriter> CreateFanOutSlicesWriter(AppContext& context, const std::wstring& filename);
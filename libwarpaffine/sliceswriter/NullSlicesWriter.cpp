@@ -13,10 +13,26 @@ std::uint32_t NullSlicesWriter::GetNumberOfPendingSliceWriteOperations()
     return 0;
 }
 
-void NullSlicesWriter::AddSlice(const AddSliceInfo& add_slice_info)
+std::uint64_t NullSlicesWriter::GetSizeOfPendingSliceWriteOperations()
 {
+    return 0;
+}
+
+bool NullSlicesWriter::TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available)
+{
+    return true;
 }
 
 void NullSlicesWriter::Close(const std::shared_ptr<libCZI::ICziMetadata>&, const libCZI::ScalingInfo*, const std::function<void(libCZI::IXmlNodeRw*)>&, const std::function<void(libCZI::ICziWriter*)>&)
 {
 }
+
+std::uint64_t NullSlicesWriter::GetNumberOfBytesWritten()
+{
+    return 0;
+}
+
+ICziSlicesWriter::CloseTimings NullSlicesWriter::GetCloseTimings()
+{
+    return {};
+}
@@ -13,9 +13,12 @@ class NullSlicesWriter : public ICziSlicesWriter
 {
 public:
     std::uint32_t GetNumberOfPendingSliceWriteOperations() override;
-    void AddSlice(const AddSliceInfo& add_slice_info) override;
+    std::uint64_t GetSizeOfPendingSliceWriteOperations() override;
+    bool TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available) override;
     void Close(const std::shared_ptr<libCZI::ICziMetadata>& source_metadata,
                 const libCZI::ScalingInfo* new_scaling_info,
                 const std::function<void(libCZI::IXmlNodeRw*)>& tweak_metadata_hook,
                 const std::function<void(libCZI::ICziWriter*)>& finalize_hook) override;
+    std::uint64_t GetNumberOfBytesWritten() override;
+    CloseTimings GetCloseTimings() override;
 };
@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "OutputFile.h"
+#if LIBWARPAFFINE_WIN32_ENVIRONMENT
+#include <Windows.h>
+#endif
+#if LIBWARPAFFINE_UNIX_ENVIRONMENT
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include "../utilities.h"
+
+using namespace std;
+
+#if LIBWARPAFFINE_WIN32_ENVIRONMENT
+OutputFile::OutputFile(const std::wstring& filename, OpenMode open_mode, bool unbuffered)
+{
+    this->file_handle_ = CreateFileW(
+        filename.c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ,
+        nullptr,
+        open_mode == OpenMode::kCreate ? CREATE_ALWAYS : OPEN_EXISTING,
+        unbuffered ? FILE_FLAG_NO_BUFFERING : FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (this->file_handle_ == INVALID_HANDLE_VALUE)
+    {
+        ostringstream string_stream;
+        string_stream << "Could not open the file \"" << Utilities::convertToUtf8(filename) << "\" (error " << GetLastError() << ").";
+        throw runtime_error(string_stream.str());
+    }
+}
+
+OutputFile::~OutputFile()
+{
+    CloseHandle(this->file_handle_);
+}
+
+void OutputFile::WriteAt(std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    while (size > 0)
+    {
+        // the size of a single write operation is limited to 32 bits
+        const DWORD bytes_to_write = static_cast<DWORD>((min)(size, static_cast<uint64_t>(1u << 30)));
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD bytes_written;
+        if (!WriteFile(this->file_handle_, data, bytes_to_write, &bytes_written, &overlapped) || bytes_written == 0)
+        {
+            ostringstream string_stream;
+            string_stream << "Error writing to the output file (offset=" << offset << ", size=" << size << ", error " << GetLastError() << ").";
+            throw runtime_error(string_stream.str());
+        }
+
+        offset += bytes_written;
+        size -= bytes_written;
+        data = static_cast<const uint8_t*>(data) + bytes_written;
+    }
+}
+#endif
+
+#if LIBWARPAFFINE_UNIX_ENVIRONMENT
+OutputFile::OutputFile(const std::wstring& filename, OpenMode open_mode, bool unbuffered)
+{
+    int flags = O_WRONLY;
+    if (open_mode == OpenMode::kCreate)
+    {
+        flags |= O_CREAT | O_TRUNC;
+    }
+
+#if defined(O_DIRECT)
+    if (unbuffered)
+    {
+        flags |= O_DIRECT;
+    }
+#endif
+
+    const string filename_utf8 = Utilities::convertToUtf8(filename);
+    this->file_descriptor_ = open(filename_utf8.c_str(), flags, 0644);
+    if (this->file_descriptor_ < 0)
+    {
+        ostringstream string_stream;
+        string_stream << "Could not open the file \"" << filename_utf8 << "\" (" << strerror(errno) << ").";
+        throw runtime_error(string_stream.str());
+    }
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if (unbuffered)
+    {
+        // on macOS, there is no O_DIRECT - instead, caching is switched off for the file descriptor
+        fcntl(this->file_descriptor_, F_NOCACHE, 1);
+    }
+#endif
+}
+
+OutputFile::~OutputFile()
+{
+    close(this->file_descriptor_);
+}
+
+void OutputFile::WriteAt(std::uint64_t offset, const void* data, std::uint64_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t bytes_written = pwrite(this->file_descriptor_, data, static_cast<size_t>(size), static_cast<off_t>(offset));
+        if (bytes_written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (bytes_written <= 0)
+        {
+            ostringstream string_stream;
+            string_stream << "Error writing to the output file (offset=" << offset << ", size=" << size << "): " << strerror(errno) << ".";
+            throw runtime_error(string_stream.str());
+        }
+
+        offset += bytes_written;
+        size -= bytes_written;
+        data = static_cast<const uint8_t*>(data) + bytes_written;
+    }
+}
+#endif
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <LibWarpAffine_Config.h>
+#include <cstdint>
+#include <string>
+
+/// A thin wrapper around an operating-system file handle, which allows for positional writes. Write operations
+/// (at different offsets) may be executed concurrently.
+class OutputFile
+{
+public:
+    /// Values that represent how the file is opened.
+    enum class OpenMode
+    {
+        kCreate,        ///< The file is created (and an existing file is overwritten).
+        kOpenExisting   ///< An existing file is opened.
+    };
+
+    /// Constructor - opens the file. In case of an error, an exception is thrown.
+    ///
+    /// \param  filename    The filename.
+    /// \param  open_mode   The open mode.
+    /// \param  unbuffered  If true, the file is opened for unbuffered I/O (bypassing the page cache, i.e. "O_DIRECT" or
+    ///                     "FILE_FLAG_NO_BUFFERING"). In this case, the data, the offset and the size of a write operation
+    ///                     must be aligned to OutputFile::kUnbufferedAlignment.
+    OutputFile(const std::wstring& filename, OpenMode open_mode, bool unbuffered);
+    ~OutputFile();
+
+    /// Writes the specified data at the specified offset. In case of an error, an exception is thrown.
+    ///
+    /// \param  offset  The file offset.
+    /// \param  data    The data.
+    /// \param  size    The size of the data in bytes.
+    void WriteAt(std::uint64_t offset, const void* data, std::uint64_t size);
+
+    /// The alignment (of the data, the offset and the size) required for unbuffered write operations.
+    static constexpr std::uint64_t kUnbufferedAlignment = 4096;
+
+    // non-copyable and non-moveable
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+    OutputFile(OutputFile&&) = delete;
+    OutputFile& operator=(OutputFile&&) = delete;
+private:
+#if LIBWARPAFFINE_WIN32_ENVIRONMENT
+    void* file_handle_;
+#endif
+#if LIBWARPAFFINE_UNIX_ENVIRONMENT
+    int file_descriptor_;
+#endif
+};
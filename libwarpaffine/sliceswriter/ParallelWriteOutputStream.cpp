@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "ParallelWriteOutputStream.h"
+#include <stdexcept>
+
+using namespace std;
+
+std::uint64_t ParallelWriteOutputStream::WriteBatch::GetTotalSize() const
+{
+    uint64_t total_size = 0;
+    for (const auto& item : this->items_)
+    {
+        total_size += item.size;
+    }
+
+    return total_size;
+}
+
+ParallelWriteOutputStream::ParallelWriteOutputStream(const std::wstring& filename)
+    : file_(filename, OutputFile::OpenMode::kCreate, false)
+{
+}
+
+void ParallelWriteOutputStream::Write(std::uint64_t offset, const void* pv, std::uint64_t size, std::uint64_t* ptrBytesWritten)
+{
+    if (this->capture_batch_ == nullptr)
+    {
+        this->file_.WriteAt(offset, pv, size);
+    }
+    else if (size > 0)
+    {
+        auto& items = this->capture_batch_->items_;
+        const auto* data = static_cast<const uint8_t*>(pv);
+        if (data >= this->capture_external_data_begin_ && data + size <= this->capture_external_data_end_)
+        {
+            items.push_back(WriteBatch::Item{ offset, size, pv, 0 });
+        }
+        else
+        {
+            // the data is copied (since it may e.g. be a temporary buffer of the libCZI-writer) - and if the previous
+            //  item was copied as well and is adjacent in the file, we simply extend it (so that the segment-header
+            //  and the padding do not result in separate write operations)
+            auto& copied_data = this->capture_batch_->copied_data_;
+            if (!items.empty() &&
+                items.back().external_data == nullptr &&
+                items.back().file_offset + items.back().size == offset)
+            {
+                items.back().size += size;
+            }
+            else
+            {
+                items.push_back(WriteBatch::Item{ offset, size, nullptr, copied_data.size() });
+            }
+
+            copied_data.insert(copied_data.end(), data, data + size);
+        }
+    }
+
+    if (ptrBytesWritten != nullptr)
+    {
+        *ptrBytesWritten = size;
+    }
+}
+
+void ParallelWriteOutputStream::BeginCapture(WriteBatch* batch, const void* external_data, std::uint64_t external_data_size)
+{
+    if (this->capture_batch_ != nullptr)
+    {
+        throw logic_error("'BeginCapture' called while capturing is already active.");
+    }
+
+    this->capture_batch_ = batch;
+    this->capture_external_data_begin_ = static_cast<const uint8_t*>(external_data);
+    this->capture_external_data_end_ = this->capture_external_data_begin_ != nullptr ? this->capture_external_data_begin_ + external_data_size : nullptr;
+}
+
+void ParallelWriteOutputStream::EndCapture()
+{
+    this->capture_batch_ = nullptr;
+    this->capture_external_data_begin_ = this->capture_external_data_end_ = nullptr;
+}
+
+void ParallelWriteOutputStream::ExecuteBatch(const WriteBatch& batch)
+{
+    for (const auto& item : batch.items_)
+    {
+        this->file_.WriteAt(
+            item.file_offset,
+            item.external_data != nullptr ? item.external_data : batch.copied_data_.data() + item.offset_in_copied_data,
+            item.size);
+    }
+}
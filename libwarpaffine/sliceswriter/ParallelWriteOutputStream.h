@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <LibWarpAffine_Config.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../inc_libCZI.h"
+#include "OutputFile.h"
+
+/// An output-stream (writing to a file) which allows to execute write operations concurrently (at different offsets).
+/// The libCZI-writer determines the layout of the file (i.e. at which offset a subblock is placed) and is used
+/// single-threaded. What this stream allows is to "capture" the write operations the libCZI-writer issues when adding a
+/// subblock - instead of writing the data out, they are recorded in a "write batch". Capturing is cheap (it only
+/// reserves the space in the file), and the write batch can then be executed (i.e. the data is actually written out with
+/// a positional write) concurrently with other write batches.
+class ParallelWriteOutputStream : public libCZI::IOutputStream
+{
+public:
+    /// A set of write operations which have been captured, and which are to be executed later.
+    class WriteBatch
+    {
+        friend class ParallelWriteOutputStream;
+
+        struct Item
+        {
+            std::uint64_t file_offset;
+            std::uint64_t size;
+            const void* external_data;      ///< If non-null, the data is not copied and this is the pointer to it.
+            size_t offset_in_copied_data;   ///< If 'external_data' is null, this is the offset into 'copied_data_'.
+        };
+
+        std::vector<Item> items_;
+        std::vector<std::uint8_t> copied_data_;
+    public:
+        /// Gets the total number of bytes to be written with this batch.
+        ///
+        /// \returns The total number of bytes.
+        std::uint64_t GetTotalSize() const;
+    };
+
+    /// Constructor - the file is created (and an existing file is overwritten).
+    ///
+    /// \param  filename    The filename.
+    explicit ParallelWriteOutputStream(const std::wstring& filename);
+    ~ParallelWriteOutputStream() override = default;
+
+    /// If capturing is active, the write operation is recorded in the write batch. Otherwise, the data is written
+    /// out immediately.
+    void Write(std::uint64_t offset, const void* pv, std::uint64_t size, std::uint64_t* ptrBytesWritten) override;
+
+    /// Starts capturing the write operations. Data which lies within the specified "external data" range is not copied
+    /// (i.e. it must stay valid until the write batch has been executed), all other data is copied.
+    /// Capturing must not be active already, and this method must not be called concurrently with 'Write'.
+    ///
+    /// \param [in,out] batch               The write batch where the write operations are recorded.
+    /// \param          external_data       Pointer to the external data (may be null).
+    /// \param          external_data_size  Size of the external data in bytes.
+    void BeginCapture(WriteBatch* batch, const void* external_data, std::uint64_t external_data_size);
+
+    /// Ends capturing the write operations.
+    void EndCapture();
+
+    /// Executes the write operations of the specified write batch. This method may be called concurrently.
+    ///
+    /// \param  batch   The write batch.
+    void ExecuteBatch(const WriteBatch& batch);
+
+    // non-copyable and non-moveable
+    ParallelWriteOutputStream(const ParallelWriteOutputStream&) = delete;
+    ParallelWriteOutputStream& operator=(const ParallelWriteOutputStream&) = delete;
+    ParallelWriteOutputStream(ParallelWriteOutputStream&&) = delete;
+    ParallelWriteOutputStream& operator=(ParallelWriteOutputStream&&) = delete;
+private:
+    OutputFile file_;
+
+    WriteBatch* capture_batch_{ nullptr };
+    const std::uint8_t* capture_external_data_begin_{ nullptr };
+    const std::uint8_t* capture_external_data_end_{ nullptr };
+};
@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "SliceQueueAdmission.h"
+
+using namespace std;
+
+bool SliceQueueAdmission::TryAdmit(std::uint64_t size_of_slice, std::uint64_t budget, const std::function<void()>& on_space_available)
+{
+    std::lock_guard<std::mutex> lck(this->mutex_admission_);
+    const uint64_t size_admitted = this->size_of_slices_admitted_.load();
+    if (size_admitted > 0 && size_admitted + size_of_slice > budget)
+    {
+        if (on_space_available)
+        {
+            this->functors_waiting_for_space_.push_back(on_space_available);
+        }
+
+        return false;
+    }
+
+    this->size_of_slices_admitted_ += size_of_slice;
+    ++this->number_of_slices_admitted_;
+    return true;
+}
+
+void SliceQueueAdmission::Admit(std::uint64_t size_of_slice)
+{
+    std::lock_guard<std::mutex> lck(this->mutex_admission_);
+    this->size_of_slices_admitted_ += size_of_slice;
+    ++this->number_of_slices_admitted_;
+}
+
+void SliceQueueAdmission::Release(std::uint64_t size_of_slice)
+{
+    vector<function<void()>> functors_to_call;
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_admission_);
+        this->size_of_slices_admitted_ -= size_of_slice;
+        --this->number_of_slices_admitted_;
+        functors_to_call.swap(this->functors_waiting_for_space_);
+    }
+
+    for (const auto& functor : functors_to_call)
+    {
+        functor();
+    }
+}
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// This class implements the admission of slices into a write-queue which is bounded by the size (in bytes) of the
+/// slices in it. A slice is admitted if it fits into the budget - or if the queue is empty (so that a slice larger
+/// than the budget does not stall the operation). If a slice is rejected, a functor can be registered which is
+/// called (once) when space is released.
+class SliceQueueAdmission
+{
+private:
+    std::atomic_uint32_t number_of_slices_admitted_{ 0 };
+    std::atomic_uint64_t size_of_slices_admitted_{ 0 };
+
+    /// This mutex protects the admission of slices and the list of functors waiting for space.
+    std::mutex mutex_admission_;
+    std::vector<std::function<void()>> functors_waiting_for_space_;
+public:
+    /// Attempts to admit a slice of the specified size. If the slice is not admitted and 'on_space_available' is
+    /// non-null, the functor is called when space is released (after this method has returned false).
+    ///
+    /// \param  size_of_slice       The size of the slice in bytes.
+    /// \param  budget              The maximum size (in bytes) of all slices admitted.
+    /// \param  on_space_available  The functor to be called when space is released (may be null).
+    ///
+    /// \returns True if the slice was admitted; false otherwise.
+    bool TryAdmit(std::uint64_t size_of_slice, std::uint64_t budget, const std::function<void()>& on_space_available);
+
+    /// Admits a slice of the specified size regardless of the budget (for the case where the slice does not go through
+    /// a queue, but is still to be accounted for).
+    ///
+    /// \param  size_of_slice   The size of the slice in bytes.
+    void Admit(std::uint64_t size_of_slice);
+
+    /// Releases a slice of the specified size (which must have been admitted before). All functors waiting for space
+    /// are called (outside of the lock, since they will usually retry to admit a slice).
+    ///
+    /// \param  size_of_slice   The size of the slice in bytes.
+    void Release(std::uint64_t size_of_slice);
+
+    /// Gets the number of slices currently admitted.
+    ///
+    /// \returns The number of slices admitted.
+    std::uint32_t GetNumberOfSlicesAdmitted() const { return this->number_of_slices_admitted_.load(); }
+
+    /// Gets the total size (in bytes) of the slices currently admitted.
+    ///
+    /// \returns The size of the slices admitted.
+    std::uint64_t GetSizeOfSlicesAdmitted() const { return this->size_of_slices_admitted_.load(); }
+};
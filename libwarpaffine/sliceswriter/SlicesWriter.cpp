@@ -5,15 +5,27 @@
 #include "ISlicesWriter.h"
 #include "NullSlicesWriter.h"
 #include "SlicesWriterTbb.h"
+#include "FanOutSlicesWriter.h"
 
 using namespace std;
 
+/*static*/const char* ICziSlicesWriter::kPropertyBagKey_parallel_write = "parallel_write";
+/*static*/const char* ICziSlicesWriter::kPropertyBagKey_direct_io = "direct_io";
+/*static*/const char* ICziSlicesWriter::kPropertyBagKey_direct_io_buffer_size_mb = "direct_io_buffer_size_mb";
+/*static*/const char* ICziSlicesWriter::kPropertyBagKey_fan_out = "fan_out";
+/*static*/const char* ICziSlicesWriter::kPropertyBagKey_fan_out_t_range = "fan_out_t_range";
+
 std::shared_ptr<ICziSlicesWriter> CreateNullSlicesWriter()
 {
     return make_shared<NullSlicesWriter>();
 }
 
-std::shared_ptr<ICziSlicesWriter> CreateSlicesWriterTbb(AppContext& context, const std::wstring& filename)
+std::shared_ptr<ICziSlicesWriter> CreateSlicesWriterTbb(AppContext& context, const std::wstring& filename, std::uint32_t expected_number_of_subblocks)
+{
+    return make_shared<CziSlicesWriterTbb>(context, filename, expected_number_of_subblocks);
+}
+
+std::shared_ptr<ICziSlicesWriter> CreateFanOutSlicesWriter(AppContext& context, const std::wstring& filename)
 {
-    return make_shared<CziSlicesWriterTbb>(context, filename);
+    return make_shared<FanOutSlicesWriter>(context, filename);
 }
@@ -13,6 +13,7 @@
 #include <tuple>
 #include <utility>
 #include <sstream>
+#include <stdexcept>
 #include <cmath>
 #include <locale>
 
@@ -58,30 +59,165 @@ namespace
     }
 }
 
-CziSlicesWriterTbb::CziSlicesWriterTbb(AppContext& context, const std::wstring& filename)
+CziSlicesWriterTbb::CziSlicesWriterTbb(AppContext& context, const std::wstring& filename, std::uint32_t expected_number_of_subblocks)
     : context_(context)
 {
-    this->queue_.set_capacity(500 * 10);
     this->use_acquisition_tiles_ = context.GetCommandLineOptions().GetUseAcquisitionTiles();
     this->retilingBaseId_ = Utilities::GenerateGuid();
 
-    // Create an "output-stream-object"
-    const auto output_stream = libCZI::CreateOutputStreamForFile(filename.c_str(), true);
+    // Create an "output-stream-object" - in the "parallel write" mode, this is a stream which allows to
+    //  write the subblocks concurrently, in the "direct I/O" mode it is a stream bypassing the page cache
+    const auto& property_bag_writer = context.GetCommandLineOptions().GetPropertyBagForWriter();
+    const bool parallel_write = property_bag_writer.GetBoolOrDefault(ICziSlicesWriter::kPropertyBagKey_parallel_write, false);
+    const bool direct_io = property_bag_writer.GetBoolOrDefault(ICziSlicesWriter::kPropertyBagKey_direct_io, false);
+    if (parallel_write && direct_io)
+    {
+        throw invalid_argument("The writer-parameters 'parallel_write' and 'direct_io' cannot be combined.");
+    }
+
+    shared_ptr<libCZI::IOutputStream> output_stream;
+    if (parallel_write)
+    {
+        this->parallel_output_stream_ = make_shared<ParallelWriteOutputStream>(filename);
+        output_stream = this->parallel_output_stream_;
+    }
+    else if (direct_io)
+    {
+        const int staging_buffer_size_in_megabytes = property_bag_writer.GetInt32OrDefault(ICziSlicesWriter::kPropertyBagKey_direct_io_buffer_size_mb, 16);
+        if (staging_buffer_size_in_megabytes <= 0)
+        {
+            ostringstream string_stream;
+            string_stream << "The writer-parameter '" << ICziSlicesWriter::kPropertyBagKey_direct_io_buffer_size_mb << "' must be greater than zero (value=" << staging_buffer_size_in_megabytes << ").";
+            throw invalid_argument(string_stream.str());
+        }
+
+        this->direct_io_output_stream_ = make_shared<DirectIoOutputStream>(filename, static_cast<uint64_t>(staging_buffer_size_in_megabytes) * 1024 * 1024);
+        if (!this->direct_io_output_stream_->GetIsDirectIo())
+        {
+            context.WriteDebugString("Direct I/O is not available for the output file, falling back to regular I/O.\n");
+        }
+
+        output_stream = this->direct_io_output_stream_;
+    }
+    else
+    {
+        output_stream = libCZI::CreateOutputStreamForFile(filename.c_str(), true);
+    }
 
     this->writer_ = libCZI::CreateCZIWriter();
     const auto spWriterInfo = make_shared<CCziWriterInfo>(libCZI::GUID{ 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } });
+
+    // The libCZI-writer keeps the subblock-directory in memory (adding an entry with each subblock), and it is written out
+    //  at close. With space reserved for it at the start of the file, it is written into this region (if it fits) - so the
+    //  file does not grow at close by the size of the directory.
+    const uint32_t reserved_size_for_subblock_directory = CziSlicesWriterTbb::CalculateReservedSizeForSubBlockDirectory(expected_number_of_subblocks);
+    if (reserved_size_for_subblock_directory > 0)
+    {
+        spWriterInfo->SetReservedSizeForSubBlockDirectory(true, reserved_size_for_subblock_directory);
+    }
+
     this->writer_->Create(output_stream, spWriterInfo);
 
-    this->number_of_slicewrite_operations_in_flight_.store(0);
-    this->worker_thread_ = std::thread([this] {this->WriteWorker(); });
+    if (!this->parallel_output_stream_)
+    {
+        this->worker_thread_ = std::thread([this] {this->WriteWorker(); });
+    }
 }
 
-void CziSlicesWriterTbb::AddSlice(const AddSliceInfo& add_slice_info)
+bool CziSlicesWriterTbb::TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available)
 {
+    if (this->parallel_output_stream_)
+    {
+        // there is no queue in this mode - the calling task writes the subblock itself
+        this->WriteSubBlockParallel(add_slice_info);
+        return true;
+    }
+
+    // the limit for the queue is the budget of the write-stage (which is only known once the operation has been
+    //  configured, so we query it here) - a slice which is larger than the budget is admitted if the queue is empty
+    if (!this->queue_admission_.TryAdmit(
+        add_slice_info.subblock_raw_data->GetSizeOfData(),
+        this->context_.GetFlowControl().GetBudget(FlowControl::Stage::Write),
+        on_space_available))
+    {
+        return false;
+    }
+
     SubBlockWriteInfo2 info;
     info.add_slice_info = add_slice_info;
     this->queue_.push(info);
-    ++this->number_of_slicewrite_operations_in_flight_;
+    return true;
+}
+
+void CziSlicesWriterTbb::PrepareAddSubBlockInfo(SubBlockWriteInfo2& sub_block_write_info, const std::string& sub_block_metadata, libCZI::AddSubBlockInfoMemPtr& add_subblock_info)
+{
+    if (sub_block_write_info.add_slice_info.scene_index.has_value())
+    {
+        sub_block_write_info.add_slice_info.coordinate.Set(DimensionIndex::S, sub_block_write_info.add_slice_info.scene_index.value());
+    }
+
+    add_subblock_info.Clear();
+    add_subblock_info.coordinate = sub_block_write_info.add_slice_info.coordinate;
+    add_subblock_info.x = sub_block_write_info.add_slice_info.x_position;
+    add_subblock_info.y = sub_block_write_info.add_slice_info.y_position;
+    add_subblock_info.logicalWidth = sub_block_write_info.add_slice_info.width;
+    add_subblock_info.logicalHeight = sub_block_write_info.add_slice_info.height;
+    add_subblock_info.physicalWidth = sub_block_write_info.add_slice_info.width;
+    add_subblock_info.physicalHeight = sub_block_write_info.add_slice_info.height;
+    add_subblock_info.PixelType = sub_block_write_info.add_slice_info.pixeltype;
+    if (sub_block_write_info.add_slice_info.m_index)
+    {
+        add_subblock_info.mIndex = sub_block_write_info.add_slice_info.m_index.value();
+        add_subblock_info.mIndexValid = true;
+    }
+
+    add_subblock_info.SetCompressionMode(sub_block_write_info.add_slice_info.compression_mode);
+
+    add_subblock_info.ptrData = sub_block_write_info.add_slice_info.subblock_raw_data->GetPtr();
+    add_subblock_info.dataSize = sub_block_write_info.add_slice_info.subblock_raw_data->GetSizeOfData();
+
+    if (!sub_block_metadata.empty())
+    {
+        add_subblock_info.ptrSbBlkMetadata = sub_block_metadata.c_str();
+        add_subblock_info.sbBlkMetadataSize = static_cast<uint32_t>(sub_block_metadata.size());
+    }
+}
+
+void CziSlicesWriterTbb::WriteSubBlockParallel(const AddSliceInfo& add_slice_info)
+{
+    const uint64_t size_of_slice = add_slice_info.subblock_raw_data->GetSizeOfData();
+    this->queue_admission_.Admit(size_of_slice);
+
+    // the subblock-metadata and the subblock-info are prepared by the calling task (concurrently)...
+    SubBlockWriteInfo2 sub_block_write_info;
+    sub_block_write_info.add_slice_info = add_slice_info;
+    const std::string sub_block_metadata = CziSlicesWriterTbb::ConstructSubBlockMetadata(sub_block_write_info);
+    AddSubBlockInfoMemPtr add_subblock_info;
+    this->PrepareAddSubBlockInfo(sub_block_write_info, sub_block_metadata, add_subblock_info);
+
+    // ...then the libCZI-writer reserves the space in the file and does its bookkeeping (for the subblock-directory),
+    //  with its write operations being captured (and the subblock's data not being copied)...
+    ParallelWriteOutputStream::WriteBatch write_batch;
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_writer_);
+        this->parallel_output_stream_->BeginCapture(&write_batch, add_subblock_info.ptrData, add_subblock_info.dataSize);
+        try
+        {
+            this->writer_->SyncAddSubBlock(add_subblock_info);
+        }
+        catch (...)
+        {
+            this->parallel_output_stream_->EndCapture();
+            throw;
+        }
+
+        this->parallel_output_stream_->EndCapture();
+    }
+
+    // ...and the actual write operations are executed outside the lock, i.e. concurrently with other tasks
+    this->parallel_output_stream_->ExecuteBatch(write_batch);
+    this->number_of_bytes_written_ += add_subblock_info.dataSize + add_subblock_info.sbBlkMetadataSize;
+    this->queue_admission_.Release(size_of_slice);
 }
 
 void CziSlicesWriterTbb::WriteWorker()
@@ -98,42 +234,13 @@ void CziSlicesWriterTbb::WriteWorker()
                 break;
             }
 
-            if (sub_block_write_info.add_slice_info.scene_index.has_value())
-            {
-                sub_block_write_info.add_slice_info.coordinate.Set(DimensionIndex::S, sub_block_write_info.add_slice_info.scene_index.value());
-            }
-
+            const std::string sub_block_metadata = CziSlicesWriterTbb::ConstructSubBlockMetadata(sub_block_write_info);
             AddSubBlockInfoMemPtr add_subblock_info;
-            add_subblock_info.Clear();
-            add_subblock_info.coordinate = sub_block_write_info.add_slice_info.coordinate;
-            add_subblock_info.x = sub_block_write_info.add_slice_info.x_position;
-            add_subblock_info.y = sub_block_write_info.add_slice_info.y_position;
-            add_subblock_info.logicalWidth = sub_block_write_info.add_slice_info.width;
-            add_subblock_info.logicalHeight = sub_block_write_info.add_slice_info.height;
-            add_subblock_info.physicalWidth = sub_block_write_info.add_slice_info.width;
-            add_subblock_info.physicalHeight = sub_block_write_info.add_slice_info.height;
-            add_subblock_info.PixelType = sub_block_write_info.add_slice_info.pixeltype;
-            if (sub_block_write_info.add_slice_info.m_index)
-            {
-                add_subblock_info.mIndex = sub_block_write_info.add_slice_info.m_index.value();
-                add_subblock_info.mIndexValid = true;
-            }
-
-            add_subblock_info.SetCompressionMode(sub_block_write_info.add_slice_info.compression_mode);
-
-            add_subblock_info.ptrData = sub_block_write_info.add_slice_info.subblock_raw_data->GetPtr();
-            add_subblock_info.dataSize = sub_block_write_info.add_slice_info.subblock_raw_data->GetSizeOfData();
-
-            std::string sub_block_metadata = CziSlicesWriterTbb::ConstructSubBlockMetadata(sub_block_write_info);
-            if (!sub_block_metadata.empty())
-            {
-                add_subblock_info.ptrSbBlkMetadata = sub_block_metadata.c_str();
-                add_subblock_info.sbBlkMetadataSize = static_cast<uint32_t>(sub_block_metadata.size());
-            }
-
+            this->PrepareAddSubBlockInfo(sub_block_write_info, sub_block_metadata, add_subblock_info);
             this->writer_->SyncAddSubBlock(add_subblock_info);
 
-            --this->number_of_slicewrite_operations_in_flight_;
+            this->number_of_bytes_written_ += add_subblock_info.dataSize + add_subblock_info.sbBlkMetadataSize;
+            this->queue_admission_.Release(sub_block_write_info.add_slice_info.subblock_raw_data->GetSizeOfData());
         }
     }
     catch (libCZI::LibCZIIOException& libCZI_io_exception)
@@ -183,9 +290,23 @@ void CziSlicesWriterTbb::Close(const std::shared_ptr<libCZI::ICziMetadata>& sour
                                 const std::function<void(libCZI::IXmlNodeRw*)>& tweak_metadata_hook,
                                 const std::function<void(libCZI::ICziWriter*)>& finalize_hook)
 {
-    SubBlockWriteInfo2 sub_block_write_info;
-    this->queue_.push(sub_block_write_info);
-    this->worker_thread_.join();
+    auto time_point_phase_started = chrono::steady_clock::now();
+    const auto end_phase =
+        [&time_point_phase_started](std::chrono::duration<double>& duration)->void
+        {
+            const auto now = chrono::steady_clock::now();
+            duration = now - time_point_phase_started;
+            time_point_phase_started = now;
+        };
+
+    if (!this->parallel_output_stream_)
+    {
+        SubBlockWriteInfo2 sub_block_write_info;
+        this->queue_.push(sub_block_write_info);
+        this->worker_thread_.join();
+    }
+
+    end_phase(this->close_timings_.drain);
 
     if (!source_metadata)
     {
@@ -269,18 +390,63 @@ void CziSlicesWriterTbb::Close(const std::shared_ptr<libCZI::ICziMetadata>& sour
         this->writer_->SyncWriteMetadata(metadata_info);
     }
 
+    end_phase(this->close_timings_.metadata);
+
     if (finalize_hook)
     {
         finalize_hook(this->writer_.get());
     }
 
+    end_phase(this->close_timings_.attachments);
+
     this->writer_->Close();
     this->writer_.reset();
+    this->parallel_output_stream_.reset();
+    if (this->direct_io_output_stream_)
+    {
+        // the staging buffers are written out, and the unaligned tail and the update of the file-header (which the
+        //  libCZI-writer did in its 'Close') are written here
+        this->direct_io_output_stream_->Close();
+        this->direct_io_output_stream_.reset();
+    }
+
+    end_phase(this->close_timings_.directory);
 }
 
 std::uint32_t CziSlicesWriterTbb::GetNumberOfPendingSliceWriteOperations()
 {
-    return this->number_of_slicewrite_operations_in_flight_.load();
+    return this->queue_admission_.GetNumberOfSlicesAdmitted();
+}
+
+std::uint64_t CziSlicesWriterTbb::GetSizeOfPendingSliceWriteOperations()
+{
+    return this->queue_admission_.GetSizeOfSlicesAdmitted();
+}
+
+std::uint64_t CziSlicesWriterTbb::GetNumberOfBytesWritten()
+{
+    return this->number_of_bytes_written_.load();
+}
+
+ICziSlicesWriter::CloseTimings CziSlicesWriterTbb::GetCloseTimings()
+{
+    return this->close_timings_;
+}
+
+/*static*/std::uint32_t CziSlicesWriterTbb::CalculateReservedSizeForSubBlockDirectory(std::uint32_t number_of_subblocks)
+{
+    if (number_of_subblocks == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t size = kSizeOfSubBlockDirectorySegmentHeader + static_cast<uint64_t>(number_of_subblocks) * kEstimatedSizeOfSubBlockDirectoryEntry;
+    if (size > numeric_limits<uint32_t>::max())
+    {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(size);
 }
 
 void CziSlicesWriterTbb::CopyMetadata(libCZI::IXmlNodeRead* rootSource, libCZI::IXmlNodeRw* rootDestination)
@@ -5,28 +5,53 @@
 #pragma once
 
 #include "ISlicesWriter.h"
+#include "ParallelWriteOutputStream.h"
+#include "DirectIoOutputStream.h"
+#include "SliceQueueAdmission.h"
 
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <thread>
 #include <string>
+#include <vector>
+#include <functional>
 
 #include <tbb/concurrent_queue.h>
 
 /// Implementation of a ICziSlicesWriter that uses a MPSC-queue to serialize the slice-write operations.
 /// The actual CZI-writing is handled by libCZI.
+/// The queue is bounded by the size (in bytes) of the slices in it, where the limit is the budget of the write-stage
+/// of the flow-control (see SliceQueueAdmission). If a slice does not fit into the queue, 'TryAddSlice' does not block -
+/// instead it registers a functor which is called when the worker thread has written a slice.
+/// In the "parallel write" mode (see ICziSlicesWriter::kPropertyBagKey_parallel_write), there is no queue and no
+/// worker thread - instead, the calling task adds the subblock to the libCZI-writer (under a lock), where the write
+/// operations are only captured (which reserves the space in the file), and then executes the write operations itself.
+/// So, the write operations for different subblocks are executed concurrently.
+/// In the "direct I/O" mode (see ICziSlicesWriter::kPropertyBagKey_direct_io), the output file is written by a
+/// DirectIoOutputStream, which aggregates the data into large aligned staging buffers and bypasses the page cache.
+/// If the number of subblocks to be written is known up front, space for the subblock-directory is reserved at the start
+/// of the file - so that at close the directory is written into this region (instead of being appended at the end of the file).
 class CziSlicesWriterTbb : public ICziSlicesWriter
 {
 private:
     static constexpr std::intptr_t kItemMarker_ItemToWrite = 1;
     static constexpr std::intptr_t kItemMarker_Shutdown = 0;
 
+    /// The size (in bytes) which is assumed for an entry in the subblock-directory when reserving space for it. An entry
+    /// consists of a fixed part of 32 bytes and 20 bytes per dimension-entry, and we assume (at most) 10 dimension-entries.
+    static constexpr std::uint64_t kEstimatedSizeOfSubBlockDirectoryEntry = 32 + 20 * 10;
+
+    /// The size (in bytes) of the header of the subblock-directory segment (i.e. the segment-header and the fixed part of
+    /// the segment-data).
+    static constexpr std::uint64_t kSizeOfSubBlockDirectorySegmentHeader = 32 + 128;
+
     AppContext& context_;
     std::thread worker_thread_;
 
     std::shared_ptr<libCZI::ICziWriter> writer_;
 
-    std::atomic_uint32_t number_of_slicewrite_operations_in_flight_{ 0 };
+    std::atomic_uint64_t number_of_bytes_written_{ 0 };
 
     struct SubBlockWriteInfo2
     {
@@ -34,20 +59,53 @@ private:
     };
 
     tbb::concurrent_bounded_queue<SubBlockWriteInfo2> queue_;
+
+    /// The admission of slices into the queue (bounded by the budget of the write-stage). In the "parallel write" mode, it
+    /// only keeps track of the slices being written.
+    SliceQueueAdmission queue_admission_;
     libCZI::GUID retilingBaseId_;
     bool use_acquisition_tiles_;
+
+    /// In the "parallel write" mode, this is the output-stream (otherwise it is null).
+    std::shared_ptr<ParallelWriteOutputStream> parallel_output_stream_;
+
+    /// In the "parallel write" mode, this mutex serializes the calls into the libCZI-writer.
+    std::mutex mutex_writer_;
+
+    /// In the "direct I/O" mode, this is the output-stream (otherwise it is null).
+    std::shared_ptr<DirectIoOutputStream> direct_io_output_stream_;
+
+    CloseTimings close_timings_;
 public:
-    CziSlicesWriterTbb(AppContext& context, const std::wstring& filename);
+    /// Constructor.
+    ///
+    /// \param [in] context                         The application context.
+    /// \param      filename                        The filename of the output file.
+    /// \param      expected_number_of_subblocks    The number of subblocks which is expected to be written (or zero if not known).
+    CziSlicesWriterTbb(AppContext& context, const std::wstring& filename, std::uint32_t expected_number_of_subblocks);
 
     std::uint32_t GetNumberOfPendingSliceWriteOperations() override;
-    void AddSlice(const AddSliceInfo& add_slice_info) override;
+    std::uint64_t GetSizeOfPendingSliceWriteOperations() override;
+    bool TryAddSlice(const AddSliceInfo& add_slice_info, const std::function<void()>& on_space_available) override;
     void Close(const std::shared_ptr<libCZI::ICziMetadata>& source_metadata,
         const libCZI::ScalingInfo* new_scaling_info,
         const std::function<void(libCZI::IXmlNodeRw*)>& tweak_metadata_hook,
         const std::function<void(libCZI::ICziWriter*)>& finalize_hook) override;
+    std::uint64_t GetNumberOfBytesWritten() override;
+    CloseTimings GetCloseTimings() override;
+
+    /// Calculates the size (in bytes) to be reserved for the subblock-directory - which is an estimate, erring on the
+    /// large side. If the size exceeds what can be reserved with the libCZI-writer, zero is returned (i.e. no space is reserved).
+    ///
+    /// \param  number_of_subblocks The number of subblocks.
+    ///
+    /// \returns The size to be reserved for the subblock-directory in bytes.
+    static std::uint32_t CalculateReservedSizeForSubBlockDirectory(std::uint32_t number_of_subblocks);
 
 private:
     void WriteWorker();
+    void WriteSubBlockParallel(const AddSliceInfo& add_slice_info);
+    void PrepareAddSubBlockInfo(SubBlockWriteInfo2& sub_block_write_info, const std::string& sub_block_metadata, libCZI::AddSubBlockInfoMemPtr& add_subblock_info);
     void CopyMetadata(libCZI::IXmlNodeRead* rootSource, libCZI::IXmlNodeRw* rootDestination);
     libCZI::GUID CreateRetilingIdWithZAndSlice(int z, std::uint32_t slice) const;
     std::string ConstructSubBlockMetadata(const SubBlockWriteInfo2& sub_block_write_info);
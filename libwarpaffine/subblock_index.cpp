@@ -0,0 +1,244 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "subblock_index.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace libCZI;
+
+namespace
+{
+    /// Axis-aligned bounding box which is accumulated while enumerating the subblocks of a tile.
+    struct BoundingBoxAccumulator
+    {
+        int min_x{ numeric_limits<int>::max() };
+        int min_y{ numeric_limits<int>::max() };
+        int max_x{ numeric_limits<int>::min() };
+        int max_y{ numeric_limits<int>::min() };
+
+        void Add(const IntRect& rectangle)
+        {
+            this->min_x = min(this->min_x, rectangle.x);
+            this->min_y = min(this->min_y, rectangle.y);
+            this->max_x = max(this->max_x, rectangle.x + rectangle.w);
+            this->max_y = max(this->max_y, rectangle.y + rectangle.h);
+        }
+
+        IntRect GetRectangle() const
+        {
+            return IntRect{ this->min_x, this->min_y, this->max_x - this->min_x, this->max_y - this->min_y };
+        }
+    };
+}
+
+SubblockIndex::SubblockIndex(libCZI::ICZIReader* czi_reader)
+    : SubblockIndex(
+        czi_reader->GetStatistics(),
+        [czi_reader]()->vector<SubblockDirectoryInfo>
+        {
+            vector<SubblockDirectoryInfo> subblocks;
+            czi_reader->EnumerateSubBlocksEx(
+                [&subblocks](int index, const DirectorySubBlockInfo& info)->bool
+                {
+                    if (subblocks.size() <= static_cast<size_t>(index))
+                    {
+                        subblocks.resize(static_cast<size_t>(index) + 1);
+                    }
+
+                    subblocks[index] = SubblockIndex::GetSubblockDirectoryInfo(info);
+                    return true;
+                });
+
+            return subblocks;
+        }())
+{
+}
+
+SubblockIndex::SubblockIndex(const libCZI::SubBlockStatistics& statistics, const std::vector<SubblockDirectoryInfo>& subblocks)
+{
+    this->entries_.reserve(subblocks.size());
+
+    // Here we gather the bounding boxes of the tiles - the logic here must be the same as the
+    //  one in CziHelpers::DetermineTileIdentifierToRectangleMap.
+    const bool document_has_scenes = !statistics.sceneBoundingBoxes.empty();
+    const bool gather_tile_rectangles = statistics.IsMIndexValid() || document_has_scenes;
+    map<TileIdentifier, BoundingBoxAccumulator> tile_bounding_boxes;
+
+    for (size_t index = 0; index < subblocks.size(); ++index)
+    {
+        // note that we only consider layer-0 subblocks here
+        const auto& info = subblocks[index];
+        if (!info.is_layer0)
+        {
+            continue;
+        }
+
+        Entry entry;
+        entry.key[kKeyIndexT] = info.t;
+        entry.key[kKeyIndexC] = info.c;
+        entry.key[kKeyIndexS] = info.s;
+        entry.key[kKeyIndexM] = info.m;
+        entry.key[kKeyIndexZ] = info.z;
+        entry.subblock_index = static_cast<int>(index);
+        this->entries_.push_back(entry);
+
+        if (gather_tile_rectangles &&
+            info.m != kNotPresent &&
+            info.m >= statistics.minMindex &&
+            info.m <= statistics.maxMindex)
+        {
+            if (!document_has_scenes)
+            {
+                tile_bounding_boxes[TileIdentifier::GetForNoSceneIndex(info.m)].Add(info.logical_rect);
+            }
+            else if (info.s != kNotPresent &&
+                    statistics.sceneBoundingBoxes.find(info.s) != statistics.sceneBoundingBoxes.cend())
+            {
+                tile_bounding_boxes[TileIdentifier(info.s, info.m)].Add(info.logical_rect);
+            }
+        }
+    }
+
+    sort(
+        this->entries_.begin(),
+        this->entries_.end(),
+        [](const Entry& a, const Entry& b)->bool
+        {
+            return a.key < b.key;
+        });
+
+    if (!gather_tile_rectangles)
+    {
+        // Having no M-index is considered "valid", but then we assume that we do not have a tiled document.
+        this->tile_identifier_to_rectangle_map_[TileIdentifier::GetForNoMIndexAndNoSceneIndex()] = statistics.boundingBoxLayer0Only;
+    }
+    else
+    {
+        for (const auto& item : tile_bounding_boxes)
+        {
+            this->tile_identifier_to_rectangle_map_[item.first] = item.second.GetRectangle();
+        }
+    }
+}
+
+/*static*/SubblockDirectoryInfo SubblockIndex::GetSubblockDirectoryInfo(const libCZI::DirectorySubBlockInfo& info)
+{
+    const auto get_coordinate_or_not_present =
+        [&info](DimensionIndex dimension_index)->int
+        {
+            int value;
+            if (info.coordinate.TryGetPosition(dimension_index, &value))
+            {
+                return value;
+            }
+
+            return kNotPresent;
+        };
+
+    SubblockDirectoryInfo subblock_directory_info;
+    subblock_directory_info.file_position = info.filePosition;
+    subblock_directory_info.logical_rect = info.logicalRect;
+    subblock_directory_info.t = get_coordinate_or_not_present(DimensionIndex::T);
+    subblock_directory_info.c = get_coordinate_or_not_present(DimensionIndex::C);
+    subblock_directory_info.s = get_coordinate_or_not_present(DimensionIndex::S);
+    subblock_directory_info.m = Utils::IsValidMindex(info.mIndex) ? info.mIndex : kNotPresent;
+    subblock_directory_info.z = get_coordinate_or_not_present(DimensionIndex::Z);
+
+    // a subblock is considered to be on pyramid-layer 0 if its logical size is equal to its physical size (which
+    //  is the same criterion as used by libCZI with "EnumSubset")
+    subblock_directory_info.is_layer0 =
+        info.logicalRect.w == static_cast<int>(info.physicalSize.w) &&
+        info.logicalRect.h == static_cast<int>(info.physicalSize.h);
+    return subblock_directory_info;
+}
+
+/*static*/std::vector<SubblockIndex::Range> SubblockIndex::NarrowRanges(const std::vector<Range>& ranges, KeyIndex key_index, const std::vector<int>& values)
+{
+    const auto value_less_than_entry = [key_index](int value, const Entry& entry)->bool { return value < entry.key[key_index]; };
+    const auto entry_less_than_value = [key_index](const Entry& entry, int value)->bool { return entry.key[key_index] < value; };
+
+    vector<Range> result;
+    for (const auto& range : ranges)
+    {
+        if (values.empty())
+        {
+            // all values are to be kept, but we need to split the range into groups of equal value (so that
+            //  the entries within each resulting range are sorted by the next key)
+            for (auto group_begin = range.first; group_begin != range.second;)
+            {
+                const auto group_end = upper_bound(group_begin, range.second, group_begin->key[key_index], value_less_than_entry);
+                result.emplace_back(group_begin, group_end);
+                group_begin = group_end;
+            }
+        }
+        else
+        {
+            auto search_begin = range.first;
+            for (const int value : values)
+            {
+                const auto lower = lower_bound(search_begin, range.second, value, entry_less_than_value);
+                const auto upper = upper_bound(lower, range.second, value, value_less_than_entry);
+                if (lower != upper)
+                {
+                    result.emplace_back(lower, upper);
+                }
+
+                search_begin = upper;
+            }
+        }
+    }
+
+    return result;
+}
+
+std::map<int, int> SubblockIndex::GetSubblocksForBrick(const libCZI::CDimCoordinate& brick_coordinate, const TileIdentifier& tile_identifier) const
+{
+    brick_coordinate.EnumValidDimensions(
+        [](libCZI::DimensionIndex dimension_index, int)->bool
+        {
+            if (dimension_index != DimensionIndex::T && dimension_index != DimensionIndex::C)
+            {
+                ostringstream string_stream;
+                string_stream << "The brick-coordinate must only contain the dimensions T and C, found '" << Utils::DimensionToChar(dimension_index) << "'.";
+                throw invalid_argument(string_stream.str());
+            }
+
+            return true;
+        });
+
+    vector<Range> ranges{ Range{ this->entries_.cbegin(), this->entries_.cend() } };
+
+    // For the dimensions given in the brick-coordinate, we require that the subblock has the same coordinate. If
+    //  the brick-coordinate does not contain a dimension, all subblocks are considered as matching.
+    int t, c;
+    const bool is_t_valid = brick_coordinate.TryGetPosition(DimensionIndex::T, &t);
+    const bool is_c_valid = brick_coordinate.TryGetPosition(DimensionIndex::C, &c);
+    ranges = NarrowRanges(ranges, kKeyIndexT, is_t_valid ? vector<int>{ t } : vector<int>{});
+    ranges = NarrowRanges(ranges, kKeyIndexC, is_c_valid ? vector<int>{ c } : vector<int>{});
+
+    // If the tile-identifier has a scene-index, then the subblock must have the same scene-index. If the tile-identifier
+    //  has an m-index, then a subblock matches if it has the same m-index or no m-index at all (note that kNotPresent
+    //  is the smallest possible value, so the vector is sorted as required).
+    ranges = NarrowRanges(ranges, kKeyIndexS, tile_identifier.IsSceneIndexValid() ? vector<int>{ tile_identifier.scene_index.value() } : vector<int>{});
+    ranges = NarrowRanges(ranges, kKeyIndexM, tile_identifier.IsMIndexValid() ? vector<int>{ kNotPresent, tile_identifier.m_index.value() } : vector<int>{});
+
+    map<int, int> map_z_subblockindex;
+    for (const auto& range : ranges)
+    {
+        for (auto iterator = range.first; iterator != range.second; ++iterator)
+        {
+            // for the time being, we only support/expect to have exactly one subblock per z
+            const auto insert_result = map_z_subblockindex.insert(pair<int, int>(iterator->key[kKeyIndexZ], iterator->subblock_index));
+            if (insert_result.second != true)
+            {
+                throw logic_error("more than one subblock");
+            }
+        }
+    }
+
+    return map_z_subblockindex;
+}
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "czi_helpers.h"
+#include "inc_libCZI.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+/// Information about a subblock (as found in the subblock-directory). This is the information from which
+/// the SubblockIndex is constructed. For coordinates not present in the subblock, the value SubblockDirectoryInfo::kNotPresent
+/// is used.
+struct SubblockDirectoryInfo
+{
+    /// The value used for a coordinate which is not present in the subblock.
+    static constexpr int kNotPresent = std::numeric_limits<int>::min();
+
+    std::uint64_t file_position{ 0 };   ///< The position of the subblock-segment in the file.
+    libCZI::IntRect logical_rect{ 0, 0, 0, 0 }; ///< The logical rectangle of the subblock.
+    int t{ kNotPresent };               ///< The T-coordinate of the subblock.
+    int c{ kNotPresent };               ///< The C-coordinate of the subblock.
+    int s{ kNotPresent };               ///< The S-coordinate of the subblock.
+    int m{ kNotPresent };               ///< The M-index of the subblock.
+    int z{ kNotPresent };               ///< The Z-coordinate of the subblock.
+    bool is_layer0{ false };            ///< True if the subblock is a pyramid-layer-0 subblock.
+};
+
+/// This class is an index of all layer-0 subblocks in a CZI-document. It is constructed with one pass over
+/// the subblock-directory, and then allows to determine the subblocks belonging to a brick with a couple
+/// of binary searches (as opposed to CziHelpers::GetSubblocksForBrick, which enumerates the whole directory
+/// for each query). The index is stored as a flat vector of small PODs, sorted lexicographically by
+/// (T, C, S, M, Z), so that all subblocks of a brick are found in contiguous ranges.
+/// Once constructed, the object is immutable and can be used concurrently from multiple threads.
+class SubblockIndex
+{
+public:
+    /// The value used in an entry for a coordinate which is not present in the subblock.
+    static constexpr int kNotPresent = SubblockDirectoryInfo::kNotPresent;
+
+    /// The position of the individual coordinates within Entry::key.
+    enum KeyIndex : std::size_t
+    {
+        kKeyIndexT = 0,
+        kKeyIndexC = 1,
+        kKeyIndexS = 2,
+        kKeyIndexM = 3,
+        kKeyIndexZ = 4,
+        kKeyCount = 5,
+    };
+
+    /// An entry of the index - the coordinate of a subblock (in the order T, C, S, M, Z) and its subblock-index.
+    struct Entry
+    {
+        std::array<int, kKeyCount> key;     ///< The coordinates of the subblock in the order T, C, S, M, Z, with kNotPresent for coordinates not present.
+        int subblock_index;                 ///< The index of the subblock.
+    };
+
+private:
+    std::vector<Entry> entries_;
+    TileIdentifierToRectangleMap tile_identifier_to_rectangle_map_;
+
+public:
+    SubblockIndex() = delete;
+
+    /// Constructs the index by enumerating the (layer-0) subblocks of the specified document.
+    ///
+    /// \param [in] czi_reader  The CZI-reader object.
+    explicit SubblockIndex(libCZI::ICZIReader* czi_reader);
+
+    /// Constructs the index from information about the subblocks which was gathered before. Subblocks which
+    /// are not layer-0 are ignored.
+    ///
+    /// \param  statistics  The subblock-statistics of the document.
+    /// \param  subblocks   Information about the subblocks of the document, where the position in the vector is the subblock-index.
+    SubblockIndex(const libCZI::SubBlockStatistics& statistics, const std::vector<SubblockDirectoryInfo>& subblocks);
+
+    /// Gets the information about a subblock from the specified subblock-directory-information.
+    ///
+    /// \param  info    The subblock-directory-information as reported by libCZI.
+    ///
+    /// \returns    The subblock-directory-information.
+    static SubblockDirectoryInfo GetSubblockDirectoryInfo(const libCZI::DirectorySubBlockInfo& info);
+
+    /// Gets the subblocks which are "inside" the specified brick. The semantic is identical to
+    /// CziHelpers::GetSubblocksForBrick - in particular, an exception is thrown if more than one subblock
+    /// is found for a z-plane. The brick coordinate is expected to contain only the dimensions T and C.
+    ///
+    /// \param  brick_coordinate    The brick coordinate.
+    /// \param  tile_identifier     The tile-identifier (which specifies the brick to be considered here).
+    ///
+    /// \returns    A map with key "z-index" and value "subblock-index".
+    std::map<int, int> GetSubblocksForBrick(const libCZI::CDimCoordinate& brick_coordinate, const TileIdentifier& tile_identifier) const;
+
+    /// Gets the map "tile-identifier to rectangle" - which is the same as what CziHelpers::DetermineTileIdentifierToRectangleMap
+    /// is reporting, but this is determined as a by-product when constructing the index.
+    ///
+    /// \returns    The tile identifier-to-rectangles map.
+    const TileIdentifierToRectangleMap& GetTileIdentifierToRectangleMap() const { return this->tile_identifier_to_rectangle_map_; }
+
+    /// Gets the number of subblocks contained in the index.
+    ///
+    /// \returns    The number of subblocks.
+    std::size_t GetNumberOfSubblocks() const { return this->entries_.size(); }
+
+private:
+    typedef std::pair<std::vector<Entry>::const_iterator, std::vector<Entry>::const_iterator> Range;
+
+    /// Narrows down the specified ranges to the entries where the key at the specified position is equal to
+    /// one of the specified values. If the values-vector is empty, then all entries are kept, but the ranges
+    /// are split into groups with equal value of this key. It is a requirement that within each range the entries
+    /// are sorted by the specified key, and that the values are sorted in ascending order. The resulting ranges
+    /// are then sorted by the next key.
+    ///
+    /// \param  ranges      The ranges to operate on.
+    /// \param  key_index   The position of the key to filter on.
+    /// \param  values      The values to look for (sorted ascending), or an empty vector meaning "all values".
+    ///
+    /// \returns    The resulting ranges.
+    static std::vector<Range> NarrowRanges(const std::vector<Range>& ranges, KeyIndex key_index, const std::vector<int>& values);
+};
@@ -6,27 +6,38 @@
 
 #include <LibWarpAffine_Config.h>
 
+#include <array>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 class AppContext;
 
+enum class TaskType
+{
+    DecompressSlice = 0,
+    Compression,
+    BrickComposition,
+    WarpAffineBrick,
+    CompressSlice,
+
+    Max
+};
+
+static constexpr size_t Count_of_TaskTypes = static_cast<size_t>(TaskType::Max);
+
 /// Statistics about the state of the task arena.
 struct TaskArenaStatistics
 {
     std::uint32_t queue_length{ 0 };     ///< How many items are currently in the task-arena's queue.
     std::uint32_t active_tasks{ 0 };     ///< How many tasks are currently executing (this number includes the suspended tasks).
     std::uint32_t suspended_tasks{ 0 };  ///< How many tasks are currently suspended.
-};
+    std::array<std::uint32_t, Count_of_TaskTypes> queue_length_per_task_type{};  ///< How many items of the respective task-type are currently in the task-arena's queue.
 
-enum class TaskType
-{
-    DecompressSlice,
-    Compression,
-    BrickComposition,
-    WarpAffineBrick,
-    CompressSlice,
+    /// The utilization (in percent) of each NUMA-node since the task-arena has been created, i.e. the time spent executing
+    /// tasks relative to the capacity of the node. This is empty if the task-arena does not model NUMA-nodes.
+    std::vector<float> numa_node_utilization;
 };
 
 /// The "task arena" interface models a simplistic thread-pool. The only supported operation is adding a task, 
@@ -37,6 +48,9 @@ public:
     /// Defines an alias representing a "suspend handle".
     typedef void* SuspendHandle;
 
+    /// The locality key meaning "no specific locality".
+    static constexpr std::uint64_t kNoLocality = 0;
+
     /// Adds a task to the task arena. The specified functor will execute at an unspecified point in time, and it
     /// will execute in an arbitrary thread-context, potentially concurrently with other tasks.
     ///
@@ -44,6 +58,17 @@ public:
     /// \param  task      The task.
     virtual void AddTask(TaskType task_type, const std::function<void()>& task) = 0;
 
+    /// Adds a task to the task arena, giving a "locality key" - tasks with the same locality key are preferably executed
+    /// on the same NUMA-node (the one which owns the memory they are operating on). All tasks belonging to the same
+    /// brick should use the same key. If the key is 'kNoLocality', the task is preferably executed on the NUMA-node of
+    /// the thread adding the task (which is the same behavior as with the other overload).
+    /// Task-arena implementations which do not model NUMA-nodes ignore the locality key.
+    ///
+    /// \param  task_type    An enum specifying at "type of the task".
+    /// \param  locality_key The locality key.
+    /// \param  task         The task.
+    virtual void AddTask(TaskType task_type, std::uint64_t locality_key, const std::function<void()>& task) = 0;
+
     /// This allows to pause (or suspend) a task. This method **must** be called from within a task,
     /// and the way this works is:
     /// - A functor is to be provided, which will be called passing in a "suspend handle". It will be called while executing this method  
@@ -66,8 +91,46 @@ public:
     ///
     /// \returns The statistics.
     virtual TaskArenaStatistics GetStatistics() = 0;
+
+    /// Gets the number of tasks which the task arena executes concurrently (i.e. the number of its worker threads).
+    ///
+    /// \returns The concurrency of the task arena.
+    virtual std::uint32_t GetConcurrency() = 0;
     virtual ~ITaskArena() = default;
 
+    /// This key for the "task arena property bag" gives the maximum number of tasks of type "DecompressSlice" which
+    /// may execute concurrently. The type is "int32", the default is "0" (meaning "no limit").
+    static const char* kPropertyBagKey_max_concurrent_decompress_tasks;
+
+    /// This key for the "task arena property bag" gives the maximum number of tasks of type "BrickComposition" which
+    /// may execute concurrently. The type is "int32", the default is "0" (meaning "no limit").
+    static const char* kPropertyBagKey_max_concurrent_composition_tasks;
+
+    /// This key for the "task arena property bag" gives the maximum number of tasks of type "WarpAffineBrick" which
+    /// may execute concurrently (including the ones which are suspended). The type is "int32", the default is "0" (meaning "no limit").
+    static const char* kPropertyBagKey_max_concurrent_warp_tasks;
+
+    /// This key for the "task arena property bag" gives the maximum number of tasks of type "CompressSlice" which
+    /// may execute concurrently. The type is "int32", the default is "0" (meaning "no limit").
+    static const char* kPropertyBagKey_max_concurrent_compress_tasks;
+
+    /// This key for the "task arena property bag" controls whether tasks of the downstream stages of the pipeline
+    /// (i.e. the ones which release memory when they are done) are given priority over tasks of the upstream stages.
+    /// If "false", the tasks are executed in FIFO order. The type is "boolean", the default is "true".
+    static const char* kPropertyBagKey_prioritize_downstream_tasks;
+
+    /// This key for the "task arena property bag" controls whether the task-arena models the NUMA-nodes of the machine
+    /// (i.e. uses a sub-arena per NUMA-node, with its worker threads bound to the node). This is only supported
+    /// by the "std" task-arena. The type is "boolean", the default is "true".
+    static const char* kPropertyBagKey_numa_aware;
+
+    /// Gets a short informal string for the task-type (for display purposes).
+    ///
+    /// \param  task_type   The task-type.
+    ///
+    /// \returns    A short informal string.
+    static const char* TaskTypeToInformalString(TaskType task_type);
+
     // non-copyable and non-moveable
     ITaskArena() = default;
     ITaskArena(const ITaskArena&) = default;             // copy constructor
@@ -77,4 +140,5 @@ public:
 };
 
 std::shared_ptr<ITaskArena> CreateTaskArenaTbb(AppContext& context);
+std::shared_ptr<ITaskArena> CreateTaskArenaStd(AppContext& context);
 
@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "numa_topology.h"
+#if LIBWARPAFFINE_WIN32_ENVIRONMENT
+#include <Windows.h>
+#endif
+#if LIBWARPAFFINE_UNIX_ENVIRONMENT
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+#if LIBWARPAFFINE_WIN32_ENVIRONMENT
+/*static*/std::vector<NumaTopology::Node> NumaTopology::DetermineNodes()
+{
+    vector<Node> nodes;
+    ULONG highest_node_number = 0;
+    if (!GetNumaHighestNodeNumber(&highest_node_number))
+    {
+        return nodes;
+    }
+
+    for (ULONG node_number = 0; node_number <= highest_node_number; ++node_number)
+    {
+        GROUP_AFFINITY group_affinity = {};
+        if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node_number), &group_affinity))
+        {
+            continue;
+        }
+
+        Node node;
+        node.node_id = node_number;
+        for (uint32_t bit = 0; bit < 64; ++bit)
+        {
+            if ((group_affinity.Mask & (static_cast<KAFFINITY>(1) << bit)) != 0)
+            {
+                node.processors.push_back(group_affinity.Group * 64 + bit);
+            }
+        }
+
+        if (!node.processors.empty())
+        {
+            nodes.push_back(node);
+        }
+    }
+
+    return nodes;
+}
+
+/*static*/bool NumaTopology::TryBindCurrentThreadToNode(const Node& node)
+{
+    if (node.processors.empty())
+    {
+        return false;
+    }
+
+    // a NUMA-node is (on Windows) always contained in a single processor-group
+    GROUP_AFFINITY group_affinity = {};
+    group_affinity.Group = static_cast<WORD>(node.processors[0] / 64);
+    for (const auto processor : node.processors)
+    {
+        group_affinity.Mask |= static_cast<KAFFINITY>(1) << (processor % 64);
+    }
+
+    return SetThreadGroupAffinity(GetCurrentThread(), &group_affinity, nullptr) != 0;
+}
+#endif
+
+#if LIBWARPAFFINE_UNIX_ENVIRONMENT
+/*static*/std::vector<NumaTopology::Node> NumaTopology::DetermineNodes()
+{
+    vector<Node> nodes;
+    ifstream online_file("/sys/devices/system/node/online");
+    string online_text;
+    vector<uint32_t> node_ids;
+    if (!getline(online_file, online_text) || !NumaTopology::TryParseNumberList(online_text, node_ids))
+    {
+        return nodes;
+    }
+
+    for (const auto node_id : node_ids)
+    {
+        ostringstream filename;
+        filename << "/sys/devices/system/node/node" << node_id << "/cpulist";
+        ifstream cpulist_file(filename.str());
+        string cpulist_text;
+        Node node;
+        node.node_id = node_id;
+        if (getline(cpulist_file, cpulist_text) &&
+            NumaTopology::TryParseNumberList(cpulist_text, node.processors) &&
+            !node.processors.empty())
+        {
+            nodes.push_back(node);
+        }
+    }
+
+    return nodes;
+}
+
+/*static*/bool NumaTopology::TryBindCurrentThreadToNode(const Node& node)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    bool any_processor_set = false;
+    for (const auto processor : node.processors)
+    {
+        if (processor < CPU_SETSIZE)
+        {
+            CPU_SET(processor, &cpu_set);
+            any_processor_set = true;
+        }
+    }
+
+    return any_processor_set && pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+#endif
+
+/*static*/bool NumaTopology::TryParseNumberList(const std::string& text, std::vector<std::uint32_t>& numbers)
+{
+    numbers.clear();
+    istringstream stream(text);
+    string part;
+    while (getline(stream, part, ','))
+    {
+        // remove whitespace (e.g. the trailing newline)
+        part.erase(remove_if(part.begin(), part.end(), [](char c)->bool { return isspace(static_cast<unsigned char>(c)) != 0; }), part.end());
+        if (part.empty())
+        {
+            continue;
+        }
+
+        unsigned long first, last;
+        char* end_pointer;
+        first = strtoul(part.c_str(), &end_pointer, 10);
+        if (end_pointer == part.c_str())
+        {
+            return false;
+        }
+
+        if (*end_pointer == '-')
+        {
+            const char* start_of_last = end_pointer + 1;
+            last = strtoul(start_of_last, &end_pointer, 10);
+            if (end_pointer == start_of_last || last < first)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            last = first;
+        }
+
+        if (*end_pointer != '\0')
+        {
+            return false;
+        }
+
+        for (unsigned long number = first; number <= last; ++number)
+        {
+            numbers.push_back(static_cast<uint32_t>(number));
+        }
+    }
+
+    sort(numbers.begin(), numbers.end());
+    return true;
+}
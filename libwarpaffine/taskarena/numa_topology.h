@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <LibWarpAffine_Config.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Utilities for determining the NUMA-topology of the machine, and for binding threads to a NUMA-node.
+class NumaTopology
+{
+public:
+    /// Information about a NUMA-node.
+    struct Node
+    {
+        std::uint32_t node_id{ 0 };                 ///< The (operating-system's) identifier of the node.
+
+        /// The logical processors belonging to the node. On Windows, the number is given as "processor-group * 64 + processor-number".
+        std::vector<std::uint32_t> processors;
+    };
+
+    /// Determines the NUMA-nodes of the machine (with at least one processor). If the information cannot be
+    /// determined, then an empty vector is returned.
+    ///
+    /// \returns    The NUMA-nodes.
+    static std::vector<Node> DetermineNodes();
+
+    /// Binds the calling thread to the processors of the specified NUMA-node.
+    ///
+    /// \param  node    The NUMA-node.
+    ///
+    /// \returns    True if it succeeds; false otherwise.
+    static bool TryBindCurrentThreadToNode(const Node& node);
+
+    /// Parses a list of numbers in the notation used by the Linux sysfs (e.g. "0-3,8-11").
+    ///
+    /// \param          text    The text.
+    /// \param [out]    numbers If successful, the numbers are put here (in ascending order).
+    ///
+    /// \returns    True if it succeeds; false otherwise.
+    static bool TryParseNumberList(const std::string& text, std::vector<std::uint32_t>& numbers);
+};
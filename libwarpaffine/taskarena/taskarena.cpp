@@ -4,6 +4,7 @@
 
 #include "ITaskArena.h"
 #include "taskarena_tbb.h"
+#include "taskarena_std.h"
 
 using namespace std;
 
@@ -12,4 +13,33 @@ std::shared_ptr<ITaskArena> CreateTaskArenaTbb(AppContext& context)
     return make_shared<TaskArenaTbb>(context);
 }
 
+std::shared_ptr<ITaskArena> CreateTaskArenaStd(AppContext& context)
+{
+    return make_shared<TaskArenaStd>(context);
+}
+
+/*static*/const char* ITaskArena::kPropertyBagKey_max_concurrent_decompress_tasks = "max_concurrent_decompress_tasks";
+/*static*/const char* ITaskArena::kPropertyBagKey_max_concurrent_composition_tasks = "max_concurrent_composition_tasks";
+/*static*/const char* ITaskArena::kPropertyBagKey_max_concurrent_warp_tasks = "max_concurrent_warp_tasks";
+/*static*/const char* ITaskArena::kPropertyBagKey_max_concurrent_compress_tasks = "max_concurrent_compress_tasks";
+/*static*/const char* ITaskArena::kPropertyBagKey_prioritize_downstream_tasks = "prioritize_downstream_tasks";
+/*static*/const char* ITaskArena::kPropertyBagKey_numa_aware = "numa_aware";
 
+/*static*/const char* ITaskArena::TaskTypeToInformalString(TaskType task_type)
+{
+    switch (task_type)
+    {
+    case TaskType::DecompressSlice:
+        return "decompress";
+    case TaskType::Compression:
+        return "compression";
+    case TaskType::BrickComposition:
+        return "compose";
+    case TaskType::WarpAffineBrick:
+        return "warp";
+    case TaskType::CompressSlice:
+        return "compress";
+    }
+
+    return "invalid";
+}
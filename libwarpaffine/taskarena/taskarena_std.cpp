@@ -0,0 +1,577 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include "taskarena_std.h"
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include "../appcontext.h"
+
+using namespace std;
+
+namespace
+{
+    /// The arena the current thread is a worker of (or null if the current thread is not a worker thread).
+    thread_local TaskArenaStd* current_arena = nullptr;
+
+    /// If the current thread is a worker thread, the index of the worker.
+    thread_local uint32_t current_worker_index = 0;
+
+    /// If the current thread is a worker thread, the point in time from which on the current task is accounted as "busy".
+    thread_local chrono::steady_clock::time_point current_task_busy_since;
+}
+
+TaskArenaStd::TaskArenaStd(AppContext& context, std::uint32_t max_number_of_workers)
+    : context_(context),
+    time_of_creation_(chrono::steady_clock::now())
+{
+    for (auto& queue_length : this->queue_length_per_task_type_)
+    {
+        queue_length.store(0);
+    }
+
+    vector<NumaTopology::Node> numa_nodes;
+    if (context.GetCommandLineOptions().GetPropertyBagForTaskArena().GetBoolOrDefault(ITaskArena::kPropertyBagKey_numa_aware, true))
+    {
+        numa_nodes = NumaTopology::DetermineNodes();
+    }
+
+    if (numa_nodes.size() > 1)
+    {
+        for (const auto& numa_node : numa_nodes)
+        {
+            auto node = make_unique<NumaNode>();
+            node->topology = numa_node;
+            node->concurrency = static_cast<uint32_t>(numa_node.processors.size());
+            this->nodes_.push_back(std::move(node));
+        }
+    }
+    else
+    {
+        // with only one NUMA-node, there is a single sub-arena (and the threads are not bound to processors)
+        auto node = make_unique<NumaNode>();
+        node->concurrency = (max)(1u, thread::hardware_concurrency());
+        this->nodes_.push_back(std::move(node));
+    }
+
+    const uint32_t concurrency = this->GetConcurrency();
+    if (max_number_of_workers == 0)
+    {
+        max_number_of_workers = kDefaultMaxNumberOfWorkersPerConcurrency * concurrency;
+    }
+
+    this->max_number_of_workers_ = (min)(kMaxNumberOfWorkers, (max)(concurrency, max_number_of_workers));
+    this->workers_.resize(this->max_number_of_workers_);
+
+    std::lock_guard<std::mutex> lck(this->mutex_pool_);
+    for (uint32_t node_index = 0; node_index < this->nodes_.size(); ++node_index)
+    {
+        for (uint32_t i = 0; i < this->nodes_[node_index]->concurrency; ++i)
+        {
+            this->StartWorker(node_index);
+        }
+    }
+}
+
+TaskArenaStd::~TaskArenaStd()
+{
+    // A worker executing a suspended task is blocked until the task is resumed, so it could not be joined. We give
+    //  a task which is about to be resumed some time, but if a task is never resumed, this is a programming error
+    //  (and we rather terminate than hang forever).
+    {
+        unique_lock<mutex> lock(this->mutex_suspended_tasks_);
+        this->suspended_tasks_resumed_.wait_for(
+            lock,
+            kMaxWaitForSuspendedTasksOnDestruction,
+            [this]()->bool { return this->suspended_tasks_.load() == 0; });
+    }
+
+    const uint32_t suspended_tasks = this->suspended_tasks_.load();
+    if (suspended_tasks > 0)
+    {
+        ostringstream error_text;
+        error_text << "The task-arena is destroyed while " << suspended_tasks << " task(s) are still suspended (and have not been resumed).";
+        this->context_.FatalError(error_text.str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_pool_);
+        this->shutdown_ = true;
+    }
+
+    for (const auto& node : this->nodes_)
+    {
+        node->work_available.notify_all();
+        node->worker_unparked.notify_all();
+    }
+
+    const uint32_t number_of_workers = this->number_of_workers_.load();
+    for (uint32_t i = 0; i < number_of_workers; ++i)
+    {
+        this->workers_[i]->thread.join();
+    }
+}
+
+void TaskArenaStd::AddTask(TaskType task_type, const std::function<void()>& task)
+{
+    this->AddTask(task_type, ITaskArena::kNoLocality, task);
+}
+
+void TaskArenaStd::AddTask(TaskType task_type, std::uint64_t locality_key, const std::function<void()>& task)
+{
+    const uint32_t node_index = this->DetermineNodeIndex(locality_key);
+    auto& node = *this->nodes_[node_index];
+    ++this->queue_length_per_task_type_[static_cast<size_t>(task_type)];
+    uint32_t node_index_to_notify = node_index;
+    {
+        // We increment the counters (before the task is actually queued) with the pool-mutex held, so that a worker
+        //  checking the counters before going to sleep cannot miss the notification. A worker may see the counter
+        //  incremented before the task is visible, in which case it will simply look for it again.
+        std::lock_guard<std::mutex> lck(this->mutex_pool_);
+        ++node.pending_tasks;
+        ++this->pending_tasks_;
+        if (node.idle_workers.load() == 0)
+        {
+            // all workers of the node are busy, so we wake up an idle worker of another node (which may then steal the task)
+            const uint32_t number_of_nodes = static_cast<uint32_t>(this->nodes_.size());
+            for (uint32_t i = 1; i < number_of_nodes; ++i)
+            {
+                const uint32_t other_node_index = (node_index + i) % number_of_nodes;
+                if (this->nodes_[other_node_index]->idle_workers.load() > 0)
+                {
+                    node_index_to_notify = other_node_index;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (current_arena == this && this->workers_[current_worker_index]->node_index == node_index)
+    {
+        // we are on a worker thread of the target node, so the task goes to this worker's deque
+        auto& worker = *this->workers_[current_worker_index];
+        std::lock_guard<std::mutex> lck(worker.mutex);
+        worker.deque.push_back(TaskItem{ task_type, task });
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lck(node.mutex_injection_queue);
+        node.injection_queue.push_back(TaskItem{ task_type, task });
+    }
+
+    this->nodes_[node_index_to_notify]->work_available.notify_one();
+}
+
+void TaskArenaStd::SuspendCurrentTask(const std::function<void(SuspendHandle)>& func_pass_resume_handle)
+{
+    if (current_arena != this)
+    {
+        throw logic_error("'SuspendCurrentTask' must only be called from within a task.");
+    }
+
+    // the time being suspended is not accounted as "busy"
+    this->AddBusyTimeOfCurrentTask();
+
+    const uint32_t node_index = this->workers_[current_worker_index]->node_index;
+    auto& node = *this->nodes_[node_index];
+    ++this->suspended_tasks_;
+    SuspendPoint suspend_point;
+    suspend_point.node_index = node_index;
+    {
+        // this worker is blocked from now on, so we activate another worker of the same node in its stead
+        std::lock_guard<std::mutex> lck(this->mutex_pool_);
+        --node.running_workers;
+        if (node.running_workers < node.concurrency)
+        {
+            if (node.parked_workers > node.unpark_requests)
+            {
+                ++node.unpark_requests;
+                ++node.running_workers;
+                node.worker_unparked.notify_one();
+            }
+            else if (this->number_of_workers_.load() < this->max_number_of_workers_)
+            {
+                this->StartWorker(node_index);
+            }
+            else
+            {
+                // there is no worker which could take our place, so this thread keeps running and executes queued tasks
+                //  while waiting (otherwise, tasks the suspended task is waiting for might never be executed)
+                ++node.running_workers;
+                suspend_point.help_while_waiting = true;
+            }
+        }
+    }
+
+    func_pass_resume_handle(&suspend_point);
+
+    if (suspend_point.help_while_waiting)
+    {
+        this->HelpWhileSuspended(suspend_point);
+    }
+
+    {
+        // note that we must acquire the mutex (also if the task was resumed already), since 'ResumeTask' may still be holding it
+        unique_lock<mutex> lock(suspend_point.mutex);
+        suspend_point.condition_variable.wait(lock, [&]()->bool { return suspend_point.resumed.load(); });
+    }
+
+    if (!suspend_point.help_while_waiting)
+    {
+        // now this worker is running again (and there may be more workers running than the concurrency we aim for, in
+        //  which case a worker will be parked when it is done with its current task)
+        bool surplus_workers;
+        {
+            std::lock_guard<std::mutex> lck(this->mutex_pool_);
+            ++node.running_workers;
+            surplus_workers = node.running_workers > node.concurrency;
+        }
+
+        if (surplus_workers)
+        {
+            // wake up the idle workers, so that one of them gets parked
+            node.work_available.notify_all();
+        }
+    }
+
+    current_task_busy_since = chrono::steady_clock::now();
+}
+
+void TaskArenaStd::ResumeTask(SuspendHandle resume_handle)
+{
+    auto suspend_point = static_cast<SuspendPoint*>(resume_handle);
+
+    // Note that the suspend-point lives on the stack of the suspended task, so we must not access it after 'resumed'
+    //  was set (and the lock released) - the notification is therefore done with the lock held.
+    {
+        std::lock_guard<std::mutex> lck(suspend_point->mutex);
+        suspend_point->resumed = true;
+        if (suspend_point->help_while_waiting)
+        {
+            // the thread of the suspended task may be waiting for work on its node - we acquire the pool-mutex (which it
+            //  holds while checking for 'resumed') before notifying, so that the notification cannot get lost
+            auto& node = *this->nodes_[suspend_point->node_index];
+            {
+                std::lock_guard<std::mutex> lck_pool(this->mutex_pool_);
+            }
+
+            node.work_available.notify_all();
+        }
+        else
+        {
+            suspend_point->condition_variable.notify_one();
+        }
+    }
+
+    // this is done last, since the arena may be destroyed as soon as there are no suspended tasks anymore
+    std::lock_guard<std::mutex> lck(this->mutex_suspended_tasks_);
+    if (--this->suspended_tasks_ == 0)
+    {
+        this->suspended_tasks_resumed_.notify_all();
+    }
+}
+
+TaskArenaStatistics TaskArenaStd::GetStatistics()
+{
+    TaskArenaStatistics statistics;
+    statistics.queue_length = this->pending_tasks_.load();
+    statistics.active_tasks = this->active_tasks_.load();
+    statistics.suspended_tasks = this->suspended_tasks_.load();
+    for (size_t i = 0; i < Count_of_TaskTypes; ++i)
+    {
+        statistics.queue_length_per_task_type[i] = this->queue_length_per_task_type_[i].load();
+    }
+
+    const auto elapsed_time_in_microseconds = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - this->time_of_creation_).count();
+    for (const auto& node : this->nodes_)
+    {
+        const double capacity_in_microseconds = static_cast<double>(elapsed_time_in_microseconds) * node->concurrency;
+        const double utilization = capacity_in_microseconds > 0 ? 100 * node->busy_time_in_microseconds.load() / capacity_in_microseconds : 0;
+        statistics.numa_node_utilization.push_back(static_cast<float>((min)(utilization, 100.0)));
+    }
+
+    return statistics;
+}
+
+std::uint32_t TaskArenaStd::GetConcurrency()
+{
+    // the number of nodes and their concurrency is fixed after construction
+    uint32_t concurrency = 0;
+    for (const auto& node : this->nodes_)
+    {
+        concurrency += node->concurrency;
+    }
+
+    return concurrency;
+}
+
+/*static*/std::uint32_t TaskArenaStd::GetNodeIndexForLocalityKey(std::uint64_t locality_key, std::uint32_t number_of_nodes)
+{
+    // the key is typically an address or a small integer, so we mix the bits (this is the finalizer of "splitmix64")
+    uint64_t hash = locality_key;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    hash = hash ^ (hash >> 31);
+    return static_cast<uint32_t>(hash % number_of_nodes);
+}
+
+std::uint32_t TaskArenaStd::DetermineNodeIndex(std::uint64_t locality_key)
+{
+    const uint32_t number_of_nodes = static_cast<uint32_t>(this->nodes_.size());
+    if (number_of_nodes == 1)
+    {
+        return 0;
+    }
+
+    if (locality_key != ITaskArena::kNoLocality)
+    {
+        return TaskArenaStd::GetNodeIndexForLocalityKey(locality_key, number_of_nodes);
+    }
+
+    if (current_arena == this)
+    {
+        // a task added from within a task (without a locality key) stays on the node of the worker
+        return this->workers_[current_worker_index]->node_index;
+    }
+
+    return this->next_node_for_external_tasks_.fetch_add(1) % number_of_nodes;
+}
+
+void TaskArenaStd::StartWorker(std::uint32_t node_index)
+{
+    // note: this method must be called with the pool-mutex held
+    const uint32_t worker_index = this->number_of_workers_.load();
+    this->workers_[worker_index] = make_unique<Worker>();
+    this->workers_[worker_index]->node_index = node_index;
+    ++this->nodes_[node_index]->running_workers;
+    this->workers_[worker_index]->thread = thread(&TaskArenaStd::WorkerThread, this, worker_index);
+    this->number_of_workers_.store(worker_index + 1);
+}
+
+void TaskArenaStd::WorkerThread(std::uint32_t worker_index)
+{
+    current_arena = this;
+    current_worker_index = worker_index;
+    const uint32_t node_index = this->workers_[worker_index]->node_index;
+    auto& node = *this->nodes_[node_index];
+    if (!node.topology.processors.empty())
+    {
+        // if this fails, the worker simply runs unbound
+        NumaTopology::TryBindCurrentThreadToNode(node.topology);
+    }
+
+    for (;;)
+    {
+        {
+            unique_lock<mutex> lock(this->mutex_pool_);
+            if (this->TryPark(node, lock))
+            {
+                continue;
+            }
+
+            if (this->shutdown_)
+            {
+                break;
+            }
+        }
+
+        TaskItem task_item;
+        if (this->TryGetTask(worker_index, task_item))
+        {
+            this->RunTask(task_item);
+            continue;
+        }
+
+        unique_lock<mutex> lock(this->mutex_pool_);
+        ++node.idle_workers;
+        node.work_available.wait(
+            lock,
+            [&]()->bool
+            {
+                return node.pending_tasks.load() > 0 ||
+                    this->shutdown_ ||
+                    node.running_workers > node.concurrency ||
+                    this->IsOtherNodeBacklogged(node_index);
+            });
+        --node.idle_workers;
+    }
+}
+
+bool TaskArenaStd::TryPark(NumaNode& node, std::unique_lock<std::mutex>& lock)
+{
+    // note: this method must be called with the pool-mutex held
+    if (node.running_workers <= node.concurrency || this->shutdown_)
+    {
+        return false;
+    }
+
+    // there are more workers running than we aim for (because a suspended task was resumed), so this worker is parked
+    --node.running_workers;
+    ++node.parked_workers;
+    node.worker_unparked.wait(lock, [&]()->bool { return node.unpark_requests > 0 || this->shutdown_; });
+    --node.parked_workers;
+    if (node.unpark_requests > 0)
+    {
+        // the 'running_workers'-counter has already been incremented by the one requesting the unpark
+        --node.unpark_requests;
+    }
+
+    return true;
+}
+
+bool TaskArenaStd::IsOtherNodeBacklogged(std::uint32_t node_index) const
+{
+    // a node has a backlog if there are more tasks queued than it has idle workers
+    for (uint32_t i = 0; i < this->nodes_.size(); ++i)
+    {
+        if (i != node_index && this->nodes_[i]->pending_tasks.load() > this->nodes_[i]->idle_workers.load())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TaskArenaStd::TryGetTask(std::uint32_t worker_index, TaskItem& task_item)
+{
+    auto& worker = *this->workers_[worker_index];
+    auto& node = *this->nodes_[worker.node_index];
+
+    // first, we take the most recently added task from our own deque...
+    {
+        std::lock_guard<std::mutex> lck(worker.mutex);
+        if (!worker.deque.empty())
+        {
+            task_item = std::move(worker.deque.back());
+            worker.deque.pop_back();
+            --node.pending_tasks;
+            --this->pending_tasks_;
+            --this->queue_length_per_task_type_[static_cast<size_t>(task_item.task_type)];
+            return true;
+        }
+    }
+
+    // ...then we look for a task on our node (starting with our neighbor when stealing)...
+    if (this->TryGetTaskFromNode(worker.node_index, worker_index + 1, task_item))
+    {
+        return true;
+    }
+
+    // ...and finally - our node being idle - we steal from a node with a backlog
+    const uint32_t number_of_nodes = static_cast<uint32_t>(this->nodes_.size());
+    for (uint32_t i = 1; i < number_of_nodes; ++i)
+    {
+        const uint32_t other_node_index = (worker.node_index + i) % number_of_nodes;
+        const auto& other_node = *this->nodes_[other_node_index];
+        if (other_node.pending_tasks.load() > other_node.idle_workers.load() &&
+            this->TryGetTaskFromNode(other_node_index, 0, task_item))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TaskArenaStd::TryGetTaskFromNode(std::uint32_t node_index, std::uint32_t first_worker_to_steal_from, TaskItem& task_item)
+{
+    auto& node = *this->nodes_[node_index];
+    const auto take = [&](TaskItem& item)->bool
+        {
+            task_item = std::move(item);
+            --node.pending_tasks;
+            --this->pending_tasks_;
+            --this->queue_length_per_task_type_[static_cast<size_t>(task_item.task_type)];
+            return true;
+        };
+
+    // the oldest task from the injection queue of the node...
+    {
+        std::lock_guard<std::mutex> lck(node.mutex_injection_queue);
+        if (!node.injection_queue.empty())
+        {
+            take(node.injection_queue.front());
+            node.injection_queue.pop_front();
+            return true;
+        }
+    }
+
+    // ...or the oldest task from a deque of a worker of the node
+    const uint32_t number_of_workers = this->number_of_workers_.load();
+    for (uint32_t i = 0; i < number_of_workers; ++i)
+    {
+        auto& victim = *this->workers_[(first_worker_to_steal_from + i) % number_of_workers];
+        if (victim.node_index != node_index)
+        {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lck(victim.mutex);
+        if (!victim.deque.empty())
+        {
+            take(victim.deque.front());
+            victim.deque.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskArenaStd::RunTask(const TaskItem& task_item)
+{
+    ++this->active_tasks_;
+    current_task_busy_since = chrono::steady_clock::now();
+    try
+    {
+        task_item.task();
+    }
+    catch (exception& exception)
+    {
+        ostringstream text;
+        text << "Task crashed: " << exception.what() << ".";
+        this->context_.FatalError(text.str());
+    }
+
+    this->AddBusyTimeOfCurrentTask();
+    --this->active_tasks_;
+}
+
+void TaskArenaStd::HelpWhileSuspended(SuspendPoint& suspend_point)
+{
+    // this is similar to the loop of a worker thread (without parking), it ends as soon as the task is resumed - tasks
+    //  executed here may themselves be suspended (and then help in turn)
+    auto& node = *this->nodes_[suspend_point.node_index];
+    const uint32_t worker_index = current_worker_index;
+    while (!suspend_point.resumed.load())
+    {
+        TaskItem task_item;
+        if (this->TryGetTask(worker_index, task_item))
+        {
+            this->RunTask(task_item);
+            continue;
+        }
+
+        unique_lock<mutex> lock(this->mutex_pool_);
+        ++node.idle_workers;
+        node.work_available.wait(
+            lock,
+            [&]()->bool
+            {
+                return node.pending_tasks.load() > 0 ||
+                    suspend_point.resumed.load() ||
+                    this->IsOtherNodeBacklogged(suspend_point.node_index);
+            });
+        --node.idle_workers;
+    }
+}
+
+void TaskArenaStd::AddBusyTimeOfCurrentTask()
+{
+    const auto now = chrono::steady_clock::now();
+    auto& node = *this->nodes_[this->workers_[current_worker_index]->node_index];
+    node.busy_time_in_microseconds += chrono::duration_cast<chrono::microseconds>(now - current_task_busy_since).count();
+    current_task_busy_since = now;
+}
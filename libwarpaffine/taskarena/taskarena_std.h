@@ -0,0 +1,188 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ITaskArena.h"
+#include "numa_topology.h"
+
+/// Implementation of a "task arena" based on a pool of std::threads with work-stealing.
+/// - The NUMA-nodes of the machine are modeled as sub-arenas - each node has its own worker threads (which are bound to the
+///   processors of the node), and its own injection queue. A task is routed to a node by its "locality key" (so that all
+///   tasks operating on the same brick are executed on the node which owns the brick's memory), a task without a locality
+///   key goes to the node of the thread adding it. If there is only one NUMA-node (or NUMA-awareness is disabled),
+///   there is exactly one sub-arena and the threads are not bound.
+/// - Each worker has its own deque. Tasks added from within a task (i.e. on a worker thread) for the worker's node are pushed
+///   onto the deque of this worker, and the worker takes the most recently added task from its deque first (so that e.g.
+///   the compression of a slice just produced is done while the data is still hot in the cache, and memory is
+///   released early). Other tasks are put into the FIFO "injection queue" of the node.
+/// - A worker with an empty deque takes the oldest task from the injection queue of its node, and if this is empty as well,
+///   it steals the oldest task from another worker's deque of the same node. Only if the node is idle and another node has a
+///   backlog (i.e. more queued tasks than idle workers), tasks are stolen from another node.
+/// - Suspending a task blocks the worker thread it is executing on. In order to keep the number of workers which
+///   are executing tasks at the configured concurrency, another worker (of the same node) is activated (or created) in its
+///   stead. When the task is resumed, it continues on the same thread, and surplus workers retire (and are kept as spares) once
+///   their current task is done. The number of workers is bounded - if no spare worker can be activated, the suspended task's
+///   thread executes queued tasks itself until the task is resumed ("help while waiting").
+/// Note that the priorities and the concurrency limits per task-type (which are implemented by the TBB-based arena)
+/// are not supported by this implementation.
+class TaskArenaStd : public ITaskArena
+{
+private:
+    struct TaskItem
+    {
+        TaskType task_type;
+        std::function<void()> task;
+    };
+
+    struct Worker
+    {
+        std::uint32_t node_index{ 0 };
+        std::mutex mutex;
+        std::deque<TaskItem> deque;
+        std::thread thread;
+    };
+
+    /// The state of a NUMA-node (i.e. of a sub-arena). The counters which are not atomic are protected by the pool-mutex.
+    struct NumaNode
+    {
+        /// The processors of the node (which are used for binding the worker threads, if non-empty).
+        NumaTopology::Node topology;
+
+        /// The number of workers which are supposed to execute tasks concurrently on this node.
+        std::uint32_t concurrency{ 0 };
+
+        std::mutex mutex_injection_queue;
+        std::deque<TaskItem> injection_queue;
+
+        std::condition_variable work_available;
+        std::condition_variable worker_unparked;
+
+        /// The number of tasks which are queued for this node (in the injection queue or in a deque of a worker of this node).
+        std::atomic_uint32_t pending_tasks{ 0 };
+
+        /// The number of workers of this node which are waiting for work.
+        std::atomic_uint32_t idle_workers{ 0 };
+
+        /// The number of workers which are allowed to pick up tasks (i.e. which are neither parked nor blocked in a suspended task).
+        std::uint32_t running_workers{ 0 };
+
+        /// The number of workers which are parked (i.e. which are available for compensating for a suspended task).
+        std::uint32_t parked_workers{ 0 };
+
+        /// The number of workers which have been requested to leave the parked state.
+        std::uint32_t unpark_requests{ 0 };
+
+        /// The accumulated time the workers of this node spent executing tasks (not including the time being suspended).
+        std::atomic_uint64_t busy_time_in_microseconds{ 0 };
+    };
+
+    /// This represents a suspended task - a pointer to this object is used as "suspend handle".
+    struct SuspendPoint
+    {
+        std::mutex mutex;
+        std::condition_variable condition_variable;
+        std::atomic_bool resumed{ false };
+
+        /// Whether the thread of the suspended task executes queued tasks while waiting (instead of being blocked).
+        bool help_while_waiting{ false };
+
+        /// The index of the node of the worker the task was suspended on.
+        std::uint32_t node_index{ 0 };
+    };
+
+    /// The upper limit for the maximum number of workers (including the ones created in order to compensate for suspended tasks).
+    static constexpr std::uint32_t kMaxNumberOfWorkers = 1024;
+
+    /// The default for the maximum number of workers, as a multiple of the concurrency of the arena.
+    static constexpr std::uint32_t kDefaultMaxNumberOfWorkersPerConcurrency = 4;
+
+    /// The maximum time the destructor waits for suspended tasks to be resumed.
+    static constexpr std::chrono::seconds kMaxWaitForSuspendedTasksOnDestruction{ 10 };
+
+    AppContext& context_;
+
+    /// The NUMA-nodes - this vector is populated on construction and is not modified afterwards.
+    std::vector<std::unique_ptr<NumaNode>> nodes_;
+
+    /// The worker-slots - this vector is sized on construction and is not resized afterwards, slots up to
+    /// 'number_of_workers_' are valid.
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic_uint32_t number_of_workers_{ 0 };
+
+    /// The maximum number of workers - this is the size of the 'workers_'-vector.
+    std::uint32_t max_number_of_workers_{ 0 };
+
+    /// The mutex protecting the state of the pool (i.e. the workers which are running, parked or idle), used with the
+    /// condition-variables of the nodes.
+    std::mutex mutex_pool_;
+
+    /// The total number of tasks which are queued.
+    std::atomic_uint32_t pending_tasks_{ 0 };
+
+    bool shutdown_{ false };
+
+    /// Used for distributing tasks without locality key which are added from a non-worker thread.
+    std::atomic_uint32_t next_node_for_external_tasks_{ 0 };
+
+    std::chrono::steady_clock::time_point time_of_creation_;
+
+    std::atomic_uint32_t active_tasks_{ 0 };
+    std::atomic_uint32_t suspended_tasks_{ 0 };
+
+    /// This mutex and condition-variable are used for waiting (on destruction) until all suspended tasks are resumed.
+    std::mutex mutex_suspended_tasks_;
+    std::condition_variable suspended_tasks_resumed_;
+    std::array<std::atomic_uint32_t, Count_of_TaskTypes> queue_length_per_task_type_;
+public:
+    /// Constructor.
+    ///
+    /// \param [in] context                 The application context.
+    /// \param      max_number_of_workers   The maximum number of workers (including the ones compensating for suspended tasks). It is
+    ///                                     clamped to the range from the concurrency of the arena to kMaxNumberOfWorkers, and zero
+    ///                                     gives the default (kDefaultMaxNumberOfWorkersPerConcurrency times the concurrency).
+    explicit TaskArenaStd(AppContext& context, std::uint32_t max_number_of_workers = 0);
+    void AddTask(TaskType task_type, const std::function<void()>& task) override;
+    void AddTask(TaskType task_type, std::uint64_t locality_key, const std::function<void()>& task) override;
+
+    void SuspendCurrentTask(const std::function<void(SuspendHandle)>& func_pass_resume_handle) override;
+    void ResumeTask(SuspendHandle resume_handle) override;
+
+    TaskArenaStatistics GetStatistics() override;
+    std::uint32_t GetConcurrency() override;
+    ~TaskArenaStd() override;
+
+    /// Gets the number of worker threads which have been created.
+    ///
+    /// \returns    The number of workers.
+    std::uint32_t GetNumberOfWorkers() const { return this->number_of_workers_.load(); }
+
+    /// Gets the index of the NUMA-node (i.e. the sub-arena) which a task with the specified locality key is routed to.
+    ///
+    /// \param  locality_key    The locality key (which must not be 'kNoLocality').
+    /// \param  number_of_nodes The number of NUMA-nodes.
+    ///
+    /// \returns    The index of the NUMA-node.
+    static std::uint32_t GetNodeIndexForLocalityKey(std::uint64_t locality_key, std::uint32_t number_of_nodes);
+private:
+    std::uint32_t DetermineNodeIndex(std::uint64_t locality_key);
+    void StartWorker(std::uint32_t node_index);
+    void WorkerThread(std::uint32_t worker_index);
+    bool TryGetTask(std::uint32_t worker_index, TaskItem& task_item);
+    bool TryGetTaskFromNode(std::uint32_t node_index, std::uint32_t first_worker_to_steal_from, TaskItem& task_item);
+    bool IsOtherNodeBacklogged(std::uint32_t node_index) const;
+    bool TryPark(NumaNode& node, std::unique_lock<std::mutex>& lock);
+    void RunTask(const TaskItem& task_item);
+    void HelpWhileSuspended(SuspendPoint& suspend_point);
+    void AddBusyTimeOfCurrentTask();
+};
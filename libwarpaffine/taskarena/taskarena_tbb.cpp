@@ -4,40 +4,176 @@
 
 #include "taskarena_tbb.h"
 #include <sstream>
+#include <stdexcept>
+#include <algorithm>
 #include <tbb/task.h>
 #include "../appcontext.h"
 
 using namespace std;
 
 TaskArenaTbb::TaskArenaTbb(AppContext& context)
-    : context_(context)
+    : context_(context),
+    task_types_in_order_of_priority_
+    {
+        // the downstream stages come first - when those tasks are done, memory is released
+        TaskType::CompressSlice,
+        TaskType::Compression,
+        TaskType::WarpAffineBrick,
+        TaskType::BrickComposition,
+        TaskType::DecompressSlice
+    }
 {
+    const auto& property_bag = context.GetCommandLineOptions().GetPropertyBagForTaskArena();
+    const auto get_max_concurrent_tasks =
+        [&](const char* key)->uint32_t
+        {
+            const int value = property_bag.GetInt32OrDefault(key, 0);
+            if (value < 0)
+            {
+                ostringstream string_stream;
+                string_stream << "Invalid value " << value << " for the task-arena parameter '" << key << "'.";
+                throw invalid_argument(string_stream.str());
+            }
+
+            return static_cast<uint32_t>(value);
+        };
+
+    this->max_concurrent_tasks_per_task_type_[static_cast<size_t>(TaskType::DecompressSlice)] = get_max_concurrent_tasks(ITaskArena::kPropertyBagKey_max_concurrent_decompress_tasks);
+    this->max_concurrent_tasks_per_task_type_[static_cast<size_t>(TaskType::BrickComposition)] = get_max_concurrent_tasks(ITaskArena::kPropertyBagKey_max_concurrent_composition_tasks);
+    this->max_concurrent_tasks_per_task_type_[static_cast<size_t>(TaskType::WarpAffineBrick)] = get_max_concurrent_tasks(ITaskArena::kPropertyBagKey_max_concurrent_warp_tasks);
+    this->max_concurrent_tasks_per_task_type_[static_cast<size_t>(TaskType::CompressSlice)] = get_max_concurrent_tasks(ITaskArena::kPropertyBagKey_max_concurrent_compress_tasks);
+    this->fifo_order_ = !property_bag.GetBoolOrDefault(ITaskArena::kPropertyBagKey_prioritize_downstream_tasks, true);
+
     this->arena.initialize();
 }
 
 void TaskArenaTbb::AddTask(TaskType task_type, const std::function<void()>& task)
 {
     ++this->queue_length;
-    this->arena.enqueue(
-        [this, task]() ->void
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_queues_);
+        this->queues_[static_cast<size_t>(task_type)].push_back(task);
+        if (this->fifo_order_)
         {
-            --this->queue_length;
-            ++this->active_tasks;
-            try
-            {
-                task();
-            }
-            catch (exception& exception)
-            {
-                ostringstream text;
-                text << "Task crashed: " << exception.what() << ".";
-                this->context_.FatalError(text.str());
-            }
+            this->fifo_queue_.push_back(task_type);
+        }
+    }
+
+    this->EnqueueDispatch();
+}
+
+void TaskArenaTbb::AddTask(TaskType task_type, std::uint64_t locality_key, const std::function<void()>& task)
+{
+    // NUMA-nodes are not modeled by this implementation, so the locality key is ignored
+    this->AddTask(task_type, task);
+}
 
-            --this->active_tasks;
+void TaskArenaTbb::EnqueueDispatch()
+{
+    this->arena.enqueue(
+        [this]() ->void
+        {
+            this->Dispatch();
         });
 }
 
+void TaskArenaTbb::Dispatch()
+{
+    TaskType task_type;
+    function<void()> task;
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_queues_);
+        if (!this->TryDequeueTask(task_type, task))
+        {
+            // All tasks in the queues are of a type which has reached its concurrency limit - so, the dispatch is
+            //  deferred, and it will be re-issued when a task completes.
+            ++this->deferred_dispatches_;
+            return;
+        }
+
+        ++this->active_tasks_per_task_type_[static_cast<size_t>(task_type)];
+    }
+
+    this->RunTask(task);
+
+    bool redispatch = false;
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_queues_);
+        --this->active_tasks_per_task_type_[static_cast<size_t>(task_type)];
+        if (this->deferred_dispatches_ > 0)
+        {
+            --this->deferred_dispatches_;
+            redispatch = true;
+        }
+    }
+
+    if (redispatch)
+    {
+        this->EnqueueDispatch();
+    }
+}
+
+void TaskArenaTbb::RunTask(const std::function<void()>& task)
+{
+    --this->queue_length;
+    ++this->active_tasks;
+    try
+    {
+        task();
+    }
+    catch (exception& exception)
+    {
+        ostringstream text;
+        text << "Task crashed: " << exception.what() << ".";
+        this->context_.FatalError(text.str());
+    }
+
+    --this->active_tasks;
+}
+
+bool TaskArenaTbb::TryDequeueTask(TaskType& task_type, std::function<void()>& task)
+{
+    // note: this method must be called with the mutex held
+    if (this->fifo_order_)
+    {
+        const auto iterator = find_if(
+            this->fifo_queue_.begin(),
+            this->fifo_queue_.end(),
+            [this](TaskType type)->bool { return this->CanRunTaskOfType(type); });
+        if (iterator == this->fifo_queue_.end())
+        {
+            return false;
+        }
+
+        task_type = *iterator;
+        this->fifo_queue_.erase(iterator);
+    }
+    else
+    {
+        const auto iterator = find_if(
+            this->task_types_in_order_of_priority_.cbegin(),
+            this->task_types_in_order_of_priority_.cend(),
+            [this](TaskType type)->bool { return !this->queues_[static_cast<size_t>(type)].empty() && this->CanRunTaskOfType(type); });
+        if (iterator == this->task_types_in_order_of_priority_.cend())
+        {
+            return false;
+        }
+
+        task_type = *iterator;
+    }
+
+    auto& queue = this->queues_[static_cast<size_t>(task_type)];
+    task = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+bool TaskArenaTbb::CanRunTaskOfType(TaskType task_type) const
+{
+    const uint32_t max_concurrent_tasks = this->max_concurrent_tasks_per_task_type_[static_cast<size_t>(task_type)];
+    return max_concurrent_tasks == 0 || this->active_tasks_per_task_type_[static_cast<size_t>(task_type)] < max_concurrent_tasks;
+}
+
 void TaskArenaTbb::SuspendCurrentTask(const std::function<void(SuspendHandle)>& func_pass_resume_handle)
 {
     ++this->suspended_tasks;
@@ -64,5 +200,18 @@ TaskArenaStatistics TaskArenaTbb::GetStatistics()
     statistics.queue_length = this->queue_length.load();
     statistics.active_tasks = this->active_tasks.load();
     statistics.suspended_tasks = this->suspended_tasks.load();
+    {
+        std::lock_guard<std::mutex> lck(this->mutex_queues_);
+        for (size_t i = 0; i < Count_of_TaskTypes; ++i)
+        {
+            statistics.queue_length_per_task_type[i] = static_cast<uint32_t>(this->queues_[i].size());
+        }
+    }
+
     return statistics;
 }
+
+std::uint32_t TaskArenaTbb::GetConcurrency()
+{
+    return static_cast<uint32_t>((max)(1, this->arena.max_concurrency()));
+}
@@ -4,11 +4,19 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <deque>
+#include <mutex>
 #include <tbb/task_arena.h>
 #include "ITaskArena.h"
 
 /// Implementation of a "task arena" based on Intel TBB.
+/// The tasks are not handed to TBB directly - instead, they are put into a queue per task-type, and for each task
+/// added a "dispatcher" is enqueued with the TBB-arena. When the dispatcher executes, it picks the task from the queue
+/// with the highest priority (where the downstream stages of the pipeline are given priority, because those tasks
+/// release memory when they are done), skipping task-types which have reached their concurrency limit. If no task
+/// can be run at this point because of the concurrency limits, the dispatch is deferred until a task completes.
 class TaskArenaTbb : public ITaskArena
 {
 private:
@@ -17,13 +25,41 @@ private:
     std::atomic_uint32_t active_tasks{0};
     std::atomic_uint32_t suspended_tasks{ 0 };
     tbb::task_arena arena;
+
+    /// The mutex protecting the task-queues, the active-tasks-counters and the deferred dispatches.
+    std::mutex mutex_queues_;
+    std::array<std::deque<std::function<void()>>, Count_of_TaskTypes> queues_;
+    std::array<std::uint32_t, Count_of_TaskTypes> active_tasks_per_task_type_{};
+
+    /// The maximum number of concurrently executing tasks for each task-type (where 0 means "no limit").
+    std::array<std::uint32_t, Count_of_TaskTypes> max_concurrent_tasks_per_task_type_{};
+
+    /// The task-types in the order in which they are served (i.e. the first one has the highest priority).
+    std::array<TaskType, Count_of_TaskTypes> task_types_in_order_of_priority_;
+
+    /// Whether the tasks are executed in FIFO order (irrespective of their type).
+    bool fifo_order_{ false };
+
+    /// The FIFO order of the tasks (containing their task-types), only used if 'fifo_order_' is true.
+    std::deque<TaskType> fifo_queue_;
+
+    /// The number of dispatches which found no task they were allowed to run (because of the concurrency limits).
+    std::uint32_t deferred_dispatches_{ 0 };
 public:
     explicit TaskArenaTbb(AppContext& context);
     void AddTask(TaskType task_type, const std::function<void()>& task) override;
+    void AddTask(TaskType task_type, std::uint64_t locality_key, const std::function<void()>& task) override;
 
     void SuspendCurrentTask(const std::function<void(SuspendHandle)>& func_pass_resume_handle) override;
     void ResumeTask(SuspendHandle resume_handle) override;
 
     TaskArenaStatistics GetStatistics() override;
+    std::uint32_t GetConcurrency() override;
     ~TaskArenaTbb() override = default;
+private:
+    void EnqueueDispatch();
+    void Dispatch();
+    bool TryDequeueTask(TaskType& task_type, std::function<void()>& task);
+    bool CanRunTaskOfType(TaskType task_type) const;
+    void RunTask(const std::function<void()>& task);
 };
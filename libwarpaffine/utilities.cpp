@@ -10,11 +10,19 @@
 #include <iomanip>
 #include <cstring>
 #include <regex>
+#include <algorithm>
 
 #if LIBWARPAFFINE_INTELPERFORMANCEPRIMITIVES_AVAILABLE
 #include <ipp.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WARPAFFINE_SSE2_AVAILABLE 1
+#else
+#define WARPAFFINE_SSE2_AVAILABLE 0
+#endif
+
 #if LIBWARPAFFINE_WIN32_ENVIRONMENT
 #include <Windows.h>
 #else
@@ -222,11 +230,52 @@ std::string Utilities::HashToString(const std::array<std::uint8_t, 16>& hash_cod
 }
 
 #if !LIBWARPAFFINE_INTELPERFORMANCEPRIMITIVES_AVAILABLE
+#if WARPAFFINE_SSE2_AVAILABLE
+/// Copies a line using non-temporal stores (i.e. bypassing the cache). The caller is responsible for issuing a
+/// store-fence after the last line has been copied.
+static void CopyLineNonTemporal(const uint8_t* ptr_source, uint8_t* ptr_destination, size_t line_length)
+{
+    // copy the bytes up to the first 16-byte-aligned destination address with an ordinary memcpy
+    const size_t head_length = (std::min)(line_length, (16 - (reinterpret_cast<uintptr_t>(ptr_destination) & 15)) & 15);
+    memcpy(ptr_destination, ptr_source, head_length);
+    ptr_source += head_length;
+    ptr_destination += head_length;
+    line_length -= head_length;
+
+    for (; line_length >= 16; line_length -= 16)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(ptr_destination), _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr_source)));
+        ptr_source += 16;
+        ptr_destination += 16;
+    }
+
+    memcpy(ptr_destination, ptr_source, line_length);
+}
+#endif
+
 static void CopyStrided(const void* ptr_source, uint32_t source_stride, void* ptr_destination, uint32_t destination_stride, size_t line_length, int height)
 {
     const uint8_t* ptr_source_byte = static_cast<const uint8_t*>(ptr_source);
     uint8_t* ptr_destination_byte = static_cast<uint8_t*>(ptr_destination);
 
+#if WARPAFFINE_SSE2_AVAILABLE
+    // For large copies (where the destination will not fit into the cache anyway), we use non-temporal stores, which
+    //  avoids reading the destination into the cache before overwriting it.
+    static constexpr size_t kMinimalSizeForNonTemporalCopy = 1024 * 1024;
+    if (line_length * static_cast<size_t>(height) >= kMinimalSizeForNonTemporalCopy)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            CopyLineNonTemporal(ptr_source_byte, ptr_destination_byte, line_length);
+            ptr_source_byte += source_stride;
+            ptr_destination_byte += destination_stride;
+        }
+
+        _mm_sfence();
+        return;
+    }
+#endif
+
     for (int y = 0; y < height; ++y)
     {
         memcpy(ptr_destination_byte, ptr_source_byte, line_length);
@@ -535,6 +584,34 @@ int IPropBag::GetInt32OrDefault(const std::string& key, int default_value) const
     return default_value;
 }
 
+std::string IPropBag::GetStringOrDefault(const std::string& key, const std::string& default_value) const
+{
+    Variant value;
+    if (this->TryGetValue(key, &value))
+    {
+        if (holds_alternative<string>(value))
+        {
+            return get<string>(value);
+        }
+    }
+
+    return default_value;
+}
+
+bool IPropBag::GetBoolOrDefault(const std::string& key, bool default_value) const
+{
+    Variant value;
+    if (this->TryGetValue(key, &value))
+    {
+        if (holds_alternative<bool>(value))
+        {
+            return get<bool>(value);
+        }
+    }
+
+    return default_value;
+}
+
 void PropertyBag::AddOrSet(const std::string& key, const Variant& value)
 {
     this->key_value_store_[key] = value;
@@ -692,7 +769,7 @@ void PropertyBag::AddOrSet(const std::string& key, const Variant& value)
 
         if (icasecmp(text, "false") || icasecmp(text, "off") || icasecmp(text, "0"))
         {
-            variant.emplace<bool>(true);
+            variant.emplace<bool>(false);
             return true;
         }
 
@@ -748,3 +825,73 @@ void PropertyBag::AddOrSet(const std::string& key, const Variant& value)
         return false;
     }
 }
+
+//-----------------------------------------------------------------------------------------
+
+void ConditionNotifier::Notify()
+{
+    // holding the lock here guarantees that a thread which has evaluated its predicate (as false) is
+    //  registered as a waiter (and not in between evaluating the predicate and starting to wait)
+    std::lock_guard<std::mutex> guard(this->mutex_);
+    for (auto* waiter : this->waiters_)
+    {
+        if (!waiter->signalled && (*waiter->predicate)())
+        {
+            waiter->signalled = true;
+            waiter->condition_variable.notify_one();
+        }
+    }
+}
+
+void ConditionNotifier::Wait(const std::function<bool()>& predicate)
+{
+    this->WaitUntil(predicate, std::nullopt);
+}
+
+bool ConditionNotifier::WaitFor(const std::function<bool()>& predicate, std::chrono::milliseconds timeout)
+{
+    return this->WaitUntil(predicate, std::chrono::steady_clock::now() + timeout);
+}
+
+bool ConditionNotifier::WaitUntil(const std::function<bool()>& predicate, const std::optional<std::chrono::steady_clock::time_point>& deadline)
+{
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    if (predicate())
+    {
+        return true;
+    }
+
+    Waiter waiter;
+    waiter.predicate = &predicate;
+    const auto iterator = this->waiters_.insert(this->waiters_.end(), &waiter);
+    bool result;
+    for (;;)
+    {
+        const auto is_signalled = [&waiter]()->bool { return waiter.signalled; };
+        if (deadline.has_value())
+        {
+            if (!waiter.condition_variable.wait_until(lock, deadline.value(), is_signalled))
+            {
+                result = predicate();
+                break;
+            }
+        }
+        else
+        {
+            waiter.condition_variable.wait(lock, is_signalled);
+        }
+
+        // the predicate was true when we were signalled, but another thread may have changed the state in
+        //  the meantime (e.g. allocated the memory which was released), so we have to check again
+        if (predicate())
+        {
+            result = true;
+            break;
+        }
+
+        waiter.signalled = false;
+    }
+
+    this->waiters_.erase(iterator);
+    return result;
+}
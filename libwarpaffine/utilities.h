@@ -11,6 +11,11 @@
 #include <vector>
 #include <array>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <optional>
+#include <chrono>
 #include "cmdlineoptions_enums.h"
 #include "operationtype.h"
 #include "inc_libCZI.h"
@@ -137,6 +142,8 @@ public:
     virtual ~IPropBag() = default;
 
     int GetInt32OrDefault(const std::string& key, int default_value) const;
+    std::string GetStringOrDefault(const std::string& key, const std::string& default_value) const;
+    bool GetBoolOrDefault(const std::string& key, bool default_value) const;
 };
 
 class PropertyBag : public IPropBag
@@ -171,3 +178,41 @@ private:
     static bool icasecmp(const std::string& l, const std::string& r);
     static bool TryParseInt32(const std::string& text, int* value);
 };
+
+/// This class allows to wait for a condition (given as a predicate) to become true. The parties which change
+/// the state the predicate depends on are to call Notify afterwards. The predicates of the waiting threads are
+/// evaluated by the notifying thread, and only the threads whose predicate is true are woken up - so that e.g.
+/// releasing a small amount of memory does not wake up all threads waiting for memory ("thundering herd").
+/// The predicate is evaluated with an internal lock held (by the waiting thread or by a notifying thread), so it
+/// must not call into Notify, and it should be cheap (e.g. reading some atomics).
+class ConditionNotifier
+{
+private:
+    struct Waiter
+    {
+        const std::function<bool()>* predicate;
+        std::condition_variable condition_variable;
+        bool signalled{ false };
+    };
+
+    std::mutex mutex_;
+    std::list<Waiter*> waiters_;
+public:
+    /// Evaluates the predicates of the waiting threads, and wakes up those threads whose predicate is true.
+    void Notify();
+
+    /// Blocks until the specified predicate is true.
+    ///
+    /// \param  predicate   The predicate.
+    void Wait(const std::function<bool()>& predicate);
+
+    /// Blocks until the specified predicate is true or the timeout has elapsed.
+    ///
+    /// \param  predicate   The predicate.
+    /// \param  timeout     The timeout.
+    ///
+    /// \returns    The value of the predicate (at the time of return).
+    bool WaitFor(const std::function<bool()>& predicate, std::chrono::milliseconds timeout);
+private:
+    bool WaitUntil(const std::function<bool()>& predicate, const std::optional<std::chrono::steady_clock::time_point>& deadline);
+};
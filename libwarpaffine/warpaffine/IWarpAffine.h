@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include <Eigen/Eigen>
 #include "../geotypes.h"
 #include "../brick.h"
@@ -34,6 +35,24 @@ public:
         const Brick& source_brick,
         const Brick& destination_brick) = 0;
 
+    /// Executes the "affine-warp-transformation" (in the same way as 'Execute'), and additionally reports for each z-slice of the
+    /// destination brick whether it is known to be "all zero" - i.e. no pixel of the slice maps into the source brick, so the
+    /// slice has been zero-filled entirely. This information is intended to be determined cheaply (as a by-product of the operation),
+    /// so "false" does not mean that the slice has non-zero content. The default implementation reports "false" for all slices.
+    /// \param  transformation              The transformation matrix.
+    /// \param  destination_brick_position  The position of the destination (in the coordinate system with the edge of the source brick at the origin).
+    /// \param  interpolation               The interpolation mode.
+    /// \param  source_brick                The source brick.
+    /// \param  destination_brick           The destination brick.
+    /// \param [out] is_slice_all_zero      For each z-slice of the destination brick, whether it is known to be all zero.
+    virtual void ExecuteAndReportAllZeroSlices(
+        const Eigen::Matrix4d& transformation,
+        const IntPos3& destination_brick_position,
+        Interpolation interpolation,
+        const Brick& source_brick,
+        const Brick& destination_brick,
+        std::vector<bool>& is_slice_all_zero);
+
     virtual ~IWarpAffine() = default;
 };
 
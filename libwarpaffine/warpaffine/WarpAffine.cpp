@@ -12,6 +12,18 @@
 
 using namespace std;
 
+void IWarpAffine::ExecuteAndReportAllZeroSlices(
+    const Eigen::Matrix4d& transformation,
+    const IntPos3& destination_brick_position,
+    Interpolation interpolation,
+    const Brick& source_brick,
+    const Brick& destination_brick,
+    std::vector<bool>& is_slice_all_zero)
+{
+    this->Execute(transformation, destination_brick_position, interpolation, source_brick, destination_brick);
+    is_slice_all_zero.assign(destination_brick.info.depth, false);
+}
+
 std::shared_ptr<IWarpAffine> CreateWarpAffine(WarpAffineImplementation implementation)
 {
     switch (implementation)
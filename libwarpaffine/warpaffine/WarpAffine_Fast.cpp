@@ -68,6 +68,7 @@
 #include <limits>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 using namespace std;
 using namespace libCZI;
@@ -268,7 +269,8 @@ namespace
     void FastNearestNeighborWarp(
         const Brick& source_brick,
         const Brick& destination_brick,
-        const IncrementalTransform& tf)
+        const IncrementalTransform& tf,
+        vector<bool>* is_slice_all_zero)
     {
         const uint32_t dst_w = destination_brick.info.width;
         const uint32_t dst_h = destination_brick.info.height;
@@ -291,6 +293,7 @@ namespace
             const double z_contrib_x = tf.dz_src_x * z + tf.base_src_x;
             const double z_contrib_y = tf.dz_src_y * z + tf.base_src_y;
             const double z_contrib_z = tf.dz_src_z * z + tf.base_src_z;
+            bool all_zero = true;
 
             for (uint32_t y = 0; y < dst_h; ++y)
             {
@@ -310,6 +313,7 @@ namespace
                     tf.dx_src_x, tf.dx_src_y, tf.dx_src_z,
                     src_w, src_h, src_d, dst_w,
                     x_in_start, x_in_end);
+                all_zero = all_zero && x_in_end <= x_in_start;
 
                 // Zone 1: [0, x_in_start) — outside, zero-fill.
                 if (x_in_start > 0)
@@ -348,6 +352,11 @@ namespace
                     memset(dst_ptr + x_in_end, 0, static_cast<size_t>(dst_w - x_in_end) * sizeof(t));
                 }
             }
+
+            if (is_slice_all_zero != nullptr)
+            {
+                (*is_slice_all_zero)[z] = all_zero;
+            }
         }
     }
 
@@ -845,7 +854,8 @@ namespace
     void FastTriLinearWarp(
         const Brick& source_brick,
         const Brick& destination_brick,
-        const IncrementalTransform& tf)
+        const IncrementalTransform& tf,
+        vector<bool>* is_slice_all_zero)
     {
         const uint32_t dst_w = destination_brick.info.width;
         const uint32_t dst_h = destination_brick.info.height;
@@ -870,6 +880,9 @@ namespace
             const double z_contrib_y = tf.dz_src_y * z + tf.base_src_y;
             const double z_contrib_z = tf.dz_src_z * z + tf.base_src_z;
 
+            // The slice is "all zero" if on all its scanlines there are only the outside zones (1 and 5).
+            bool all_zero = true;
+
             for (uint32_t y = 0; y < dst_h; ++y)
             {
                 // Source position at x=0 for this scanline (the "scanline base").
@@ -890,6 +903,7 @@ namespace
                     tf.dx_src_x, tf.dx_src_y, tf.dx_src_z,
                     src_w, src_h, src_d, dst_w,
                     x_ext_start, x_ext_end, x_in_start, x_in_end);
+                all_zero = all_zero && x_ext_end <= x_ext_start;
 
                 // Zone 1: [0, x_ext_start) — outside, zero-fill.
                 // All supported pixel types (uint8_t, uint16_t, float) represent zero
@@ -957,6 +971,11 @@ namespace
                     memset(dst_ptr + x_ext_end, 0, static_cast<size_t>(dst_w - x_ext_end) * sizeof(t));
                 }
             }
+
+            if (is_slice_all_zero != nullptr)
+            {
+                (*is_slice_all_zero)[z] = all_zero;
+            }
         }
     }
 
@@ -970,18 +989,19 @@ namespace
     void DoFastNearestNeighbor(
         const Brick& source_brick,
         const Brick& destination_brick,
-        const IncrementalTransform& tf)
+        const IncrementalTransform& tf,
+        vector<bool>* is_slice_all_zero)
     {
         switch (source_brick.info.pixelType)
         {
         case PixelType::Gray16:
-            FastNearestNeighborWarp<uint16_t>(source_brick, destination_brick, tf);
+            FastNearestNeighborWarp<uint16_t>(source_brick, destination_brick, tf, is_slice_all_zero);
             break;
         case PixelType::Gray8:
-            FastNearestNeighborWarp<uint8_t>(source_brick, destination_brick, tf);
+            FastNearestNeighborWarp<uint8_t>(source_brick, destination_brick, tf, is_slice_all_zero);
             break;
         case PixelType::Gray32Float:
-            FastNearestNeighborWarp<float>(source_brick, destination_brick, tf);
+            FastNearestNeighborWarp<float>(source_brick, destination_brick, tf, is_slice_all_zero);
             break;
         default:
         {
@@ -996,18 +1016,19 @@ namespace
     void DoFastLinearInterpolation(
         const Brick& source_brick,
         const Brick& destination_brick,
-        const IncrementalTransform& tf)
+        const IncrementalTransform& tf,
+        vector<bool>* is_slice_all_zero)
     {
         switch (source_brick.info.pixelType)
         {
         case PixelType::Gray16:
-            FastTriLinearWarp<uint16_t>(source_brick, destination_brick, tf);
+            FastTriLinearWarp<uint16_t>(source_brick, destination_brick, tf, is_slice_all_zero);
             break;
         case PixelType::Gray8:
-            FastTriLinearWarp<uint8_t>(source_brick, destination_brick, tf);
+            FastTriLinearWarp<uint8_t>(source_brick, destination_brick, tf, is_slice_all_zero);
             break;
         case PixelType::Gray32Float:
-            FastTriLinearWarp<float>(source_brick, destination_brick, tf);
+            FastTriLinearWarp<float>(source_brick, destination_brick, tf, is_slice_all_zero);
             break;
         default:
         {
@@ -1029,12 +1050,25 @@ void WarpAffine_Fast::Execute(
     return WarpAffine_Fast::ExecuteFunction(transformation, destination_brick_position, interpolation, source_brick, destination_brick);
 }
 
+void WarpAffine_Fast::ExecuteAndReportAllZeroSlices(
+    const Eigen::Matrix4d& transformation,
+    const IntPos3& destination_brick_position,
+    Interpolation interpolation,
+    const Brick& source_brick,
+    const Brick& destination_brick,
+    std::vector<bool>& is_slice_all_zero)
+{
+    is_slice_all_zero.assign(destination_brick.info.depth, false);
+    WarpAffine_Fast::ExecuteFunction(transformation, destination_brick_position, interpolation, source_brick, destination_brick, &is_slice_all_zero);
+}
+
 /*static*/void WarpAffine_Fast::ExecuteFunction(
     const Eigen::Matrix4d& transformation,
     const IntPos3& destination_brick_position,
     Interpolation interpolation,
     const Brick& source_brick,
-    const Brick& destination_brick)
+    const Brick& destination_brick,
+    std::vector<bool>* is_slice_all_zero)
 {
     // The source brick sits with its corner at the origin in a continuous coordinate system.
     // The caller supplies a 'transformation' that maps source coordinates to a global frame,
@@ -1062,10 +1096,10 @@ void WarpAffine_Fast::Execute(
     switch (interpolation)
     {
     case Interpolation::kNearestNeighbor:
-        DoFastNearestNeighbor(source_brick, destination_brick, tf);
+        DoFastNearestNeighbor(source_brick, destination_brick, tf, is_slice_all_zero);
         break;
     case Interpolation::kBilinear:
-        DoFastLinearInterpolation(source_brick, destination_brick, tf);
+        DoFastLinearInterpolation(source_brick, destination_brick, tf, is_slice_all_zero);
         break;
     default:
         throw invalid_argument("Only nearest-neighbor and linear interpolation are supported.");
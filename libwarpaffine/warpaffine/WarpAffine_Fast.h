@@ -17,10 +17,21 @@ public:
         const Brick& source_brick,
         const Brick& destination_brick) override;
 
+    /// @copydoc IWarpAffine::ExecuteAndReportAllZeroSlices
+    /// A slice is reported as "all zero" if all its scanlines consist only of the zero-filled outside zones.
+    void ExecuteAndReportAllZeroSlices(
+        const Eigen::Matrix4d& transformation,
+        const IntPos3& destination_brick_position,
+        Interpolation interpolation,
+        const Brick& source_brick,
+        const Brick& destination_brick,
+        std::vector<bool>& is_slice_all_zero) override;
+
     static void ExecuteFunction(
         const Eigen::Matrix4d& transformation,
         const IntPos3& destination_brick_position,
         Interpolation interpolation,
         const Brick& source_brick,
-        const Brick& destination_brick);
+        const Brick& destination_brick,
+        std::vector<bool>* is_slice_all_zero = nullptr);
 };
@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/adaptive_compression_level.h"
+
+#include <chrono>
+#include <limits>
+
+using namespace std;
+
+namespace
+{
+    /// The budget of the write-stage used in the tests.
+    constexpr uint64_t kWriteBudget = 1000;
+
+    AdaptiveCompressionLevel::PipelineState MakeState(uint64_t write_slices_queue_size, uint32_t compression_tasks_in_flight)
+    {
+        AdaptiveCompressionLevel::PipelineState state;
+        state.write_slices_queue_size = write_slices_queue_size;
+        state.write_budget = kWriteBudget;
+        state.compression_tasks_in_flight = compression_tasks_in_flight;
+        return state;
+    }
+}
+
+TEST(AdaptiveCompressionLevel, DetermineVerdict)
+{
+    constexpr uint32_t kNumberOfWorkerThreads = 8;
+
+    // the writer's queue fills more than half of the budget and is growing, and the data is compressible
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(600, 2), 500, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kIoBound);
+
+    // ...but not if the data is (almost) incompressible, or if the compression ratio is not yet known
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(600, 2), 500, 1.01, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kBalanced);
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(600, 2), 500, numeric_limits<double>::quiet_NaN(), kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kBalanced);
+
+    // ...and not if the writer's queue is shrinking, or if it fills less than half of the budget
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(600, 2), 700, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kBalanced);
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(400, 2), 300, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kBalanced);
+
+    // compression tasks are piling up, and the writer is starving
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(100, 40), 100, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kCpuBound);
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(0, 40), 0, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kCpuBound);
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(MakeState(200, 40), 200, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kBalanced);
+
+    // an empty queue is never considered long (even if there is no budget)
+    AdaptiveCompressionLevel::PipelineState state_without_budget = MakeState(0, 2);
+    state_without_budget.write_budget = 0;
+    EXPECT_EQ(AdaptiveCompressionLevel::DetermineVerdict(state_without_budget, 0, 2.0, kNumberOfWorkerThreads), AdaptiveCompressionLevel::Verdict::kBalanced);
+}
+
+TEST(AdaptiveCompressionLevel, LevelIsChangedWithinBoundsAfterConsistentVerdicts)
+{
+    constexpr auto kEvaluationInterval = chrono::seconds(1);
+    AdaptiveCompressionLevel adaptive_compression_level(1, 3, 2, 4, kEvaluationInterval);
+    EXPECT_EQ(adaptive_compression_level.GetLevel(), 2);
+    auto now = chrono::steady_clock::now();
+
+    // within the evaluation interval nothing happens
+    EXPECT_FALSE(adaptive_compression_level.TryUpdate(MakeState(10, 100), now, nullptr));
+
+    // CPU-bound: the first verdict does not change the level yet, the second one does
+    now += kEvaluationInterval;
+    EXPECT_FALSE(adaptive_compression_level.TryUpdate(MakeState(10, 100), now, nullptr));
+    now += kEvaluationInterval;
+    EXPECT_TRUE(adaptive_compression_level.TryUpdate(MakeState(10, 100), now, nullptr));
+    EXPECT_EQ(adaptive_compression_level.GetLevel(), 1);
+
+    // the level does not go below the minimum
+    for (int i = 0; i < 4; ++i)
+    {
+        now += kEvaluationInterval;
+        EXPECT_FALSE(adaptive_compression_level.TryUpdate(MakeState(10, 100), now, nullptr));
+    }
+
+    EXPECT_EQ(adaptive_compression_level.GetLevel(), 1);
+
+    // I/O-bound with compressible data: the level goes up to the maximum
+    for (int i = 0; i < 10; ++i)
+    {
+        adaptive_compression_level.AddCompressionResult(1000, 500);
+        now += kEvaluationInterval;
+        double compression_ratio = 0;
+        if (adaptive_compression_level.TryUpdate(MakeState(kWriteBudget, 0), now, &compression_ratio))
+        {
+            EXPECT_DOUBLE_EQ(compression_ratio, 2.0);
+        }
+    }
+
+    EXPECT_EQ(adaptive_compression_level.GetLevel(), 3);
+    EXPECT_EQ(adaptive_compression_level.GetNumberOfLevelChanges(), 3u);
+}
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/appcontext.h"
+#include "../libwarpaffine/BrickAllocator.h"
+
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+TEST(BrickAllocator, QueuedRequestsAreGrantedInFifoOrder)
+{
+    AppContext context;
+    BrickAllocator allocator(context);
+    allocator.SetMaximumMemoryLimitForMemoryType(BrickAllocator::MemoryType::DestinationBrick, 101);
+
+    auto memory = allocator.TryAllocateInOrder(BrickAllocator::MemoryType::DestinationBrick, 100, nullptr, nullptr);
+    ASSERT_TRUE(memory);
+
+    vector<int> order_of_grants;
+    vector<shared_ptr<void>> granted_memory;
+    for (int i = 0; i < 3; ++i)
+    {
+        allocator.EnqueueAllocationRequest(
+            BrickAllocator::MemoryType::DestinationBrick,
+            100,
+            nullptr,
+            [&, i](shared_ptr<void> memory, shared_ptr<void>)->void
+            {
+                order_of_grants.push_back(i);
+                granted_memory.push_back(memory);
+            });
+    }
+
+    EXPECT_TRUE(order_of_grants.empty());
+    EXPECT_EQ(allocator.GetWaitQueueStatistics().queue_length, 3);
+
+    // only one request fits at a time, so releasing the memory must only grant the request at the head of the queue
+    memory.reset();
+    ASSERT_EQ(order_of_grants.size(), 1);
+    EXPECT_EQ(order_of_grants[0], 0);
+
+    granted_memory[0].reset();
+    granted_memory[1].reset();
+    ASSERT_EQ(order_of_grants.size(), 3);
+    EXPECT_EQ(order_of_grants[1], 1);
+    EXPECT_EQ(order_of_grants[2], 2);
+
+    const auto statistics = allocator.GetWaitQueueStatistics();
+    EXPECT_EQ(statistics.queue_length, 0);
+    EXPECT_EQ(statistics.requests_granted_after_waiting, 3);
+    EXPECT_GE(statistics.max_wait_time_in_seconds, statistics.average_wait_time_in_seconds);
+}
+
+TEST(BrickAllocator, NewRequestDoesNotOvertakeWaitingRequests)
+{
+    AppContext context;
+    BrickAllocator allocator(context);
+    allocator.SetMaximumMemoryLimitForMemoryType(BrickAllocator::MemoryType::DestinationBrick, 101);
+
+    auto memory = allocator.TryAllocateInOrder(BrickAllocator::MemoryType::DestinationBrick, 60, nullptr, nullptr);
+    ASSERT_TRUE(memory);
+
+    shared_ptr<void> granted_memory;
+    allocator.EnqueueAllocationRequest(
+        BrickAllocator::MemoryType::DestinationBrick,
+        60,
+        nullptr,
+        [&](shared_ptr<void> memory, shared_ptr<void>)->void { granted_memory = memory; });
+
+    // there would be memory for this small request, but it must not overtake the request which is waiting
+    EXPECT_FALSE(allocator.TryAllocateInOrder(BrickAllocator::MemoryType::DestinationBrick, 10, nullptr, nullptr));
+
+    memory.reset();
+    EXPECT_TRUE(granted_memory);
+    EXPECT_TRUE(allocator.TryAllocateInOrder(BrickAllocator::MemoryType::DestinationBrick, 10, nullptr, nullptr));
+}
+
+TEST(BrickAllocator, QueuedRequestIsOnlyGrantedWhenAdmitted)
+{
+    AppContext context;
+    BrickAllocator allocator(context);
+
+    bool admit = false;
+    int number_of_admission_calls = 0;
+    shared_ptr<void> granted_memory;
+    shared_ptr<void> granted_token;
+    allocator.EnqueueAllocationRequest(
+        BrickAllocator::MemoryType::DestinationBrick,
+        100,
+        [&]()->shared_ptr<void>
+        {
+            ++number_of_admission_calls;
+            return admit ? make_shared<int>(1) : nullptr;
+        },
+        [&](shared_ptr<void> memory, shared_ptr<void> token)->void
+        {
+            granted_memory = memory;
+            granted_token = token;
+        });
+
+    EXPECT_EQ(number_of_admission_calls, 1);
+    EXPECT_FALSE(granted_memory);
+
+    admit = true;
+    allocator.ServiceAllocationWaitQueue();
+    EXPECT_EQ(number_of_admission_calls, 2);
+    EXPECT_TRUE(granted_memory);
+    EXPECT_TRUE(granted_token);
+    EXPECT_EQ(allocator.GetWaitQueueStatistics().queue_length, 0);
+}
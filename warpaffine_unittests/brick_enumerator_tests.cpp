@@ -206,3 +206,54 @@ TEST(BrickEnumerator, TestWithMaxT2MaxC2AndTwoRegions)
     b = brick_enumerator.GetNextBrickCoordinate(coordinate, tile_identifier, rectangle);
     EXPECT_FALSE(b);
 }
+
+TEST(BrickEnumerator, TestOrderedByFileOffsetWithMaxC2MaxT2AndTwoRegions)
+{
+    // the bricks of the tile with m-index 1 are reported with the lower file offsets, and within a tile,
+    //  the file offset decreases with T - so we expect the order M1T1, M1T0, M0T1, M0T0 (and C0 before C1,
+    //  since the file offset does not depend on C)
+    BrickEnumerator brick_enumerator;
+    brick_enumerator.ResetOrderedByFileOffset(
+        2,
+        2,
+        TileIdentifierToRectangleMap{ {{ nullopt, 0}, { 0, 0, 10, 11}}, {{ nullopt, 1}, { 1, 1, 20, 21}} },
+        [](const CDimCoordinate& coordinate, const TileIdentifier& tile_identifier)->uint64_t
+        {
+            int t;
+            coordinate.TryGetPosition(DimensionIndex::T, &t);
+            return (tile_identifier.m_index.value() == 0 ? 1000 : 0) + (t == 0 ? 100 : 0);
+        });
+
+    libCZI::CDimCoordinate coordinate;
+    TileIdentifier tile_identifier;
+    libCZI::IntRect rectangle;
+
+    static const struct
+    {
+        const char* coordinate;
+        int m_index;
+    } expected[] =
+    {
+        { "C0T1", 1 }, { "C1T1", 1 }, { "C0T0", 1 }, { "C1T0", 1 },
+        { "C0T1", 0 }, { "C1T1", 0 }, { "C0T0", 0 }, { "C1T0", 0 },
+    };
+
+    for (const auto& item : expected)
+    {
+        const bool b = brick_enumerator.GetNextBrickCoordinate(coordinate, tile_identifier, rectangle);
+        EXPECT_TRUE(b);
+        EXPECT_TRUE(CompareDimCoordinateForEquality(coordinate, CDimCoordinate::Parse(item.coordinate)));
+        EXPECT_TRUE(!tile_identifier.IsSceneIndexValid() && tile_identifier.IsMIndexValid() && tile_identifier.m_index.value() == item.m_index);
+        if (item.m_index == 0)
+        {
+            EXPECT_TRUE(rectangle.x == 0 && rectangle.y == 0 && rectangle.w == 10 && rectangle.h == 11);
+        }
+        else
+        {
+            EXPECT_TRUE(rectangle.x == 1 && rectangle.y == 1 && rectangle.w == 20 && rectangle.h == 21);
+        }
+    }
+
+    const bool b = brick_enumerator.GetNextBrickCoordinate(coordinate, tile_identifier, rectangle);
+    EXPECT_FALSE(b);
+}
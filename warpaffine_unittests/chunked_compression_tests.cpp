@@ -0,0 +1,243 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/appcontext.h"
+#include "../libwarpaffine/chunked_compression.h"
+#include "mem_output_stream.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace libCZI;
+
+namespace
+{
+    vector<uint8_t> CompressWithZstd0(const uint8_t* data, uint32_t size)
+    {
+        size_t size_compressed = ZstdCompress::CalculateMaxCompressedSizeZStd0(size, 1, PixelType::Gray8);
+        vector<uint8_t> compressed(size_compressed);
+        const bool b = ZstdCompress::CompressZStd0(size, 1, size, PixelType::Gray8, data, compressed.data(), size_compressed, nullptr);
+        EXPECT_TRUE(b);
+        compressed.resize(size_compressed);
+        return compressed;
+    }
+
+    vector<uint8_t> CompressChunked(ChunkedZstdCompression& chunked_compression)
+    {
+        for (size_t i = 0; i < chunked_compression.GetNumberOfChunks(); ++i)
+        {
+            chunked_compression.CompressChunk(i);
+        }
+
+        vector<uint8_t> result(chunked_compression.GetSizeOfResult());
+        chunked_compression.CopyResult(result.data());
+        return result;
+    }
+
+    /// Puts the specified compressed data as a subblock into a CZI-document (in memory), reads it back and decodes it with
+    /// libCZI - and compares the result with the specified bitmap.
+    void CheckDecodedResult(CompressionMode compression_mode, const vector<uint8_t>& compressed, PixelType pixel_type, uint32_t width, uint32_t height, uint32_t stride, const void* expected_bitmap)
+    {
+        auto writer = CreateCZIWriter();
+        auto out_stream = make_shared<CMemOutputStream>(0);
+        writer->Create(out_stream, make_shared<CCziWriterInfo>());
+        AddSubBlockInfoMemPtr add_subblock_info;
+        add_subblock_info.Clear();
+        add_subblock_info.coordinate = CDimCoordinate::Parse("C0");
+        add_subblock_info.mIndexValid = true;
+        add_subblock_info.mIndex = 0;
+        add_subblock_info.x = 0;
+        add_subblock_info.y = 0;
+        add_subblock_info.logicalWidth = width;
+        add_subblock_info.logicalHeight = height;
+        add_subblock_info.physicalWidth = width;
+        add_subblock_info.physicalHeight = height;
+        add_subblock_info.PixelType = pixel_type;
+        add_subblock_info.SetCompressionMode(compression_mode);
+        add_subblock_info.ptrData = compressed.data();
+        add_subblock_info.dataSize = static_cast<uint32_t>(compressed.size());
+        writer->SyncAddSubBlock(add_subblock_info);
+
+        PrepareMetadataInfo prepare_metadata_info;
+        const auto metadata_builder = writer->GetPreparedMetadata(prepare_metadata_info);
+        const auto& metadata_xml = metadata_builder->GetXml();
+        WriteMetadataInfo write_metadata_info;
+        write_metadata_info.szMetadata = metadata_xml.c_str();
+        write_metadata_info.szMetadataSize = metadata_xml.size() + 1;
+        write_metadata_info.ptrAttachment = nullptr;
+        write_metadata_info.attachmentSize = 0;
+        writer->SyncWriteMetadata(write_metadata_info);
+        writer->Close();
+        writer.reset();
+
+        size_t size_of_czi_data;
+        auto czi_data = out_stream->GetCopy(&size_of_czi_data);
+        auto reader = CreateCZIReader();
+        reader->Open(CreateStreamFromMemory(czi_data, size_of_czi_data));
+        const auto sub_block = reader->ReadSubBlock(0);
+        ASSERT_TRUE(sub_block);
+        ASSERT_EQ(sub_block->GetSubBlockInfo().GetCompressionMode(), compression_mode);
+        const auto bitmap = sub_block->CreateBitmap();
+        ASSERT_TRUE(bitmap);
+        ASSERT_EQ(bitmap->GetPixelType(), pixel_type);
+        ASSERT_EQ(bitmap->GetWidth(), width);
+        ASSERT_EQ(bitmap->GetHeight(), height);
+
+        const size_t bytes_per_line = static_cast<size_t>(width) * Utils::GetBytesPerPixel(pixel_type);
+        ScopedBitmapLockerSP lock_bitmap{ bitmap };
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            EXPECT_EQ(
+                memcmp(
+                    static_cast<const uint8_t*>(lock_bitmap.ptrDataRoi) + static_cast<size_t>(y) * lock_bitmap.stride,
+                    static_cast<const uint8_t*>(expected_bitmap) + static_cast<size_t>(y) * stride,
+                    bytes_per_line),
+                0) << "line " << y << " differs";
+        }
+    }
+}
+
+TEST(ChunkedZstdCompression, CalculateNumberOfChunks)
+{
+    EXPECT_EQ(ChunkedZstdCompression::CalculateNumberOfChunks(100, 100), 1);
+    EXPECT_EQ(ChunkedZstdCompression::CalculateNumberOfChunks(101, 100), 2);
+    EXPECT_EQ(ChunkedZstdCompression::CalculateNumberOfChunks(250, 50), 5);
+}
+
+TEST(ChunkedZstdCompression, Zstd0_ResultIsConcatenationOfIndependentlyCompressedChunks)
+{
+    // a Gray8-bitmap of 64x10 pixels with a stride of 70 bytes, compressed in chunks of 200 bytes
+    constexpr uint32_t kWidth = 64;
+    constexpr uint32_t kHeight = 10;
+    constexpr uint32_t kStride = 70;
+    vector<uint8_t> bitmap(kStride * kHeight);
+    vector<uint8_t> payload;
+    for (uint32_t y = 0; y < kHeight; ++y)
+    {
+        for (uint32_t x = 0; x < kWidth; ++x)
+        {
+            bitmap[y * kStride + x] = static_cast<uint8_t>(x * y);
+            payload.push_back(bitmap[y * kStride + x]);
+        }
+    }
+
+    AppContext context;
+    ChunkedZstdCompression chunked_compression(context.GetAllocator(), CompressionMode::Zstd0, PixelType::Gray8, kWidth, kHeight, kStride, bitmap.data(), nullptr, 200);
+    ASSERT_EQ(chunked_compression.GetNumberOfChunks(), 4);
+    const auto result = CompressChunked(chunked_compression);
+
+    vector<uint8_t> expected_result;
+    for (uint32_t offset = 0; offset < payload.size(); offset += 200)
+    {
+        const auto compressed_chunk = CompressWithZstd0(payload.data() + offset, min(200u, static_cast<uint32_t>(payload.size() - offset)));
+        expected_result.insert(expected_result.end(), compressed_chunk.cbegin(), compressed_chunk.cend());
+    }
+
+    EXPECT_EQ(result, expected_result);
+}
+
+TEST(ChunkedZstdCompression, Zstd1WithLoHiBytePacking_HeaderIsFollowedByCompressedChunksOfPackedData)
+{
+    // a Gray16-bitmap of 32x4 pixels, compressed in chunks of 100 bytes - with lo-hi-byte packing, the payload
+    //  consists of all the low-bytes followed by all the high-bytes
+    constexpr uint32_t kWidth = 32;
+    constexpr uint32_t kHeight = 4;
+    vector<uint16_t> bitmap(kWidth * kHeight);
+    vector<uint8_t> payload(bitmap.size() * 2);
+    for (size_t i = 0; i < bitmap.size(); ++i)
+    {
+        bitmap[i] = static_cast<uint16_t>(i * 263);
+        payload[i] = static_cast<uint8_t>(bitmap[i] & 0xff);
+        payload[bitmap.size() + i] = static_cast<uint8_t>(bitmap[i] >> 8);
+    }
+
+    CompressParametersOnMap parameters;
+    parameters.map[static_cast<int>(CompressionParameterKey::ZSTD_PREPROCESS_DOLOHIBYTEPACKING)] = CompressParameter(true);
+    AppContext context;
+    ChunkedZstdCompression chunked_compression(context.GetAllocator(), CompressionMode::Zstd1, PixelType::Gray16, kWidth, kHeight, kWidth * 2, bitmap.data(), &parameters, 100);
+    ASSERT_EQ(chunked_compression.GetNumberOfChunks(), 3);
+    const auto result = CompressChunked(chunked_compression);
+
+    vector<uint8_t> expected_result{ 3, 1, 1 };
+    for (uint32_t offset = 0; offset < payload.size(); offset += 100)
+    {
+        const auto compressed_chunk = CompressWithZstd0(payload.data() + offset, min(100u, static_cast<uint32_t>(payload.size() - offset)));
+        expected_result.insert(expected_result.end(), compressed_chunk.cbegin(), compressed_chunk.cend());
+    }
+
+    EXPECT_EQ(result, expected_result);
+}
+
+TEST(ChunkedZstdCompression, Zstd0_ResultIsDecodedByLibCziToTheSourceBitmap)
+{
+    // a Gray16-bitmap of 100x20 pixels with a stride of 210 bytes, compressed in chunks of 512 bytes
+    constexpr uint32_t kWidth = 100;
+    constexpr uint32_t kHeight = 20;
+    constexpr uint32_t kStride = 210;
+    vector<uint8_t> bitmap(kStride * kHeight);
+    for (uint32_t y = 0; y < kHeight; ++y)
+    {
+        for (uint32_t x = 0; x < kWidth; ++x)
+        {
+            const uint16_t value = static_cast<uint16_t>(x * 97 + y * 1031);
+            memcpy(bitmap.data() + y * kStride + x * 2, &value, 2);
+        }
+    }
+
+    AppContext context;
+    ChunkedZstdCompression chunked_compression(context.GetAllocator(), CompressionMode::Zstd0, PixelType::Gray16, kWidth, kHeight, kStride, bitmap.data(), nullptr, 512);
+    ASSERT_GT(chunked_compression.GetNumberOfChunks(), 1);
+    const auto result = CompressChunked(chunked_compression);
+    CheckDecodedResult(CompressionMode::Zstd0, result, PixelType::Gray16, kWidth, kHeight, kStride, bitmap.data());
+}
+
+TEST(ChunkedZstdCompression, Zstd1WithLoHiBytePacking_ResultIsDecodedByLibCziToTheSourceBitmap)
+{
+    constexpr uint32_t kWidth = 100;
+    constexpr uint32_t kHeight = 20;
+    vector<uint16_t> bitmap(kWidth * kHeight);
+    for (size_t i = 0; i < bitmap.size(); ++i)
+    {
+        bitmap[i] = static_cast<uint16_t>(i * 263);
+    }
+
+    CompressParametersOnMap parameters;
+    parameters.map[static_cast<int>(CompressionParameterKey::ZSTD_PREPROCESS_DOLOHIBYTEPACKING)] = CompressParameter(true);
+    AppContext context;
+    ChunkedZstdCompression chunked_compression(context.GetAllocator(), CompressionMode::Zstd1, PixelType::Gray16, kWidth, kHeight, kWidth * 2, bitmap.data(), &parameters, 512);
+    ASSERT_GT(chunked_compression.GetNumberOfChunks(), 1);
+    const auto result = CompressChunked(chunked_compression);
+    CheckDecodedResult(CompressionMode::Zstd1, result, PixelType::Gray16, kWidth, kHeight, kWidth * 2, bitmap.data());
+}
+
+TEST(ChunkedZstdCompression, MemoryIsAccountedForAndReleasedWithTheObject)
+{
+    constexpr uint32_t kWidth = 64;
+    constexpr uint32_t kHeight = 16;
+    constexpr uint32_t kStride = 80;
+    const vector<uint8_t> bitmap(kStride * kHeight, 42);
+
+    AppContext context;
+    array<uint64_t, BrickAllocator::Count_of_MemoryTypes> allocation_state;
+    {
+        ChunkedZstdCompression chunked_compression(context.GetAllocator(), CompressionMode::Zstd0, PixelType::Gray8, kWidth, kHeight, kStride, bitmap.data(), nullptr, 256);
+
+        // the source is not contiguous, so the payload is copied
+        context.GetAllocator().GetState(allocation_state);
+        EXPECT_EQ(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::CompressionScratchBuffer)], static_cast<uint64_t>(kWidth) * kHeight);
+
+        CompressChunked(chunked_compression);
+        context.GetAllocator().GetState(allocation_state);
+        EXPECT_GT(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::CompressionScratchBuffer)], static_cast<uint64_t>(kWidth) * kHeight);
+    }
+
+    context.GetAllocator().GetState(allocation_state);
+    EXPECT_EQ(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::CompressionScratchBuffer)], 0);
+}
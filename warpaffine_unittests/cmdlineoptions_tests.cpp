@@ -4,10 +4,15 @@
 
 #include <gtest/gtest.h>
 #include <iterator>
+#include <stdexcept>
 #include <warpafine_unittests_config.h>
 #include "../libwarpaffine/cmdlineoptions.h"
 #include "../libwarpaffine/document_info.h"
 #include "../libwarpaffine/utilities.h"
+#include "../libwarpaffine/taskarena/ITaskArena.h"
+#include "../libwarpaffine/sliceswriter/ISlicesWriter.h"
+#include "../libwarpaffine/adaptive_compression_level.h"
+#include "../libwarpaffine/chunked_compression.h"
 
 TEST(CmdLineOptions, IlluminationAngleNotSpecified_ReturnsNullopt)
 {
@@ -100,6 +105,110 @@ TEST(CmdLineOptions, IlluminationAngleFractional_IsValid)
     EXPECT_DOUBLE_EQ(options.GetIlluminationAngleOverride().value(), 60.5);
 }
 
+TEST(CmdLineOptions, TaskArenaParametersSpecified_AreParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--parameters_taskarena", "max_concurrent_warp_tasks=4;prioritize_downstream_tasks=false;numa_aware=false" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_EQ(options.GetPropertyBagForTaskArena().GetInt32OrDefault(ITaskArena::kPropertyBagKey_max_concurrent_warp_tasks, 0), 4);
+    EXPECT_EQ(options.GetPropertyBagForTaskArena().GetInt32OrDefault(ITaskArena::kPropertyBagKey_max_concurrent_compress_tasks, 0), 0);
+    EXPECT_FALSE(options.GetPropertyBagForTaskArena().GetBoolOrDefault(ITaskArena::kPropertyBagKey_prioritize_downstream_tasks, true));
+    EXPECT_FALSE(options.GetPropertyBagForTaskArena().GetBoolOrDefault(ITaskArena::kPropertyBagKey_numa_aware, true));
+}
+
+TEST(CmdLineOptions, WriterParametersSpecified_AreParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--parameters_writer", "parallel_write=true" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_TRUE(options.GetPropertyBagForWriter().GetBoolOrDefault(ICziSlicesWriter::kPropertyBagKey_parallel_write, false));
+}
+
+TEST(CmdLineOptions, WriterParametersForDirectIoSpecified_AreParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--parameters_writer", "direct_io=true;direct_io_buffer_size_mb=64" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_TRUE(options.GetPropertyBagForWriter().GetBoolOrDefault(ICziSlicesWriter::kPropertyBagKey_direct_io, false));
+    EXPECT_EQ(options.GetPropertyBagForWriter().GetInt32OrDefault(ICziSlicesWriter::kPropertyBagKey_direct_io_buffer_size_mb, 0), 64);
+    EXPECT_FALSE(options.GetPropertyBagForWriter().GetBoolOrDefault(ICziSlicesWriter::kPropertyBagKey_parallel_write, false));
+}
+
+TEST(CmdLineOptions, WriterParametersForFanOutSpecified_AreParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--parameters_writer", "fan_out=T;fan_out_t_range=10" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_EQ(options.GetPropertyBagForWriter().GetStringOrDefault(ICziSlicesWriter::kPropertyBagKey_fan_out, ""), "T");
+    EXPECT_EQ(options.GetPropertyBagForWriter().GetInt32OrDefault(ICziSlicesWriter::kPropertyBagKey_fan_out_t_range, 0), 10);
+}
+
+TEST(CmdLineOptions, UncompressedOutputSpecified_IsParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "-c", "uncompressed:" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_EQ(options.GetCompressionOptions().first, libCZI::CompressionMode::UnCompressed);
+}
+
+TEST(CmdLineOptions, CompressionParametersSpecified_AreParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--parameters_compression", "adaptive_level=true;min_level=2;max_level=7" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_TRUE(options.GetPropertyBagForCompression().GetBoolOrDefault(AdaptiveCompressionLevel::kPropertyBagKey_adaptive_level, false));
+    EXPECT_EQ(options.GetPropertyBagForCompression().GetInt32OrDefault(AdaptiveCompressionLevel::kPropertyBagKey_min_level, 0), 2);
+    EXPECT_EQ(options.GetPropertyBagForCompression().GetInt32OrDefault(AdaptiveCompressionLevel::kPropertyBagKey_max_level, 0), 7);
+}
+
+TEST(CmdLineOptions, OmitEmptySubblocksSpecified_IsParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--omit-empty-subblocks" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_TRUE(options.GetDoOmitEmptySubblocks());
+}
+
+TEST(CmdLineOptions, ChunkSizeForCompressionSpecified_IsParsed)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--parameters_compression", "chunk_size_mb=8" };
+
+    const auto result = options.Parse(std::size(argv), const_cast<char**>(argv));
+
+    ASSERT_EQ(result, CCmdLineOptions::ParseResult::OK);
+    EXPECT_EQ(options.GetPropertyBagForCompression().GetInt32OrDefault(ChunkedZstdCompression::kPropertyBagKey_chunk_size_mb, 0), 8);
+}
+
+TEST(CmdLineOptions, HashResultWithAdaptiveCompressionLevel_IsRejected)
+{
+    CCmdLineOptions options;
+    static const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", "output.czi", "--hash-result", "--parameters_compression", "adaptive_level=true" };
+
+    EXPECT_THROW(options.Parse(std::size(argv), const_cast<char**>(argv)), std::invalid_argument);
+}
+
 // Test the DeskewDocumentInfo::SetIlluminationAngleInDegrees function
 TEST(DeskewDocumentInfo, SetIlluminationAngleInDegrees_ConvertsCorrectly)
 {
@@ -4,7 +4,12 @@
 
 #include <gtest/gtest.h>
 #include "../libwarpaffine/czi_helpers.h"
+#include "../libwarpaffine/subblock_index.h"
+#include "../libwarpaffine/document_analysis.h"
+#include "../libwarpaffine/document_analysis_cache.h"
+#include "../libwarpaffine/brickreader/linearreading_orderhelper.h"
 #include "mem_output_stream.h"
+#include <algorithm>
 #include <charconv>
 #include <limits>
 #include <cmath>
@@ -12,6 +17,8 @@
 #include <sstream>
 #include <locale>
 #include <iomanip>
+#include <filesystem>
+#include <fstream>
 
 using namespace std;
 using namespace libCZI;
@@ -313,6 +320,373 @@ TEST(Czi_Helpers, GetSubblocksForBrickWithMindexTest)
     }
 }
 
+/// Creates a CZI-document (Z=0...4 C=0..1 T=0..1 M=0..2) in memory and opens it with a CZI-reader.
+static std::shared_ptr<libCZI::ICZIReader> CreateMosaicTestDocumentAndOpenIt()
+{
+    auto writer = CreateCZIWriter();
+    auto outStream = make_shared<CMemOutputStream>(0);
+
+    auto spWriterInfo = make_shared<CCziWriterInfo>();
+    writer->Create(outStream, spWriterInfo);
+    auto bitmap = CreateTestBitmap(PixelType::Gray8, 4, 4);
+
+    ScopedBitmapLockerSP lockBm{ bitmap };
+    AddSubBlockInfoStridedBitmap addSbBlkInfo;
+
+    for (int z = 0; z < 5; ++z)
+    {
+        for (int t = 0; t < 2; ++t)
+        {
+            for (int c = 0; c < 2; ++c)
+            {
+                for (int m = 0; m < 3; ++m)
+                {
+                    addSbBlkInfo.Clear();
+                    addSbBlkInfo.coordinate.Set(DimensionIndex::C, c);
+                    addSbBlkInfo.coordinate.Set(DimensionIndex::T, t);
+                    addSbBlkInfo.coordinate.Set(DimensionIndex::Z, z);
+                    addSbBlkInfo.mIndexValid = true;
+                    addSbBlkInfo.mIndex = m;
+                    addSbBlkInfo.x = m * 10;
+                    addSbBlkInfo.y = m * 3;
+                    addSbBlkInfo.logicalWidth = bitmap->GetWidth();
+                    addSbBlkInfo.logicalHeight = bitmap->GetHeight();
+                    addSbBlkInfo.physicalWidth = bitmap->GetWidth();
+                    addSbBlkInfo.physicalHeight = bitmap->GetHeight();
+                    addSbBlkInfo.PixelType = bitmap->GetPixelType();
+                    addSbBlkInfo.ptrBitmap = lockBm.ptrDataRoi;
+                    addSbBlkInfo.strideBitmap = lockBm.stride;
+
+                    writer->SyncAddSubBlock(addSbBlkInfo);
+                }
+            }
+        }
+    }
+
+    PrepareMetadataInfo prepare_metadata_info;
+    auto metaDataBuilder = writer->GetPreparedMetadata(prepare_metadata_info);
+
+    WriteMetadataInfo write_metadata_info;
+    const auto& strMetadata = metaDataBuilder->GetXml();
+    write_metadata_info.szMetadata = strMetadata.c_str();
+    write_metadata_info.szMetadataSize = strMetadata.size() + 1;
+    write_metadata_info.ptrAttachment = nullptr;
+    write_metadata_info.attachmentSize = 0;
+    writer->SyncWriteMetadata(write_metadata_info);
+
+    writer->Close();
+    writer.reset();		// not needed anymore
+
+    size_t cziData_Size;
+    auto cziData = outStream->GetCopy(&cziData_Size);
+    outStream.reset();	// not needed anymore
+
+    // now, open the CZI-document from the memory-blob
+    auto inputStream = CreateStreamFromMemory(cziData, cziData_Size);
+    auto reader = CreateCZIReader();
+    reader->Open(inputStream);
+    return reader;
+}
+
+TEST(Czi_Helpers, SubblockIndexGivesSameResultAsGetSubblocksForBrick)
+{
+    auto reader = CreateMosaicTestDocumentAndOpenIt();
+
+    SubblockIndex subblock_index(reader.get());
+    EXPECT_EQ(subblock_index.GetNumberOfSubblocks(), 5 * 2 * 2 * 3);
+
+    const auto tile_identifier_to_rectangle_map = CziHelpers::DetermineTileIdentifierToRectangleMap(reader.get());
+    const auto& tile_identifier_to_rectangle_map_from_index = subblock_index.GetTileIdentifierToRectangleMap();
+    ASSERT_EQ(tile_identifier_to_rectangle_map.size(), 3);
+    ASSERT_EQ(tile_identifier_to_rectangle_map_from_index.size(), tile_identifier_to_rectangle_map.size());
+    for (const auto& item : tile_identifier_to_rectangle_map)
+    {
+        const auto iterator = tile_identifier_to_rectangle_map_from_index.find(item.first);
+        ASSERT_TRUE(iterator != tile_identifier_to_rectangle_map_from_index.cend());
+        EXPECT_EQ(iterator->second.x, item.second.x);
+        EXPECT_EQ(iterator->second.y, item.second.y);
+        EXPECT_EQ(iterator->second.w, item.second.w);
+        EXPECT_EQ(iterator->second.h, item.second.h);
+    }
+
+    for (int t = 0; t < 2; ++t)
+    {
+        for (int c = 0; c < 2; ++c)
+        {
+            for (const auto& item : tile_identifier_to_rectangle_map)
+            {
+                CDimCoordinate brick_coordinate{ { DimensionIndex::T, t }, { DimensionIndex::C, c } };
+                const auto map_z_subblocks = CziHelpers::GetSubblocksForBrick(reader.get(), brick_coordinate, item.first);
+                const auto map_z_subblocks_from_index = subblock_index.GetSubblocksForBrick(brick_coordinate, item.first);
+                ASSERT_EQ(map_z_subblocks.size(), 5);
+                EXPECT_EQ(map_z_subblocks_from_index, map_z_subblocks);
+            }
+        }
+    }
+
+    // a tile-identifier which is not present in the document must give an empty result
+    const auto map_z_subblocks_from_index = subblock_index.GetSubblocksForBrick(CDimCoordinate::Parse("T0C0"), TileIdentifier::GetForNoSceneIndex(42));
+    EXPECT_TRUE(map_z_subblocks_from_index.empty());
+}
+
+TEST(Czi_Helpers, DocumentAnalysisGivesSameResultAsCziHelpers)
+{
+    auto reader = CreateMosaicTestDocumentAndOpenIt();
+
+    const DocumentAnalysis document_analysis(reader.get());
+    EXPECT_EQ(document_analysis.GetSubblocks().size(), 5 * 2 * 2 * 3);
+    EXPECT_EQ(document_analysis.GetSubblockIndex()->GetNumberOfSubblocks(), 5 * 2 * 2 * 3);
+    EXPECT_EQ(document_analysis.GetMapOfChannelsToPixeltype(), CziHelpers::GetMapOfChannelsToPixeltype(reader.get()));
+
+    IntSize tile_size;
+    ASSERT_TRUE(document_analysis.TryGetLayer0TileSize(&tile_size));
+    EXPECT_EQ(tile_size.w, 4);
+    EXPECT_EQ(tile_size.h, 4);
+
+    reader->EnumerateSubBlocksEx(
+        [&](int index, const DirectorySubBlockInfo& info)->bool
+        {
+            const auto& subblock_info = document_analysis.GetSubblocks().at(index);
+            EXPECT_EQ(subblock_info.file_position, info.filePosition);
+            EXPECT_EQ(subblock_info.m, info.mIndex);
+            EXPECT_TRUE(subblock_info.is_layer0);
+            int c;
+            EXPECT_TRUE(info.coordinate.TryGetPosition(DimensionIndex::C, &c));
+            EXPECT_EQ(subblock_info.c, c);
+            return true;
+        });
+}
+
+TEST(Czi_Helpers, LinearReadingOrderForMosaicDocumentHasOneBrickPerTile)
+{
+    auto reader = CreateMosaicTestDocumentAndOpenIt();
+
+    const DocumentAnalysis document_analysis(reader.get());
+    LinearReadingOrderHelper::ReadingConstraints reading_constraints;
+    reading_constraints.max_number_of_subblocks_inflight = 10;
+    const auto reading_order = LinearReadingOrderHelper::DetermineOrder(document_analysis, reading_constraints);
+
+    // we expect a brick for each T, C and M (and no scene-index, since the document has no scenes), each with 5 slices
+    ASSERT_EQ(reading_order.number_of_slices_per_brick.size(), 2 * 2 * 3);
+    for (int t = 0; t < 2; ++t)
+    {
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int m = 0; m < 3; ++m)
+            {
+                const auto iterator = reading_order.number_of_slices_per_brick.find(BrickCoordinate(t, c, BrickCoordinate::kNotPresent, m));
+                ASSERT_NE(iterator, reading_order.number_of_slices_per_brick.cend());
+                EXPECT_EQ(iterator->second, 5);
+            }
+        }
+    }
+
+    // every subblock must be read exactly once
+    auto subblocks_in_reading_order = reading_order.reading_order;
+    sort(subblocks_in_reading_order.begin(), subblocks_in_reading_order.end());
+    ASSERT_EQ(subblocks_in_reading_order.size(), 5 * 2 * 2 * 3);
+    for (size_t i = 0; i < subblocks_in_reading_order.size(); ++i)
+    {
+        EXPECT_EQ(subblocks_in_reading_order[i], static_cast<int>(i));
+    }
+}
+
+/// Creates a CZI-document with one scene (S=0, M=0..1, Z=0..2) in memory and opens it with a CZI-reader. In addition, the
+/// document contains subblocks which are not part of a tile - one without an S-index and one without an M-index.
+static std::shared_ptr<libCZI::ICZIReader> CreateMosaicTestDocumentWithSubblocksOutsideOfTilesAndOpenIt()
+{
+    auto writer = CreateCZIWriter();
+    auto outStream = make_shared<CMemOutputStream>(0);
+
+    auto spWriterInfo = make_shared<CCziWriterInfo>();
+    writer->Create(outStream, spWriterInfo);
+    auto bitmap = CreateTestBitmap(PixelType::Gray8, 4, 4);
+
+    ScopedBitmapLockerSP lockBm{ bitmap };
+    AddSubBlockInfoStridedBitmap addSbBlkInfo;
+
+    const auto add_subblock =
+        [&](int z, bool has_s, bool has_m, int m)->void
+        {
+            addSbBlkInfo.Clear();
+            addSbBlkInfo.coordinate.Set(DimensionIndex::C, 0);
+            addSbBlkInfo.coordinate.Set(DimensionIndex::T, 0);
+            addSbBlkInfo.coordinate.Set(DimensionIndex::Z, z);
+            if (has_s)
+            {
+                addSbBlkInfo.coordinate.Set(DimensionIndex::S, 0);
+            }
+
+            addSbBlkInfo.mIndexValid = has_m;
+            addSbBlkInfo.mIndex = m;
+            addSbBlkInfo.x = m * 10;
+            addSbBlkInfo.y = 0;
+            addSbBlkInfo.logicalWidth = bitmap->GetWidth();
+            addSbBlkInfo.logicalHeight = bitmap->GetHeight();
+            addSbBlkInfo.physicalWidth = bitmap->GetWidth();
+            addSbBlkInfo.physicalHeight = bitmap->GetHeight();
+            addSbBlkInfo.PixelType = bitmap->GetPixelType();
+            addSbBlkInfo.ptrBitmap = lockBm.ptrDataRoi;
+            addSbBlkInfo.strideBitmap = lockBm.stride;
+            writer->SyncAddSubBlock(addSbBlkInfo);
+        };
+
+    for (int z = 0; z < 3; ++z)
+    {
+        for (int m = 0; m < 2; ++m)
+        {
+            add_subblock(z, true, true, m);
+        }
+    }
+
+    add_subblock(0, false, true, 0);    // no S-index
+    add_subblock(1, true, false, 0);    // no M-index
+
+    PrepareMetadataInfo prepare_metadata_info;
+    auto metaDataBuilder = writer->GetPreparedMetadata(prepare_metadata_info);
+
+    WriteMetadataInfo write_metadata_info;
+    const auto& strMetadata = metaDataBuilder->GetXml();
+    write_metadata_info.szMetadata = strMetadata.c_str();
+    write_metadata_info.szMetadataSize = strMetadata.size() + 1;
+    write_metadata_info.ptrAttachment = nullptr;
+    write_metadata_info.attachmentSize = 0;
+    writer->SyncWriteMetadata(write_metadata_info);
+
+    writer->Close();
+    writer.reset();
+
+    size_t cziData_Size;
+    auto cziData = outStream->GetCopy(&cziData_Size);
+    outStream.reset();
+
+    auto inputStream = CreateStreamFromMemory(cziData, cziData_Size);
+    auto reader = CreateCZIReader();
+    reader->Open(inputStream);
+    return reader;
+}
+
+TEST(Czi_Helpers, LinearReadingOrderSkipsSubblocksWhichAreNotPartOfATile)
+{
+    auto reader = CreateMosaicTestDocumentWithSubblocksOutsideOfTilesAndOpenIt();
+
+    const DocumentAnalysis document_analysis(reader.get());
+    ASSERT_EQ(document_analysis.GetSubblocks().size(), 3 * 2 + 2);
+    LinearReadingOrderHelper::ReadingConstraints reading_constraints;
+    reading_constraints.max_number_of_subblocks_inflight = 10;
+    const auto reading_order = LinearReadingOrderHelper::DetermineOrder(document_analysis, reading_constraints);
+
+    // we expect two bricks (S=0, M=0 and S=0, M=1), each with 3 slices, and the two subblocks which are
+    //  not part of a tile are not to be read
+    ASSERT_EQ(reading_order.number_of_slices_per_brick.size(), 2);
+    EXPECT_EQ(reading_order.number_of_slices_per_brick.at(BrickCoordinate(0, 0, 0, 0)), 3);
+    EXPECT_EQ(reading_order.number_of_slices_per_brick.at(BrickCoordinate(0, 0, 0, 1)), 3);
+    ASSERT_EQ(reading_order.reading_order.size(), 3 * 2);
+
+    // every subblock in the reading order must belong to a tile which is known to the subblock-index (this
+    //  is what the linear brick-reader relies on when composing the brick)
+    const auto& tile_identifier_to_rectangle_map = document_analysis.GetSubblockIndex()->GetTileIdentifierToRectangleMap();
+    for (const int subblock_index : reading_order.reading_order)
+    {
+        const auto& subblock_info = document_analysis.GetSubblocks()[subblock_index];
+        ASSERT_TRUE(LinearReadingOrderHelper::IsSubblockPartOfBrick(document_analysis.GetStatistics(), subblock_info));
+        const auto brick_coordinate = LinearReadingOrderHelper::GetBrickCoordinateOfSubblock(document_analysis.GetStatistics(), subblock_info);
+        EXPECT_NE(tile_identifier_to_rectangle_map.find(TileIdentifier(brick_coordinate.s, brick_coordinate.m)), tile_identifier_to_rectangle_map.cend());
+    }
+}
+
+TEST(Czi_Helpers, DocumentAnalysisCacheRoundTrip)
+{
+    auto reader = CreateMosaicTestDocumentAndOpenIt();
+
+    DocumentAnalysis document_analysis(reader.get());
+    LinearReadingOrderHelper::ReadingConstraints reading_constraints;
+    reading_constraints.max_number_of_subblocks_inflight = 10;
+    document_analysis.SetLinearReadingOrder(
+        reading_constraints.max_number_of_subblocks_inflight,
+        make_shared<const LinearReadingOrder>(LinearReadingOrderHelper::DetermineOrder(document_analysis, reading_constraints)));
+
+    DocumentAnalysisCache::SourceFingerprint fingerprint;
+    fingerprint.file_size = 12345;
+    fingerprint.last_write_time = 42;
+    fingerprint.header_hash.fill(0xab);
+
+    const auto cache_filename = (filesystem::temp_directory_path() / "warpaffine_unittests_analysis_cache.bin").u8string();
+    ASSERT_TRUE(DocumentAnalysisCache::TrySave(cache_filename, fingerprint, document_analysis));
+
+    const auto document_analysis_from_cache = DocumentAnalysisCache::TryLoad(cache_filename, fingerprint);
+    ASSERT_TRUE(document_analysis_from_cache);
+    EXPECT_EQ(document_analysis_from_cache->GetSubblocks().size(), document_analysis.GetSubblocks().size());
+    for (size_t i = 0; i < document_analysis.GetSubblocks().size(); ++i)
+    {
+        const auto& a = document_analysis.GetSubblocks()[i];
+        const auto& b = document_analysis_from_cache->GetSubblocks()[i];
+        EXPECT_EQ(a.file_position, b.file_position);
+        EXPECT_TRUE(a.t == b.t && a.c == b.c && a.s == b.s && a.m == b.m && a.z == b.z && a.is_layer0 == b.is_layer0);
+        EXPECT_TRUE(a.logical_rect.x == b.logical_rect.x && a.logical_rect.y == b.logical_rect.y && a.logical_rect.w == b.logical_rect.w && a.logical_rect.h == b.logical_rect.h);
+    }
+
+    EXPECT_EQ(document_analysis_from_cache->GetMapOfChannelsToPixeltype(), document_analysis.GetMapOfChannelsToPixeltype());
+    EXPECT_EQ(document_analysis_from_cache->GetStatistics().minMindex, document_analysis.GetStatistics().minMindex);
+    EXPECT_EQ(document_analysis_from_cache->GetStatistics().maxMindex, document_analysis.GetStatistics().maxMindex);
+    EXPECT_EQ(document_analysis_from_cache->GetSubblockIndex()->GetTileIdentifierToRectangleMap().size(), document_analysis.GetSubblockIndex()->GetTileIdentifierToRectangleMap().size());
+    int z_count_original, z_count_from_cache;
+    EXPECT_TRUE(document_analysis.GetStatistics().dimBounds.TryGetInterval(DimensionIndex::Z, nullptr, &z_count_original));
+    EXPECT_TRUE(document_analysis_from_cache->GetStatistics().dimBounds.TryGetInterval(DimensionIndex::Z, nullptr, &z_count_from_cache));
+    EXPECT_EQ(z_count_original, z_count_from_cache);
+
+    const auto reading_order = document_analysis.TryGetLinearReadingOrder(reading_constraints.max_number_of_subblocks_inflight);
+    const auto reading_order_from_cache = document_analysis_from_cache->TryGetLinearReadingOrder(reading_constraints.max_number_of_subblocks_inflight);
+    ASSERT_TRUE(reading_order_from_cache);
+    EXPECT_EQ(reading_order_from_cache->reading_order, reading_order->reading_order);
+    EXPECT_EQ(reading_order_from_cache->max_number_of_subblocks_inflight, reading_order->max_number_of_subblocks_inflight);
+    EXPECT_EQ(reading_order_from_cache->number_of_slices_per_brick, reading_order->number_of_slices_per_brick);
+
+    // a cache file written for a different version of the source file must not be used
+    auto other_fingerprint = fingerprint;
+    other_fingerprint.last_write_time = 43;
+    EXPECT_FALSE(DocumentAnalysisCache::TryLoad(cache_filename, other_fingerprint));
+
+    filesystem::remove(filesystem::u8path(cache_filename));
+}
+
+TEST(Czi_Helpers, DocumentAnalysisCacheWithInvalidContentIsNotUsed)
+{
+    auto reader = CreateMosaicTestDocumentAndOpenIt();
+
+    DocumentAnalysisCache::SourceFingerprint fingerprint;
+    fingerprint.file_size = 12345;
+    fingerprint.last_write_time = 42;
+    fingerprint.header_hash.fill(0xab);
+    const auto cache_filename = (filesystem::temp_directory_path() / "warpaffine_unittests_analysis_cache_invalid.bin").u8string();
+
+    // a reading order referring to a subblock-index which is out-of-range
+    DocumentAnalysis document_analysis(reader.get());
+    auto linear_reading_order = make_shared<LinearReadingOrder>();
+    linear_reading_order->max_number_of_subblocks_inflight = 10;
+    linear_reading_order->reading_order = { 0, static_cast<int>(document_analysis.GetSubblocks().size()) };
+    document_analysis.SetLinearReadingOrder(10, linear_reading_order);
+    ASSERT_TRUE(DocumentAnalysisCache::TrySave(cache_filename, fingerprint, document_analysis));
+    EXPECT_FALSE(DocumentAnalysisCache::TryLoad(cache_filename, fingerprint));
+
+    // now write a valid cache file, check that it can be loaded, then patch the first dimension-index in the
+    //  statistics-section to an invalid value - it is located after the header (magic, version and fingerprint = 44 bytes),
+    //  the fixed-size part of the statistics (3 int32 and 2 rectangles = 44 bytes) and the count (8 bytes)
+    const DocumentAnalysis document_analysis_valid(reader.get());
+    ASSERT_TRUE(DocumentAnalysisCache::TrySave(cache_filename, fingerprint, document_analysis_valid));
+    ASSERT_TRUE(DocumentAnalysisCache::TryLoad(cache_filename, fingerprint));
+    {
+        fstream stream(filesystem::u8path(cache_filename), ios::binary | ios::in | ios::out);
+        stream.seekp(44 + 44 + 8);
+        const int32_t invalid_dimension_index = 100;
+        stream.write(reinterpret_cast<const char*>(&invalid_dimension_index), sizeof(invalid_dimension_index));
+    }
+
+    EXPECT_FALSE(DocumentAnalysisCache::TryLoad(cache_filename, fingerprint));
+
+    filesystem::remove(filesystem::u8path(cache_filename));
+}
+
 namespace
 {
     string FormatDoubleForXml(double value)
@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/sliceswriter/DirectIoOutputStream.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<uint8_t> ReadFile(const filesystem::path& path)
+    {
+        ifstream stream(path, ios::binary);
+        return vector<uint8_t>(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+    }
+
+    /// Writes the specified data at the specified offset into the "expected file content".
+    void WriteToExpected(vector<uint8_t>& expected, uint64_t offset, const vector<uint8_t>& data)
+    {
+        if (expected.size() < offset + data.size())
+        {
+            expected.resize(offset + data.size(), 0);
+        }
+
+        copy(data.cbegin(), data.cend(), expected.begin() + offset);
+    }
+
+    /// Writes a couple of (unaligned) pieces of data (including a gap and a re-write of the header) with the specified
+    /// stream and gives the expected file content.
+    vector<uint8_t> WriteTestContent(DirectIoOutputStream& stream)
+    {
+        vector<uint8_t> expected;
+
+        // a preliminary header, then a couple of "subblocks" of odd size...
+        const vector<uint8_t> header(512, 0xff);
+        stream.Write(0, header.data(), header.size(), nullptr);
+        WriteToExpected(expected, 0, header);
+        uint64_t offset = header.size();
+        for (int i = 0; i < 20; ++i)
+        {
+            const vector<uint8_t> data(1000 + i * 97, static_cast<uint8_t>(i));
+            uint64_t bytes_written = 0;
+            stream.Write(offset, data.data(), data.size(), &bytes_written);
+            EXPECT_EQ(bytes_written, data.size());
+            WriteToExpected(expected, offset, data);
+            offset += data.size();
+        }
+
+        // ...with a gap (which reads as zeroes)...
+        offset += 20000;
+        const vector<uint8_t> trailer(33, 0x42);
+        stream.Write(offset, trailer.data(), trailer.size(), nullptr);
+        WriteToExpected(expected, offset, trailer);
+
+        // ...and finally the header is updated (which targets a part of the file already written out)
+        const vector<uint8_t> final_header(512, 0x11);
+        stream.Write(0, final_header.data(), final_header.size(), nullptr);
+        WriteToExpected(expected, 0, final_header);
+
+        stream.Close();
+        return expected;
+    }
+}
+
+// we use a small staging buffer here, so that a couple of staging buffers are written out
+static constexpr uint64_t kStagingBufferSize = 8192;
+
+TEST(DirectIoOutputStream, SequentialWritesWithHeaderUpdateAndUnalignedTailWithDirectIo)
+{
+    // Note that the temp-folder is often on a file system which does not support direct I/O (e.g. tmpfs), so we use
+    //  the current working directory here - and skip the test if direct I/O is not available there.
+    const auto filename = filesystem::current_path() / "warpaffine_unittests_direct_io_1.bin";
+    vector<uint8_t> expected;
+    {
+        DirectIoOutputStream stream(filename.wstring(), kStagingBufferSize);
+        if (!stream.GetIsDirectIo())
+        {
+            stream.Close();
+            filesystem::remove(filename);
+            GTEST_SKIP() << "direct I/O is not available for the file \"" << filename.string() << "\"";
+        }
+
+        expected = WriteTestContent(stream);
+        EXPECT_TRUE(stream.GetIsDirectIo());
+    }
+
+    EXPECT_EQ(ReadFile(filename), expected);
+    filesystem::remove(filename);
+}
+
+TEST(DirectIoOutputStream, SequentialWritesWithHeaderUpdateAndUnalignedTailWithRegularIo)
+{
+    const auto filename = filesystem::temp_directory_path() / "warpaffine_unittests_direct_io_3.bin";
+    vector<uint8_t> expected;
+    {
+        DirectIoOutputStream stream(filename.wstring(), kStagingBufferSize, false);
+        EXPECT_FALSE(stream.GetIsDirectIo());
+        expected = WriteTestContent(stream);
+        EXPECT_FALSE(stream.GetIsDirectIo());
+    }
+
+    EXPECT_EQ(ReadFile(filename), expected);
+    filesystem::remove(filename);
+}
+
+
+TEST(DirectIoOutputStream, StreamIsClosedWhenDestroyed)
+{
+    const auto filename = filesystem::temp_directory_path() / "warpaffine_unittests_direct_io_2.bin";
+    {
+        DirectIoOutputStream stream(filename.wstring(), 4096);
+        const uint8_t data[] = { 1, 2, 3 };
+        stream.Write(0, data, sizeof(data), nullptr);
+        stream.Write(1, data, 1, nullptr);
+    }
+
+    EXPECT_EQ(ReadFile(filename), (vector<uint8_t>{ 1, 1, 3 }));
+    filesystem::remove(filename);
+}
@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/appcontext.h"
+#include "../libwarpaffine/dowarp.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+using namespace libCZI;
+
+TEST(DoWarp, UncompressedSliceStaysValidAfterBrickIsReleased)
+{
+    constexpr uint32_t kWidth = 7;
+    constexpr uint32_t kHeight = 5;
+    constexpr uint32_t kDepth = 3;
+
+    AppContext context;
+    auto& allocator = context.GetAllocator();
+    Brick brick;
+    brick.info.pixelType = PixelType::Gray16;
+    brick.info.width = kWidth;
+    brick.info.height = kHeight;
+    brick.info.depth = kDepth;
+    brick.info.stride_line = kWidth * 2;
+    brick.info.stride_plane = brick.info.stride_line * kHeight;
+    const size_t size_of_brick = static_cast<size_t>(brick.info.stride_plane) * kDepth;
+    brick.data = allocator.Allocate(BrickAllocator::MemoryType::DestinationBrick, size_of_brick);
+    for (size_t i = 0; i < size_of_brick; ++i)
+    {
+        static_cast<uint8_t*>(brick.data.get())[i] = static_cast<uint8_t>(i);
+    }
+
+    auto slice = DoWarp::GetUncompressedSlice(allocator, brick, 1);
+    ASSERT_TRUE(slice);
+    ASSERT_EQ(slice->GetSizeOfData(), static_cast<size_t>(brick.info.stride_plane));
+
+    // the slice is a view onto the brick (i.e. no copy is made)
+    EXPECT_EQ(slice->GetPtr(), static_cast<uint8_t*>(brick.data.get()) + brick.info.stride_plane);
+
+    // when the brick is released, the slice keeps the brick's memory alive (and accounted for)...
+    brick.data.reset();
+    array<uint64_t, BrickAllocator::Count_of_MemoryTypes> allocation_state;
+    allocator.GetState(allocation_state);
+    EXPECT_EQ(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::DestinationBrick)], size_of_brick);
+    const auto* slice_data = static_cast<const uint8_t*>(slice->GetPtr());
+    for (size_t i = 0; i < slice->GetSizeOfData(); ++i)
+    {
+        ASSERT_EQ(slice_data[i], static_cast<uint8_t>(brick.info.stride_plane + i)) << "at index " << i;
+    }
+
+    // ...until the slice is released
+    slice.reset();
+    allocator.GetState(allocation_state);
+    EXPECT_EQ(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::DestinationBrick)], 0);
+}
+
+TEST(DoWarp, UncompressedSliceIsCopiedIfLinesAreNotContiguous)
+{
+    constexpr uint32_t kWidth = 3;
+    constexpr uint32_t kHeight = 4;
+
+    AppContext context;
+    auto& allocator = context.GetAllocator();
+    Brick brick;
+    brick.info.pixelType = PixelType::Gray8;
+    brick.info.width = kWidth;
+    brick.info.height = kHeight;
+    brick.info.depth = 1;
+    brick.info.stride_line = kWidth + 5;
+    brick.info.stride_plane = brick.info.stride_line * kHeight;
+    brick.data = allocator.Allocate(BrickAllocator::MemoryType::DestinationBrick, brick.info.stride_plane);
+    for (uint32_t y = 0; y < kHeight; ++y)
+    {
+        memset(static_cast<uint8_t*>(brick.data.get()) + y * brick.info.stride_line, static_cast<int>(y + 1), brick.info.stride_line);
+    }
+
+    auto slice = DoWarp::GetUncompressedSlice(allocator, brick, 0);
+    brick.data.reset();
+    ASSERT_EQ(slice->GetSizeOfData(), static_cast<size_t>(kWidth) * kHeight);
+    const auto* slice_data = static_cast<const uint8_t*>(slice->GetPtr());
+    for (uint32_t y = 0; y < kHeight; ++y)
+    {
+        for (uint32_t x = 0; x < kWidth; ++x)
+        {
+            EXPECT_EQ(slice_data[y * kWidth + x], y + 1);
+        }
+    }
+
+    // the copy is accounted for as "compressed destination slice", the brick itself is not kept alive
+    array<uint64_t, BrickAllocator::Count_of_MemoryTypes> allocation_state;
+    allocator.GetState(allocation_state);
+    EXPECT_EQ(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::DestinationBrick)], 0);
+    EXPECT_EQ(allocation_state[static_cast<size_t>(BrickAllocator::MemoryType::CompressedDestinationSlice)], static_cast<uint64_t>(kWidth) * kHeight);
+}
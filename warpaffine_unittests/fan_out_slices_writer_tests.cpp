@@ -0,0 +1,324 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/appcontext.h"
+#include "../libwarpaffine/sliceswriter/FanOutSlicesWriter.h"
+#include "mem_output_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace libCZI;
+
+namespace
+{
+    /// A memory block for the tests - optionally, "GetPtr" blocks until the specified future is ready (which allows to hold
+    /// a slice in the writer).
+    class TestMemoryBlock : public IMemoryBlock
+    {
+    private:
+        vector<uint8_t> data_;
+        shared_future<void> gate_;
+    public:
+        explicit TestMemoryBlock(size_t size, shared_future<void> gate = shared_future<void>())
+            : data_(size, 0), gate_(std::move(gate))
+        {
+        }
+
+        void* GetPtr() override
+        {
+            if (this->gate_.valid())
+            {
+                this->gate_.wait();
+            }
+
+            return this->data_.data();
+        }
+
+        size_t GetSizeOfData() const override
+        {
+            return this->data_.size();
+        }
+    };
+
+    ICziSlicesWriter::AddSliceInfo CreateAddSliceInfo(const shared_ptr<IMemoryBlock>& data, const char* coordinate)
+    {
+        ICziSlicesWriter::AddSliceInfo add_slice_info;
+        add_slice_info.subblock_raw_data = data;
+        add_slice_info.compression_mode = CompressionMode::UnCompressed;
+        add_slice_info.pixeltype = PixelType::Gray8;
+        add_slice_info.width = static_cast<uint32_t>(data->GetSizeOfData());
+        add_slice_info.height = 1;
+        add_slice_info.coordinate = CDimCoordinate::Parse(coordinate);
+        add_slice_info.m_index = 0;
+        return add_slice_info;
+    }
+
+    /// Initializes the application context for writing the specified output with the specified writer-parameters.
+    void InitializeAppContext(AppContext& context, const filesystem::path& output_filename, const char* writer_parameters)
+    {
+        const string output_filename_utf8 = output_filename.u8string();
+        const char* argv[] = { "warpaffine", "-s", "input.czi", "-d", output_filename_utf8.c_str(), "--parameters_writer", writer_parameters };
+        ASSERT_TRUE(context.Initialize(static_cast<int>(size(argv)), const_cast<char**>(argv)));
+    }
+
+    /// Creates document-metadata with two channels (with the names "first" and "second") by writing a document (in memory)
+    /// and reading back its metadata.
+    shared_ptr<ICziMetadata> CreateMetadataWithTwoChannels()
+    {
+        auto writer = CreateCZIWriter();
+        auto out_stream = make_shared<CMemOutputStream>(0);
+        writer->Create(out_stream, make_shared<CCziWriterInfo>());
+        const uint8_t pixel_data[4] = {};
+        for (int c = 0; c < 2; ++c)
+        {
+            AddSubBlockInfoMemPtr add_subblock_info;
+            add_subblock_info.Clear();
+            add_subblock_info.coordinate = CDimCoordinate{ { DimensionIndex::C, c } };
+            add_subblock_info.mIndexValid = true;
+            add_subblock_info.mIndex = 0;
+            add_subblock_info.logicalWidth = add_subblock_info.physicalWidth = 4;
+            add_subblock_info.logicalHeight = add_subblock_info.physicalHeight = 1;
+            add_subblock_info.PixelType = PixelType::Gray8;
+            add_subblock_info.SetCompressionMode(CompressionMode::UnCompressed);
+            add_subblock_info.ptrData = pixel_data;
+            add_subblock_info.dataSize = sizeof(pixel_data);
+            writer->SyncAddSubBlock(add_subblock_info);
+        }
+
+        const auto metadata_builder = writer->GetPreparedMetadata(PrepareMetadataInfo());
+        metadata_builder->GetRootNode()->GetOrCreateChildNode("Metadata/Information/Image/Dimensions/Channels/Channel[Id=Channel:0]/Name")->SetValue("first");
+        metadata_builder->GetRootNode()->GetOrCreateChildNode("Metadata/Information/Image/Dimensions/Channels/Channel[Id=Channel:1]/Name")->SetValue("second");
+        metadata_builder->GetRootNode()->GetOrCreateChildNode("Metadata/DisplaySetting/Channels/Channel[Id=Channel:0]/ShortName")->SetValue("first");
+        metadata_builder->GetRootNode()->GetOrCreateChildNode("Metadata/DisplaySetting/Channels/Channel[Id=Channel:1]/ShortName")->SetValue("second");
+        const string metadata_xml = metadata_builder->GetXml();
+        WriteMetadataInfo write_metadata_info;
+        write_metadata_info.Clear();
+        write_metadata_info.szMetadata = metadata_xml.c_str();
+        write_metadata_info.szMetadataSize = metadata_xml.size();
+        writer->SyncWriteMetadata(write_metadata_info);
+        writer->Close();
+
+        size_t size_of_czi_data;
+        const auto czi_data = out_stream->GetCopy(&size_of_czi_data);
+        const auto reader = CreateCZIReader();
+        reader->Open(CreateStreamFromMemory(czi_data, size_of_czi_data));
+        return reader->ReadMetadataSegment()->CreateMetaFromMetadataSegment();
+    }
+
+    /// Gets the values of the child-nodes "child_name" of all nodes with the specified name below the node at the specified path.
+    vector<wstring> GetValuesOfChildren(IXmlNodeRw* root_node, const char* path, const wchar_t* name, const char* child_name)
+    {
+        vector<wstring> values;
+        const auto node = root_node->GetChildNode(path);
+        if (node)
+        {
+            static_cast<IXmlNodeRead*>(node.get())->EnumChildren(
+                [&](shared_ptr<IXmlNodeRead> child)->bool
+                {
+                    if (child->Name() == name)
+                    {
+                        wstring value;
+                        const auto value_node = child->GetChildNodeReadonly(child_name);
+                        if (value_node)
+                        {
+                            value_node->TryGetValue(&value);
+                        }
+
+                        values.push_back(value);
+                    }
+
+                    return true;
+                });
+        }
+
+        return values;
+    }
+}
+
+TEST(FanOutSlicesWriter, TryParseKey)
+{
+    FanOutSlicesWriter::Key key;
+    EXPECT_TRUE(FanOutSlicesWriter::TryParseKey("C", &key));
+    EXPECT_EQ(key, FanOutSlicesWriter::Key::Channel);
+    EXPECT_TRUE(FanOutSlicesWriter::TryParseKey("t", &key));
+    EXPECT_EQ(key, FanOutSlicesWriter::Key::TRange);
+    EXPECT_TRUE(FanOutSlicesWriter::TryParseKey("S", &key));
+    EXPECT_EQ(key, FanOutSlicesWriter::Key::Scene);
+    EXPECT_FALSE(FanOutSlicesWriter::TryParseKey("Z", &key));
+    EXPECT_FALSE(FanOutSlicesWriter::TryParseKey("", &key));
+}
+
+TEST(FanOutSlicesWriter, GetPartIndex)
+{
+    ICziSlicesWriter::AddSliceInfo add_slice_info;
+    add_slice_info.coordinate = CDimCoordinate::Parse("C2T25Z7");
+
+    EXPECT_EQ(FanOutSlicesWriter::GetPartIndex(FanOutSlicesWriter::Key::Channel, 1, add_slice_info), 2);
+    EXPECT_EQ(FanOutSlicesWriter::GetPartIndex(FanOutSlicesWriter::Key::TRange, 1, add_slice_info), 25);
+    EXPECT_EQ(FanOutSlicesWriter::GetPartIndex(FanOutSlicesWriter::Key::TRange, 10, add_slice_info), 2);
+
+    // if there is no scene-index (and no S-coordinate), all slices go into the part with index 0
+    EXPECT_EQ(FanOutSlicesWriter::GetPartIndex(FanOutSlicesWriter::Key::Scene, 1, add_slice_info), 0);
+    add_slice_info.scene_index = 3;
+    EXPECT_EQ(FanOutSlicesWriter::GetPartIndex(FanOutSlicesWriter::Key::Scene, 1, add_slice_info), 3);
+}
+
+TEST(FanOutSlicesWriter, CreateFilenameOfPart)
+{
+    EXPECT_EQ(FanOutSlicesWriter::CreateFilenameOfPart(L"/data/output.czi", FanOutSlicesWriter::Key::Channel, 1, 1), L"/data/output_C1.czi");
+    EXPECT_EQ(FanOutSlicesWriter::CreateFilenameOfPart(L"/data/output.czi", FanOutSlicesWriter::Key::Scene, 1, 2), L"/data/output_S2.czi");
+    EXPECT_EQ(FanOutSlicesWriter::CreateFilenameOfPart(L"/data/output.czi", FanOutSlicesWriter::Key::TRange, 1, 5), L"/data/output_T5.czi");
+    EXPECT_EQ(FanOutSlicesWriter::CreateFilenameOfPart(L"/data/output.czi", FanOutSlicesWriter::Key::TRange, 10, 1), L"/data/output_T10-19.czi");
+
+    // a dot in a directory name is not taken as the start of the extension
+    EXPECT_EQ(FanOutSlicesWriter::CreateFilenameOfPart(L"C:\\my.data\\output", FanOutSlicesWriter::Key::Channel, 1, 0), L"C:\\my.data\\output_C0");
+}
+
+TEST(FanOutSlicesWriter, AdjustCoordinateForPart)
+{
+    int c_index, t_index, s_index;
+    ICziSlicesWriter::AddSliceInfo add_slice_info;
+    add_slice_info.coordinate = CDimCoordinate::Parse("C2T25Z7");
+    FanOutSlicesWriter::AdjustCoordinateForPart(FanOutSlicesWriter::Key::Channel, 1, 2, add_slice_info);
+    ASSERT_TRUE(add_slice_info.coordinate.TryGetPosition(DimensionIndex::C, &c_index));
+    EXPECT_EQ(c_index, 0);
+    ASSERT_TRUE(add_slice_info.coordinate.TryGetPosition(DimensionIndex::T, &t_index));
+    EXPECT_EQ(t_index, 25);
+
+    add_slice_info.coordinate = CDimCoordinate::Parse("C2T25Z7");
+    FanOutSlicesWriter::AdjustCoordinateForPart(FanOutSlicesWriter::Key::TRange, 10, 2, add_slice_info);
+    ASSERT_TRUE(add_slice_info.coordinate.TryGetPosition(DimensionIndex::C, &c_index));
+    EXPECT_EQ(c_index, 2);
+    ASSERT_TRUE(add_slice_info.coordinate.TryGetPosition(DimensionIndex::T, &t_index));
+    EXPECT_EQ(t_index, 5);
+
+    add_slice_info.coordinate = CDimCoordinate::Parse("C2S3");
+    add_slice_info.scene_index = 3;
+    FanOutSlicesWriter::AdjustCoordinateForPart(FanOutSlicesWriter::Key::Scene, 1, 3, add_slice_info);
+    ASSERT_TRUE(add_slice_info.coordinate.TryGetPosition(DimensionIndex::C, &c_index));
+    EXPECT_EQ(c_index, 2);
+    ASSERT_TRUE(add_slice_info.coordinate.TryGetPosition(DimensionIndex::S, &s_index));
+    EXPECT_EQ(s_index, 0);
+    ASSERT_TRUE(add_slice_info.scene_index.has_value());
+    EXPECT_EQ(add_slice_info.scene_index.value(), 0);
+}
+
+TEST(FanOutSlicesWriter, WriteTwoChannels_EachPartHasOneChannelWithItsMetadata)
+{
+    const auto output_filename = filesystem::temp_directory_path() / "warpaffine_fan_out_test.czi";
+    AppContext context;
+    InitializeAppContext(context, output_filename, "fan_out=C");
+
+    vector<shared_ptr<IMemoryBlock>> data;
+    {
+        FanOutSlicesWriter writer(context, output_filename.wstring());
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int z = 0; z < 3; ++z)
+            {
+                data.push_back(make_shared<TestMemoryBlock>(16));
+                const string coordinate = "C" + to_string(c) + "Z" + to_string(z);
+                ASSERT_TRUE(writer.TryAddSlice(CreateAddSliceInfo(data.back(), coordinate.c_str()), nullptr));
+            }
+        }
+
+        writer.Close(CreateMetadataWithTwoChannels(), nullptr, nullptr, nullptr);
+
+        // the data of all slices has been released (through the deleter installed by the fan-out writer), and the
+        //  admission is back to zero
+        EXPECT_EQ(writer.GetNumberOfPendingSliceWriteOperations(), 0u);
+        EXPECT_EQ(writer.GetSizeOfPendingSliceWriteOperations(), 0u);
+        for (const auto& item : data)
+        {
+            EXPECT_EQ(item.use_count(), 1);
+        }
+    }
+
+    const wchar_t* expected_channel_names[] = { L"first", L"second" };
+    for (int c = 0; c < 2; ++c)
+    {
+        const auto filename_of_part = FanOutSlicesWriter::CreateFilenameOfPart(output_filename.wstring(), FanOutSlicesWriter::Key::Channel, 1, c);
+        {
+            const auto reader = CreateCZIReader();
+            reader->Open(CreateStreamFromFile(filename_of_part.c_str()));
+
+            // the C-index is renumbered (to zero) in each part
+            vector<int> z_indices;
+            reader->EnumerateSubBlocks(
+                [&](int, const SubBlockInfo& info)->bool
+                {
+                    int c_index = -1;
+                    int z_index = -1;
+                    EXPECT_TRUE(info.coordinate.TryGetPosition(DimensionIndex::C, &c_index));
+                    EXPECT_EQ(c_index, 0);
+                    EXPECT_TRUE(info.coordinate.TryGetPosition(DimensionIndex::Z, &z_index));
+                    z_indices.push_back(z_index);
+                    return true;
+                });
+            sort(z_indices.begin(), z_indices.end());
+            EXPECT_EQ(z_indices, (vector<int>{ 0, 1, 2 }));
+
+            // and the metadata describes only the channel in the part
+            const auto metadata_builder = CreateMetadataBuilderFromXml(reader->ReadMetadataSegment()->CreateMetaFromMetadataSegment()->GetXml());
+            const auto root_node = metadata_builder->GetRootNode();
+            wstring size_c;
+            ASSERT_TRUE(root_node->GetChildNode("Metadata/Information/Image/SizeC"));
+            root_node->GetChildNode("Metadata/Information/Image/SizeC")->TryGetValue(&size_c);
+            EXPECT_EQ(size_c, L"1");
+            EXPECT_EQ(
+                GetValuesOfChildren(root_node.get(), "Metadata/Information/Image/Dimensions/Channels", L"Channel", "Name"),
+                vector<wstring>{ expected_channel_names[c] });
+            EXPECT_EQ(
+                GetValuesOfChildren(root_node.get(), "Metadata/DisplaySetting/Channels", L"Channel", "ShortName"),
+                vector<wstring>{ expected_channel_names[c] });
+        }
+
+        filesystem::remove(filesystem::path(filename_of_part));
+    }
+}
+
+TEST(FanOutSlicesWriter, BudgetIsSharedByAllParts)
+{
+    const auto output_filename = filesystem::temp_directory_path() / "warpaffine_fan_out_budget_test.czi";
+    AppContext context;
+    InitializeAppContext(context, output_filename, "fan_out=C");
+    context.GetFlowControl().SetBudget(FlowControl::Stage::Write, 100);
+
+    {
+        FanOutSlicesWriter writer(context, output_filename.wstring());
+
+        // the first slice is held in the writer of the part C0 (until the gate is opened)...
+        promise<void> gate;
+        ASSERT_TRUE(writer.TryAddSlice(CreateAddSliceInfo(make_shared<TestMemoryBlock>(80, gate.get_future().share()), "C0"), nullptr));
+        EXPECT_EQ(writer.GetSizeOfPendingSliceWriteOperations(), 80u);
+
+        // ...so a slice for the part C1 does not fit into the budget, although the queue of this part is empty
+        promise<void> space_available;
+        const auto slice_for_c1 = CreateAddSliceInfo(make_shared<TestMemoryBlock>(80), "C1");
+        EXPECT_FALSE(writer.TryAddSlice(slice_for_c1, [&space_available]()->void {space_available.set_value(); }));
+
+        // once the first slice has been written, the functor is called and the slice is admitted
+        gate.set_value();
+        ASSERT_EQ(space_available.get_future().wait_for(chrono::seconds(10)), future_status::ready);
+        EXPECT_TRUE(writer.TryAddSlice(slice_for_c1, nullptr));
+
+        writer.Close(nullptr, nullptr, nullptr, nullptr);
+        EXPECT_EQ(writer.GetSizeOfPendingSliceWriteOperations(), 0u);
+    }
+
+    for (int c = 0; c < 2; ++c)
+    {
+        filesystem::remove(filesystem::path(FanOutSlicesWriter::CreateFilenameOfPart(output_filename.wstring(), FanOutSlicesWriter::Key::Channel, 1, c)));
+    }
+}
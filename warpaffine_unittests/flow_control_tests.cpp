@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/flow_control.h"
+
+#include <memory>
+
+using namespace std;
+
+TEST(FlowControl, TryAcquireRespectsBudgetAndCreditsAreReturned)
+{
+    FlowControl flow_control;
+    flow_control.SetBudget(FlowControl::Stage::Warp, 100);
+
+    auto credits1 = flow_control.TryAcquire(FlowControl::Stage::Warp, 60);
+    ASSERT_TRUE(credits1);
+    EXPECT_EQ(flow_control.GetOccupancy(FlowControl::Stage::Warp), 60);
+
+    auto credits2 = flow_control.TryAcquire(FlowControl::Stage::Warp, 60);
+    EXPECT_FALSE(credits2);
+    EXPECT_EQ(flow_control.GetOccupancy(FlowControl::Stage::Warp), 60);
+
+    credits1.reset();
+    EXPECT_EQ(flow_control.GetOccupancy(FlowControl::Stage::Warp), 0);
+
+    credits2 = flow_control.TryAcquire(FlowControl::Stage::Warp, 60);
+    EXPECT_TRUE(credits2);
+}
+
+TEST(FlowControl, RequestLargerThanBudgetIsGrantedIfStageIsEmpty)
+{
+    FlowControl flow_control;
+    flow_control.SetBudget(FlowControl::Stage::Compose, 100);
+
+    auto credits1 = flow_control.TryAcquire(FlowControl::Stage::Compose, 1000);
+    ASSERT_TRUE(credits1);
+    auto credits2 = flow_control.TryAcquire(FlowControl::Stage::Compose, 1);
+    EXPECT_FALSE(credits2);
+}
+
+TEST(FlowControl, CreditsAreOnlyGrantedIfDownstreamHasCapacity)
+{
+    FlowControl flow_control;
+    flow_control.SetBudget(FlowControl::Stage::Warp, 100);
+    flow_control.SetBudget(FlowControl::Stage::Write, 10);
+
+    auto write_credits = flow_control.Register(FlowControl::Stage::Write, 20);
+    EXPECT_FALSE(flow_control.HasCapacity(FlowControl::Stage::Write));
+    EXPECT_FALSE(flow_control.TryAcquire(FlowControl::Stage::Warp, 1));
+
+    write_credits.reset();
+    EXPECT_TRUE(flow_control.TryAcquire(FlowControl::Stage::Warp, 1));
+}
+
+TEST(FlowControl, DecodeStageDoesNotExertBackPressure)
+{
+    FlowControl flow_control;
+    flow_control.SetBudget(FlowControl::Stage::Decode, 10);
+
+    auto decode_credits = flow_control.Register(FlowControl::Stage::Decode, 20);
+    EXPECT_FALSE(flow_control.HasCapacity(FlowControl::Stage::Decode));
+    EXPECT_TRUE(flow_control.HasDownstreamCapacity(FlowControl::Stage::Read));
+    EXPECT_TRUE(flow_control.TryAcquire(FlowControl::Stage::Read, 1));
+}
+
+TEST(FlowControl, TieCreditsToDataReturnsCreditsWhenDataIsReleased)
+{
+    FlowControl flow_control;
+    FlowControl::Stage released_stage = FlowControl::Stage::Max;
+    flow_control.AddCreditsReleasedCallback([&](FlowControl::Stage stage)->void { released_stage = stage; });
+
+    auto data = make_shared<int>(42);
+    auto tied = FlowControl::TieCreditsToData(data, flow_control.Register(FlowControl::Stage::Compress, 4));
+    EXPECT_EQ(tied.get(), data.get());
+    data.reset();
+    EXPECT_EQ(*static_cast<int*>(tied.get()), 42);
+    EXPECT_EQ(flow_control.GetOccupancy(FlowControl::Stage::Compress), 4);
+
+    tied.reset();
+    EXPECT_EQ(flow_control.GetOccupancy(FlowControl::Stage::Compress), 0);
+    EXPECT_EQ(released_stage, FlowControl::Stage::Compress);
+}
+
+TEST(FlowControl, CreditsReleasedCallbackIsNotCalledAfterItWasRemoved)
+{
+    FlowControl flow_control;
+    int number_of_calls = 0;
+    FlowControl::Stage stage_reported = FlowControl::Stage::Max;
+    const int handle = flow_control.AddCreditsReleasedCallback(
+        [&](FlowControl::Stage stage)->void
+        {
+            ++number_of_calls;
+            stage_reported = stage;
+        });
+
+    flow_control.TryAcquire(FlowControl::Stage::Write, 10).reset();
+    EXPECT_EQ(number_of_calls, 1);
+    EXPECT_EQ(stage_reported, FlowControl::Stage::Write);
+
+    EXPECT_TRUE(flow_control.RemoveCreditsReleasedCallback(handle));
+    EXPECT_FALSE(flow_control.RemoveCreditsReleasedCallback(handle));
+    flow_control.TryAcquire(FlowControl::Stage::Write, 10).reset();
+    EXPECT_EQ(number_of_calls, 1);
+}
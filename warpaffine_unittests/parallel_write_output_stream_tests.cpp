@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/sliceswriter/ParallelWriteOutputStream.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<uint8_t> ReadFile(const filesystem::path& path)
+    {
+        ifstream stream(path, ios::binary);
+        return vector<uint8_t>(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+    }
+}
+
+TEST(ParallelWriteOutputStream, CapturedWritesAreExecutedLater)
+{
+    const auto filename = filesystem::temp_directory_path() / "warpaffine_unittests_parallel_write_1.bin";
+    {
+        auto stream = make_unique<ParallelWriteOutputStream>(filename.wstring());
+        const uint8_t header[] = { 1, 2, 3, 4 };
+        stream->Write(0, header, sizeof(header), nullptr);
+
+        const vector<uint8_t> external_data = { 10, 11, 12, 13, 14, 15 };
+        ParallelWriteOutputStream::WriteBatch batch;
+        stream->BeginCapture(&batch, external_data.data(), external_data.size());
+        {
+            // this temporary buffer goes out of scope before the batch is executed, so it must have been copied
+            const uint8_t segment_header[] = { 5, 6 };
+            uint64_t bytes_written = 0;
+            stream->Write(4, segment_header, sizeof(segment_header), &bytes_written);
+            EXPECT_EQ(bytes_written, sizeof(segment_header));
+        }
+
+        stream->Write(6, external_data.data(), external_data.size(), nullptr);
+        stream->EndCapture();
+        EXPECT_EQ(batch.GetTotalSize(), 8);
+
+        // nothing captured has been written yet
+        EXPECT_EQ(filesystem::file_size(filename), 4);
+        stream->ExecuteBatch(batch);
+    }
+
+    EXPECT_EQ(ReadFile(filename), (vector<uint8_t>{ 1, 2, 3, 4, 5, 6, 10, 11, 12, 13, 14, 15 }));
+    filesystem::remove(filename);
+}
+
+TEST(ParallelWriteOutputStream, BatchesCanBeExecutedConcurrently)
+{
+    constexpr int kNumberOfThreads = 4;
+    constexpr int kBatchesPerThread = 50;
+    constexpr size_t kSizeOfBatch = 4096;
+    const auto filename = filesystem::temp_directory_path() / "warpaffine_unittests_parallel_write_2.bin";
+    {
+        ParallelWriteOutputStream stream(filename.wstring());
+
+        // the batches are captured in sequence (as done by the writer, under a lock)...
+        vector<vector<uint8_t>> data(kNumberOfThreads * kBatchesPerThread);
+        vector<ParallelWriteOutputStream::WriteBatch> batches(data.size());
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i].assign(kSizeOfBatch, static_cast<uint8_t>(i));
+            stream.BeginCapture(&batches[i], data[i].data(), data[i].size());
+            stream.Write(i * kSizeOfBatch, data[i].data(), data[i].size(), nullptr);
+            stream.EndCapture();
+        }
+
+        // ...and executed concurrently
+        vector<thread> threads;
+        for (int t = 0; t < kNumberOfThreads; ++t)
+        {
+            threads.emplace_back(
+                [&, t]()->void
+                {
+                    for (int i = t; i < kNumberOfThreads * kBatchesPerThread; i += kNumberOfThreads)
+                    {
+                        stream.ExecuteBatch(batches[i]);
+                    }
+                });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    const auto content = ReadFile(filename);
+    ASSERT_EQ(content.size(), kNumberOfThreads * kBatchesPerThread * kSizeOfBatch);
+    for (size_t i = 0; i < content.size(); ++i)
+    {
+        ASSERT_EQ(content[i], static_cast<uint8_t>(i / kSizeOfBatch)) << "at offset " << i;
+    }
+
+    filesystem::remove(filename);
+}
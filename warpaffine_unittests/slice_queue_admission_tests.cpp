@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/sliceswriter/SliceQueueAdmission.h"
+
+using namespace std;
+
+TEST(SliceQueueAdmission, SliceIsRejectedWhenOverBudget)
+{
+    SliceQueueAdmission admission;
+    EXPECT_TRUE(admission.TryAdmit(60, 100, nullptr));
+    EXPECT_TRUE(admission.TryAdmit(40, 100, nullptr));
+    EXPECT_FALSE(admission.TryAdmit(1, 100, nullptr));
+    EXPECT_EQ(admission.GetNumberOfSlicesAdmitted(), 2);
+    EXPECT_EQ(admission.GetSizeOfSlicesAdmitted(), 100);
+
+    admission.Release(60);
+    EXPECT_TRUE(admission.TryAdmit(50, 100, nullptr));
+    EXPECT_FALSE(admission.TryAdmit(11, 100, nullptr));
+    EXPECT_EQ(admission.GetNumberOfSlicesAdmitted(), 2);
+    EXPECT_EQ(admission.GetSizeOfSlicesAdmitted(), 90);
+}
+
+TEST(SliceQueueAdmission, OversizedSliceIsAdmittedIntoEmptyQueue)
+{
+    SliceQueueAdmission admission;
+    EXPECT_TRUE(admission.TryAdmit(1000, 100, nullptr));
+    EXPECT_EQ(admission.GetSizeOfSlicesAdmitted(), 1000);
+
+    // ...but only if the queue is empty
+    EXPECT_FALSE(admission.TryAdmit(1000, 100, nullptr));
+    admission.Release(1000);
+    EXPECT_EQ(admission.GetNumberOfSlicesAdmitted(), 0);
+    EXPECT_EQ(admission.GetSizeOfSlicesAdmitted(), 0);
+    EXPECT_TRUE(admission.TryAdmit(1000, 100, nullptr));
+}
+
+TEST(SliceQueueAdmission, FunctorsAreCalledOnceWhenSpaceIsReleased)
+{
+    SliceQueueAdmission admission;
+    ASSERT_TRUE(admission.TryAdmit(100, 100, nullptr));
+    ASSERT_TRUE(admission.TryAdmit(0, 100, nullptr));
+
+    int number_of_calls_1 = 0;
+    int number_of_calls_2 = 0;
+    EXPECT_FALSE(admission.TryAdmit(10, 100, [&]() { ++number_of_calls_1; }));
+    EXPECT_FALSE(admission.TryAdmit(20, 100, [&]() { ++number_of_calls_2; }));
+    EXPECT_EQ(number_of_calls_1, 0);
+    EXPECT_EQ(number_of_calls_2, 0);
+
+    admission.Release(100);
+    EXPECT_EQ(number_of_calls_1, 1);
+    EXPECT_EQ(number_of_calls_2, 1);
+
+    // the functors are removed once they have been called
+    admission.Release(0);
+    EXPECT_EQ(number_of_calls_1, 1);
+    EXPECT_EQ(number_of_calls_2, 1);
+}
+
+TEST(SliceQueueAdmission, FunctorCanRetryToAdmitTheSlice)
+{
+    SliceQueueAdmission admission;
+    ASSERT_TRUE(admission.TryAdmit(80, 100, nullptr));
+
+    // this is what the caller usually does: retry in the functor (which is called outside of the lock)
+    bool admitted_in_functor = false;
+    EXPECT_FALSE(admission.TryAdmit(50, 100, [&]() { admitted_in_functor = admission.TryAdmit(50, 100, nullptr); }));
+    admission.Release(80);
+    EXPECT_TRUE(admitted_in_functor);
+    EXPECT_EQ(admission.GetNumberOfSlicesAdmitted(), 1);
+    EXPECT_EQ(admission.GetSizeOfSlicesAdmitted(), 50);
+}
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/sliceswriter/SlicesWriterTbb.h"
+#include "mem_output_stream.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace libCZI;
+
+namespace
+{
+    /// Offset of the field "SubBlockDirectoryPosition" in the CZI-file (i.e. in the file-header segment).
+    constexpr size_t kOffsetOfSubBlockDirectoryPositionInFileHeader = 32 + 4 * 4 + 2 * 16 + 4;
+
+    /// Size of the segment-header (which consists of the segment-ID, the allocated size and the used size).
+    constexpr size_t kSizeOfSegmentHeader = 32;
+
+    template <typename t>
+    t ReadLittleEndian(const uint8_t* data, size_t offset)
+    {
+        t value;
+        memcpy(&value, data + offset, sizeof(value));
+        return value;
+    }
+}
+
+TEST(CziSlicesWriterTbb, CalculateReservedSizeForSubBlockDirectory_SubBlockDirectoryWrittenByLibCziFitsIntoReservedSize)
+{
+    // we write subblocks with the same dimensions as the slices-writer does (Z, C, T, S and the M-index), and check
+    //  that the subblock-directory as written by libCZI does not exceed the size we reserve for it
+    constexpr uint32_t kNumberOfSubblocks = 50;
+    const uint32_t reserved_size = CziSlicesWriterTbb::CalculateReservedSizeForSubBlockDirectory(kNumberOfSubblocks);
+    ASSERT_GT(reserved_size, 0u);
+
+    auto writer = CreateCZIWriter();
+    auto out_stream = make_shared<CMemOutputStream>(0);
+    auto writer_info = make_shared<CCziWriterInfo>(libCZI::GUID{ 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } });
+    writer_info->SetReservedSizeForSubBlockDirectory(true, reserved_size);
+    writer->Create(out_stream, writer_info);
+
+    const uint8_t pixel_data[4 * 4] = {};
+    for (uint32_t i = 0; i < kNumberOfSubblocks; ++i)
+    {
+        AddSubBlockInfoMemPtr add_subblock_info;
+        add_subblock_info.Clear();
+        add_subblock_info.coordinate = CDimCoordinate{ { DimensionIndex::Z, static_cast<int>(i) }, { DimensionIndex::C, 1 }, { DimensionIndex::T, 2 }, { DimensionIndex::S, 3 } };
+        add_subblock_info.mIndexValid = true;
+        add_subblock_info.mIndex = 4;
+        add_subblock_info.x = 0;
+        add_subblock_info.y = 0;
+        add_subblock_info.logicalWidth = 4;
+        add_subblock_info.logicalHeight = 4;
+        add_subblock_info.physicalWidth = 4;
+        add_subblock_info.physicalHeight = 4;
+        add_subblock_info.PixelType = PixelType::Gray8;
+        add_subblock_info.SetCompressionMode(CompressionMode::UnCompressed);
+        add_subblock_info.ptrData = pixel_data;
+        add_subblock_info.dataSize = sizeof(pixel_data);
+        writer->SyncAddSubBlock(add_subblock_info);
+    }
+
+    writer->Close();
+    writer.reset();
+
+    const auto* czi_data = reinterpret_cast<const uint8_t*>(out_stream->GetDataC());
+    const auto subblock_directory_position = ReadLittleEndian<int64_t>(czi_data, kOffsetOfSubBlockDirectoryPositionInFileHeader);
+    ASSERT_GT(subblock_directory_position, 0);
+    ASSERT_LE(static_cast<size_t>(subblock_directory_position) + kSizeOfSegmentHeader, out_stream->GetDataSize());
+    ASSERT_EQ(memcmp(czi_data + subblock_directory_position, "ZISRAWDIRECTORY", 15), 0);
+
+    // the used size is the size of the segment-data, i.e. the fixed part (of 128 bytes) and the entries
+    const auto used_size = ReadLittleEndian<int64_t>(czi_data, subblock_directory_position + 24);
+    const auto entry_count = ReadLittleEndian<int32_t>(czi_data, subblock_directory_position + kSizeOfSegmentHeader);
+    EXPECT_EQ(entry_count, static_cast<int32_t>(kNumberOfSubblocks));
+    EXPECT_LE(kSizeOfSegmentHeader + static_cast<uint64_t>(used_size), reserved_size);
+
+    // and the document can be read back with all the subblocks
+    int number_of_subblocks_read = 0;
+    auto reader = CreateCZIReader();
+    size_t size_of_czi_data;
+    reader->Open(CreateStreamFromMemory(out_stream->GetCopy(&size_of_czi_data), size_of_czi_data));
+    reader->EnumerateSubBlocks(
+        [&](int, const SubBlockInfo&)->bool
+        {
+            ++number_of_subblocks_read;
+            return true;
+        });
+    EXPECT_EQ(number_of_subblocks_read, static_cast<int>(kNumberOfSubblocks));
+}
+
+TEST(CziSlicesWriterTbb, CalculateReservedSizeForSubBlockDirectory_ZeroForUnknownOrTooManySubblocks)
+{
+    EXPECT_EQ(CziSlicesWriterTbb::CalculateReservedSizeForSubBlockDirectory(0), 0u);
+    EXPECT_EQ(CziSlicesWriterTbb::CalculateReservedSizeForSubBlockDirectory(numeric_limits<uint32_t>::max()), 0u);
+}
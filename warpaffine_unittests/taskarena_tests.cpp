@@ -0,0 +1,294 @@
+// SPDX-FileCopyrightText: 2023 Carl Zeiss Microscopy GmbH
+//
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+#include "../libwarpaffine/appcontext.h"
+#include "../libwarpaffine/taskarena/ITaskArena.h"
+#include "../libwarpaffine/taskarena/numa_topology.h"
+#include "../libwarpaffine/taskarena/taskarena_std.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    /// Runs a synthetic workload resembling the pipeline - every "warp"-task adds a number of "compress"-tasks, and
+    /// every n-th warp-task is suspended (and resumed from the thread calling this function).
+    ///
+    /// \param [in] task_arena                      The task arena.
+    /// \param      number_of_warp_tasks            The number of warp-tasks.
+    /// \param      compress_tasks_per_warp_task    The number of compress-tasks added by each warp-task.
+    /// \param      suspend_every_nth_task          Every n-th warp-task is suspended (0 means "none").
+    /// \param      work_per_task                   The number of iterations of a dummy-loop executed by each task.
+    ///
+    /// \returns    The number of compress-tasks which have been executed.
+    int RunSyntheticPipeline(ITaskArena* task_arena, int number_of_warp_tasks, int compress_tasks_per_warp_task, int suspend_every_nth_task, int work_per_task)
+    {
+        // the state is shared with the tasks (which may still be running if we return because of the timeout)
+        struct State
+        {
+            atomic_int compress_tasks_done{ 0 };
+            mutex mutex_handles;
+            vector<ITaskArena::SuspendHandle> handles;
+        };
+
+        const auto state = make_shared<State>();
+        const auto do_work = [work_per_task]()->void
+            {
+                volatile int dummy = 0;
+                for (int i = 0; i < work_per_task; ++i)
+                {
+                    dummy = dummy + i;
+                }
+            };
+
+        for (int i = 0; i < number_of_warp_tasks; ++i)
+        {
+            task_arena->AddTask(
+                TaskType::WarpAffineBrick,
+                [=]()->void
+                {
+                    if (suspend_every_nth_task > 0 && i % suspend_every_nth_task == 0)
+                    {
+                        task_arena->SuspendCurrentTask(
+                            [state](ITaskArena::SuspendHandle handle)->void
+                            {
+                                lock_guard<mutex> lck(state->mutex_handles);
+                                state->handles.push_back(handle);
+                            });
+                    }
+
+                    do_work();
+                    for (int j = 0; j < compress_tasks_per_warp_task; ++j)
+                    {
+                        task_arena->AddTask(
+                            TaskType::CompressSlice,
+                            [state, do_work]()->void
+                            {
+                                do_work();
+                                ++state->compress_tasks_done;
+                            });
+                    }
+                });
+        }
+
+        const int expected_number_of_compress_tasks = number_of_warp_tasks * compress_tasks_per_warp_task;
+        const auto timeout = chrono::steady_clock::now() + chrono::seconds(60);
+        while (state->compress_tasks_done.load() < expected_number_of_compress_tasks && chrono::steady_clock::now() < timeout)
+        {
+            {
+                lock_guard<mutex> lck(state->mutex_handles);
+                for (const auto handle : state->handles)
+                {
+                    task_arena->ResumeTask(handle);
+                }
+
+                state->handles.clear();
+            }
+
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        return state->compress_tasks_done.load();
+    }
+}
+
+TEST(TaskArenaStd, AllTasksAreExecuted)
+{
+    AppContext context;
+    auto task_arena = CreateTaskArenaStd(context);
+    EXPECT_EQ(RunSyntheticPipeline(task_arena.get(), 200, 4, 0, 100), 800);
+
+    const auto statistics = task_arena->GetStatistics();
+    EXPECT_EQ(statistics.queue_length, 0);
+    EXPECT_EQ(statistics.suspended_tasks, 0);
+}
+
+TEST(TaskArenaStd, SuspendedTasksAreResumed)
+{
+    AppContext context;
+    auto task_arena = CreateTaskArenaStd(context);
+    EXPECT_EQ(RunSyntheticPipeline(task_arena.get(), 200, 2, 3, 100), 400);
+    EXPECT_EQ(task_arena->GetStatistics().suspended_tasks, 0);
+}
+
+TEST(TaskArenaStd, TaskCanBeResumedFromWithinSuspendCallback)
+{
+    // the state used by the tasks is declared before the arena, so that it outlives the arena's worker threads
+    atomic_bool done{ false };
+    AppContext context;
+    auto task_arena = CreateTaskArenaStd(context);
+    task_arena->AddTask(
+        TaskType::WarpAffineBrick,
+        [&]()->void
+        {
+            task_arena->SuspendCurrentTask(
+                [&](ITaskArena::SuspendHandle handle)->void
+                {
+                    task_arena->ResumeTask(handle);
+                });
+            done = true;
+        });
+
+    const auto timeout = chrono::steady_clock::now() + chrono::seconds(10);
+    while (!done.load() && chrono::steady_clock::now() < timeout)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    EXPECT_TRUE(done.load());
+}
+
+TEST(TaskArenaStd, MoreTasksThanMaxNumberOfWorkersCanBeSuspended)
+{
+    // Every task adds a task (of the same arena) which resumes it, and then suspends itself. With the maximum number of
+    //  workers being the concurrency, no worker can be activated in order to compensate for a suspended task - so the
+    //  suspended tasks' threads must execute the queued tasks themselves (otherwise, this would hang).
+    // the state used by the tasks is declared before the arena, so that it outlives the arena's worker threads
+    atomic_int tasks_done{ 0 };
+    AppContext context;
+    TaskArenaStd task_arena(context, 1);
+    const uint32_t max_number_of_workers = task_arena.GetConcurrency();
+    const int number_of_tasks = static_cast<int>(4 * max_number_of_workers + 10);
+    for (int i = 0; i < number_of_tasks; ++i)
+    {
+        task_arena.AddTask(
+            TaskType::CompressSlice,
+            [&]()->void
+            {
+                task_arena.SuspendCurrentTask(
+                    [&](ITaskArena::SuspendHandle handle)->void
+                    {
+                        task_arena.AddTask(TaskType::Compression, [&task_arena, handle]()->void { task_arena.ResumeTask(handle); });
+                    });
+                ++tasks_done;
+            });
+    }
+
+    const auto timeout = chrono::steady_clock::now() + chrono::seconds(60);
+    while (tasks_done.load() < number_of_tasks && chrono::steady_clock::now() < timeout)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(tasks_done.load(), number_of_tasks);
+    EXPECT_LE(task_arena.GetNumberOfWorkers(), max_number_of_workers);
+    EXPECT_EQ(task_arena.GetStatistics().suspended_tasks, 0u);
+}
+
+TEST(TaskArenaStd, TasksWithLocalityKeyAreExecutedAndUtilizationIsReported)
+{
+    // the state used by the tasks is declared before the arena, so that it outlives the arena's worker threads
+    atomic_int tasks_done{ 0 };
+    AppContext context;
+    auto task_arena = CreateTaskArenaStd(context);
+    for (uint64_t i = 1; i <= 1000; ++i)
+    {
+        task_arena->AddTask(
+            TaskType::BrickComposition,
+            i,
+            [&]()->void
+            {
+                // a task without locality key added from within a task stays on the node
+                task_arena->AddTask(TaskType::CompressSlice, [&]()->void { ++tasks_done; });
+            });
+    }
+
+    const auto timeout = chrono::steady_clock::now() + chrono::seconds(60);
+    while (tasks_done.load() < 1000 && chrono::steady_clock::now() < timeout)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(tasks_done.load(), 1000);
+    const auto statistics = task_arena->GetStatistics();
+    ASSERT_FALSE(statistics.numa_node_utilization.empty());
+    for (const auto utilization : statistics.numa_node_utilization)
+    {
+        EXPECT_GE(utilization, 0.f);
+        EXPECT_LE(utilization, 100.f);
+    }
+}
+
+TEST(TaskArenaStd, LocalityKeyIsMappedToNodeDeterministically)
+{
+    set<uint32_t> nodes_used;
+    for (uint64_t key = 1; key <= 100; ++key)
+    {
+        const auto node_index = TaskArenaStd::GetNodeIndexForLocalityKey(key, 4);
+        EXPECT_LT(node_index, 4u);
+        EXPECT_EQ(node_index, TaskArenaStd::GetNodeIndexForLocalityKey(key, 4));
+        nodes_used.insert(node_index);
+
+        // keys which are addresses (i.e. multiples of the alignment) must be distributed as well
+        nodes_used.insert(TaskArenaStd::GetNodeIndexForLocalityKey(key * 64, 4));
+    }
+
+    EXPECT_EQ(nodes_used.size(), 4u);
+}
+
+TEST(NumaTopology, ParseNumberList)
+{
+    vector<uint32_t> numbers;
+    EXPECT_TRUE(NumaTopology::TryParseNumberList("0-3,8-9,12\n", numbers));
+    EXPECT_EQ(numbers, (vector<uint32_t>{ 0, 1, 2, 3, 8, 9, 12 }));
+    EXPECT_TRUE(NumaTopology::TryParseNumberList("5", numbers));
+    EXPECT_EQ(numbers, (vector<uint32_t>{ 5 }));
+    EXPECT_TRUE(NumaTopology::TryParseNumberList("", numbers));
+    EXPECT_TRUE(numbers.empty());
+    EXPECT_FALSE(NumaTopology::TryParseNumberList("3-1", numbers));
+    EXPECT_FALSE(NumaTopology::TryParseNumberList("a,b", numbers));
+    EXPECT_FALSE(NumaTopology::TryParseNumberList("1-x", numbers));
+}
+
+// This is a benchmark comparing the task-arena implementations, it is not run by default - use
+//  "--gtest_also_run_disabled_tests --gtest_filter=TaskArena.DISABLED_*" to run it. The elapsed times (in milliseconds)
+//  are reported as test-properties (e.g. in the XML-output with "--gtest_output=xml").
+TEST(TaskArena, DISABLED_BenchmarkTbbVersusStd)
+{
+    struct Configuration
+    {
+        const char* name;
+        int number_of_warp_tasks;
+        int compress_tasks_per_warp_task;
+        int suspend_every_nth_task;
+        int work_per_task;
+    };
+
+    static const Configuration configurations[] =
+    {
+        { "many_small_tasks", 20000, 8, 0, 100 },
+        { "few_large_tasks", 200, 8, 0, 1000000 },
+        { "small_tasks_with_suspension", 20000, 8, 10, 100 },
+    };
+
+    for (const auto& configuration : configurations)
+    {
+        for (const auto implementation : { TaskArenaImplementation::kTBB, TaskArenaImplementation::kStd })
+        {
+            AppContext context;
+            auto task_arena = implementation == TaskArenaImplementation::kTBB ? CreateTaskArenaTbb(context) : CreateTaskArenaStd(context);
+            const auto start = chrono::steady_clock::now();
+            const int tasks_done = RunSyntheticPipeline(
+                task_arena.get(),
+                configuration.number_of_warp_tasks,
+                configuration.compress_tasks_per_warp_task,
+                configuration.suspend_every_nth_task,
+                configuration.work_per_task);
+            const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+            EXPECT_EQ(tasks_done, configuration.number_of_warp_tasks * configuration.compress_tasks_per_warp_task);
+            RecordProperty(
+                string(configuration.name) + (implementation == TaskArenaImplementation::kTBB ? "_tbb_ms" : "_std_ms"),
+                static_cast<int>(elapsed.count()));
+        }
+    }
+}
@@ -6,7 +6,12 @@
 #include <warpafine_unittests_config.h>
 #include "../libwarpaffine/utilities.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
 
 TEST(Utilities, CopyBitmapAtOffsetAndClearNonCoveredArea_Case1_Gray8)
 {
@@ -435,3 +440,108 @@ TEST(Utilities, CopyBitmapAtOffsetAndClearNonCoveredArea_Case6_Gray16)
 
     EXPECT_EQ(memcmp(expected_result, destination, 3 * 3 * sizeof(uint16_t)), 0);
 }
+
+TEST(Utilities, CopyBitmapAtOffsetAndClearNonCoveredArea_LargeBitmap_Gray16)
+{
+    // the source is large enough so that the copy is done with the "large copy" code path (if available), and the
+    //  destination stride and offset are chosen so that the lines in the destination are not aligned
+    constexpr int kSourceWidth = 1031;
+    constexpr int kSourceHeight = 517;
+    constexpr int kDestinationWidth = kSourceWidth + 3;
+    constexpr int kDestinationHeight = kSourceHeight + 2;
+    constexpr uint32_t kDestinationStride = kDestinationWidth * sizeof(uint16_t) + 6;
+
+    std::vector<uint16_t> source(static_cast<size_t>(kSourceWidth) * kSourceHeight);
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        source[i] = static_cast<uint16_t>(1 + i % 65521);
+    }
+
+    std::vector<uint8_t> destination(static_cast<size_t>(kDestinationStride) * kDestinationHeight, 42);
+
+    Utilities::CopyAtOffsetInfo info =
+    {
+        1,
+        1,
+        libCZI::PixelType::Gray16,
+        source.data(),
+        kSourceWidth * sizeof(uint16_t),
+        kSourceWidth,
+        kSourceHeight,
+        destination.data(),
+        kDestinationStride,
+        kDestinationWidth,
+        kDestinationHeight
+    };
+
+    Utilities::CopyBitmapAtOffsetAndClearNonCoveredArea(info);
+
+    bool is_as_expected = true;
+    for (int y = 0; y < kDestinationHeight && is_as_expected; ++y)
+    {
+        for (int x = 0; x < kDestinationWidth; ++x)
+        {
+            uint16_t value;
+            memcpy(&value, destination.data() + static_cast<size_t>(y) * kDestinationStride + x * sizeof(uint16_t), sizeof(uint16_t));
+            const bool is_inside_source = x >= 1 && x < 1 + kSourceWidth && y >= 1 && y < 1 + kSourceHeight;
+            const uint16_t expected_value = is_inside_source ? source[static_cast<size_t>(y - 1) * kSourceWidth + (x - 1)] : 0;
+            if (value != expected_value)
+            {
+                is_as_expected = false;
+                break;
+            }
+        }
+    }
+
+    EXPECT_TRUE(is_as_expected);
+}
+
+TEST(Utilities, ConditionNotifier_WaitIsWokenUpByNotify)
+{
+    ConditionNotifier notifier;
+    std::atomic_bool flag{ false };
+
+    std::thread thread(
+        [&]()->void
+        {
+            flag.store(true);
+            notifier.Notify();
+        });
+
+    notifier.Wait([&]()->bool { return flag.load(); });
+    thread.join();
+    EXPECT_TRUE(flag.load());
+}
+
+TEST(Utilities, ConditionNotifier_OnlyWaitersWhosePredicateIsTrueAreWokenUp)
+{
+    ConditionNotifier notifier;
+    std::atomic_bool flag_a{ false };
+    std::atomic_bool flag_b{ false };
+    std::atomic_bool waiter_b_returned{ false };
+
+    std::thread waiter_a([&]()->void { notifier.Wait([&]()->bool { return flag_a.load(); }); });
+    std::thread waiter_b(
+        [&]()->void
+        {
+            notifier.Wait([&]()->bool { return flag_b.load(); });
+            waiter_b_returned.store(true);
+        });
+
+    flag_a.store(true);
+    notifier.Notify();
+    waiter_a.join();
+    EXPECT_FALSE(waiter_b_returned.load());
+
+    flag_b.store(true);
+    notifier.Notify();
+    waiter_b.join();
+    EXPECT_TRUE(waiter_b_returned.load());
+}
+
+TEST(Utilities, ConditionNotifier_WaitForTimesOut)
+{
+    ConditionNotifier notifier;
+    EXPECT_FALSE(notifier.WaitFor([]()->bool { return false; }, std::chrono::milliseconds(10)));
+    EXPECT_TRUE(notifier.WaitFor([]()->bool { return true; }, std::chrono::milliseconds(10)));
+}
@@ -9,7 +9,9 @@
 #include "testutilities.h"
 
 #include <math.h>
+#include <cstring>
 #include <string>
+#include <vector>
 
 using namespace std;
 using namespace libCZI;
@@ -1088,3 +1090,103 @@ TEST(WarpAffine, SampleVolumeQuarterOfAPixelOffGray8IppBicubic)
     const void* result_data = destination_brick.data.get();
     EXPECT_EQ(memcmp(expected_result_data, destination_brick.data.get(), sizeof(expected_result_data)), 0);
 }
+
+// ----------------------------------------------------------------------------
+
+static Brick CreateSourceBrickForAllZeroSlicesTest()
+{
+    static const uint8_t source_data[2 * 2 * 2] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    Brick source_brick = TestUtilities::CreateBrick(PixelType::Gray8, 2, 2, 2);
+    CopyIntoBrick(source_brick, source_data);
+    return source_brick;
+}
+
+static bool IsSliceAllZero(const Brick& brick, uint32_t z)
+{
+    for (uint32_t y = 0; y < brick.info.height; ++y)
+    {
+        for (uint32_t x = 0; x < brick.info.width; ++x)
+        {
+            if (*static_cast<const uint8_t*>(brick.GetConstPointerToPixel(x, y, z)) != 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+TEST(WarpAffine, FastNearestNeighbor_ReportsSlicesOutsideOfSourceAsAllZero)
+{
+    // with the identity transformation, the slices z=2...4 of the destination brick are outside of the source brick
+    Eigen::Matrix4d transformation_matrix = Eigen::Matrix4d::Identity();
+    const Brick source_brick = CreateSourceBrickForAllZeroSlicesTest();
+    const Brick destination_brick = TestUtilities::CreateBrick(PixelType::Gray8, 2, 2, 5);
+    memset(destination_brick.data.get(), 0xff, static_cast<size_t>(destination_brick.info.stride_plane) * destination_brick.info.depth);
+
+    const auto warp_affine = CreateWarpAffine(WarpAffineImplementation::kFast);
+    vector<bool> is_slice_all_zero;
+    warp_affine->ExecuteAndReportAllZeroSlices(
+        transformation_matrix,
+        IntPos3{ 0, 0, 0 },
+        Interpolation::kNearestNeighbor,
+        source_brick,
+        destination_brick,
+        is_slice_all_zero);
+
+    ASSERT_EQ(is_slice_all_zero.size(), 5);
+    EXPECT_FALSE(is_slice_all_zero[0]);
+    EXPECT_FALSE(is_slice_all_zero[1]);
+    for (uint32_t z = 2; z < 5; ++z)
+    {
+        EXPECT_TRUE(is_slice_all_zero[z]);
+        EXPECT_TRUE(IsSliceAllZero(destination_brick, z));
+    }
+}
+
+TEST(WarpAffine, FastLinearInterpolation_ReportsSlicesOutsideOfSourceAsAllZero)
+{
+    // the destination brick is placed far away from the source brick, so all its slices are outside
+    Eigen::Matrix4d transformation_matrix = Eigen::Matrix4d::Identity();
+    const Brick source_brick = CreateSourceBrickForAllZeroSlicesTest();
+    const Brick destination_brick = TestUtilities::CreateBrick(PixelType::Gray8, 2, 2, 3);
+    memset(destination_brick.data.get(), 0xff, static_cast<size_t>(destination_brick.info.stride_plane) * destination_brick.info.depth);
+
+    const auto warp_affine = CreateWarpAffine(WarpAffineImplementation::kFast);
+    vector<bool> is_slice_all_zero;
+    warp_affine->ExecuteAndReportAllZeroSlices(
+        transformation_matrix,
+        IntPos3{ 10, 0, 0 },
+        Interpolation::kBilinear,
+        source_brick,
+        destination_brick,
+        is_slice_all_zero);
+
+    ASSERT_EQ(is_slice_all_zero.size(), 3);
+    for (uint32_t z = 0; z < 3; ++z)
+    {
+        EXPECT_TRUE(is_slice_all_zero[z]);
+        EXPECT_TRUE(IsSliceAllZero(destination_brick, z));
+    }
+}
+
+TEST(WarpAffine, Reference_ReportsNoSliceAsAllZero)
+{
+    // the reference implementation does not know about "all zero" slices, so it reports "false" for all slices
+    Eigen::Matrix4d transformation_matrix = Eigen::Matrix4d::Identity();
+    const Brick source_brick = CreateSourceBrickForAllZeroSlicesTest();
+    const Brick destination_brick = TestUtilities::CreateBrick(PixelType::Gray8, 2, 2, 5);
+
+    const auto warp_affine = CreateWarpAffine(WarpAffineImplementation::kReference);
+    vector<bool> is_slice_all_zero;
+    warp_affine->ExecuteAndReportAllZeroSlices(
+        transformation_matrix,
+        IntPos3{ 0, 0, 0 },
+        Interpolation::kNearestNeighbor,
+        source_brick,
+        destination_brick,
+        is_slice_all_zero);
+
+    EXPECT_EQ(is_slice_all_zero, vector<bool>(5, false));
+}